@@ -172,7 +172,7 @@ struct iCelHNavStruct : public virtual iBase
  */
 struct iCelHNavStructBuilder : public virtual iBase
 {
-  SCF_INTERFACE (iCelHNavStructBuilder, 1, 0, 0);
+  SCF_INTERFACE (iCelHNavStructBuilder, 1, 2, 0);
 
   /**
    * Set the Sectors used to build the navigation structure.
@@ -208,6 +208,24 @@ struct iCelHNavStructBuilder : public virtual iBase
    * \remarks Should be called before iCelHNavStructBuilder::SetSectors().
    */
   virtual void SetNavMeshParams (const iCelNavMeshParams* parameters) = 0;
+
+  /**
+   * Set the number of threads used to build the tiles of each navigation mesh.
+   * \param threads Number of threads, 0 uses one thread for each processor.
+   */
+  virtual void SetBuildThreads (int threads) = 0;
+
+  /**
+   * Set a directory keeping built tiles, so only tiles whose input geometry
+   * changed are built again. See iCelNavMeshBuilder::SetTileCache().
+   */
+  virtual void SetTileCache (iVFS* vfs, const char* directory, bool reuse = true) = 0;
+
+  /**
+   * Set the memory available to the tiles of each navigation mesh loaded
+   * afterwards. See iCelNavMeshBuilder::SetTileBudget().
+   */
+  virtual void SetTileBudget (size_t bytes) = 0;
 };
 
 #endif // __CEL_HPFAPI__
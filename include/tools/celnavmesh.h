@@ -31,6 +31,7 @@ class csVector3;
 struct csSimpleRenderMesh;
 struct iFile;
 struct iSector;
+struct iVFS;
 
 
 
@@ -268,7 +269,7 @@ struct iCelNavMesh : public virtual iBase
  */
 struct iCelNavMeshBuilder : public virtual iBase
 {
-  SCF_INTERFACE (iCelNavMeshBuilder, 1, 0, 0);
+  SCF_INTERFACE (iCelNavMeshBuilder, 1, 2, 0);
 
   /**
    * Set an iSector as the current working sector and loads it's triangles.
@@ -307,6 +308,32 @@ struct iCelNavMeshBuilder : public virtual iBase
   virtual void SetNavMeshParams (const iCelNavMeshParams* parameters) = 0;
 
   virtual iSector* GetSector () const = 0;
+
+  /**
+   * Set the number of threads used to build the tiles of a navigation mesh.
+   * \param threads Number of threads, 0 uses one thread for each processor.
+   */
+  virtual void SetBuildThreads (int threads) = 0;
+
+  /**
+   * Set a directory keeping built tiles by a hash of their input geometry and
+   * parameters. Tiles whose input did not change since they were stored are
+   * loaded from there instead of built again. Each sector has a subdirectory,
+   * a build removes the tiles of its sector it didn't use.
+   * \param vfs Pointer to the virtual file system, 0 disables the cache.
+   * \param directory Directory name (vfs path).
+   * \param reuse If false all tiles are built, the cache is only written.
+   */
+  virtual void SetTileCache (iVFS* vfs, const char* directory, bool reuse = true) = 0;
+
+  /**
+   * Set the memory available to the tiles of each navigation mesh loaded from
+   * a file. Tiles are attached when a query first needs them, and the least
+   * recently used ones are dropped again when their size exceeds the budget.
+   * \param bytes Budget for each navigation mesh, 0 keeps all attached tiles.
+   * \remarks Only affects navigation meshes loaded afterwards.
+   */
+  virtual void SetTileBudget (size_t bytes) = 0;
  
 };
 
@@ -100,6 +100,9 @@ psCelClient* GEMClientObject::cel = NULL;
 psCelClient::psCelClient()
 {
     instantiateItems = false;
+    entityBudget = 5;
+    receivedHead = 0;
+    pendingSerial = 0;
 
     requeststatus = 0;
 
@@ -136,6 +139,15 @@ psCelClient::~psCelClient()
     entities.DeleteAll();
     entities_hash.DeleteAll();
 
+    for(size_t i = receivedHead; i < receivedEntities.GetSize(); i++)
+    {
+        delete receivedEntities[i];
+    }
+    while(parsedEntities.Length())
+    {
+        delete parsedEntities.DeleteMin();
+    }
+
     // Delete effectItems
     csHash<ItemEffect*, csString>::GlobalIterator i = effectItems.GetIterator();
     while (i.HasNext())
@@ -189,6 +201,7 @@ bool psCelClient::Initialize(iObjectRegistry* object_reg, MsgHandler* newmsghand
     unresSector = psengine->GetEngine()->CreateSector("SectorWhereWeKeepEntitiesResidingInUnloadedMaps");
 
     instantiateItems = psengine->GetConfig()->GetBool("PlaneShift.Items.Instantiate", false);
+    entityBudget = psengine->GetConfig()->GetInt("PlaneShift.Loading.EntityBudget", 5);
 
     LoadEffectItems();
 
@@ -249,17 +262,30 @@ void psCelClient::RequestActor()
     msghandler->SendMessage(mesg.msg);
 }
 
-void psCelClient::HandleActor(MsgEntry* me)
+bool psCelClient::CanHandleActor()
 {
     // Check for loading errors first
     if(psengine->LoadingError() || !GetClientDR()->GetMsgStrings())
     {
         Error1("Ignoring Actor message.  LoadingError or missing strings table!");
         psengine->FatalError("Cannot load main actor. Error during loading.");
+        return false;
+    }
+    return true;
+}
+
+void psCelClient::HandleActor(MsgEntry* me)
+{
+    if(!CanHandleActor())
+    {
         return;
     }
     psPersistActor msg(me, psengine->GetNetManager()->GetConnection()->GetAccessPointers());
+    CreateActor(msg);
+}
 
+void psCelClient::CreateActor(psPersistActor &msg)
+{
     GEMClientActor* actor = new GEMClientActor(this, msg);
 
     // Extra steps for a controlled actor/the main player:
@@ -281,10 +307,129 @@ void psCelClient::HandleActor(MsgEntry* me)
 void psCelClient::HandleItem(MsgEntry* me)
 {
     psPersistItem msg(me, psengine->GetNetManager()->GetConnection()->GetAccessPointers());
+    CreateItem(msg);
+}
+
+void psCelClient::CreateItem(psPersistItem &msg)
+{
     GEMClientItem* item = new GEMClientItem(this, msg);
     AddEntity(item);
 }
 
+psCelClient::PendingEntity::PendingEntity()
+    : isActor(false), actor(NULL), item(NULL), distance(FLT_MAX), serial(0), dropped(false)
+{
+}
+
+psCelClient::PendingEntity::~PendingEntity()
+{
+    delete actor;
+    delete item;
+}
+
+void psCelClient::QueueEntity(MsgEntry* me, bool isActor)
+{
+    PendingEntity* pending = new PendingEntity;
+    pending->message = me;
+    pending->isActor = isActor;
+    pending->eid = EID(isActor ? psPersistActor::PeekEID(me) : psPersistItem::PeekEID(me));
+    pending->serial = pendingSerial++;
+
+    // The server sent the entity again, only the latest one counts.
+    RemovePendingEntity(pending->eid);
+    pendingByEID.Put(pending->eid, pending);
+    receivedEntities.Push(pending);
+}
+
+void psCelClient::ParseNextEntity(const csVector3 &viewPos, const csString &viewSector)
+{
+    PendingEntity* pending = receivedEntities[receivedHead++];
+    if(receivedHead == receivedEntities.GetSize())
+    {
+        receivedEntities.Empty();
+        receivedHead = 0;
+    }
+
+    if(pending->dropped || (pending->isActor && !CanHandleActor()))
+    {
+        pendingByEID.Delete(pending->eid, pending);
+        delete pending;
+        return;
+    }
+
+    NetBase::AccessPointers* accessPointers = psengine->GetNetManager()->GetConnection()->GetAccessPointers();
+    if(pending->isActor)
+    {
+        pending->actor = new psPersistActor(pending->message, accessPointers);
+        pending->pos = pending->actor->pos;
+        pending->sectorName = pending->actor->sectorName;
+        pending->factory = psengine->GetLoader()->LoadFactory(pending->actor->factname);
+    }
+    else
+    {
+        pending->item = new psPersistItem(pending->message, accessPointers);
+        pending->pos = pending->item->pos;
+        pending->sectorName = pending->item->sector;
+        pending->factory = psengine->GetLoader()->LoadFactory(pending->item->factname);
+    }
+    pending->message.Invalidate();
+
+    // Entities in other sectors come last, in the order they were received.
+    if(pending->sectorName == viewSector)
+    {
+        pending->distance = (pending->pos - viewPos).SquaredNorm();
+    }
+    parsedEntities.Insert(pending);
+}
+
+bool psCelClient::CreateNearestEntity()
+{
+    PendingEntity* pending;
+    while((pending = parsedEntities.FindMin()) != NULL && pending->dropped)
+    {
+        delete parsedEntities.DeleteMin();
+    }
+
+    if(!pending || (pending->factory.IsValid() && !pending->factory->IsFinished()))
+    {
+        return false;
+    }
+
+    CreatePendingEntity(parsedEntities.DeleteMin());
+    return true;
+}
+
+void psCelClient::CreatePendingEntity(PendingEntity* pending)
+{
+    pendingByEID.Delete(pending->eid, pending);
+
+    if(pending->actor)
+    {
+        // The sector might have been loaded while the actor was queued.
+        if(!pending->actor->sector)
+        {
+            pending->actor->sector = psengine->GetEngine()->GetSectors()->FindByName(pending->actor->sectorName);
+        }
+        CreateActor(*pending->actor);
+    }
+    else
+    {
+        CreateItem(*pending->item);
+    }
+    delete pending;
+}
+
+void psCelClient::RemovePendingEntity(EID eid)
+{
+    // Dropped entries are deleted when they come up in their queue.
+    PendingEntity* pending = pendingByEID.Get(eid, NULL);
+    if(pending)
+    {
+        pending->dropped = true;
+        pendingByEID.Delete(eid, pending);
+    }
+}
+
 void psCelClient::HandleActionLocation(MsgEntry* me)
 {
     psPersistActionLocation msg(me);
@@ -325,7 +470,8 @@ void psCelClient::HandleObjectRemoval(MsgEntry* me)
 {
     psRemoveObject mesg(me);
 
-    ForceEntityQueues();
+    // An entity still waiting in the queue doesn't need to be created at all.
+    RemovePendingEntity(mesg.objectEID);
 
     GEMClientObject* entity = FindObject(mesg.objectEID);
 
@@ -728,34 +874,42 @@ void psCelClient::HandleMecsActivate(MsgEntry* me)
     }
 }
 
-void psCelClient::ForceEntityQueues()
+void psCelClient::CheckEntityQueues()
 {
-    while(!newActorQueue.IsEmpty())
+    if(receivedHead == receivedEntities.GetSize() && !parsedEntities.Length())
     {
-        csRef<MsgEntry> me = newActorQueue.Pop();
-        HandleActor(me);
+        return;
     }
-    if(!newItemQueue.IsEmpty())
+
+    csVector3 viewPos(0);
+    csString viewSector;
+    psCamera* camera = psengine->GetPSCamera();
+    if(camera && camera->GetICamera()->GetCamera()->GetSector())
     {
-        csRef<MsgEntry> me = newItemQueue.Pop();
-        HandleItem(me);
+        viewPos = camera->GetPosition();
+        viewSector = camera->GetICamera()->GetCamera()->GetSector()->QueryObject()->GetName();
     }
-}
-
-void psCelClient::CheckEntityQueues()
-{
-    if(newActorQueue.GetSize())
+    else if(local_player && local_player->GetSector())
     {
-        csRef<MsgEntry> me = newActorQueue.Pop();
-        HandleActor(me);
-        return;
+        viewPos = local_player->Pos();
+        viewSector = local_player->GetSector()->QueryObject()->GetName();
     }
-    if(newItemQueue.GetSize())
+
+    // Parse everything received first, so the factories load while the
+    // nearest entities are created.
+    csTicks start = csGetTicks();
+    do
     {
-        csRef<MsgEntry> me = newItemQueue.Pop();
-        HandleItem(me);
-        return;
+        if(receivedHead < receivedEntities.GetSize())
+        {
+            ParseNextEntity(viewPos, viewSector);
+        }
+        else if(!CreateNearestEntity())
+        {
+            break;
+        }
     }
+    while(csGetTicks() - start < entityBudget);
 }
 
 void psCelClient::Update(bool loaded)
@@ -848,14 +1002,14 @@ void psCelClient::HandleMessage(MsgEntry* me)
             }
             else
             {
-                newActorQueue.Push(me);
+                QueueEntity(me, true);
             }
             break;
         }
 
         case MSGTYPE_PERSIST_ITEM:
         {
-            newItemQueue.Push(me);
+            QueueEntity(me, false);
             break;
 
         }
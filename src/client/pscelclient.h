@@ -40,6 +40,7 @@
 
 #include "net/cmdbase.h"
 #include "engine/linmove.h"
+#include "util/heap.h"
 
 //=============================================================================
 // Local Includes
@@ -61,6 +62,7 @@ class psShadowManager;
 class psWorld;
 class psPersistActor;
 class psPersistItem;
+struct iThreadReturn;
 class GEMClientObject;
 class GEMClientActor;
 class GEMClientItem;
@@ -111,10 +113,54 @@ private:
     iObjectRegistry* object_reg;
     csPDelArray<GEMClientObject> entities;
     csHash<GEMClientObject*, EID> entities_hash;
-    csRefArray<MsgEntry> newActorQueue;
-    csRefArray<MsgEntry> newItemQueue;
     bool instantiateItems;
 
+    /**
+     * An actor or item waiting in the queue to be created.
+     *
+     * Only the message is kept when it is received. CheckEntityQueues
+     * parses it and starts loading the mesh factory, then the entity
+     * waits in a heap keyed by its distance to the camera until the
+     * factory is loaded.
+     */
+    struct PendingEntity
+    {
+        csRef<MsgEntry> message;        ///< The received message, until it is parsed.
+        bool isActor;
+        psPersistActor* actor;          ///< Set for parsed actors.
+        psPersistItem* item;            ///< Set for parsed items.
+        EID eid;
+        csVector3 pos;
+        csString sectorName;
+        csRef<iThreadReturn> factory;   ///< Loading of the mesh factory.
+        float distance;                 ///< Squared distance to the camera when parsed, FLT_MAX in other sectors.
+        uint32 serial;                  ///< Arrival order, for entities at the same distance.
+        bool dropped;                   ///< Removed or sent again while waiting.
+
+        PendingEntity();
+        ~PendingEntity();
+
+        bool operator<(const PendingEntity& other) const
+        {
+            return distance < other.distance || (distance == other.distance && serial < other.serial);
+        }
+        bool operator>(const PendingEntity& other) const
+        {
+            return other < *this;
+        }
+    };
+
+    /// Received entities not parsed yet, in arrival order from receivedHead on.
+    csArray<PendingEntity*> receivedEntities;
+    size_t receivedHead;
+    /// Parsed entities, nearest to the camera first.
+    Heap<PendingEntity> parsedEntities;
+    /// The latest queued entry of each entity.
+    csHash<PendingEntity*, EID> pendingByEID;
+    uint32 pendingSerial;
+    /// Time in ms spent on queued entities each frame.
+    csTicks entityBudget;
+
     // Keep seperate for speedups
     csArray<GEMClientActionLocation*> actions;
 
@@ -246,10 +292,14 @@ public:
         return requeststatus;
     }
 
-    /// Add one new actor or item entity from the queue.
+    /**
+     * Parse the queued actors and items, then create them nearest to the
+     * camera first once their mesh factory is loaded.
+     *
+     * At least one entity is handled each frame, more as long as the
+     * time spent stays within the entity budget.
+     */
     void CheckEntityQueues();
-    /// Add all new entities on the queue.
-    void ForceEntityQueues();
 
     void Update(bool loaded);
 
@@ -336,6 +386,20 @@ protected:
     void HandleWorld(MsgEntry* me);
     void HandleActor(MsgEntry* me);
     void HandleItem(MsgEntry* me);
+    void CreateActor(psPersistActor &msg);
+    void CreateItem(psPersistItem &msg);
+    /// Keep a received actor or item message for CheckEntityQueues().
+    void QueueEntity(MsgEntry* me, bool isActor);
+    /// Parse the oldest received entity and move it to the parsed heap.
+    void ParseNextEntity(const csVector3 &viewPos, const csString &viewSector);
+    /// Create the nearest parsed entity, false if it is still loading.
+    bool CreateNearestEntity();
+    /// Create a parsed entity and delete the queue entry.
+    void CreatePendingEntity(PendingEntity* pending);
+    /// Drop a queued entity that hasn't been created yet.
+    void RemovePendingEntity(EID eid);
+    /// Check if the actor message can be handled, fails if the loading failed.
+    bool CanHandleActor();
     void HandleActionLocation(MsgEntry* me);
     void HandleObjectRemoval(MsgEntry* me);
     void HandleNameChange(MsgEntry* me);
@@ -79,6 +79,9 @@ psEffectObjKeyFrame::psEffectObjKeyFrame(const psEffectObjKeyFrame* other) : spe
     {
         useScale[i] = other->useScale[i];
     }
+
+    rotMatrix = other->rotMatrix;
+    spinMatrix = other->spinMatrix;
 }
 
 psEffectObjKeyFrame::psEffectObjKeyFrame(iDocumentNode* node, const psEffectObjKeyFrame* prevKeyFrame) : specAction(KA_VEC_COUNT)
@@ -304,10 +307,22 @@ bool psEffectObjKeyFrame::SetParamScalings(const float* scale)
             result = true; // At least one param where adjusted
         }
     }
+    if(result)
+    {
+        UpdateMatrices();
+    }
     return result;
 }
 
-psEffectObjKeyFrameGroup::psEffectObjKeyFrameGroup()
+void psEffectObjKeyFrame::UpdateMatrices()
+{
+    const csVector3 &rot = vecActions[KA_ROT - KA_COUNT];
+    const csVector3 &spin = vecActions[KA_SPIN - KA_COUNT];
+    rotMatrix = csZRotMatrix3(rot.z) * csYRotMatrix3(rot.y) * csXRotMatrix3(rot.x);
+    spinMatrix = csZRotMatrix3(spin.z) * csYRotMatrix3(spin.y) * csXRotMatrix3(spin.x);
+}
+
+psEffectObjKeyFrameGroup::psEffectObjKeyFrameGroup() : sorted(true)
 {
 }
 
@@ -327,6 +342,62 @@ csPtr<psEffectObjKeyFrameGroup> psEffectObjKeyFrameGroup::Clone() const    //tic
     return csPtr<psEffectObjKeyFrameGroup> (clone);                        //ticket 6051
 }
 
+void psEffectObjKeyFrameGroup::UpdateSorted()
+{
+    sorted = true;
+    for(size_t i = 1; i < keyFrames.GetSize(); i++)
+    {
+        if(keyFrames[i]->time < keyFrames[i-1]->time)
+        {
+            sorted = false;
+            return;
+        }
+    }
+}
+
+bool psEffectObjKeyFrameGroup::UsesParamScaling() const
+{
+    for(size_t i = 0; i < keyFrames.GetSize(); i++)
+    {
+        for(size_t k = 0; k < psEffectObjKeyFrame::KA_VEC_COUNT; k++)
+        {
+            if(keyFrames[i]->useScale[k])
+                return true;
+        }
+    }
+    return false;
+}
+
+void psEffectObjKeyFrameGroup::UpdateMatrices()
+{
+    for(size_t i = 0; i < keyFrames.GetSize(); i++)
+    {
+        keyFrames[i]->UpdateMatrices();
+    }
+}
+
+size_t psEffectObjKeyFrameGroup::FindByTime(csTicks time, size_t hint) const
+{
+    if(!sorted)
+    {
+        for(size_t a = keyFrames.GetSize(); a > 0; --a)
+        {
+            if(keyFrames[a-1]->time < time)
+                return (a-1);
+        }
+        return 0;
+    }
+
+    // the animation moves forward a bit each frame, so the keyframe is
+    // usually the hint or one of the next ones
+    size_t a = hint < keyFrames.GetSize() ? hint : 0;
+    while(a > 0 && keyFrames[a]->time >= time)
+        --a;
+    while(a + 1 < keyFrames.GetSize() && keyFrames[a+1]->time < time)
+        ++a;
+    return a;
+}
+
 bool psEffectObjKeyFrameGroup::SetFrameParamScalings(const float* scale)
 {
     bool result = false;
@@ -351,6 +422,8 @@ psEffectObj::psEffectObj(iView* parentView, psEffect2DRenderer* renderer2d)
     view = parentView;
 
     killTime = -1;
+    currKeyFrame = 0;
+    nextKeyFrame = 0;
     animScaling = 1;
     autoScale = SCALING_NONE;
     isAlive = true;
@@ -516,6 +589,7 @@ bool psEffectObj::Load(iDocumentNode* node, iLoaderContext* /*ldr_context*/)
 
     // linearly interpolate values where an action wasn't specified
     FillInLerps();
+    keyFrames->UpdateMatrices();
 
     return true;
 }
@@ -546,6 +620,13 @@ bool psEffectObj::SetScaling(float scale, float aspect)
 
 bool psEffectObj::SetFrameParamScalings(const float* scale)
 {
+    if(!keyFrames->UsesParamScaling())
+    {
+        return false;
+    }
+
+    // the keyframes are shared with the other clones, scale a copy
+    keyFrames = keyFrames->Clone();
     return keyFrames->SetFrameParamScalings(scale);
 }
 
@@ -615,8 +696,13 @@ bool psEffectObj::Update(csTicks elapsed)
         csVector3 lerpSpin = LERP_VEC_KEY(KA_SPIN,lerpfactor);
         csVector3 objOffset = LERP_VEC_KEY(KA_POS,lerpfactor);
 
-        // calculate rotation from lerped values - expensive
-        csMatrix3 matRot = csZRotMatrix3(lerpRot.z) * csYRotMatrix3(lerpRot.y) * csXRotMatrix3(lerpRot.x);
+        // calculate rotation from lerped values, unless it's the one of the keyframe
+        const psEffectObjKeyFrame* currKey = keyFrames->Get(currKeyFrame);
+        csMatrix3 matRot;
+        if(lerpRot == currKey->vecActions[psEffectObjKeyFrame::KA_ROT - psEffectObjKeyFrame::KA_COUNT])
+            matRot = currKey->rotMatrix;
+        else
+            matRot = csZRotMatrix3(lerpRot.z) * csYRotMatrix3(lerpRot.y) * csXRotMatrix3(lerpRot.x);
         if(dir != DT_CAMERA && dir != DT_BILLBOARD)
         {
             matRot *= matBase;
@@ -646,7 +732,10 @@ bool psEffectObj::Update(csTicks elapsed)
         else
         {
             matTransform = matRot;
-            matTransform *= csZRotMatrix3(lerpSpin.z) * csYRotMatrix3(lerpSpin.y) * csXRotMatrix3(lerpSpin.x);
+            if(lerpSpin == currKey->vecActions[psEffectObjKeyFrame::KA_SPIN - psEffectObjKeyFrame::KA_COUNT])
+                matTransform *= currKey->spinMatrix;
+            else
+                matTransform *= csZRotMatrix3(lerpSpin.z) * csYRotMatrix3(lerpSpin.y) * csXRotMatrix3(lerpSpin.x);
         }
 
         // SCALE
@@ -691,8 +780,11 @@ void psEffectObj::CloneBase(psEffectObj* newObj) const
     newObj->mixmode = mixmode;
     newObj->autoScale = autoScale;
     newObj->animScaling = animScaling;
+    newObj->currKeyFrame = 0;
+    newObj->nextKeyFrame = 0;
 
-    newObj->keyFrames = keyFrames->Clone();
+    // the keyframes are never changed after loading, so they are shared
+    newObj->keyFrames = keyFrames;
 }
 
 psEffectObj* psEffectObj::Clone() const
@@ -733,12 +825,7 @@ size_t psEffectObj::FindKeyFrameByTime(csTicks time) const
         time %= animLength;
     }
 
-    for(size_t a = keyFrames->GetSize(); a > 0; --a)
-    {
-        if(keyFrames->Get(a-1)->time < time)
-            return (a-1);
-    }
-    return 0;
+    return keyFrames->FindByTime(time, currKeyFrame);
 }
 
 bool psEffectObj::FindNextKeyFrameWithAction(size_t startFrame, size_t action, size_t &index) const
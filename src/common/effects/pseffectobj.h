@@ -67,6 +67,11 @@ public:
      */
     bool SetParamScalings(const float* scale);
 
+    /**
+     * Calculates the rotation matrices from the rotation and spin actions.
+     */
+    void UpdateMatrices();
+
 
     /// this is the time of the keyframe animation (in milliseconds)
     csTicks time;
@@ -110,15 +115,26 @@ public:
 
     /// keep track of which actions were specified for which
     csBitArray specAction;
+
+    /// the rotation and spin actions as matrices, so they don't have to be built every frame
+    csMatrix3 rotMatrix;
+    csMatrix3 spinMatrix;
 };
 
 /**
  * Effect objects KeyFrame group.
+ *
+ * The group is shared by all clones of an effect object, so it must not
+ * be changed once the object is loaded. Clones that need different
+ * keyframes get their own copy with Clone().
  */
 class psEffectObjKeyFrameGroup : public csRefCount
 {
 private:
     csPDelArray<psEffectObjKeyFrame> keyFrames;
+    bool sorted;    ///< the keyframes are ordered by time
+
+    void UpdateSorted();
 
 public:
     psEffectObjKeyFrameGroup();
@@ -163,6 +179,8 @@ public:
      */
     void Push(psEffectObjKeyFrame* keyFrame)
     {
+        if(!keyFrames.IsEmpty() && keyFrame->time < keyFrames.Top()->time)
+            sorted = false;
         keyFrames.Push(keyFrame);
     }
 
@@ -174,6 +192,7 @@ public:
     void DeleteIndex(size_t idx)
     {
         keyFrames.DeleteIndex(idx);
+        UpdateSorted();
     }
 
     /**
@@ -182,6 +201,7 @@ public:
     void DeleteAll()
     {
         keyFrames.DeleteAll();
+        sorted = true;
     }
 
     /**
@@ -197,6 +217,25 @@ public:
      */
     bool SetFrameParamScalings(const float* scale);
 
+    /**
+     * Checks if any frame has parameters that are scaled by SetFrameParamScalings().
+     */
+    bool UsesParamScaling() const;
+
+    /**
+     * Calculates the rotation matrices of all keyframes.
+     */
+    void UpdateMatrices();
+
+    /**
+     * Finds the index of the last keyframe before the given time, or 0 if there is none.
+     *
+     * @param time the time to lookup
+     * @param hint the index found for an earlier time, the search starts there
+     * @return the index of the keyframe at the given time
+     */
+    size_t FindByTime(csTicks time, size_t hint) const;
+
 };
 
 /**
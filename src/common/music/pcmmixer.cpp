@@ -0,0 +1,124 @@
+/*
+ * pcmmixer.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#include <psconfig.h>
+#include "pcmmixer.h"
+
+// SSE2 is always there on x86-64, AVX2 only if the compiler was asked for it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCMMIXER_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define PCMMIXER_AVX2
+#include <immintrin.h>
+#endif
+
+namespace psMusic
+{
+
+void MixSamples(int16* dest, const int16* src, size_t count)
+{
+    size_t i = 0;
+
+#ifdef PCMMIXER_AVX2
+    for(; i + 16 <= count; i += 16)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dest + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_adds_epi16(d, s));
+    }
+#endif
+#ifdef PCMMIXER_SSE2
+    for(; i + 8 <= count; i += 8)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dest + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_adds_epi16(d, s));
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        int sum = dest[i] + src[i];
+        if(sum > 32767)
+        {
+            sum = 32767;
+        }
+        else if(sum < -32768)
+        {
+            sum = -32768;
+        }
+        dest[i] = (int16)sum;
+    }
+}
+
+void MixSamples(uint8* dest, const uint8* src, size_t count)
+{
+    size_t i = 0;
+
+    // Flipping the top bit turns the unsigned samples into signed ones
+    // centered at 0, so the signed saturating add can be used.
+#ifdef PCMMIXER_AVX2
+    const __m256i bias256 = _mm256_set1_epi8((char)0x80);
+    for(; i + 32 <= count; i += 32)
+    {
+        __m256i d = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(dest + i)), bias256);
+        __m256i s = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(src + i)), bias256);
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_xor_si256(_mm256_adds_epi8(d, s), bias256));
+    }
+#endif
+#ifdef PCMMIXER_SSE2
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    for(; i + 16 <= count; i += 16)
+    {
+        __m128i d = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(dest + i)), bias);
+        __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + i)), bias);
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_xor_si128(_mm_adds_epi8(d, s), bias));
+    }
+#endif
+
+    for(; i < count; i++)
+    {
+        int sum = dest[i] + src[i] - 128;
+        if(sum > 255)
+        {
+            sum = 255;
+        }
+        else if(sum < 0)
+        {
+            sum = 0;
+        }
+        dest[i] = (uint8)sum;
+    }
+}
+
+void MixPCM(char* dest, const char* src, size_t bytes, int bits)
+{
+    if(bits == 16)
+    {
+        MixSamples((int16*)dest, (const int16*)src, bytes / 2);
+    }
+    else
+    {
+        MixSamples((uint8*)dest, (const uint8*)src, bytes);
+    }
+}
+
+}
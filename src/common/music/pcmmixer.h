@@ -0,0 +1,69 @@
+/*
+ * pcmmixer.h
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#ifndef PCM_MIXER_H
+#define PCM_MIXER_H
+
+//====================================================================================
+// Crystal Space Includes
+//====================================================================================
+#include <cssysdef.h>
+
+/**
+ * \addtogroup common_music
+ * @{ */
+
+namespace psMusic
+{
+
+/**
+ * Adds the 16 bit signed samples in src to the ones in dest. Samples that
+ * would overflow are clamped to the range of int16.
+ *
+ * @param dest the samples to mix into.
+ * @param src the samples to add.
+ * @param count the number of samples.
+ */
+void MixSamples(int16* dest, const int16* src, size_t count);
+
+/**
+ * Adds the 8 bit unsigned samples in src to the ones in dest. The samples
+ * are centered at 128 and clamped to the range of uint8.
+ *
+ * @param dest the samples to mix into.
+ * @param src the samples to add.
+ * @param count the number of samples.
+ */
+void MixSamples(uint8* dest, const uint8* src, size_t count);
+
+/**
+ * Adds PCM data to a buffer with the same format.
+ *
+ * @param dest the data to mix into.
+ * @param src the data to add.
+ * @param bytes the length of the data in bytes.
+ * @param bits the number of bits per sample, 8 or 16.
+ */
+void MixPCM(char* dest, const char* src, size_t bytes, int bits);
+
+}
+
+/** @} */
+
+#endif // PCM_MIXER_H
@@ -0,0 +1,124 @@
+/*
+ * pcmmixer_unittest.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#include <psconfig.h>
+
+//====================================================================================
+// Crystal Space Includes
+//====================================================================================
+#include <csutil/sysfunc.h>
+
+//====================================================================================
+// Project Includes
+//====================================================================================
+#include "music/pcmmixer.h"
+
+//====================================================================================
+// Library Includes
+//====================================================================================
+#include <gtest/gtest.h>
+
+TEST(PCMMixerTest, Saturate16)
+{
+    // Odd sizes so the scalar tail is used too
+    int16 dest[37];
+    int16 src[37];
+    for(int i = 0; i < 37; i++)
+    {
+        dest[i] = (int16)(i % 2 ? 30000 : -30000);
+        src[i] = (int16)(i % 2 ? 10000 : -10000);
+    }
+    dest[36] = 100;
+    src[36] = -50;
+
+    psMusic::MixSamples(dest, src, 37);
+
+    for(int i = 0; i < 36; i++)
+    {
+        EXPECT_EQ(i % 2 ? 32767 : -32768, dest[i]);
+    }
+    EXPECT_EQ(50, dest[36]);
+}
+
+TEST(PCMMixerTest, Saturate8)
+{
+    uint8 dest[37];
+    uint8 src[37];
+    for(int i = 0; i < 37; i++)
+    {
+        dest[i] = i % 2 ? 250 : 10;
+        src[i] = i % 2 ? 200 : 50;
+    }
+    dest[36] = 128;
+    src[36] = 140;
+
+    psMusic::MixSamples(dest, src, 37);
+
+    for(int i = 0; i < 36; i++)
+    {
+        EXPECT_EQ(i % 2 ? 255 : 0, dest[i]);
+    }
+    EXPECT_EQ(140, dest[36]);
+}
+
+// Run with --gtest_also_run_disabled_tests. Mixes four note chords of half a
+// second of 44.1kHz 16 bit stereo, compared with the old byte by byte mixing.
+TEST(PCMMixerTest, DISABLED_ChordBenchmark)
+{
+    const size_t bytes = 44100 / 2 * 2 * 2;
+    const int chords = 200;
+    const int chordNotes = 4;
+
+    char* chord = new char[bytes];
+    char* note = new char[bytes];
+    for(size_t i = 0; i < bytes; i++)
+    {
+        note[i] = (char)(i * 7);
+    }
+
+    csTicks start = csGetTicks();
+    for(int c = 0; c < chords; c++)
+    {
+        memcpy(chord, note, bytes);
+        for(int n = 1; n < chordNotes; n++)
+        {
+            for(size_t i = 0; i < bytes; i++)
+            {
+                chord[i] += note[i];
+            }
+        }
+    }
+    csTicks bytewise = csGetTicks() - start;
+
+    start = csGetTicks();
+    for(int c = 0; c < chords; c++)
+    {
+        memcpy(chord, note, bytes);
+        for(int n = 1; n < chordNotes; n++)
+        {
+            psMusic::MixPCM(chord, note, bytes, 16);
+        }
+    }
+    csTicks mixer = csGetTicks() - start;
+
+    printf("%d chords: byte by byte %u ms, mixer %u ms\n", chords, bytewise, mixer);
+
+    delete[] chord;
+    delete[] note;
+}
@@ -5625,6 +5625,13 @@ psPersistItem::psPersistItem(MsgEntry* me, NetBase::AccessPointers* accessPointe
     }
 }
 
+uint32_t psPersistItem::PeekEID(MsgEntry* me)
+{
+    uint32_t eid = me->GetUInt32();
+    me->Reset();
+    return eid;
+}
+
 csString psPersistItem::ToString(NetBase::AccessPointers* /*accessPointers*/)
 {
     csString msgtext;
@@ -3479,6 +3479,11 @@ public:
 
     PSF_DECLARE_MSG_FACTORY();
 
+    /**
+     * Used to extract just the entity EID from the message.
+     */
+    static uint32_t PeekEID(MsgEntry* me);
+
     /**
      *  Converts the message into human readable string.
      *
@@ -252,6 +252,15 @@ public:
 
     psNetMsgProfiles * GetProfs() { return profs; }
 
+    /// Get the packets and bytes received and sent since the start.
+    void GetTotals(long &countIn, long &countOut, long &transferIn, long &transferOut)
+    {
+        countIn = totalcountin;
+        countOut = totalcountout;
+        transferIn = totaltransferin;
+        transferOut = totaltransferout;
+    }
+
     /// The timeout to use when waiting for new incoming packets.
     struct timeval timeout;
 
@@ -397,6 +397,11 @@ pawsMessageTextBox::pawsMessageTextBox()
 {
     topLine = 0;
     maxLines = 0;
+    firstMessage = 0;
+    maxMessages = MESSAGE_TEXTBOX_MAX_MESSAGES;
+    totalLines = 0;
+    wrapSerial = 1;
+    wrapWidth = 0;
     scrollBarWidth = 25;
     CalcLineHeight();
     scrollBar = NULL;
@@ -406,10 +411,15 @@ pawsMessageTextBox::pawsMessageTextBox(const pawsMessageTextBox &origin)
     :pawsWidget(origin)
 {
     maxLines = origin.maxLines;
-    //adjusted = origin.adjusted;
     lineHeight = origin.lineHeight;
     topLine = origin.topLine;
     scrollBarWidth = origin.scrollBarWidth;
+    firstMessage = 0;
+    maxMessages = origin.maxMessages;
+    totalLines = 0;
+    wrapSerial = 1;
+    wrapWidth = 0;
+    scrollBar = NULL;
     for(unsigned int x = 0 ; x < origin.children.GetSize(); x++)
     {
         if(origin.scrollBar == origin.children[x] && x < children.GetSize())
@@ -418,15 +428,15 @@ pawsMessageTextBox::pawsMessageTextBox(const pawsMessageTextBox &origin)
         }
     }
 
-    for(unsigned int i = 0 ; i < origin.adjusted.GetSize(); i++)
-    {
-        adjusted.Push(new MessageLine(*origin.adjusted[i]));
-    }
-    for(unsigned int i = 0 ; i < origin.messages.GetSize(); i++)
+    // The copies are wrapped again when they are shown
+    for(size_t i = 0 ; i < origin.messages.GetSize(); i++)
     {
-        messages.Push(new MessageLine(*origin.messages[i]));
+        MessageEntry* entry = new MessageEntry;
+        entry->message = origin.GetEntry(i)->message;
+        entry->lineCount = origin.GetEntry(i)->lineCount;
+        totalLines += entry->lineCount;
+        messages.Push(entry);
     }
-
 }
 pawsMessageTextBox::~pawsMessageTextBox()
 {
@@ -436,12 +446,203 @@ pawsMessageTextBox::~pawsMessageTextBox()
 void pawsMessageTextBox::Clear()
 {
     messages.Empty();
-    adjusted.Empty();
+    firstMessage = 0;
+    totalLines = 0;
     topLine = 0;
     if(scrollBar)
         scrollBar->Hide();
 }
 
+void pawsMessageTextBox::SetMaxMessages(size_t max)
+{
+    if(max == 0)
+        max = 1;
+
+    // Put the ring in order, so it can grow and shrink at the end again
+    for(; firstMessage > 0; firstMessage--)
+        messages.Push(messages.Extract(0));
+
+    size_t dropped = 0;
+    while(messages.GetSize() > max)
+    {
+        dropped += messages[0]->lineCount;
+        messages.DeleteIndex(0);
+    }
+    totalLines -= dropped;
+    maxMessages = max;
+
+    topLine -= (int)dropped;
+    if(topLine < 0)
+        topLine = 0;
+    UpdateScrollBar();
+}
+
+size_t pawsMessageTextBox::PushEntry(MessageEntry* entry)
+{
+    totalLines += entry->lineCount;
+
+    // The ring stays in order until it is full for the first time
+    if(messages.GetSize() < maxMessages)
+    {
+        messages.Push(entry);
+        return 0;
+    }
+
+    MessageEntry* oldest = messages[firstMessage];
+    size_t dropped = oldest->lineCount;
+    totalLines -= dropped;
+    delete oldest;
+
+    messages[firstMessage] = entry;
+    firstMessage = (firstMessage + 1) % messages.GetSize();
+    return dropped;
+}
+
+void pawsMessageTextBox::UpdateWrap(MessageEntry* entry)
+{
+    // Everything has to be wrapped again when the font or the width changed
+    iFont* font = GetFont();
+    if(font != glyphFont)
+    {
+        glyphFont = font;
+        glyphWidths.DeleteAll();
+        wrapSerial++;
+    }
+    if(screenFrame.Width() != wrapWidth)
+    {
+        wrapWidth = screenFrame.Width();
+        wrapSerial++;
+    }
+
+    if(entry->wrapSerial == wrapSerial)
+        return;
+
+    entry->lines.Empty();
+
+    const MessageLine &msg = entry->message;
+    MessageLine* msgLine = NULL;
+    if(msg.segments.IsEmpty())
+    {
+        int dummyX = -1;
+        SplitMessage(entry->lines, msg.text, msg.colour, msg.size, msgLine, dummyX);
+    }
+    else
+    {
+        int offsetX = 0;
+        for(size_t i = 0; i < msg.segments.GetSize(); i++)
+            SplitMessage(entry->lines, msg.segments[i].text, msg.segments[i].colour, msg.segments[i].size, msgLine, offsetX);
+    }
+
+    entry->wrapSerial = wrapSerial;
+    totalLines = totalLines - entry->lineCount + entry->lines.GetSize();
+    entry->lineCount = entry->lines.GetSize();
+}
+
+void pawsMessageTextBox::GetVisibleLines(csArray<MessageLine*> &visible)
+{
+    if(topLine < 0)
+        topLine = 0;
+
+    if((size_t)topLine + maxLines >= totalLines)
+    {
+        // Showing the end, so collect the lines from the last message up
+        // and keep the view at the end if the line counts change.
+        csArray<MessageLine*> reversed;
+        for(size_t i = messages.GetSize(); i-- > 0 && reversed.GetSize() < maxLines;)
+        {
+            MessageEntry* entry = GetEntry(i);
+            UpdateWrap(entry);
+            for(size_t l = entry->lines.GetSize(); l-- > 0 && reversed.GetSize() < maxLines;)
+                reversed.Push(entry->lines[l]);
+        }
+        for(size_t l = reversed.GetSize(); l-- > 0;)
+            visible.Push(reversed[l]);
+
+        topLine = (int)(totalLines - visible.GetSize());
+        return;
+    }
+
+    // Find the message holding the top line, messages that were not
+    // wrapped for the current width count with their old line count.
+    size_t i = 0;
+    size_t line = 0;
+    while(i < messages.GetSize() && line + GetEntry(i)->lineCount <= (size_t)topLine)
+    {
+        line += GetEntry(i)->lineCount;
+        i++;
+    }
+
+    size_t skip = topLine - line;
+    for(; i < messages.GetSize() && visible.GetSize() < maxLines; i++)
+    {
+        MessageEntry* entry = GetEntry(i);
+        UpdateWrap(entry);
+        for(size_t l = skip; l < entry->lines.GetSize() && visible.GetSize() < maxLines; l++)
+            visible.Push(entry->lines[l]);
+        skip = 0;
+    }
+}
+
+void pawsMessageTextBox::UpdateScrollBar()
+{
+    if(!scrollBar)
+        return;
+
+    scrollBar->SetMaxValue(maxLines > totalLines ? 0 : (float)(totalLines-maxLines));
+    scrollBar->SetCurrentValue((float)topLine, false);
+
+    if(maxLines < totalLines)
+        scrollBar->ShowBehind();
+    else
+        scrollBar->Hide();
+}
+
+int pawsMessageTextBox::GetGlyphWidth(utf32_char c)
+{
+    const int* cached = glyphWidths.GetElementPointer(c);
+    if(cached)
+        return *cached;
+
+    int width = 0;
+    csGlyphMetrics metrics;
+    if(glyphFont->GetGlyphMetrics(c, metrics))
+        width = metrics.advance;
+
+    glyphWidths.Put(c, width);
+    return width;
+}
+
+int pawsMessageTextBox::GetTextWidth(const char* text)
+{
+    int width = 0;
+    size_t len = strlen(text);
+    size_t pos = 0;
+    while(pos < len)
+    {
+        utf32_char c;
+        int skip = csUnicodeTransform::UTF8Decode((const utf8_char*)text + pos, len - pos, c);
+        pos += skip > 0 ? skip : 1;
+        width += GetGlyphWidth(c);
+    }
+    return width;
+}
+
+int pawsMessageTextBox::GetFitLength(const char* text, int width)
+{
+    size_t len = strlen(text);
+    size_t pos = 0;
+    while(pos < len)
+    {
+        utf32_char c;
+        int skip = csUnicodeTransform::UTF8Decode((const utf8_char*)text + pos, len - pos, c);
+        width -= GetGlyphWidth(c);
+        if(width < 0)
+            break;
+        pos += skip > 0 ? skip : 1;
+    }
+    return (int)pos;
+}
+
 void pawsMessageTextBox::CalcLineHeight()
 {
     int dummy;
@@ -464,6 +665,10 @@ pawsScrollBar* pawsMessageTextBox::GetScrollBar()
 
 bool pawsMessageTextBox::Setup(iDocumentNode* node)
 {
+    int max = node->GetAttributeValueAsInt("maxmessages", 0);
+    if(max > 0)
+        SetMaxMessages(max);
+
     csRef<iDocumentNode> scrollBarNode = node->GetNode("pawsScrollBar");
     if(scrollBarNode)
     {
@@ -511,24 +716,8 @@ void pawsMessageTextBox::Resize()
 {
     pawsWidget::Resize();
 
+    // The messages are wrapped for the new width when they are shown
     CalcLineHeight();
-
-    adjusted.Empty();
-
-    for(size_t x = 0; x < messages.GetSize(); x++)
-    {
-        MessageLine* dummy = NULL;
-        int dummyX = -1;
-        if(messages[x]->segments.IsEmpty())
-            SplitMessage(messages[x]->text, messages[x]->colour, messages[x]->size, dummy, dummyX);
-        else
-        {
-            MessageLine* msgLine = NULL;
-            int offsetX = 0;
-            for(size_t i = 0; i < messages[x]->segments.GetSize(); i++)
-                SplitMessage(messages[x]->segments[i].text, messages[x]->segments[i].colour, messages[x]->segments[i].size, msgLine, offsetX);
-        }
-    }
 }
 
 void pawsMessageTextBox::OnResize()
@@ -544,16 +733,16 @@ void pawsMessageTextBox::OnResize()
         maxLines = 0;
 
     // Re adjust the top line value
-    topLine = (int)adjusted.GetSize() - (int)maxLines;
+    topLine = (int)totalLines - (int)maxLines;
     if(topLine < 0)
         topLine = 0;
 
     if(scrollBar)
     {
-        scrollBar->SetMaxValue(maxLines > adjusted.GetSize() ? 0 : (float)(adjusted.GetSize()-maxLines));
+        scrollBar->SetMaxValue(maxLines > totalLines ? 0 : (float)(totalLines-maxLines));
         scrollBar->SetCurrentValue((float)topLine);
 
-        if(maxLines < adjusted.GetSize())
+        if(maxLines < totalLines)
         {
             scrollBar->Show();
             scrollBar->RecalcScreenPositions();
@@ -570,54 +759,54 @@ void pawsMessageTextBox::Draw()
 
     ClipToParent(false);
 
-    int yPos = 0;
-
-    if(topLine < 0)
-        topLine = 0;
-
-    for(size_t x = topLine; x < (topLine+maxLines); x++)
-    {
-        if(x < adjusted.GetSize())
+    size_t oldTotalLines = totalLines;
+    csArray<MessageLine*> visible;
+    GetVisibleLines(visible);
+
+    // Wrapping for a new width changed the number of lines
+    if(totalLines != oldTotalLines)
+        UpdateScrollBar();
+
+    for(size_t x = 0; x < visible.GetSize(); x++)
+    {
+        MessageLine* line = visible[x];
+        int yPos = (int)x;
+        if(line->segments.IsEmpty())
+        {
+            // Draw shadow
+            graphics2D->Write(GetFont(),
+                              screenFrame.xmin + 1,
+                              screenFrame.ymin + yPos*lineHeight + 1,
+                              0,
+                              -1,
+                              (const char*)line->text);
+            // Draw actual text
+            graphics2D->Write(GetFont(),
+                              screenFrame.xmin,
+                              screenFrame.ymin + yPos*lineHeight,
+                              line->colour,
+                              -1,
+                              (const char*)line->text);
+        }
+        else
         {
-            if(adjusted[x]->segments.IsEmpty())
+            for(size_t i = 0; i < line->segments.GetSize(); i++)
             {
                 // Draw shadow
                 graphics2D->Write(GetFont(),
-                                  screenFrame.xmin + 1,
+                                  screenFrame.xmin + line->segments[i].x + 1,
                                   screenFrame.ymin + yPos*lineHeight + 1,
                                   0,
                                   -1,
-                                  (const char*)adjusted[x]->text);
+                                  (const char*)line->segments[i].text);
                 // Draw actual text
                 graphics2D->Write(GetFont(),
-                                  screenFrame.xmin,
+                                  screenFrame.xmin + line->segments[i].x,
                                   screenFrame.ymin + yPos*lineHeight,
-                                  adjusted[x]->colour,
+                                  line->segments[i].colour,
                                   -1,
-                                  (const char*)adjusted[x]->text);
+                                  (const char*)line->segments[i].text);
             }
-            else
-            {
-                for(size_t i = 0; i < adjusted[x]->segments.GetSize(); i++)
-                {
-                    // Draw shadow
-                    graphics2D->Write(GetFont(),
-                                      screenFrame.xmin + adjusted[x]->segments[i].x + 1,
-                                      screenFrame.ymin + yPos*lineHeight + 1,
-                                      0,
-                                      -1,
-                                      (const char*)adjusted[x]->segments[i].text);
-                    // Draw actual text
-                    graphics2D->Write(GetFont(),
-                                      screenFrame.xmin + adjusted[x]->segments[i].x,
-                                      screenFrame.ymin + yPos*lineHeight,
-                                      adjusted[x]->segments[i].colour,
-                                      -1,
-                                      (const char*)adjusted[x]->segments[i].text);
-                }
-            }
-
-            yPos++;
         }
     }
 }
@@ -699,7 +888,8 @@ void pawsMessageTextBox::AddMessage(const char* data, int msgColour)
             topLine = 0;
 
         // Add it to the main message buffer.
-        MessageLine* msg = new MessageLine;
+        MessageEntry* entry = new MessageEntry;
+        MessageLine* msg = &entry->message;
 
         // Find font info embedded in the data.
         int colour = msgColour;
@@ -712,18 +902,11 @@ void pawsMessageTextBox::AddMessage(const char* data, int msgColour)
 
         size_t textStart = 0;
         size_t textEnd = messageText.Length();
-        int x = 0;
-        MessageLine* msgLine = NULL;
         msg->size = 0;
-        msg->colour = msgColour;
-        msg->text = messageText;
-
-        // Empty line is a special case here
-        if(messageText.Length() == 0)
-        {
-            SplitMessage(messageText, colour, size, msgLine, x);
-        }
+        msg->colour = colour;
 
+        // Split the message into segments of different colours, it is
+        // wrapped from those whenever the width changes.
         while(textStart < messageText.Length())
         {
             size_t pos = messageText.FindFirst(ESCAPECODE, textStart);
@@ -734,14 +917,12 @@ void pawsMessageTextBox::AddMessage(const char* data, int msgColour)
 
             if(textStart == 0 && pos == SIZET_NOT_FOUND)
             {
-                int dummyX = -1;
-                SplitMessage(messageText, colour, size, msgLine, dummyX);
+                // No colour codes, wrapped from the text
                 break;
             }
             else if(textEnd > textStart)
             {
                 csString subText = messageText.Slice(textStart, textEnd - textStart);
-                SplitMessage(subText, colour, size, msgLine, x);
 
                 MessageSegment newSegment;
                 newSegment.text = subText;
@@ -767,18 +948,27 @@ void pawsMessageTextBox::AddMessage(const char* data, int msgColour)
                 messageText.DeleteAt(pos, LENGTHCODE);
             }
         }
-        messages.Push(msg);
+        msg->text = messageText;
+
+        // Dropping the oldest message moves the lines up
+        oldTopLine -= (int)PushEntry(entry);
+        if(oldTopLine < 0)
+            oldTopLine = 0;
+
+        // New messages are usually shown right away
+        UpdateWrap(entry);
+
         if(scrollBar)
         {
-            if(adjusted.GetSize() > maxLines)
+            if(totalLines > maxLines)
                 scrollBar->ShowBehind();
             else
                 scrollBar->Hide();
 
-            scrollBar->SetMaxValue(maxLines > adjusted.GetSize() ? 0 : (float)(adjusted.GetSize()-maxLines));
+            scrollBar->SetMaxValue(maxLines > totalLines ? 0 : (float)(totalLines-maxLines));
         }
 
-        topLine = (int)adjusted.GetSize() - (int)maxLines;
+        topLine = (int)totalLines - (int)maxLines;
         if(topLine < 0)
             topLine = 0;
 
@@ -806,17 +996,12 @@ void pawsMessageTextBox::AppendLastMessage(const char* data)
         return;
     }
 
-    MessageLine* line = messages.Get(messages.GetSize()-1);
-    line->text.Append(data);
-    line = adjusted.Get(adjusted.GetSize()-1);
-    line->text.Append(data);
+    MessageEntry* entry = GetEntry(messages.GetSize()-1);
+    entry->message.text.Append(data);
+    if(!entry->message.segments.IsEmpty())
+        entry->message.segments.Top().text.Append(data);
 
-    // Trim \n from the end and add a new line.
-    while(line->text.FindLast("\n") == line->text.Length()-1)
-    {
-        line->text.Truncate(line->text.Length()-1);
-        AddMessage("");
-    }
+    UpdateLastMessage(entry);
 }
 
 void pawsMessageTextBox::ReplaceLastMessage(const char* rawMessage)
@@ -829,17 +1014,43 @@ void pawsMessageTextBox::ReplaceLastMessage(const char* rawMessage)
         return;
     }
 
-    MessageLine* line = messages.Get(messages.GetSize()-1);
-    line->text.Replace(data);
-    line = adjusted.Get(adjusted.GetSize()-1);
-    line->text.Replace(data);
+    MessageEntry* entry = GetEntry(messages.GetSize()-1);
+    entry->message.text.Replace(data);
+    entry->message.segments.Empty();
+
+    UpdateLastMessage(entry);
+}
 
-    // Trim \n from the end and add a new line.
-    while(line->text.FindLast("\n") == line->text.Length()-1)
+void pawsMessageTextBox::UpdateLastMessage(MessageEntry* entry)
+{
+    // Trim \n from the end and add a new line for each.
+    csString &text = entry->message.text;
+    int newLines = 0;
+    while(!text.IsEmpty() && text.GetAt(text.Length()-1) == '\n')
     {
-        line->text.Truncate(line->text.Length()-1);
-        AddMessage("");
+        text.Truncate(text.Length()-1);
+        if(!entry->message.segments.IsEmpty())
+        {
+            csString &segment = entry->message.segments.Top().text;
+            if(!segment.IsEmpty() && segment.GetAt(segment.Length()-1) == '\n')
+                segment.Truncate(segment.Length()-1);
+        }
+        newLines++;
     }
+
+    bool onBottom = (size_t)topLine + maxLines >= totalLines;
+    entry->wrapSerial = 0;
+    UpdateWrap(entry);
+    if(onBottom)
+    {
+        topLine = (int)totalLines - (int)maxLines;
+        if(topLine < 0)
+            topLine = 0;
+    }
+    UpdateScrollBar();
+
+    while(newLines-- > 0)
+        AddMessage("");
 }
 
 void pawsMessageTextBox::OnUpdateData(const char* /*dataname*/, PAWSData &value)
@@ -867,14 +1078,14 @@ void pawsMessageTextBox::FullScroll()
 
 }
 
-void pawsMessageTextBox::SplitMessage(const char* newText, int colour,
+void pawsMessageTextBox::SplitMessage(csPDelArray<MessageLine> &lines, const char* newText, int colour,
                                       int /*size*/, MessageLine* &msgLine, int &startPosition)
 {
     csString stringBuffer(newText);
 
     if(stringBuffer.IsEmpty())
     {
-        WriteMessageLine(msgLine, "", colour);
+        WriteMessageLine(lines, msgLine, "", colour);
         return;
     }
 
@@ -882,22 +1093,21 @@ void pawsMessageTextBox::SplitMessage(const char* newText, int colour,
     {
         int offSet = INITOFFSET;
         int width = -1;
-        int height = -1;
         /// See how many characters can be drawn on a single line.
         if(startPosition != -1)
         {
-            GetFont()->GetDimensions(stringBuffer.GetData(), width, height);
+            width = GetTextWidth(stringBuffer.GetData());
             offSet += startPosition;
         }
-        int canDrawLength = GetFont()->GetLength(stringBuffer.GetData(),
-                            screenFrame.Width() - offSet);
+        int canDrawLength = GetFitLength(stringBuffer.GetData(),
+                                         screenFrame.Width() - offSet);
 
         /// If it can fit the entire string then return.
         if(size_t(canDrawLength) == stringBuffer.Length())
         {
             if(!msgLine)
             {
-                WriteMessageLine(msgLine,stringBuffer,colour);
+                WriteMessageLine(lines,msgLine,stringBuffer,colour);
             }
             if(startPosition != -1)
             {
@@ -913,7 +1123,7 @@ void pawsMessageTextBox::SplitMessage(const char* newText, int colour,
 
             if(!msgLine)
             {
-                WriteMessageLine(msgLine,processedString,colour);
+                WriteMessageLine(lines,msgLine,processedString,colour);
             }
             if(startPosition != -1)
             {
@@ -926,13 +1136,13 @@ void pawsMessageTextBox::SplitMessage(const char* newText, int colour,
     }
 }
 
-void pawsMessageTextBox::WriteMessageLine(MessageLine* &msgLine, csString text, int colour)
+void pawsMessageTextBox::WriteMessageLine(csPDelArray<MessageLine> &lines, MessageLine* &msgLine, csString text, int colour)
 {
     msgLine = new MessageLine;
     msgLine->size = text.Length();
     msgLine->text = text;
     msgLine->colour = colour;
-    adjusted.Push(msgLine);
+    lines.Push(msgLine);
 }
 
 void pawsMessageTextBox::WriteMessageSegment(MessageLine* &msgLine, csString text, int colour, int startPosition)
@@ -961,9 +1171,7 @@ csString pawsMessageTextBox::FindStringThatFits(csString stringBuffer, int canDr
         stringBuffer.SubString(wordAfterBreak, breakPoint + 1, wordLength);
     }
 
-    int width = 0;
-    int height = 0;
-    GetFont()->GetDimensions(wordAfterBreak.GetData(), width, height);
+    int width = GetTextWidth(wordAfterBreak.GetData());
 
     csString processedString;
     if(width <= screenFrame.Width() - INITOFFSET)
@@ -26,6 +26,7 @@
 struct iVirtualClock;
 
 #include "pawswidget.h"
+#include <csutil/hash.h>
 #include <csutil/parray.h>
 #include <ivideo/fontserv.h>
 #include <iutil/virtclk.h>
@@ -278,9 +279,15 @@ CREATE_PAWS_FACTORY(pawsTextBox);
 //--------------------------------------------------------------------------
 
 #define MESSAGE_TEXTBOX_MOUSE_SCROLL_AMOUNT 3
+/// Default number of messages kept by a pawsMessageTextBox.
+#define MESSAGE_TEXTBOX_MAX_MESSAGES 1000
 /** This is a special type of text box that is used for messages.
  * This text box allows each 'message' to be stored as it's own line with
  * it's own colours.
+ *
+ * Only the last maxmessages messages are kept, older ones are dropped.
+ * Messages are word wrapped when they are shown, so resizing the box
+ * only wraps the visible messages again.
  */
 class pawsMessageTextBox : public pawsWidget
 {
@@ -363,16 +370,51 @@ public:
     bool OnKeyDown(utf32_char code, utf32_char key, int modifiers);
 
 
+    /** Sets the number of messages kept, older messages are dropped. */
+    void SetMaxMessages(size_t max);
+
 protected:
+    /// A message and its lines wrapped to the width of the box.
+    struct MessageEntry
+    {
+        MessageLine message;
+        csPDelArray<MessageLine> lines;
+        /// Wrap serial the lines were made for, 0 if never wrapped.
+        uint32 wrapSerial;
+        /// Number of lines, kept from the last wrap while the lines are out of date.
+        size_t lineCount;
+
+        MessageEntry() : wrapSerial(0), lineCount(1) { }
+    };
+
     /// Renders an entire message and returns the total lines it took.
     int RenderMessage(const char* data, int lineStart, int colour);
 
-    /// List of messages this box has.
-    csPDelArray<MessageLine> messages;
+    /// Get a message by age, 0 is the oldest one kept.
+    MessageEntry* GetEntry(size_t index) const
+    {
+        return messages[(firstMessage + index) % messages.GetSize()];
+    }
+
+    /**
+     * Adds a message, dropping the oldest one when the box is full.
+     * @return The number of lines dropped.
+     */
+    size_t PushEntry(MessageEntry* entry);
+
+    /// Wraps a message again if the width or font changed since the last wrap.
+    void UpdateWrap(MessageEntry* entry);
+
+    /// Gets the lines to draw, wrapping the messages they belong to.
+    void GetVisibleLines(csArray<MessageLine*> &visible);
+
+    /// Updates the scroll bar to the number of lines.
+    void UpdateScrollBar();
 
-    //void AdjustMessages();
+    /// Wraps the last message again after it was changed.
+    void UpdateLastMessage(MessageEntry* entry);
 
-    void SplitMessage(const char* newText, int colour, int size, MessageLine* &msgLine, int &startPosition);
+    void SplitMessage(csPDelArray<MessageLine> &lines, const char* newText, int colour, int size, MessageLine* &msgLine, int &startPosition);
 
     /// Calculates value of the lineHeight attribute
     void CalcLineHeight();
@@ -383,7 +425,18 @@ protected:
      */
     pawsScrollBar* GetScrollBar();
 
-    csPDelArray<MessageLine> adjusted;
+    /// Ring of the messages in this box, the oldest is at firstMessage.
+    csPDelArray<MessageEntry> messages;
+    size_t firstMessage;
+    size_t maxMessages;
+
+    /// Sum of the line counts of all messages.
+    size_t totalLines;
+
+    /// Increased whenever all messages have to be wrapped again.
+    uint32 wrapSerial;
+    /// Width the messages are wrapped for.
+    int wrapWidth;
 
     int lineHeight;
     size_t maxLines;
@@ -395,9 +448,20 @@ protected:
 
 private:
     static const int INITOFFSET = 20;
-    void WriteMessageLine(MessageLine* &msgLine, csString text, int colour);
+    void WriteMessageLine(csPDelArray<MessageLine> &lines, MessageLine* &msgLine, csString text, int colour);
     void WriteMessageSegment(MessageLine* &msgLine, csString text, int colour, int startPosition);
     csString FindStringThatFits(csString stringBuffer, int canDrawLength);
+
+    /// Gets the advance of a glyph of the current font.
+    int GetGlyphWidth(utf32_char c);
+    /// Gets the width of a text in the current font.
+    int GetTextWidth(const char* text);
+    /// Gets the number of bytes of a text that fit in the given width, like iFont::GetLength().
+    int GetFitLength(const char* text, int width);
+
+    /// Font the glyph widths were measured with.
+    csRef<iFont> glyphFont;
+    csHash<int, utf32_char> glyphWidths;
 };
 
 CREATE_PAWS_FACTORY(pawsMessageTextBox);
@@ -20,9 +20,14 @@
 
 #include <psconfig.h>
 
+#include <csutil/array.h>
 #include <csutil/snprintf.h>
 #include <csutil/sysfunc.h>
+#include <csutil/threading/atomicops.h>
+#include <csutil/threading/condition.h>
+#include <csutil/threading/mutex.h>
 #include <csutil/threading/thread.h>
+#include <csutil/threading/tls.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -62,6 +67,7 @@
 #include "consoleout.h"
 #include "command.h"
 #include "util/pserror.h"
+#include "util/log.h"
 
 FILE* errorLog = NULL;
 static FILE* outputfile = NULL;
@@ -114,23 +120,18 @@ void ConsoleOut::SetOutputFile (const char* filename, bool append)
     }
 }
 
-void ConsoleOut::Intern_Printf (ConsoleOutMsgClass con, const char* string, ...)
+/**
+ * Write a message to stdout, the output file and the error log.
+ * If buffer is set the message is added to it instead of stdout.
+ */
+static void WriteConsole(ConsoleOutMsgClass con, const char* text, time_t curtime, int shift,
+                         csString* buffer, bool flush)
 {
-    va_list args;
-    va_start(args, string);
-    Intern_VPrintf(con,string,args);
-    va_end(args);
-}
-
-void ConsoleOut::Intern_VPrintf (ConsoleOutMsgClass con, const char* string, va_list args)
-{
-    csString output;
+    csString output(text);
     csString time_buffer; //holds the time string to be appended to each line
     bool ending_newline = false;
-    output.FormatV(string, args); //formats the output
-	
+
 	//get time stamp
-    time_t curtime = time(NULL);
     struct tm *loctime;
     loctime = localtime (&curtime);
     time_buffer.Format("%s", asctime(loctime)); //formats the time string to be appended
@@ -162,19 +163,20 @@ void ConsoleOut::Intern_VPrintf (ConsoleOutMsgClass con, const char* string, va_
     // Check for stdout
     if (con <= maxoutput_stdout)
     {
-        if (strBuffer)
+        if (buffer)
         {
-            strBuffer->Append(output);
+            buffer->Append(output);
         }
         else
         {
-            if (promptDisplayed)
+            if (ConsoleOut::promptDisplayed)
             {
                 printf("\n");
-                promptDisplayed = false;
+                ConsoleOut::promptDisplayed = false;
             }
             printf("%s", output.GetDataSafe());
-            fflush(stdout);
+            if (flush)
+                fflush(stdout);
         }
     }
     
@@ -206,6 +208,363 @@ void ConsoleOut::Intern_VPrintf (ConsoleOutMsgClass con, const char* string, va_
 #endif
 }
 
+/// Write a message to the output file only.
+static void WriteLogOnly(ConsoleOutMsgClass con, const char* text, int shift, bool flush)
+{
+    if (outputfile && con <= maxoutput_file)
+    {
+        for (int i=0; i < shift; i++)
+        {
+            fputs ("  ", outputfile);
+        }
+        fputs (text, outputfile);
+        if (flush)
+            fflush (outputfile);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+#ifndef va_copy
+#define va_copy(dst, src) ((dst) = (src))
+#endif
+
+/// Number of messages queued per thread, has to be a power of two.
+#define CONSOLE_RING_SIZE       1024
+/// Size of the text buffer of a queued message, longer messages are copied to the heap.
+#define CONSOLE_RECORD_TEXT     240
+/// Time in ms the output thread waits when no messages are queued.
+#define CONSOLE_WRITER_INTERVAL 10
+
+enum ConsoleRecordKind
+{
+    RECORD_CONSOLE,
+    RECORD_LOGONLY,
+    RECORD_CSV
+};
+
+/// A message queued for the output thread.
+struct ConsoleRecord
+{
+    int    kind;
+    int    con;         ///< The message class, or the csv log of csv records.
+    int    shift;
+    time_t time;
+    char*  overflow;    ///< Heap copy of messages not fitting in text.
+    char   text[CONSOLE_RECORD_TEXT];
+
+    const char* GetText() const
+    {
+        return overflow ? overflow : text;
+    }
+};
+
+/**
+ * The queued messages of one thread.
+ *
+ * Only the owning thread advances head and only the consumer, the output
+ * thread or a thread holding the output mutex, advances tail, so messages
+ * are queued without any lock.
+ */
+struct ConsoleRing
+{
+    ConsoleRecord records[CONSOLE_RING_SIZE];
+    int32         head;
+    int32         tail;
+    int32         orphaned;    ///< Set when the owning thread exited.
+
+    ConsoleRing() : head(0), tail(0), orphaned(0)
+    {
+    }
+};
+
+/// Thread local reference to the ring of a thread.
+struct ConsoleRingHandle
+{
+    ConsoleRing* ring;
+
+    ConsoleRingHandle() : ring(NULL)
+    {
+    }
+
+    ~ConsoleRingHandle()
+    {
+        // The consumer deletes the ring once it's written
+        if (ring)
+            CS::Threading::AtomicOperations::Set(&ring->orphaned, 1);
+    }
+};
+
+/// Background thread writing the queued messages.
+class ConsoleWriter : public CS::Threading::Runnable
+{
+public:
+    virtual void Run();
+};
+
+static int32 asyncOutput = 0;
+static int32 queueingThreads = 0;
+static bool outputStopping = false;
+static CS::Threading::Mutex outputMutex;
+static CS::Threading::Condition outputCondition;
+static csRef<CS::Threading::Thread> outputThread;
+static csArray<ConsoleRing*> rings;
+static CS::Threading::ThreadLocal<ConsoleRingHandle> localRing;
+static int32 droppedRecords = 0;
+static int32 overflowRecords = 0;
+static uint32 writtenRecords = 0;
+
+/**
+ * Start queueing a record if the output is asynchronous. Every successful
+ * call has to be paired with EndQueue once the record is committed, so
+ * StopAsync can wait for records that are still being written.
+ *
+ * @return False if the output is synchronous.
+ */
+static bool BeginQueue()
+{
+    CS::Threading::AtomicOperations::Increment(&queueingThreads);
+    if (CS::Threading::AtomicOperations::Read(&asyncOutput))
+        return true;
+
+    CS::Threading::AtomicOperations::Decrement(&queueingThreads);
+    return false;
+}
+
+static void EndQueue()
+{
+    CS::Threading::AtomicOperations::Decrement(&queueingThreads);
+}
+
+/// Get the ring of the calling thread.
+static ConsoleRing* GetRing()
+{
+    ConsoleRingHandle& handle = localRing.Get();
+    if (!handle.ring)
+    {
+        handle.ring = new ConsoleRing;
+
+        CS::Threading::MutexScopedLock lock(outputMutex);
+        rings.Push(handle.ring);
+    }
+    return handle.ring;
+}
+
+/// Get the next free record of a ring, NULL if the ring is full.
+static ConsoleRecord* BeginRecord(ConsoleRing* ring, int kind, int con)
+{
+    uint32 head = (uint32)ring->head;
+    uint32 tail = (uint32)CS::Threading::AtomicOperations::Read(&ring->tail);
+    if (head - tail >= CONSOLE_RING_SIZE)
+    {
+        return NULL;
+    }
+
+    ConsoleRecord* rec = &ring->records[head & (CONSOLE_RING_SIZE-1)];
+    rec->kind = kind;
+    rec->con = con;
+    rec->shift = ConsoleOut::shift;
+    rec->time = time(NULL);
+    rec->overflow = NULL;
+    return rec;
+}
+
+/// Hand the record returned by BeginRecord to the consumer.
+static void CommitRecord(ConsoleRing* ring)
+{
+    CS::Threading::AtomicOperations::Set(&ring->head, (int32)((uint32)ring->head + 1));
+}
+
+static void FormatRecord(ConsoleRecord* rec, const char* format, va_list args, bool newline)
+{
+    va_list copy;
+    va_copy(copy, args);
+
+    size_t room = CONSOLE_RECORD_TEXT - (newline ? 1 : 0);
+    char* text = rec->text;
+    int len = cs_vsnprintf(text, room, format, args);
+    if (len < 0)
+    {
+        len = 0;
+        text[0] = '\0';
+    }
+    else if ((size_t)len >= room)
+    {
+        CS::Threading::AtomicOperations::Increment(&overflowRecords);
+        text = rec->overflow = new char[len + 2];
+        cs_vsnprintf(text, len + 1, format, copy);
+    }
+    va_end(copy);
+
+    if (newline)
+    {
+        text[len] = '\n';
+        text[len + 1] = '\0';
+    }
+}
+
+static void CopyRecord(ConsoleRecord* rec, const char* text)
+{
+    size_t len = strlen(text);
+    if (len >= CONSOLE_RECORD_TEXT)
+    {
+        CS::Threading::AtomicOperations::Increment(&overflowRecords);
+        rec->overflow = new char[len + 1];
+        memcpy(rec->overflow, text, len + 1);
+    }
+    else
+    {
+        memcpy(rec->text, text, len + 1);
+    }
+}
+
+/// Write a queued record, the output mutex has to be held.
+static void WriteRecord(ConsoleRecord &rec)
+{
+    switch (rec.kind)
+    {
+        case RECORD_CONSOLE:
+            WriteConsole((ConsoleOutMsgClass)rec.con, rec.GetText(), rec.time, rec.shift, NULL, false);
+            break;
+        case RECORD_LOGONLY:
+            WriteLogOnly((ConsoleOutMsgClass)rec.con, rec.GetText(), rec.shift, false);
+            break;
+        case RECORD_CSV:
+            if (LogCSV::GetSingletonPtr())
+            {
+                LogCSV::GetSingletonPtr()->WriteLine(rec.con, rec.GetText(), rec.time);
+            }
+            break;
+    }
+
+    delete[] rec.overflow;
+    rec.overflow = NULL;
+    writtenRecords++;
+}
+
+/**
+ * Write the queued records of all threads, the output mutex has to be held.
+ *
+ * @return The number of records written.
+ */
+static size_t DrainRings()
+{
+    size_t written = 0;
+    for (size_t i = rings.GetSize(); i-- > 0;)
+    {
+        ConsoleRing* ring = rings[i];
+
+        // Check before reading head, the thread doesn't queue anything after exiting
+        bool orphaned = CS::Threading::AtomicOperations::Read(&ring->orphaned) != 0;
+        uint32 head = (uint32)CS::Threading::AtomicOperations::Read(&ring->head);
+        uint32 tail = (uint32)ring->tail;
+        while (tail != head)
+        {
+            WriteRecord(ring->records[tail & (CONSOLE_RING_SIZE-1)]);
+            tail++;
+            written++;
+        }
+        CS::Threading::AtomicOperations::Set(&ring->tail, (int32)tail);
+
+        if (orphaned)
+        {
+            delete ring;
+            rings.DeleteIndexFast(i);
+        }
+    }
+
+    if (written)
+    {
+        fflush(stdout);
+        if (outputfile)
+            fflush(outputfile);
+    }
+    return written;
+}
+
+void ConsoleWriter::Run()
+{
+    while (true)
+    {
+        // Release the lock after each batch so other threads can write their errors
+        CS::Threading::MutexScopedLock lock(outputMutex);
+        if (outputStopping)
+            break;
+
+        if (!DrainRings())
+        {
+            outputCondition.Wait(outputMutex, CONSOLE_WRITER_INTERVAL);
+        }
+    }
+}
+
+/// Check if a message of this class is written anywhere.
+static bool IsOutput(ConsoleOutMsgClass con)
+{
+    return con <= maxoutput_stdout || (outputfile && con <= maxoutput_file) ||
+           con == CON_ERROR || con == CON_BUG;
+}
+
+static void VPrintf(ConsoleOutMsgClass con, const char* string, va_list args, bool newline)
+{
+    if (!IsOutput(con))
+        return;
+
+    // Command output, errors and bugs are written right away. So is captured
+    // output, the string buffer is only valid during the call.
+    if (!ConsoleOut::strBuffer && con > CON_ERROR && BeginQueue())
+    {
+        ConsoleRing* ring = GetRing();
+        ConsoleRecord* rec = BeginRecord(ring, RECORD_CONSOLE, con);
+        if (!rec)
+        {
+            CS::Threading::AtomicOperations::Increment(&droppedRecords);
+        }
+        else
+        {
+            FormatRecord(rec, string, args, newline);
+            CommitRecord(ring);
+        }
+        EndQueue();
+        return;
+    }
+
+    csString output;
+    output.FormatV(string, args); //formats the output
+    if (newline)
+        output.Append("\n");
+
+    if (ConsoleOut::IsAsync())
+    {
+        // Keep the order with the messages queued before
+        CS::Threading::MutexScopedLock lock(outputMutex);
+        DrainRings();
+        WriteConsole(con, output, time(NULL), ConsoleOut::shift, ConsoleOut::strBuffer, true);
+    }
+    else
+    {
+        WriteConsole(con, output, time(NULL), ConsoleOut::shift, ConsoleOut::strBuffer, true);
+    }
+}
+
+void ConsoleOut::Intern_Printf (ConsoleOutMsgClass con, const char* string, ...)
+{
+    va_list args;
+    va_start(args, string);
+    Intern_VPrintf(con,string,args);
+    va_end(args);
+}
+
+void ConsoleOut::Intern_VPrintf (ConsoleOutMsgClass con, const char* string, va_list args)
+{
+    VPrintf(con, string, args, false);
+}
+
+void ConsoleOut::Intern_VPrintfLine (ConsoleOutMsgClass con, const char* string, va_list args)
+{
+    VPrintf(con, string, args, true);
+}
+
 void ConsoleOut::Intern_Printf_LogOnly(ConsoleOutMsgClass con,
                                        const char *string, ...)
 {
@@ -218,15 +577,119 @@ void ConsoleOut::Intern_Printf_LogOnly(ConsoleOutMsgClass con,
 void ConsoleOut::Intern_VPrintf_LogOnly(ConsoleOutMsgClass con,
                                        const char *string, va_list args)
 {
-    if (outputfile && con <= maxoutput_file)
+    if (!outputfile || con > maxoutput_file)
+        return;
+
+    if (BeginQueue())
     {
-        for (int i=0; i < shift; i++)
+        ConsoleRing* ring = GetRing();
+        ConsoleRecord* rec = BeginRecord(ring, RECORD_LOGONLY, con);
+        if (!rec)
         {
-            vfprintf (outputfile, "  ", args);
+            CS::Threading::AtomicOperations::Increment(&droppedRecords);
         }
-        vfprintf (outputfile, string, args);
-        fflush (outputfile);
+        else
+        {
+            FormatRecord(rec, string, args, false);
+            CommitRecord(ring);
+        }
+        EndQueue();
+        return;
     }
+
+    for (int i=0; i < shift; i++)
+    {
+        fputs ("  ", outputfile);
+    }
+    vfprintf (outputfile, string, args);
+    fflush (outputfile);
+}
+
+bool ConsoleOut::QueueCSV(int type, const char* text)
+{
+    if (!BeginQueue())
+        return false;
+
+    ConsoleRing* ring = GetRing();
+    ConsoleRecord* rec = BeginRecord(ring, RECORD_CSV, type);
+    if (!rec)
+    {
+        // Csv logs are records of what happened, make room instead of dropping
+        Flush();
+        rec = BeginRecord(ring, RECORD_CSV, type);
+    }
+    CopyRecord(rec, text);
+    CommitRecord(ring);
+    EndQueue();
+    return true;
+}
+
+void ConsoleOut::StartAsync()
+{
+    CS::Threading::MutexScopedLock lock(outputMutex);
+    if (CS::Threading::AtomicOperations::Read(&asyncOutput))
+        return;
+
+    outputStopping = false;
+
+    csRef<ConsoleWriter> writer;
+    writer.AttachNew(new ConsoleWriter);
+    outputThread.AttachNew(new CS::Threading::Thread(writer));
+    outputThread->Start();
+
+    CS::Threading::AtomicOperations::Set(&asyncOutput, 1);
+}
+
+void ConsoleOut::StopAsync()
+{
+    {
+        CS::Threading::MutexScopedLock lock(outputMutex);
+        if (!CS::Threading::AtomicOperations::Read(&asyncOutput))
+            return;
+
+        CS::Threading::AtomicOperations::Set(&asyncOutput, 0);
+        outputStopping = true;
+        outputCondition.NotifyAll();
+    }
+
+    outputThread->Wait();
+    outputThread.Invalidate();
+
+    // Threads that saw the async output before it stopped may still be
+    // committing their records, drain the rings once they are done.
+    while (CS::Threading::AtomicOperations::Read(&queueingThreads))
+    {
+        CS::Threading::Thread::Yield();
+    }
+
+    Flush();
+}
+
+bool ConsoleOut::IsAsync()
+{
+    return CS::Threading::AtomicOperations::Read(&asyncOutput) != 0;
+}
+
+void ConsoleOut::Flush()
+{
+    CS::Threading::MutexScopedLock lock(outputMutex);
+    DrainRings();
+}
+
+void ConsoleOut::PrintStats()
+{
+    size_t threads;
+    uint32 written;
+    {
+        CS::Threading::MutexScopedLock lock(outputMutex);
+        threads = rings.GetSize();
+        written = writtenRecords;
+    }
+
+    CPrintf(CON_CMDOUTPUT, "Console output: %s, %zu threads, %u queued messages written, %d dropped, %d on the heap\n",
+            IsAsync() ? "async" : "sync", threads, written,
+            CS::Threading::AtomicOperations::Read(&droppedRecords),
+            CS::Threading::AtomicOperations::Read(&overflowRecords));
 }
 
 void ConsoleOut::Shift()
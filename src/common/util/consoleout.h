@@ -60,6 +60,12 @@ public:
      */
     static void Intern_VPrintf(ConsoleOutMsgClass con, const char *arg, va_list ap);
 
+    /**
+     * Used to print things to the console.
+     * This version terminates the line after the formatted text.
+     */
+    static void Intern_VPrintfLine(ConsoleOutMsgClass con, const char *arg, va_list ap);
+
     /**
      * Used to print things to the console.
      * This version only does the log to the output file.
@@ -112,6 +118,46 @@ public:
      */
     static void SetPrompt(const char*format, ...);
 
+    /**
+     * Write the output from a background thread.
+     *
+     * Messages are formatted into a ring buffer of the calling thread and
+     * written to stdout and the output file by the output thread, so
+     * verbose logging doesn't block the calling thread on the console.
+     * Command output, errors and bugs are still written right away, after
+     * the messages queued before them. Messages are dropped and counted
+     * when the ring of a thread is full.
+     */
+    static void StartAsync();
+
+    /**
+     * Stop the output thread and write the messages still queued.
+     */
+    static void StopAsync();
+
+    /**
+     * Check if the output is written from the output thread.
+     */
+    static bool IsAsync();
+
+    /**
+     * Write all queued messages.
+     */
+    static void Flush();
+
+    /**
+     * Queue a line for a csv log, LogCSV writes it from the output thread.
+     *
+     * @return False if the output isn't asynchronous and the caller has to
+     *         write the line itself.
+     */
+    static bool QueueCSV(int type, const char* text);
+
+    /**
+     * Print the statistics of the output thread.
+     */
+    static void PrintStats();
+
     static ConsoleOutMsgClass GetMaximumOutputClassStdout();
     static ConsoleOutMsgClass GetMaximumOutputClassFile();
     
@@ -129,6 +175,7 @@ public:
  */
 #define CPrintf         ConsoleOut::Intern_Printf
 #define CVPrintf        ConsoleOut::Intern_VPrintf
+#define CVPrintfLine    ConsoleOut::Intern_VPrintfLine
 #define CPrintfLog      ConsoleOut::Intern_Printf_LogOnly
 #define CVPrintfLog     ConsoleOut::Intern_VPrintf_LogOnly
 #define CShift          ConsoleOut::Shift
@@ -47,8 +47,16 @@ void psDBProfiles::StripConstantsFromSQL(psString & sql)
     }
 }
 
+psDBProfiles::psDBProfiles()
+    : totalStatements(0), totalTime(0)
+{
+}
+
 void psDBProfiles::AddSQLTime(const csString & sql, csTicks time)
 {
+    totalStatements++;
+    totalTime += time;
+
     psString strippedSQL(sql.GetData());
     
     strippedSQL.Downcase();
@@ -62,3 +70,9 @@ csString psDBProfiles::Dump()
     return psNamedProfiles::Dump("msec", "Database profile");
 }
 
+void psDBProfiles::GetTotals(uint32 & statements, uint64 & time)
+{
+    statements = totalStatements;
+    time = totalTime;
+}
+
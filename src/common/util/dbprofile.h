@@ -33,11 +33,18 @@ class psString;
 class psDBProfiles : public psNamedProfiles
 {
 public:
+    psDBProfiles();
 
     virtual void AddSQLTime(const csString & sql, csTicks time);
     csString Dump();
+
+    /** Get the number of statements and their total time in msec since
+      * the start. These are not cleared by Reset(). */
+    void GetTotals(uint32 & statements, uint64 & time);
     
 protected:
+    uint32 totalStatements;
+    uint64 totalTime;
 
     void StripConstantsFromSQL(psString & sql);
 
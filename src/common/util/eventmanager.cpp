@@ -20,6 +20,7 @@
 
 #include "gameevent.h"
 #include "util/consoleout.h"
+#include "util/pstrace.h"
 
 #include "net/messages.h"
 #include "eventmanager.h"
@@ -116,14 +117,28 @@ csTicks EventManager::ProcessEventQueue()
         
 
         events++;
-        csTicks start = csGetTicks();
+        metrics.events++;
+        csTicks lateness = now - event->triggerticks;
+        metrics.totalLateness += lateness;
+        if (lateness > metrics.maxLateness)
+        {
+            metrics.maxLateness = lateness;
+        }
+
+        int64 start = csGetMicroTicks();
 
         if (event->CheckTrigger())
         {
             event->Trigger();
         }
 
-        csTicks timeTaken = csGetTicks() - start;
+        int64 end = csGetMicroTicks();
+        if (psTrace::IsEnabled())
+        {
+            psTrace::AddSpan(GetTraceName(event->GetType()), 0, start, end);
+        }
+
+        csTicks timeTaken = (csTicks)((end - start)/1000);
 
         if(timeTaken > 1000)
         {
@@ -200,8 +215,71 @@ void EventManager::TrackEventTimes(csTicks timeTaken,MsgEntry *msg)
 // This is the MAIN GAME thread. Every message and event are handled from
 // this thread. This eliminate need for synchronization of access to
 // game data.
+void EventManager::TrackMessage(int msgType, int64 start, int64 end)
+{
+    int64 time = end - start;
+
+    metrics.messages++;
+    MsgTypeMetrics &typeMetrics = metrics.msgTypes.GetOrCreate(msgType);
+    typeMetrics.count++;
+    typeMetrics.time += time;
+    if (time > typeMetrics.maxTime)
+    {
+        typeMetrics.maxTime = time;
+    }
+
+    if (psTrace::IsEnabled())
+    {
+        psTrace::AddSpan(GetTraceName(msgType), msgType, start, end);
+    }
+}
+
+const char* EventManager::GetTraceName(const char* type)
+{
+    const char* name = traceNames.Get(type, NULL);
+    if (!name)
+    {
+        name = psTrace::Intern(type);
+        traceNames.Put(type, name);
+    }
+    return name;
+}
+
+const char* EventManager::GetTraceName(int msgType)
+{
+    const char* name = msgTraceNames.Get(msgType, NULL);
+    if (!name)
+    {
+        name = psTrace::Intern(GetMsgTypeName(msgType));
+        msgTraceNames.Put(msgType, name);
+    }
+    return name;
+}
+
+void EventManager::ResetMetrics()
+{
+    metrics.events = 0;
+    metrics.messages = 0;
+    metrics.totalLateness = 0;
+    metrics.maxLateness = 0;
+    metrics.msgTypes.Empty();
+}
+
+size_t EventManager::GetEventQueueSize()
+{
+    CS::Threading::MutexScopedLock lock(mutex);
+    return eventqueue.Length();
+}
+
+unsigned int EventManager::GetMessageQueueSize()
+{
+    return queue->Count();
+}
+
 void EventManager::Run ()
 {
+    psTrace::SetThreadName("event");
+
     csRef<MsgEntry> msg = 0;
 
     csTicks nextEvent = csGetTicks() + PROCESS_EVENT;
@@ -220,11 +298,14 @@ void EventManager::Run ()
 		// if there is a message to process, then process it
         if (msg)
         {
-            csTicks start = csGetTicks();
+            int64 start = csGetMicroTicks();
 
             Publish(msg);
 
-            csTicks timeTaken = csGetTicks() - start;
+            int64 end = csGetMicroTicks();
+            TrackMessage(msg->GetType(), start, end);
+
+            csTicks timeTaken = (csTicks)((end - start)/1000);
 
             // Ignore messages that take no time to process.
             if(timeTaken)
@@ -20,6 +20,9 @@
 #ifndef __EVENTMANAGER_H__
 #define __EVENTMANAGER_H__
 
+#include <csutil/csstring.h>
+#include <csutil/hash.h>
+
 #include "util/heap.h"
 #include "net/msghandler.h"
 
@@ -30,6 +33,38 @@ class MsgHandler;
  * \addtogroup common_util
  * @{ */
 
+/**
+ * Time spent handling one message type.
+ */
+struct MsgTypeMetrics
+{
+    uint32 count;
+    int64  time;      ///< Total time in microseconds.
+    int64  maxTime;   ///< Longest time in microseconds.
+
+    MsgTypeMetrics() : count(0), time(0), maxTime(0)
+    {
+    }
+};
+
+/**
+ * Counters of the event thread since they were last reset.
+ *
+ * Only used from the event thread, so read them from an event.
+ */
+struct EventMetrics
+{
+    uint32  events;            ///< Events triggered.
+    uint32  messages;          ///< Messages published.
+    uint64  totalLateness;     ///< Sum of the ms events were triggered after their time.
+    csTicks maxLateness;       ///< Most ms an event was triggered after its time.
+    csHash<MsgTypeMetrics,int> msgTypes;
+
+    EventMetrics() : events(0), messages(0), totalLateness(0), maxLateness(0)
+    {
+    }
+};
+
 /**
  * This class handles all queueing and invoking of timed events, such as
  * combat, spells, NPC dialog responses, range weapons, or NPC respawning.
@@ -51,6 +86,23 @@ protected:
 	/// Helper function to keep a running average of the last 50 events.
 	void TrackEventTimes(csTicks timeTaken,MsgEntry *msg);
 
+    /// Add a published message to the metrics and the trace.
+    void TrackMessage(int msgType, int64 start, int64 end);
+
+    /// Get the trace span name of an event type.
+    const char* GetTraceName(const char* type);
+
+    /// Get the trace span name of a message type.
+    const char* GetTraceName(int msgType);
+
+    EventMetrics metrics;
+
+    /// Trace span names by event type.
+    csHash<const char*, csString> traceNames;
+
+    /// Trace span names by message type.
+    csHash<const char*, int> msgTraceNames;
+
 public:
     EventManager();
     virtual ~EventManager();
@@ -69,6 +121,21 @@ public:
 
     /// Allows sending of a message not immediately, but after a short delay
     virtual void SendMessageDelayed(MsgEntry *msg,csTicks msecDelay);
+
+    /// Get the counters of the event thread, only call from the event thread.
+    const EventMetrics &GetMetrics() const
+    {
+        return metrics;
+    }
+
+    /// Reset the counters of the event thread, only call from the event thread.
+    void ResetMetrics();
+
+    /// Number of events waiting to be triggered.
+    size_t GetEventQueueSize();
+
+    /// Number of messages waiting to be published.
+    unsigned int GetMessageQueueSize();
 };
 
 /** @} */
@@ -19,6 +19,8 @@
 #include <psconfig.h>
 
 #include <csutil/csstring.h>
+#include <csutil/sysfunc.h>
+#include <csutil/threading/atomicops.h>
 #include <iutil/objreg.h>
 #include <ivaria/reporter.h>
 #include "util/consoleout.h"
@@ -127,11 +129,51 @@ bool DoLog(int severity, LOG_TYPES type, uint32 filter_id)
 }
 
 
+/// Messages of one log type in the current second, for the rate limit.
+struct RateWindow
+{
+    int32 second;
+    int32 count;
+    int32 dropped;
+};
+
+static int32 rateLimit = 0;
+static RateWindow rateWindows[MAX_FLAGS];
+
+/**
+ * Check if a debug or notify message goes over the rate limit of its type.
+ * The counters are updated without a lock, so the limit is approximate when
+ * several threads log the same type.
+ */
+static bool RateLimited(LOG_TYPES type)
+{
+    int32 limit = CS::Threading::AtomicOperations::Read(&rateLimit);
+    if (limit <= 0)
+        return false;
+
+    RateWindow &window = rateWindows[type];
+    int32 second = (int32)(csGetTicks()/1000);
+    if (CS::Threading::AtomicOperations::Read(&window.second) != second)
+    {
+        CS::Threading::AtomicOperations::Set(&window.second, second);
+        CS::Threading::AtomicOperations::Set(&window.count, 0);
+    }
+
+    if (CS::Threading::AtomicOperations::Increment(&window.count) > limit)
+    {
+        CS::Threading::AtomicOperations::Increment(&window.dropped);
+        return true;
+    }
+    return false;
+}
+
 void LogMessage (const char* file, int line, const char* function,
              int severity, LOG_TYPES type, uint32 filter_id, const char* msg, ...)
 {
     if (!DoLog(severity,type,filter_id)) return;
 
+    if (severity > CS_REPORTER_SEVERITY_WARNING && RateLimited(type)) return;
+
     va_list arg;
 
     ConsoleOutMsgClass con = CON_SPAM;
@@ -146,45 +188,17 @@ void LogMessage (const char* file, int line, const char* function,
 
     if(con <= ConsoleOut::GetMaximumOutputClassStdout())
     {
-        csString msgid;
+        // File, Line, Function is too much spam on the console for debug output
         if(con < CON_WARNING && con > CON_CMDOUTPUT)
         {
-            msgid.Format("<%s:%d %s SEVERE>\n",file, line, function);
+            CPrintf(con, "<%s:%d %s SEVERE>\n", file, line, function);
         }
-        else
-            msgid = ""; // File, Line, Function is too much spam on the console for debug output
-            //msgid.Format("<%s:%d %s>\n", file, line, function);
 
-        csString description;
+        // Formatted by the console, into the output queue when it's asynchronous.
+        // ERR and BUG will be loged to errorLog by the console.
         va_start(arg, msg);
-        description.FormatV(msg, arg);
+        CVPrintfLine(con, msg, arg);
         va_end(arg);
-        description.Append("\n"); //add an ending new line
-
-        // Disable use of csReport while testing using CPrintf
-        //        va_start(arg, msg);
-        //        csReportV (logger, severity, msgid, msg, arg);
-        //        va_end(arg);
-        CPrintf(con,msgid.GetDataSafe());
-    // For safety, print to %s:
-        CPrintf(con,"%s",description.GetDataSafe());
-
-        /* ERR and BUG will be loged to errorLog by the CPrintf
-        // Log errors to a file so they can be emailed to devs daily.
-        if (severity == CS_REPORTER_SEVERITY_ERROR ||
-            severity == CS_REPORTER_SEVERITY_BUG)
-        {
-            if(!errorLog)
-                errorLog = fopen("errorlog.txt","w");
-            fprintf(errorLog,msgid);
-            fprintf(errorLog," ");
-            va_start(arg, msg);
-            vfprintf(errorLog,msg,arg);
-            va_end(arg);
-            fprintf(errorLog, "\n");
-            fflush(errorLog);
-        }
-        */
     }
     else
     {
@@ -195,6 +209,35 @@ void LogMessage (const char* file, int line, const char* function,
     }
 }
 
+void SetRateLimit(int messagesPerSecond)
+{
+    CS::Threading::AtomicOperations::Set(&rateLimit, messagesPerSecond);
+}
+
+void DisplayStats()
+{
+    int32 limit = CS::Threading::AtomicOperations::Read(&rateLimit);
+    if (limit > 0)
+    {
+        CPrintf(CON_CMDOUTPUT, "Rate limit: %d debug and notify messages per second and log\n", limit);
+    }
+    else
+    {
+        CPrintf(CON_CMDOUTPUT, "Rate limit: none\n");
+    }
+
+    for (int i=0; i<MAX_FLAGS; i++)
+    {
+        int32 dropped = CS::Threading::AtomicOperations::Read(&rateWindows[i].dropped);
+        if (dropped)
+        {
+            CPrintf(CON_CMDOUTPUT, "%s: %d messages over the rate limit\n", flagnames[i], dropped);
+        }
+    }
+
+    ConsoleOut::PrintStats();
+}
+
 
 void Initialize(iObjectRegistry* object_reg)
 {
@@ -418,12 +461,21 @@ void LogCSV::StartLog(const char* logfile, iVFS* vfs, const char* header, size_t
 }
 
 void LogCSV::Write(int type, csString& text)
+{
+    if (!csvFile[type])
+        return;
+
+    // Written by the console output thread when it's running
+    if (!ConsoleOut::QueueCSV(type, text))
+        WriteLine(type, text, time(NULL));
+}
+
+void LogCSV::WriteLine(int type, const char* text, time_t curtime)
 {
     if (!csvFile[type])
         return;
 
 
-    time_t curtime = time(NULL);
     struct tm *loctime;
     loctime = localtime (&curtime);
     csString buf(asctime(loctime));
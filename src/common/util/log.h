@@ -173,6 +173,17 @@ void Initialize(iObjectRegistry* object_reg);
 void SetFlag(const char *name,bool flag, uint32 filter);
 void DisplayFlags(const char *name=NULL);
 bool GetValue(const char* name);
+
+/**
+ * Limit the debug and notify messages per second of each log type,
+ * 0 for no limit. Warnings, errors and bugs are never limited.
+ */
+void SetRateLimit(int messagesPerSecond);
+
+/**
+ * Print the messages dropped by the rate limit and the console output statistics.
+ */
+void DisplayStats();
 const char* GetName(int id);
 const char* GetSettingName(int id);
 
@@ -311,6 +322,12 @@ class LogCSV : public Singleton<LogCSV>
 public:
     LogCSV(iConfigManager* configmanager, iVFS* vfs);
     void Write(int type, csString& text);
+
+    /**
+     * Write a line to a log file, called by Write or by the console
+     * output thread for the lines it queued.
+     */
+    void WriteLine(int type, const char* text, time_t time);
 };
 
 /** @} */
@@ -42,6 +42,14 @@
 //====================================================================================
 #include "pspathnetwork.h"
 
+/// Max range where the spatial index is used, larger searches just check everything.
+#define SPATIAL_INDEX_MAX_RANGE   256.0f
+
+psPathNetwork::psPathNetwork()
+    : world(NULL), spatialIndexValid(false)
+{
+}
+
 bool psPathNetwork::Load(iEngine *engine, iDataConnection *db,psWorld * world)
 {
     // First initialize pointers to some importent classes
@@ -238,7 +246,9 @@ Waypoint *psPathNetwork::FindWaypoint(const csVector3& v, iSector *sector)
 
 Waypoint *psPathNetwork::FindNearestWaypoint(const csVector3& v,iSector *sector, float range, float * found_range)
 {
-    csPDelArray<Waypoint>::Iterator iter(waypoints.GetIterator());
+    csArray<Waypoint*> candidates;
+    FindWaypointCandidates(v, sector, range, candidates);
+    csArray<Waypoint*>::Iterator iter(candidates.GetIterator());
     Waypoint *wp;
 
     float min_range = range;
@@ -264,7 +274,9 @@ Waypoint *psPathNetwork::FindNearestWaypoint(const csVector3& v,iSector *sector,
 
 Waypoint *psPathNetwork::FindRandomWaypoint(const csVector3& v,iSector *sector, float range, float * found_range)
 {
-    csPDelArray<Waypoint>::Iterator iter(waypoints.GetIterator());
+    csArray<Waypoint*> candidates;
+    FindWaypointCandidates(v, sector, range, candidates);
+    csArray<Waypoint*>::Iterator iter(candidates.GetIterator());
     Waypoint *wp;
 
     csArray<Waypoint*> nearby;
@@ -298,6 +310,35 @@ Waypoint *psPathNetwork::FindRandomWaypoint(const csVector3& v,iSector *sector,
 
 Waypoint *psPathNetwork::FindNearestWaypoint(int group, const csVector3& v,iSector *sector, float range, float * found_range)
 {
+    if (range >= 0.0 && range <= SPATIAL_INDEX_MAX_RANGE)
+    {
+        // Search the nearby waypoints for members of the group
+        csArray<Waypoint*> candidates;
+        FindWaypointCandidates(v, sector, range, candidates);
+
+        float min_range = range;
+        Waypoint *min_wp = NULL;
+
+        for (size_t i = 0; i < candidates.GetSize(); i++)
+        {
+            Waypoint *wp = candidates[i];
+            if (wp->group != waypointGroupNames[group])
+            {
+                continue;
+            }
+
+            float dist2 = world->Distance(v,sector,wp->loc.pos,wp->GetSector(engine));
+            if (dist2 < min_range)
+            {
+                min_range = dist2;
+                min_wp = wp;
+            }
+        }
+        if (min_wp && found_range) *found_range = min_range;
+
+        return min_wp;
+    }
+
     csList<Waypoint*>::Iterator iter(waypointGroups[group]);
     Waypoint *wp;
 
@@ -324,22 +365,46 @@ Waypoint *psPathNetwork::FindNearestWaypoint(int group, const csVector3& v,iSect
 
 Waypoint *psPathNetwork::FindRandomWaypoint(int group, const csVector3& v,iSector *sector, float range, float * found_range)
 {
-    csList<Waypoint*>::Iterator iter(waypointGroups[group]);
     Waypoint *wp;
 
     csArray<Waypoint*> nearby;
     csArray<float> dist;
- 
-    while (iter.HasNext())
+
+    if (range >= 0.0 && range <= SPATIAL_INDEX_MAX_RANGE)
     {
-        wp = iter.Next();
+        // Only the nearby waypoints can be within range
+        csArray<Waypoint*> candidates;
+        FindWaypointCandidates(v, sector, range, candidates);
+        for (size_t i = 0; i < candidates.GetSize(); i++)
+        {
+            wp = candidates[i];
+            if (wp->group != waypointGroupNames[group])
+            {
+                continue;
+            }
 
-        float dist2 = world->Distance(v,sector,wp->loc.pos,wp->GetSector(engine));
-        
-        if (range < 0 || dist2 < range)
+            float dist2 = world->Distance(v,sector,wp->loc.pos,wp->GetSector(engine));
+            if (dist2 < range)
+            {
+                nearby.Push(wp);
+                dist.Push(dist2);
+            }
+        }
+    }
+    else
+    {
+        csList<Waypoint*>::Iterator iter(waypointGroups[group]);
+        while (iter.HasNext())
         {
-            nearby.Push(wp);
-            dist.Push(dist2);
+            wp = iter.Next();
+
+            float dist2 = world->Distance(v,sector,wp->loc.pos,wp->GetSector(engine));
+
+            if (range < 0 || dist2 < range)
+            {
+                nearby.Push(wp);
+                dist.Push(dist2);
+            }
         }
     }
 
@@ -399,14 +464,17 @@ psPath *psPathNetwork::FindNearestPath(const csVector3& v,iSector *sector, float
     int idx = -1;
     int tmpIdx;
     float fract = 0.0, tmpFract;
- 
-    for (size_t p = 0; p < paths.GetSize(); p++)
+
+    csArray<psPath*> candidates;
+    FindPathCandidates(v, sector, range, candidates);
+
+    for (size_t p = 0; p < candidates.GetSize(); p++)
     {
-        float dist2 = paths[p]->Distance(world,engine,v,sector,&tmpIdx,&tmpFract);
+        float dist2 = candidates[p]->Distance(world,engine,v,sector,&tmpIdx,&tmpFract);
                     
         if (dist2 >= 0.0 && (range < 0 || dist2 < range))
         {
-            found = paths[p];
+            found = candidates[p];
             range = dist2;
             idx = tmpIdx;
             fract = tmpFract;
@@ -451,14 +519,17 @@ psPath *psPathNetwork::FindNearestPoint(const csVector3& v,iSector *sector, floa
     psPath * found = NULL;
     int idx = -1;
     int tmpIdx;
- 
-    for (size_t p = 0; p < paths.GetSize(); p++)
+
+    csArray<psPath*> candidates;
+    FindPathCandidates(v, sector, range, candidates);
+
+    for (size_t p = 0; p < candidates.GetSize(); p++)
     {
-        float dist2 = paths[p]->DistancePoint(world,engine,v,sector,&tmpIdx);
+        float dist2 = candidates[p]->DistancePoint(world,engine,v,sector,&tmpIdx);
                     
         if (dist2 >= 0.0 && (range < 0 || dist2 < range))
         {
-            found = paths[p];
+            found = candidates[p];
             range = dist2;
             idx = tmpIdx;
         }
@@ -477,91 +548,171 @@ psPath *psPathNetwork::FindNearestPoint(const csVector3& v,iSector *sector, floa
     return found;
 }
 
+//====================================================================================
+
+psPathNetwork::RouteSearch::RouteSearch()
+    : nodePool(64), openPool(128)
+{
+}
+
+void psPathNetwork::RouteSearch::Reset()
+{
+    while (open.Length())
+    {
+        open.DeleteMin();
+    }
+    nodes.Empty();
+    openPool.Empty();
+    nodePool.Empty();
+}
+
+psPathNetwork::RouteSearch::Node* psPathNetwork::RouteSearch::GetNode(Waypoint* wp, Waypoint* start, Waypoint* end,
+                                                                    const psPathNetwork::RouteFilter* routeFilter)
+{
+    Node* node = nodes.Get(csPtrKey<Waypoint>(wp), NULL);
+    if (node)
+    {
+        return node;
+    }
+
+    node = nodePool.Alloc();
+    node->wp = wp;
+    node->pi = NULL;
+    node->g = INFINITY_DISTANCE;
+    // Filter the waypoints with exception of the start and end point.
+    node->excluded = (wp != start) && (wp != end) && routeFilter && routeFilter->Filter(wp);
+
+    nodes.Put(csPtrKey<Waypoint>(wp), node);
+    return node;
+}
+
+void psPathNetwork::RouteSearch::Push(Node* node, float f)
+{
+    OpenEntry* entry = openPool.Alloc();
+    entry->f = f;
+    entry->g = node->g;
+    entry->node = node;
+    open.Insert(entry);
+}
+
+psPathNetwork::RouteSearch::OpenEntry* psPathNetwork::RouteSearch::PopMin()
+{
+    if (!open.Length())
+    {
+        return NULL;
+    }
+    return open.DeleteMin();
+}
+
+//====================================================================================
+
+float psPathNetwork::RouteHeuristic(const Waypoint* wp, const Waypoint* end)
+{
+    if (!world)
+    {
+        return 0.0;
+    }
+
+    float dist = world->Distance(wp->GetPosition(),wp->GetSector(engine),end->GetPosition(),end->GetSector(engine));
+    if (dist >= INFINITY_DISTANCE)
+    {
+        // No known warp between the sectors, so fall back to plain Dijkstra
+        // for this waypoint instead of overestimating.
+        return 0.0;
+    }
+
+    return dist;
+}
+
 csList<Waypoint*> psPathNetwork::FindWaypointRoute(Waypoint * start, Waypoint * end, const psPathNetwork::RouteFilter* routeFilter)
+{
+    RouteSearch search;
+
+    return FindWaypointRoute(start, end, routeFilter, search);
+}
+
+csList<Waypoint*> psPathNetwork::FindWaypointRoute(Waypoint * start, Waypoint * end, const psPathNetwork::RouteFilter* routeFilter,
+                                                   RouteSearch& search)
 {
     csList<Waypoint*> waypoint_list;
-    csList<Waypoint*> priority; // Should have been a priority queue
-    csPDelArray<Waypoint>::Iterator iter(waypoints.GetIterator());
-    Waypoint *wp;
-    
-    // Using Dijkstra's algorithm to find shortest way
 
-    // Initialize
-    while (iter.HasNext())
+    if (!start || !end || start == end)
     {
-        wp = iter.Next();
-
-        // Filter the waypoints with exception of the start and end point.
-        if ((wp != start) && (wp != end) && routeFilter->Filter(wp))
-        {
-            wp->excluded = true;
-            continue; // No need to think more about this waypoint
-        }
-        else    
-        {
-            wp->excluded = false;
-        }
+        return waypoint_list;
+    }
 
-        wp->distance = INFINITY_DISTANCE;
-        wp->pi = NULL;
-        
-        // Insert WP into priority queue
-        priority.PushBack(wp);
+    uint32 filterKey = 0;
+    bool cacheable = !routeFilter || routeFilter->GetFilterKey(filterKey);
+    if (cacheable && routeCache.Get(start->GetID(), end->GetID(), filterKey, waypoint_list))
+    {
+        return waypoint_list;
     }
-    start->distance = 0;
 
-    while (!priority.IsEmpty())
+    // Using A* with a binary heap as open set. Nodes are only created
+    // for waypoints actually reached by the search.
+    search.Reset();
+
+    RouteSearch::Node* startNode = search.GetNode(start, start, end, routeFilter);
+    startNode->g = 0.0;
+    search.Push(startNode, RouteHeuristic(start, end));
+
+    RouteSearch::Node* endNode = NULL;
+
+    RouteSearch::OpenEntry* entry;
+    while ((entry = search.PopMin()) != NULL)
     {
-        Waypoint *wp_u = NULL;
-        Waypoint *pri_wp = NULL;
+        RouteSearch::Node* u = entry->node;
 
-        // Extract min from priority queue
-        csList<Waypoint*>::Iterator pri(priority);
-        csList<Waypoint*>::Iterator pri_loc;
-        while (pri.HasNext())
+        // Skip entries that has been superseded by a shorter distance.
+        if (entry->g > u->g)
         {
-            pri_wp = pri.Next();
+            continue;
+        }
 
-            if (!wp_u || pri_wp->distance < wp_u->distance)
-            {
-                wp_u = pri_wp;
-                pri_loc = pri;
-            }
+        if (u->wp == end)
+        {
+            endNode = u;
+            break;
         }
-        priority.Delete(pri_loc);
-        size_t v;
-        for (v = 0; v < wp_u->links.GetSize(); v++)
+
+        for (size_t v = 0; v < u->wp->links.GetSize(); v++)
         {
-            Waypoint * wp_v = wp_u->links[v];
+            RouteSearch::Node* node_v = search.GetNode(u->wp->links[v], start, end, routeFilter);
 
             // Is the target waypoint excluded, in that case continue on.
-            if (wp_v->excluded)
+            if (node_v->excluded)
             {
                 continue;
             }
 
             // Relax
-            if (wp_v->distance > wp_u->distance + wp_u->dists[v])
+            float g = u->g + u->wp->dists[v];
+            if (g < node_v->g)
             {
-                wp_v->distance = wp_u->distance + wp_u->dists[v];
-                wp_v->pi = wp_u;
+                node_v->g = g;
+                node_v->pi = u;
+                search.Push(node_v, g + RouteHeuristic(node_v->wp, end));
             }
         }
-        // if wp == end, we should be done!!!!!!
     }
 
-    wp = end;
-
-    if (end->pi)
+    if (endNode)
     {
-        wp = end;
-        while (wp)
+        RouteSearch::Node* node = endNode;
+        while (node)
         {
-            waypoint_list.PushFront(wp);
-            wp = wp->pi;
+            waypoint_list.PushFront(node->wp);
+            node = node->pi;
         }
     }
 
+    search.Reset();
+
+    if (cacheable)
+    {
+        routeCache.Put(start->GetID(), end->GetID(), filterKey, waypoint_list);
+    }
+
     return waypoint_list;
 }
 
@@ -593,17 +744,16 @@ void psPathNetwork::ListWaypoints(const char * pattern)
     csPDelArray<Waypoint>::Iterator iter(waypoints.GetIterator());
     Waypoint *wp;
     CPrintf(CON_CMDOUTPUT, "Waypoints\n");
-    CPrintf(CON_CMDOUTPUT, "%9s %-30s %-45s %-6s %-6s %-30s\n", "WP", "Name", "Position","Radius","Dist","PI");
+    CPrintf(CON_CMDOUTPUT, "%9s %-30s %-45s %-6s\n", "WP", "Name", "Position","Radius");
     while (iter.HasNext())
     {
         wp = iter.Next();
 
         if (!pattern || strstr(wp->GetName(),pattern))
         {
-            CPrintf(CON_CMDOUTPUT, "%9d %-30s %-45s %6.2f %6.1f %-30s" ,
+            CPrintf(CON_CMDOUTPUT, "%9d %-30s %-45s %6.2f" ,
                     wp->loc.id,wp->GetName(),toString(wp->loc.pos,wp->loc.sector).GetDataSafe(),
-                    wp->loc.radius,wp->distance,
-                    (wp->pi?wp->pi->GetName():""));
+                    wp->loc.radius);
 
             for (size_t i = 0; i < wp->links.GetSize(); i++)
             {
@@ -759,6 +909,12 @@ Waypoint* psPathNetwork::CreateWaypoint(csString& name,
     Waypoint *wp = new Waypoint(name,pos,sectorName,radius,flags);
 
     waypoints.Push(wp);
+    NetworkChanged();
+
+    if (spatialIndexValid)
+    {
+        IndexWaypoint(wp);
+    }
 
     return wp;
 }
@@ -774,6 +930,12 @@ psPath* psPathNetwork::CreatePath(iDataConnection *db, const csString& name, Way
 psPath* psPathNetwork::CreatePath(psPath * path)
 {
     paths.Push(path);
+    NetworkChanged();
+
+    if (spatialIndexValid)
+    {
+        IndexPath(path);
+    }
 
     float dist = path->GetLength(world,engine); 
     
@@ -798,6 +960,170 @@ psPath* psPathNetwork::CreatePath(iDataConnection *db, psPath * path)
 }
 
 
+void psPathNetwork::NetworkChanged()
+{
+    routeCache.Invalidate();
+}
+
+void psPathNetwork::WaypointChanged(Waypoint* wp)
+{
+    NetworkChanged();
+
+    if (!spatialIndexValid)
+    {
+        return;
+    }
+
+    IndexWaypoint(wp);
+
+    // Moving a waypoint move the end points of the connected paths as well.
+    for (size_t i = 0; i < wp->paths.GetSize(); i++)
+    {
+        IndexPath(wp->paths[i]);
+    }
+}
+
+void psPathNetwork::PathChanged(psPath* path)
+{
+    NetworkChanged();
+
+    // Paths under construction are not part of the network until created.
+    if (spatialIndexValid && paths.Find(path) != csArrayItemNotFound)
+    {
+        IndexPath(path);
+    }
+}
+
+void psPathNetwork::BuildSpatialIndex()
+{
+    waypointIndex.Clear();
+    pathIndex.Clear();
+
+    for (size_t i = 0; i < waypoints.GetSize(); i++)
+    {
+        IndexWaypoint(waypoints[i]);
+    }
+    for (size_t i = 0; i < paths.GetSize(); i++)
+    {
+        IndexPath(paths[i]);
+    }
+
+    spatialIndexValid = true;
+}
+
+void psPathNetwork::IndexWaypoint(Waypoint* wp)
+{
+    waypointIndex.Remove(wp);
+
+    iSector* sector = wp->GetSector(engine);
+    if (!sector)
+    {
+        return; // Not possible to find by position anyway.
+    }
+
+    const csVector3& pos = wp->GetPosition();
+    waypointIndex.Add(wp, sector, csBox2(pos.x, pos.z, pos.x, pos.z));
+}
+
+void psPathNetwork::IndexPath(psPath* path)
+{
+    pathIndex.Remove(path);
+
+    // Insert the box around each segment in the sector of the first point
+    // of the segment. The last point is inserted alone so paths with only
+    // one point is indexed as well.
+    for (size_t i = 0; i < path->points.GetSize(); i++)
+    {
+        psPathPoint* point = path->points[i];
+        iSector* sector = point->GetSector(engine);
+        if (!sector)
+        {
+            continue;
+        }
+
+        const csVector3& pos = point->GetPosition();
+        csBox2 box(pos.x, pos.z, pos.x, pos.z);
+
+        if (i+1 < path->points.GetSize())
+        {
+            psPathPoint* next = path->points[i+1];
+            csVector3 nextPos = next->GetPosition();
+            if (world && world->WarpSpace(next->GetSector(engine), sector, nextPos))
+            {
+                box.AddBoundingVertex(nextPos.x, nextPos.z);
+            }
+        }
+
+        pathIndex.Add(path, sector, box);
+    }
+}
+
+void psPathNetwork::FindWaypointCandidates(const csVector3& v, iSector* sector, float range, csArray<Waypoint*>& candidates)
+{
+    if (range < 0.0 || range > SPATIAL_INDEX_MAX_RANGE || !world)
+    {
+        for (size_t i = 0; i < waypoints.GetSize(); i++)
+        {
+            candidates.Push(waypoints[i]);
+        }
+        return;
+    }
+
+    if (!spatialIndexValid)
+    {
+        BuildSpatialIndex();
+    }
+
+    csSet<csPtrKey<Waypoint> > found;
+    const csArray<csPtrKey<iSector> >& sectors = waypointIndex.GetSectors();
+    for (size_t i = 0; i < sectors.GetSize(); i++)
+    {
+        iSector* other = sectors[i];
+
+        // Transform the position into each sector connected by a warp portal.
+        csVector3 pos = v;
+        if (other != sector && !world->WarpSpace(sector, other, pos))
+        {
+            continue;
+        }
+
+        waypointIndex.Query(sectors[i], csBox2(pos.x-range, pos.z-range, pos.x+range, pos.z+range), candidates, found);
+    }
+}
+
+void psPathNetwork::FindPathCandidates(const csVector3& v, iSector* sector, float range, csArray<psPath*>& candidates)
+{
+    if (range < 0.0 || range > SPATIAL_INDEX_MAX_RANGE || !world)
+    {
+        for (size_t i = 0; i < paths.GetSize(); i++)
+        {
+            candidates.Push(paths[i]);
+        }
+        return;
+    }
+
+    if (!spatialIndexValid)
+    {
+        BuildSpatialIndex();
+    }
+
+    csSet<csPtrKey<psPath> > found;
+    const csArray<csPtrKey<iSector> >& sectors = pathIndex.GetSectors();
+    for (size_t i = 0; i < sectors.GetSize(); i++)
+    {
+        iSector* other = sectors[i];
+
+        // Transform the position into each sector connected by a warp portal.
+        csVector3 pos = v;
+        if (other != sector && !world->WarpSpace(sector, other, pos))
+        {
+            continue;
+        }
+
+        pathIndex.Query(sectors[i], csBox2(pos.x-range, pos.z-range, pos.x+range, pos.z+range), candidates, found);
+    }
+}
+
 int psPathNetwork::GetNextWaypointCheck()
 {
     static int check = 0;
@@ -810,6 +1136,10 @@ bool psPathNetwork::Delete(psPath * path)
     db->CommandPump("delete from sc_path_points where path_id=%d",path->GetID());
     db->CommandPump("delete from sc_waypoint_links where id=%d",path->GetID());
 
+    // Cached routes may point to the path or its waypoints.
+    NetworkChanged();
+    pathIndex.Remove(path);
+
     // Delete the object
     Waypoint * start = path->start;
     Waypoint * end = path->end;
@@ -830,6 +1160,8 @@ bool psPathNetwork::Delete(psPath * path)
         db->CommandPump("delete from sc_waypoints where id=%d",start->GetID());
         db->CommandPump("delete from sc_waypoint_aliases where wp_id=%d",start->GetID());
 
+        waypointIndex.Remove(start);
+
         size_t index = waypoints.Find(start);
         if (index != csArrayItemNotFound)
         {
@@ -844,6 +1176,8 @@ bool psPathNetwork::Delete(psPath * path)
         db->CommandPump("delete from sc_waypoints where id=%d",end->GetID());
         db->CommandPump("delete from sc_waypoint_aliases where wp_id=%d",end->GetID());
 
+        waypointIndex.Remove(end);
+
         size_t index = waypoints.Find(end);
         if (index != csArrayItemNotFound)
         {
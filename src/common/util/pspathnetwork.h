@@ -20,11 +20,16 @@
 #define __PSPATHNETWORK_H__
 
 #include <csutil/array.h>
+#include <csutil/blockallocator.h>
+#include <csutil/hash.h>
 #include <csutil/list.h>
 
 #include <idal.h>
 
+#include "util/heap.h"
 #include "util/pspath.h"
+#include "util/psroutecache.h"
+#include "util/psspatialindex.h"
 
 class Edge;
 class Waypoint;
@@ -53,6 +58,83 @@ public:
         * Called to check if a waypoint should be filters.
         */
         virtual bool Filter(const Waypoint* wp) const = 0;
+
+       /**
+        * Get a key uniquely identifying the waypoints filtered by this filter.
+        *
+        * Routes are only cached for filters that provide a key.
+        *
+        * @param[out] key The key for this filter.
+        * @return True if the filter has a key and routes can be cached.
+        */
+        virtual bool GetFilterKey(uint32 &key) const { return false; }
+    };
+
+    /**
+     * Scratch state for one route search.
+     *
+     * All per-query data used by the A* search is kept here instead of
+     * in the shared Waypoint objects, so several routes can be calculated
+     * at the same time as long as each caller use its own RouteSearch.
+     * A RouteSearch can be reused for several searches to avoid
+     * reallocating the arenas.
+     */
+    class RouteSearch
+    {
+      public:
+        RouteSearch();
+
+        /**
+         * Release all nodes from the previous search.
+         */
+        void Reset();
+
+        /**
+         * Search state for one waypoint visited by the search.
+         */
+        struct Node
+        {
+            Waypoint* wp;       ///< The waypoint this node represent.
+            Node*     pi;       ///< Predecessor to track shortest way back to start.
+            float     g;        ///< Current shortest distance from the start WP.
+            bool      excluded; ///< Set to true if the waypoint is filtered out.
+        };
+
+        /**
+         * Entry in the open set. The same node can be pushed several
+         * times, entries with a f value that no longer match the node are skipped.
+         */
+        struct OpenEntry
+        {
+            float f;            ///< Estimated total cost, g + heuristic.
+            float g;            ///< The g of the node when this entry was pushed.
+            Node* node;
+
+            bool operator<(const OpenEntry& other) const { return f < other.f; }
+            bool operator>(const OpenEntry& other) const { return f > other.f; }
+        };
+
+        /**
+         * Get the node for a waypoint, creating it if this is the first visit.
+         */
+        Node* GetNode(Waypoint* wp, Waypoint* start, Waypoint* end, const RouteFilter* routeFilter);
+
+        /**
+         * Push a node onto the open set with the given estimated total cost.
+         */
+        void Push(Node* node, float f);
+
+        /**
+         * Get the entry with lowest f from the open set, NULL when empty.
+         * The returned entry is valid until the next call to Reset.
+         */
+        OpenEntry* PopMin();
+
+      private:
+        csBlockAllocator<Node>               nodePool;
+        csBlockAllocator<OpenEntry>          openPool;
+        csHash<Node*, csPtrKey<Waypoint> >   nodes;
+        Heap<OpenEntry>                      open;
     };
 
 
@@ -65,6 +147,35 @@ public:
     csWeakRef<iEngine> engine;
     csWeakRef<iDataConnection> db;
     psWorld * world;
+
+    psRouteCache routeCache;   ///< Cache of previous calculated routes.
+
+    psSpatialIndex<Waypoint> waypointIndex; ///< Per sector grid of all waypoints.
+    psSpatialIndex<psPath>   pathIndex;     ///< Per sector grid of all path segments.
+    bool spatialIndexValid;                 ///< True when the spatial indexes has been built.
+
+    psPathNetwork();
+
+    /**
+     * Have to be called whenever waypoints or paths are changed.
+     *
+     * Invalidate all cached routes.
+     */
+    void NetworkChanged();
+
+    /**
+     * Have to be called when a waypoint is moved.
+     *
+     * Update the spatial index for the waypoint and the paths connected to it.
+     */
+    void WaypointChanged(Waypoint* wp);
+
+    /**
+     * Have to be called when a point is added, removed or moved in a path.
+     *
+     * Update the spatial index for the path.
+     */
+    void PathChanged(psPath* path);
     
     
     /**
@@ -206,6 +317,21 @@ public:
      */
     csList<Waypoint*> FindWaypointRoute(Waypoint * start, Waypoint * end, const RouteFilter* routeFilter);
 
+    /**
+     * Find the shortest route between waypoint start and stop.
+     *
+     * Use A* with the straight line distance to the end waypoint as the
+     * heuristic. No state is stored in the waypoints, so this can be
+     * called from several threads as long as each use its own search object.
+     *
+     * @param start            The waypoint to start from.
+     * @param end              The waypoint to find a route to.
+     * @param routeFilter      Filter used to exclude waypoints from the route.
+     * @param search           Scratch state for the search.
+     * @return The waypoints on the route including start and end, or an empty list if no route was found.
+     */
+    csList<Waypoint*> FindWaypointRoute(Waypoint * start, Waypoint * end, const RouteFilter* routeFilter, RouteSearch& search);
+
     /**
      * Find the shortest route between waypoint start and stop.
      */
@@ -247,6 +373,45 @@ public:
      */
     Edge* FindEdge(const Waypoint * wp1, const Waypoint * wp2);
 
+    /**
+     * Build the spatial indexes for all waypoints and paths.
+     */
+    void BuildSpatialIndex();
+
+    /**
+     * Insert or update a waypoint in the spatial index.
+     */
+    void IndexWaypoint(Waypoint* wp);
+
+    /**
+     * Insert or update a path in the spatial index.
+     */
+    void IndexPath(psPath* path);
+
+    /**
+     * Get all waypoints that may be within range of a position.
+     *
+     * Search all sectors connected by warp portals to the given sector.
+     * If range is negative all waypoints are returned.
+     */
+    void FindWaypointCandidates(const csVector3& v, iSector* sector, float range, csArray<Waypoint*>& candidates);
+
+    /**
+     * Get all paths that may be within range of a position.
+     *
+     * Search all sectors connected by warp portals to the given sector.
+     * If range is negative all paths are returned.
+     */
+    void FindPathCandidates(const csVector3& v, iSector* sector, float range, csArray<psPath*>& candidates);
+
+    /**
+     * Estimate the distance from a waypoint to the end waypoint of a route search.
+     *
+     * Will never overestimate, waypoints in sectors without any known warp
+     * to the end sector is given an estimate of 0.
+     */
+    float RouteHeuristic(const Waypoint* wp, const Waypoint* end);
+
 
     /**
      * Create a new waypoint and insert in db.
@@ -0,0 +1,187 @@
+/*
+ * psroutecache.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#include <psconfig.h>
+
+//====================================================================================
+// Project Includes
+//====================================================================================
+#include "util/consoleout.h"
+
+//====================================================================================
+// Local Includes
+//====================================================================================
+#include "psroutecache.h"
+
+psRouteCache::psRouteCache(size_t capacity)
+    : newest(NULL), oldest(NULL), capacity(capacity),
+      hits(0), misses(0), evictions(0), invalidations(0)
+{
+}
+
+psRouteCache::~psRouteCache()
+{
+    Invalidate();
+}
+
+bool psRouteCache::Get(int startId, int endId, uint32 filterKey, csList<Waypoint*>& route)
+{
+    // Waypoints not saved yet all share the id -1
+    if (startId < 0 || endId < 0)
+    {
+        return false;
+    }
+
+    CS::Threading::MutexScopedLock lock(mutex);
+
+    Key key = { startId, endId, filterKey };
+    Entry* entry = entries.Get(key, NULL);
+    if (!entry)
+    {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    Unlink(entry);
+    LinkNewest(entry);
+
+    for (size_t i = 0; i < entry->route.GetSize(); i++)
+    {
+        route.PushBack(entry->route[i]);
+    }
+
+    return true;
+}
+
+void psRouteCache::Put(int startId, int endId, uint32 filterKey, const csList<Waypoint*>& route)
+{
+    if (startId < 0 || endId < 0)
+    {
+        return;
+    }
+
+    CS::Threading::MutexScopedLock lock(mutex);
+
+    if (capacity == 0)
+    {
+        return;
+    }
+
+    Key key = { startId, endId, filterKey };
+    Entry* entry = entries.Get(key, NULL);
+    if (entry)
+    {
+        Unlink(entry);
+    }
+    else
+    {
+        while (entries.GetSize() >= capacity)
+        {
+            EvictOne();
+        }
+        entry = new Entry;
+        entry->key = key;
+        entries.Put(key, entry);
+    }
+    LinkNewest(entry);
+
+    entry->route.Empty();
+    csList<Waypoint*>::Iterator iter(route);
+    while (iter.HasNext())
+    {
+        entry->route.Push(iter.Next());
+    }
+    entry->route.ShrinkBestFit();
+}
+
+void psRouteCache::Unlink(Entry* entry)
+{
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        newest = entry->older;
+
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        oldest = entry->newer;
+}
+
+void psRouteCache::LinkNewest(Entry* entry)
+{
+    entry->newer = NULL;
+    entry->older = newest;
+    if (newest)
+        newest->newer = entry;
+    else
+        oldest = entry;
+    newest = entry;
+}
+
+void psRouteCache::EvictOne()
+{
+    Entry* entry = oldest;
+    if (entry)
+    {
+        Unlink(entry);
+        entries.Delete(entry->key, entry);
+        delete entry;
+        evictions++;
+    }
+}
+
+void psRouteCache::Invalidate()
+{
+    CS::Threading::MutexScopedLock lock(mutex);
+
+    while (oldest)
+    {
+        Entry* entry = oldest;
+        oldest = entry->newer;
+        delete entry;
+    }
+    newest = NULL;
+    if (!entries.IsEmpty())
+    {
+        invalidations++;
+    }
+    entries.Empty();
+}
+
+void psRouteCache::SetCapacity(size_t capacity)
+{
+    CS::Threading::MutexScopedLock lock(mutex);
+
+    this->capacity = capacity;
+    while (entries.GetSize() > capacity)
+    {
+        EvictOne();
+    }
+}
+
+void psRouteCache::PrintStats()
+{
+    CS::Threading::MutexScopedLock lock(mutex);
+
+    uint32 lookups = hits + misses;
+    CPrintf(CON_CMDOUTPUT, "Route cache: %zu/%zu routes, %u lookups, %u hits (%.1f%%), %u misses, %u evictions, %u invalidations\n",
+            entries.GetSize(), capacity, lookups, hits,
+            lookups ? (100.0f*hits)/lookups : 0.0f,
+            misses, evictions, invalidations);
+}
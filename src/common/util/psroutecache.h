@@ -0,0 +1,142 @@
+/*
+ * psroutecache.h
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#ifndef __PSROUTECACHE_H__
+#define __PSROUTECACHE_H__
+
+#include <csutil/array.h>
+#include <csutil/hash.h>
+#include <csutil/list.h>
+#include <csutil/threading/mutex.h>
+
+class Waypoint;
+
+/**
+ * \addtogroup common_util
+ * @{ */
+
+/**
+ * A LRU cache of calculated waypoint routes.
+ *
+ * Routes are stored as compact arrays of waypoints keyed by the start
+ * waypoint, the end waypoint and the key of the route filter used.
+ * Since the stored routes point directly to waypoints the whole cache
+ * has to be invalidated whenever the path network is edited. Routes of
+ * waypoints not saved yet (id -1) are never cached.
+ */
+class psRouteCache
+{
+public:
+    /**
+     * Create a new cache holding at most capacity routes.
+     */
+    psRouteCache(size_t capacity = 512);
+    ~psRouteCache();
+
+    /**
+     * Look up a route.
+     *
+     * @param startId    The id of the start waypoint.
+     * @param endId      The id of the end waypoint.
+     * @param filterKey  The key of the route filter used.
+     * @param[out] route Set to the cached route if found.
+     * @return True if the route was found in the cache.
+     */
+    bool Get(int startId, int endId, uint32 filterKey, csList<Waypoint*>& route);
+
+    /**
+     * Store a route. Empty routes are stored as well, so failing
+     * lookups is cached too.
+     */
+    void Put(int startId, int endId, uint32 filterKey, const csList<Waypoint*>& route);
+
+    /**
+     * Remove all routes from the cache.
+     *
+     * Has to be called whenever waypoints or paths are changed.
+     */
+    void Invalidate();
+
+    /**
+     * Set the max number of routes in the cache.
+     */
+    void SetCapacity(size_t capacity);
+
+    /**
+     * Print hit rate statistics to the console.
+     */
+    void PrintStats();
+
+private:
+    struct Key
+    {
+        int    startId;
+        int    endId;
+        uint32 filterKey;
+
+        // required to be used in csHash
+        uint GetHash() const
+        {
+            return uint(startId)*2654435761u ^ uint(endId)*40503u ^ filterKey;
+        }
+
+        // required by csComparator used in csHash
+        bool operator<(const Key& rhs) const
+        {
+            if (startId != rhs.startId)
+                return startId < rhs.startId;
+            if (endId != rhs.endId)
+                return endId < rhs.endId;
+            return filterKey < rhs.filterKey;
+        }
+    };
+
+    struct Entry
+    {
+        Key                key;
+        csArray<Waypoint*> route;    ///< The route including start and end waypoint.
+        Entry*             newer;    ///< Next entry in the LRU list, towards the most recently used.
+        Entry*             older;    ///< Previous entry in the LRU list, towards the least recently used.
+    };
+
+    /// Unlink an entry from the LRU list.
+    void Unlink(Entry* entry);
+
+    /// Link an entry in as the most recently used one.
+    void LinkNewest(Entry* entry);
+
+    /// Remove the least recently used entry.
+    void EvictOne();
+
+    csHash<Entry*, Key>      entries;
+    Entry*                   newest;
+    Entry*                   oldest;
+    size_t                   capacity;
+
+    // Statistics
+    uint32                   hits;
+    uint32                   misses;
+    uint32                   evictions;
+    uint32                   invalidations;
+
+    CS::Threading::Mutex     mutex;
+};
+
+/** @} */
+
+#endif
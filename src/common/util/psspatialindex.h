@@ -0,0 +1,235 @@
+/*
+ * psspatialindex.h
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#ifndef __PSSPATIALINDEX_H__
+#define __PSSPATIALINDEX_H__
+
+#include <csgeom/box.h>
+#include <csutil/array.h>
+#include <csutil/hash.h>
+#include <csutil/set.h>
+
+struct iSector;
+
+/**
+ * \addtogroup common_util
+ * @{ */
+
+/**
+ * A per sector uniform grid over objects in the world.
+ *
+ * Objects are inserted with a bounding box in the x/z plane of their
+ * sector, and can be queried for all objects overlapping a box. The
+ * grid does not know about warp portals, callers that need to search
+ * across sectors have to transform the query into each sector first.
+ *
+ * Sectors are identified by their iSector by default, K can be set to
+ * any other hash key, like the sector id from the database.
+ *
+ * Objects can be removed and inserted again at any time, so the index
+ * can be kept updated while the objects are edited.
+ */
+template <class T, class K = csPtrKey<iSector> >
+class psSpatialIndex
+{
+public:
+    psSpatialIndex(float cellSize = 32.0f)
+        : cellSize(cellSize)
+    {
+    }
+
+    ~psSpatialIndex()
+    {
+        Clear();
+    }
+
+    /**
+     * Insert an object covering the given box in a sector.
+     *
+     * An object can be inserted several times, with different boxes or
+     * in different sectors, to cover objects that span sectors.
+     */
+    void Add(T* item, const K &sector, const csBox2 &box)
+    {
+        Grid* grid = grids.Get(sector, NULL);
+        if(!grid)
+        {
+            grid = new Grid;
+            grids.Put(sector, grid);
+            sectors.Push(sector);
+        }
+
+        int minX = CellCoord(box.MinX());
+        int minZ = CellCoord(box.MinY());
+        int maxX = CellCoord(box.MaxX());
+        int maxZ = CellCoord(box.MaxY());
+
+        csArray<CellRef>* refs = itemCells.GetElementPointer(csPtrKey<T>(item));
+        if(!refs)
+        {
+            itemCells.Put(csPtrKey<T>(item), csArray<CellRef>());
+            refs = itemCells.GetElementPointer(csPtrKey<T>(item));
+        }
+
+        for(int x = minX; x <= maxX; x++)
+        {
+            for(int z = minZ; z <= maxZ; z++)
+            {
+                uint32 key = CellKey(x,z);
+                csArray<T*>* cell = grid->GetElementPointer(key);
+                if(!cell)
+                {
+                    grid->Put(key, csArray<T*>());
+                    cell = grid->GetElementPointer(key);
+                }
+                if(cell->Find(item) == csArrayItemNotFound)
+                {
+                    cell->Push(item);
+
+                    CellRef ref;
+                    ref.grid = grid;
+                    ref.key = key;
+                    refs->Push(ref);
+                }
+            }
+        }
+    }
+
+    /**
+     * Remove all entries of an object from the index.
+     */
+    void Remove(T* item)
+    {
+        csArray<CellRef>* refs = itemCells.GetElementPointer(csPtrKey<T>(item));
+        if(!refs)
+        {
+            return;
+        }
+
+        for(size_t i = 0; i < refs->GetSize(); i++)
+        {
+            csArray<T*>* cell = (*refs)[i].grid->GetElementPointer((*refs)[i].key);
+            if(cell)
+            {
+                cell->Delete(item);
+            }
+        }
+        itemCells.DeleteAll(csPtrKey<T>(item));
+    }
+
+    /**
+     * Remove all objects from the index.
+     */
+    void Clear()
+    {
+        typename csHash<Grid*, K>::GlobalIterator iter(grids.GetIterator());
+        while(iter.HasNext())
+        {
+            delete iter.Next();
+        }
+        grids.Empty();
+        sectors.Empty();
+        itemCells.Empty();
+    }
+
+    /**
+     * Find all objects in a sector that may overlap the given box.
+     *
+     * Each object is only added once to the result, found is used
+     * to track the objects already added.
+     */
+    void Query(const K &sector, const csBox2 &box, csArray<T*> &result, csSet<csPtrKey<T> > &found) const
+    {
+        Grid* grid = grids.Get(sector, NULL);
+        if(!grid)
+        {
+            return;
+        }
+
+        int minX = CellCoord(box.MinX());
+        int minZ = CellCoord(box.MinY());
+        int maxX = CellCoord(box.MaxX());
+        int maxZ = CellCoord(box.MaxY());
+
+        for(int x = minX; x <= maxX; x++)
+        {
+            for(int z = minZ; z <= maxZ; z++)
+            {
+                const csArray<T*>* cell = grid->GetElementPointer(CellKey(x,z));
+                if(!cell)
+                {
+                    continue;
+                }
+                for(size_t i = 0; i < cell->GetSize(); i++)
+                {
+                    T* item = (*cell)[i];
+                    if(!found.Contains(csPtrKey<T>(item)))
+                    {
+                        found.AddNoTest(csPtrKey<T>(item));
+                        result.Push(item);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Get the size of the grid cells.
+     */
+    float GetCellSize() const
+    {
+        return cellSize;
+    }
+
+    /**
+     * Get all sectors with objects in the index.
+     */
+    const csArray<K> &GetSectors() const
+    {
+        return sectors;
+    }
+
+private:
+    typedef csHash<csArray<T*>, uint32> Grid;
+
+    /// Location of one entry of an object, used to remove the object again.
+    struct CellRef
+    {
+        Grid*  grid;
+        uint32 key;
+    };
+
+    int CellCoord(float coord) const
+    {
+        return (int)floorf(coord/cellSize);
+    }
+
+    static uint32 CellKey(int x, int z)
+    {
+        return (uint32(x & 0xFFFF) << 16) | uint32(z & 0xFFFF);
+    }
+
+    float                                  cellSize;
+    csHash<Grid*, K>                       grids;
+    csArray<K>                             sectors;
+    csHash<csArray<CellRef>, csPtrKey<T> > itemCells;
+};
+
+/** @} */
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * pstrace.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#include <psconfig.h>
+
+//====================================================================================
+// Crystal Space Includes
+//====================================================================================
+#include <csutil/array.h>
+#include <csutil/csstring.h>
+#include <csutil/strset.h>
+#include <csutil/threading/atomicops.h>
+#include <csutil/threading/mutex.h>
+#include <csutil/threading/tls.h>
+
+#include <stdio.h>
+
+//====================================================================================
+// Local Includes
+//====================================================================================
+#include "pstrace.h"
+
+/// A finished span.
+struct psTraceRecord
+{
+    const char* name;
+    int         id;
+    int64       start;
+    int64       duration;
+};
+
+/**
+ * The spans of one thread.
+ *
+ * Only the owning thread writes, the oldest spans are overwritten when
+ * the buffer is full. Readers copy the spans and check head again
+ * afterwards to skip the ones overwritten while copying.
+ */
+struct psTraceBuffer
+{
+    psTraceRecord records[PS_TRACE_BUFFER_SIZE];
+    int32         head;
+    uint32        cleared;   ///< Spans before this were cleared, guarded by the trace mutex.
+    int           tid;
+    csString      name;
+};
+
+/// Thread local reference to the buffer of a thread.
+struct psTraceBufferHandle
+{
+    psTraceBuffer* buffer;
+
+    psTraceBufferHandle() : buffer(NULL)
+    {
+    }
+};
+
+bool psTrace::enabled = true;
+
+// Buffers of exited threads are kept, their spans are still of interest.
+static CS::Threading::Mutex traceMutex;
+static csArray<psTraceBuffer*> traceBuffers;
+static CS::Threading::ThreadLocal<psTraceBufferHandle> localTraceBuffer;
+static csStringSet traceNames;
+
+static psTraceBuffer* GetTraceBuffer()
+{
+    psTraceBufferHandle &handle = localTraceBuffer.Get();
+    if(!handle.buffer)
+    {
+        psTraceBuffer* buffer = new psTraceBuffer;
+        buffer->head = 0;
+        buffer->cleared = 0;
+
+        CS::Threading::MutexScopedLock lock(traceMutex);
+        buffer->tid = (int)traceBuffers.GetSize() + 1;
+        buffer->name.Format("thread %d", buffer->tid);
+        traceBuffers.Push(buffer);
+        handle.buffer = buffer;
+    }
+    return handle.buffer;
+}
+
+static csString EscapeJSON(const char* str)
+{
+    csString escaped;
+    for(; *str; str++)
+    {
+        if(*str == '"' || *str == '\\')
+        {
+            escaped.Append('\\');
+        }
+        escaped.Append(*str);
+    }
+    return escaped;
+}
+
+void psTrace::SetEnabled(bool enable)
+{
+    enabled = enable;
+}
+
+void psTrace::SetThreadName(const char* name)
+{
+    psTraceBuffer* buffer = GetTraceBuffer();
+
+    CS::Threading::MutexScopedLock lock(traceMutex);
+    buffer->name = name;
+}
+
+const char* psTrace::Intern(const char* name)
+{
+    CS::Threading::MutexScopedLock lock(traceMutex);
+    return traceNames.Request(traceNames.Request(name));
+}
+
+void psTrace::AddSpan(const char* name, int id, int64 start, int64 end)
+{
+    psTraceBuffer* buffer = GetTraceBuffer();
+
+    uint32 head = (uint32)buffer->head;
+    psTraceRecord &record = buffer->records[head & (PS_TRACE_BUFFER_SIZE-1)];
+    record.name = name;
+    record.id = id;
+    record.start = start;
+    record.duration = end - start;
+    CS::Threading::AtomicOperations::Set(&buffer->head, (int32)(head + 1));
+}
+
+int psTrace::ExportChrome(const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if(!file)
+    {
+        return -1;
+    }
+
+    CS::Threading::MutexScopedLock lock(traceMutex);
+
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    int count = 0;
+    csArray<psTraceRecord> records;
+    for(size_t b = 0; b < traceBuffers.GetSize(); b++)
+    {
+        psTraceBuffer* buffer = traceBuffers[b];
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                b ? ",\n" : "", buffer->tid, EscapeJSON(buffer->name).GetData());
+
+        uint32 head = (uint32)CS::Threading::AtomicOperations::Read(&buffer->head);
+        uint32 first = head > PS_TRACE_BUFFER_SIZE ? head - PS_TRACE_BUFFER_SIZE : 0;
+        if(head - buffer->cleared < head - first)
+        {
+            first = buffer->cleared;
+        }
+
+        records.Empty();
+        for(uint32 i = first; i != head; i++)
+        {
+            records.Push(buffer->records[i & (PS_TRACE_BUFFER_SIZE-1)]);
+        }
+
+        // Skip the spans the thread overwrote while they were copied, and
+        // the one it may be writing at newHead right now
+        uint32 newHead = (uint32)CS::Threading::AtomicOperations::Read(&buffer->head);
+        uint32 skip = 0;
+        if(newHead - first >= PS_TRACE_BUFFER_SIZE)
+        {
+            skip = csMin((uint32)records.GetSize(), newHead - first - PS_TRACE_BUFFER_SIZE + 1);
+        }
+
+        for(size_t i = skip; i < records.GetSize(); i++)
+        {
+            const psTraceRecord &record = records[i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"args\":{\"id\":%d}}",
+                    EscapeJSON(record.name).GetData(), buffer->tid,
+                    (long long)record.start, (long long)record.duration, record.id);
+            count++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    return count;
+}
+
+void psTrace::Clear()
+{
+    // Only the owning threads write their buffers, so just remember
+    // where the spans to export start.
+    CS::Threading::MutexScopedLock lock(traceMutex);
+    for(size_t b = 0; b < traceBuffers.GetSize(); b++)
+    {
+        traceBuffers[b]->cleared = (uint32)CS::Threading::AtomicOperations::Read(&traceBuffers[b]->head);
+    }
+}
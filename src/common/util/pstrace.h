@@ -0,0 +1,128 @@
+/*
+ * pstrace.h
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#ifndef __PSTRACE_H__
+#define __PSTRACE_H__
+
+#include <csutil/sysfunc.h>
+
+/**
+ * \addtogroup common_util
+ * @{ */
+
+/// Number of spans kept per thread, has to be a power of two.
+#define PS_TRACE_BUFFER_SIZE 8192
+
+/**
+ * Always on tracing of where the time goes in the threads of a program.
+ *
+ * Code marks the spans to measure with PS_TRACE_SCOPE. Each thread keeps
+ * its last PS_TRACE_BUFFER_SIZE spans in its own buffer, so recording a
+ * span takes no lock. The buffers can be exported at any time to the
+ * Chrome trace event format, to be viewed in chrome://tracing.
+ */
+class psTrace
+{
+public:
+    /**
+     * Enable or disable recording new spans.
+     */
+    static void SetEnabled(bool enable);
+
+    static bool IsEnabled()
+    {
+        return enabled;
+    }
+
+    /**
+     * Name the calling thread in the exported traces.
+     */
+    static void SetThreadName(const char* name);
+
+    /**
+     * Get a copy of a name that stays valid, for span names that are
+     * not string literals.
+     */
+    static const char* Intern(const char* name);
+
+    /**
+     * Record a span of the calling thread.
+     *
+     * @param name The name of the span, has to stay valid, see Intern().
+     * @param id   A number shown with the span, like the message type.
+     * @param start The start of the span from csGetMicroTicks().
+     * @param end  The end of the span from csGetMicroTicks().
+     */
+    static void AddSpan(const char* name, int id, int64 start, int64 end);
+
+    /**
+     * Write the recorded spans of all threads to a file in the Chrome
+     * trace event format.
+     *
+     * @return The number of spans written, -1 if the file couldn't be written.
+     */
+    static int ExportChrome(const char* filename);
+
+    /**
+     * Forget all recorded spans.
+     */
+    static void Clear();
+
+private:
+    static bool enabled;
+};
+
+/**
+ * Record the time from construction to destruction as a span.
+ */
+class psTraceScope
+{
+public:
+    psTraceScope(const char* name, int id = 0)
+        : name(name), id(id), start(psTrace::IsEnabled() ? csGetMicroTicks() : -1)
+    {
+    }
+
+    ~psTraceScope()
+    {
+        if(start >= 0)
+        {
+            psTrace::AddSpan(name, id, start, csGetMicroTicks());
+        }
+    }
+
+private:
+    const char* name;
+    int         id;
+    int64       start;
+};
+
+#define PS_TRACE_CONCAT2(a,b) a##b
+#define PS_TRACE_CONCAT(a,b)  PS_TRACE_CONCAT2(a,b)
+
+/// Trace the rest of the enclosing scope, name has to stay valid.
+#define PS_TRACE_SCOPE(name) \
+    psTraceScope PS_TRACE_CONCAT(psTraceScope_,__LINE__)(name)
+
+/// Trace the rest of the enclosing scope with a number, like a message type.
+#define PS_TRACE_SCOPE_ID(name,id) \
+    psTraceScope PS_TRACE_CONCAT(psTraceScope_,__LINE__)(name,id)
+
+/** @} */
+
+#endif
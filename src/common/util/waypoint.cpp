@@ -90,16 +90,12 @@ bool WaypointAlias::SetRotationAngle(iDataConnection* db, float rotationAngle)
 Waypoint::Waypoint()
     :effectID(0)
 {
-    distance = 0.0;
-    pi = NULL;
     loc.id = -1;
 }
 
 Waypoint::Waypoint(const char* name)
     :effectID(0)
 {
-    distance = 0.0;
-    pi = NULL;
     loc.id = -1;
     loc.name = name;
 }
@@ -109,8 +105,6 @@ Waypoint::Waypoint(csString& name,
                    float radius, csString& flags)
     :effectID(0)
 {
-    distance = 0.0;
-    pi = NULL;
     loc.id = -1;
     loc.name = name;
     loc.pos = pos;
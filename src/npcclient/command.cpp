@@ -174,7 +174,7 @@ int com_list(const char* arg)
 
     if(words.GetCount() == 0 || strncasecmp(words[0],"help",1) == 0)
     {
-        CPrintf(CON_CMDOUTPUT,"Syntax: list [char|ent|help|loc|npc|path|race|reactions|recipe|tribe|warpspace|waypoint] <pattern|EID>\n");
+        CPrintf(CON_CMDOUTPUT,"Syntax: list [char|ent|help|loc|npc|path|pathquery|race|reactions|recipe|routecache|tribe|warpspace|waypoint] <pattern|EID>\n");
         CPrintf(CON_CMDOUTPUT,"Sub commands:\n");
         CPrintf(CON_CMDOUTPUT,"  char|npc [summary|stats|<pattern>]\n");
         return 0;
@@ -197,6 +197,10 @@ int com_list(const char* arg)
     {
         npcclient->ListAllNPCs(words[1]);
     }
+    else if(strncasecmp(words[0],"pathquery",5) == 0)
+    {
+        npcclient->ListPathQueries();
+    }
     else if(strncasecmp(words[0],"path",1) == 0)
     {
         npcclient->ListPaths(words[1]);
@@ -216,6 +220,10 @@ int com_list(const char* arg)
     {
         npcclient->ListTribeRecipes(words[1]);
     }
+    else if(strncasecmp(words[0],"routecache",3) == 0)
+    {
+        npcclient->ListRouteCache();
+    }
     else if(strncasecmp(words[0],"tribe",1) == 0)
     {
         npcclient->ListTribes(words[1]);
@@ -290,6 +298,12 @@ int com_showlogs(const char* line)
     return 0;
 }
 
+int com_logstats(const char* line)
+{
+    pslog::DisplayStats();
+    return 0;
+}
+
 int com_print(const char* line)
 {
     if(!npcclient->DumpNPC(line))
@@ -519,7 +533,8 @@ const COMMAND commands[] =
     { "fireperc",     false, com_fireperc,     "Fire the given perception on the given npc. (fireperc [npcPID] [perception])"},
     { "help",         false, com_help,         "Show help information" },
     { "info",         false, com_info,         "Short print for 1 NPC"},
-    { "list",         false, com_list,         "List entities ( list [char|ent|loc|npc|path|race|recipe|tribe|warpspace|waypoint] <filter> )" },
+    { "list",         false, com_list,         "List entities ( list [char|ent|loc|npc|path|pathquery|race|recipe|routecache|tribe|warpspace|waypoint] <filter> )" },
+    { "logstats",     false, com_logstats,     "Show the dropped log messages and the console output statistics" },
     { "print",        false, com_print,        "List all behaviors/hate of 1 NPC"},
     { "quit",         true,  com_quit,         "Makes the npc client exit"},
     { "setbuffer",    false, com_setbuffer,    "Set a npc buffer"},
@@ -473,6 +473,9 @@ void NetworkManager::HandlePathNetwork(MsgEntry* me)
 
     psPathNetwork* pathNetwork = npcclient->GetPathNetwork();
 
+    // All path network commands edit the network, so any cached routes are stale.
+    pathNetwork->NetworkChanged();
+
     switch(msg.command)
     {
         case psPathNetworkMessage::PATH_ADD_POINT:
@@ -482,6 +485,7 @@ void NetworkManager::HandlePathNetwork(MsgEntry* me)
             {
                 psPathPoint* point = path->AddPoint(msg.position, 0.0, msg.sector->QueryObject()->GetName());
                 point->SetID(msg.secondId);
+                pathNetwork->PathChanged(path);
 
                 Debug4(LOG_NET, 0, "Added point %d to path %d at %s.\n",
                        msg.secondId, msg.id, toString(msg.position,msg.sector).GetDataSafe());
@@ -537,6 +541,7 @@ void NetworkManager::HandlePathNetwork(MsgEntry* me)
                 if(index >= 0)
                 {
                     path->RemovePoint(index);
+                    pathNetwork->PathChanged(path);
                     Debug3(LOG_NET, 0, "Removed point %d from path %d.\n", msg.secondId, msg.id);
                 }
                 else
@@ -592,6 +597,7 @@ void NetworkManager::HandlePathNetwork(MsgEntry* me)
             if(point)
             {
                 point->Adjust(msg.position, msg.sector);
+                pathNetwork->PathChanged(point->GetPath());
 
                 Debug3(LOG_NET, 0, "Adjusted pathpoint %d to %s.\n",
                        msg.id, toString(msg.position, msg.sector).GetDataSafe());
@@ -642,6 +648,7 @@ void NetworkManager::HandlePathNetwork(MsgEntry* me)
             if(wp)
             {
                 wp->Adjust(msg.position, msg.sector);
+                pathNetwork->WaypointChanged(wp);
 
                 Debug3(LOG_NET, 0, "Adjusted waypoint %d to %s.\n",
                        msg.id, toString(msg.position, msg.sector).GetDataSafe());
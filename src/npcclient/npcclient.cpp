@@ -64,6 +64,7 @@
 //=============================================================================
 #include "npcclient.h"
 #include "pathfind.h"
+#include "pathquery.h"
 #include "networkmgr.h"
 #include "npcbehave.h"
 #include "npc.h"
@@ -98,6 +99,7 @@ psNPCClient::psNPCClient() : serverconsole(NULL)
     world         = NULL;
     //    PFMaps       = NULL;
     pathNetwork   = NULL;
+    pathQueryService = NULL;
     eventmanager  = NULL;
     recipemanager = NULL;
     running       = true;
@@ -124,10 +126,17 @@ psNPCClient::~psNPCClient()
     running = false;
     delete connection;
     delete network;
+
+    ConsoleOut::StopAsync();
     delete serverconsole;
     delete database;
 
 
+    // The NPCs are deleted after this, the service deletes the queries
+    // their operations still hold. Make sure they don't find it any more.
+    delete pathQueryService;
+    pathQueryService = NULL;
+
     delete pathNetwork;
     //    delete PFMaps;
     delete world;
@@ -371,6 +380,13 @@ void psNPCClient::LoadLogSettings()
     {
         CPrintf(CON_CMDOUTPUT,"All LOGS are off.\n");
     }
+
+    // Write the console output from a background thread, so verbose logs don't stall the game
+    pslog::SetRateLimit(configmanager->GetInt("PlaneShift.Log.RateLimit", 1000));
+    if(configmanager->GetBool("PlaneShift.Log.Async", true))
+    {
+        ConsoleOut::StartAsync();
+    }
 }
 
 void psNPCClient::SaveLogSettings()
@@ -926,6 +942,10 @@ bool psNPCClient::LoadPathNetwork()
         return false;
     }
     csString navmesh = configmanager->GetStr("PlaneShift.NPCClient.NavMesh","/planeshift/navmesh");
+
+    // Navmesh tiles are only loaded when a path needs them, the budget in KB
+    // limits the memory of the loaded tiles of each sector.
+    builder->SetTileBudget((size_t)configmanager->GetInt("PlaneShift.NPCClient.NavMeshTileBudget", 0) * 1024);
     navStruct = builder->LoadHNavStruct(vfs, navmesh);
 
     if(!navStruct.IsValid())
@@ -934,6 +954,24 @@ bool psNPCClient::LoadPathNetwork()
         return false;
     }
 
+    // Each path query worker needs its own copy of the navigation mesh,
+    // the main one is only used by the main loop. Zero threads calculates
+    // all paths in the main loop.
+    int pathQueryThreads = configmanager->GetInt("PlaneShift.NPCClient.PathQueryThreads", 1);
+    csRefArray<iCelHNavStruct> workerNavStructs;
+    for(int i = 0; i < pathQueryThreads; i++)
+    {
+        csRef<iCelHNavStruct> workerNavStruct = builder->LoadHNavStruct(vfs, navmesh);
+        if(!workerNavStruct.IsValid())
+        {
+            Error2("Failed to load navigation mesh for path query thread %d", i);
+            break;
+        }
+        workerNavStructs.Push(workerNavStruct);
+    }
+    pathQueryService = new psPathQueryService(navStruct, workerNavStructs);
+    CPrintf(CON_CMDOUTPUT, "Using %zu path query threads.\n", workerNavStructs.GetSize());
+
     pathNetwork = new psPathNetwork();
     return pathNetwork->Load(engine, db, world);
 }
@@ -1901,6 +1939,11 @@ void psNPCClient::ListPaths(const char* pattern)
     pathNetwork->ListPaths(pattern);
 }
 
+void psNPCClient::ListRouteCache()
+{
+    pathNetwork->routeCache.PrintStats();
+}
+
 void psNPCClient::ListLocations(const char* pattern)
 {
     csHash<LocationType*, csString>::GlobalIterator iter(locationManager->GetIterator());
@@ -2208,43 +2251,41 @@ void psNPCClient::UpdateTime(int minute, int hour, int day, int month, int year)
             gameHour,gameMinute,gameYear,gameMonth,gameDay);
 }
 
-iCelHPath* psNPCClient::ShortestPath(NPC* npc, const csVector3 &from, iSector* fromSector, const csVector3 &goal, iSector* goalSector)
+csPtr<iCelHPath> psNPCClient::ShortestPath(NPC* npc, const csVector3 &from, iSector* fromSector, const csVector3 &goal, iSector* goalSector)
 {
-    if(npc->IsDebugging(5))
+    csRef<iCelHPath> path = pathQueryService->ShortestPath(from,fromSector,goal,goalSector);
+    if(!path)
     {
-        // Seems like the getdebugmeshes destroy the path, so get a separate path for debug...
-        iCelHPath* path = GetNavStruct()->ShortestPath(from,fromSector,goal,goalSector);
-        if(path)
-        {
-            csArray<csSimpleRenderMesh*>* list = path->GetDebugMeshes();
-            csArray<csSimpleRenderMesh*>::Iterator countIter = list->GetIterator();
-            uint16_t count = 0;
-            while(countIter.HasNext())
-            {
-                count++;
-                countIter.Next();
-            }
+        NPCDebug(npc, 5, "Failed to find path");
+    }
 
-            csArray<csSimpleRenderMesh*>::Iterator iter = list->GetIterator();
-            uint16_t index = 0;
-            while(iter.HasNext())
-            {
-                csSimpleRenderMesh* &simpleRenderMesh = iter.Next();
-                psSimpleRenderMeshMessage msg(0, connection->GetAccessPointers(), "NPC Path", index, count, fromSector, *simpleRenderMesh);
-                msghandler->SendMessage(msg.msg);
-                index++;
-            }
-        }
+    return csPtr<iCelHPath>(path);
+}
 
+void psNPCClient::ShowPath(NPC* npc, psPathQuery* query)
+{
+    if(!query->GetPath())
+    {
+        return;
     }
 
-    iCelHPath* path = GetNavStruct()->ShortestPath(from,fromSector,goal,goalSector);
-    if(!path)
+    csArray<csSimpleRenderMesh*>* list = query->GetDebugMeshes();
+    uint16_t count = (uint16_t)list->GetSize();
+
+    csArray<csSimpleRenderMesh*>::Iterator iter = list->GetIterator();
+    uint16_t index = 0;
+    while(iter.HasNext())
     {
-        NPCDebug(npc, 5, "Failed to find path");
+        csSimpleRenderMesh* &simpleRenderMesh = iter.Next();
+        psSimpleRenderMeshMessage msg(0, connection->GetAccessPointers(), "NPC Path", index, count, query->GetStartSector(), *simpleRenderMesh);
+        msghandler->SendMessage(msg.msg);
+        index++;
     }
+}
 
-    return path;
+void psNPCClient::ListPathQueries()
+{
+    pathQueryService->PrintStats();
 }
 
 
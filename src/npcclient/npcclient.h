@@ -73,6 +73,8 @@ class  Waypoint;
 class  Tribe;
 class  psPath;
 class  psPathNetwork;
+class  psPathQuery;
+class  psPathQueryService;
 struct iCelHNavStruct;
 
 /**
@@ -466,6 +468,16 @@ public:
      */
     void ListPaths(const char* pattern);
 
+    /**
+     * Print route cache statistics to console.
+     */
+    void ListRouteCache();
+
+    /**
+     * Print navmesh path query statistics to console.
+     */
+    void ListPathQueries();
+
     /**
      * List all locations matching pattern to console.
      */
@@ -540,7 +552,26 @@ public:
         return navStruct;
     }
 
-    iCelHPath* ShortestPath(NPC* npc, const csVector3 &from, iSector* fromSector, const csVector3 &goal, iSector* goalSector);
+    /**
+     * Calculate a path right away.
+     *
+     * Only meant to check if a path exists, movement operations
+     * request their paths from the path query service.
+     */
+    csPtr<iCelHPath> ShortestPath(NPC* npc, const csVector3 &from, iSector* fromSector, const csVector3 &goal, iSector* goalSector);
+
+    /**
+     * Send a path found by a path query to the client for display.
+     */
+    void ShowPath(NPC* npc, psPathQuery* query);
+
+    /**
+     * Return the service calculating navmesh paths.
+     */
+    psPathQueryService* GetPathQueryService()
+    {
+        return pathQueryService;
+    }
 
     psWorld*  GetWorld()
     {
@@ -782,6 +813,7 @@ protected:
     MathScriptEngine*               mathScriptEngine;
     psPathNetwork*                  pathNetwork;
     csRef<iCelHNavStruct>           navStruct;
+    psPathQueryService*             pathQueryService;
     csPDelArray<NPC>                npcs;
     csArray<DeferredNPC>            npcsDeferred;
     csPDelArray<Tribe>              tribes;
@@ -57,6 +57,7 @@
 #include "gem.h"
 #include "npcmesh.h"
 #include "npcbehave.h"
+#include "pathquery.h"
 
 //---------------------------------------------------------------------------
 
@@ -622,13 +623,15 @@ void ScriptOperation::SetParent(Behavior* behavior)
 //---------------------------------------------------------------------------
 
 MovementOperation::MovementOperation(const char* name)
-    :ScriptOperation(name),endSector(NULL),currentDistance(0.0f)
+    :ScriptOperation(name),pathQuery(NULL),pendingQuery(NULL),endSector(NULL),currentDistance(0.0f)
 {
 }
 
 MovementOperation::MovementOperation(const MovementOperation* other)
     :ScriptOperation(other),
      // Instance variables
+     pathQuery(NULL),
+     pendingQuery(NULL),
      endSector(NULL),
      currentDistance(0.0f),
      // Operation parameters
@@ -636,6 +639,11 @@ MovementOperation::MovementOperation(const MovementOperation* other)
 {
 }
 
+MovementOperation::~MovementOperation()
+{
+    ReleasePaths();
+}
+
 bool MovementOperation::Load(iDocumentNode* node)
 {
     if(!ScriptOperation::Load(node))
@@ -680,47 +688,38 @@ bool PathReachedEndPoint(NPC* npc, iCelHPath* path, const csVector3 &endPos, iSe
 
 
 
-ScriptOperation::OperationResult MovementOperation::Run(NPC* npc, bool interrupted)
+void MovementOperation::RequestPath(NPC* npc, const csVector3 &myPos, iSector* mySector)
 {
-    iSector* mySector;
-    csVector3 myPos;
-
-    // Reset the consec collisions counter each time a movment operation is started
-    if(!interrupted)
-    {
-        consecCollisions = 0;
-    }
+    psPathQueryService* service = npcclient->GetPathQueryService();
 
+    service->Release(pendingQuery);
+    pendingQuery = service->Submit(myPos, mySector, endPos, endSector);
+}
 
-    psGameObject::GetPosition(npc->GetActor(), myPos, mySector);
+ScriptOperation::OperationResult MovementOperation::StartPath(NPC* npc, const csVector3 &myPos, iSector* mySector)
+{
+    // Switch to the new path
+    npcclient->GetPathQueryService()->Release(pathQuery);
+    pathQuery = pendingQuery;
+    pendingQuery = NULL;
+    path = pathQuery->GetPath();
 
-    if(!GetEndPosition(npc, myPos, mySector, endPos, endSector))
+    if(npc->IsDebugging(5))
     {
-        NPCDebug(npc, 5, "Failed to find target position!");
-        StopMovement(npc);
-        return OPERATION_FAILED;  // This operation is complete
+        npcclient->ShowPath(npc, pathQuery);
     }
 
-	// did we reach the final destination?
-    float distance = npcclient->GetWorld()->Distance2(myPos, mySector, endPos, endSector);
-    if(distance < 0.5)
-    {
-        NPCDebug(npc, 5, "We are done..");
-        StopMovement(npc);
-        return OPERATION_COMPLETED;
-    }
-    path = npcclient->ShortestPath(npc, myPos,mySector,endPos,endSector);
     if(!path || !path->HasNext())
     {
         // We really failed to find a path between us and the target
         NPCDebug(npc, 5, "Failed to find a path between %s and %s",
                  toString(myPos, mySector).GetData(),
-                 toString(endPos, endSector).GetData());
+                 toString(pathQuery->GetGoal(), pathQuery->GetGoalSector()).GetData());
 
         StopMovement(npc);
         return OPERATION_FAILED;  // This operation is complete
     }
-    else if(!PathReachedEndPoint(npc, path, endPos, endSector))
+    else if(!PathReachedEndPoint(npc, path, pathQuery->GetGoal(), pathQuery->GetGoalSector()))
     {
         StopMovement(npc);
         return OPERATION_FAILED;
@@ -737,7 +736,7 @@ ScriptOperation::OperationResult MovementOperation::Run(NPC* npc, bool interrupt
         float dummyAngle;
 
         // Find next local destination and start moving towards local destination
-        csRef<iMapNode> dest = path->Next();
+        csRef<iMapNode> dest = pathQuery->Next();
         StartMoveTo(npc, dest->GetPosition(), dest->GetSector(), GetVelocity(npc),
                     action, dummyAngle);
         currentDistance =  npcclient->GetWorld()->Distance2(myPos, mySector,
@@ -753,6 +752,61 @@ ScriptOperation::OperationResult MovementOperation::Run(NPC* npc, bool interrupt
     }
 }
 
+void MovementOperation::ReleasePaths()
+{
+    // The service is gone when the operations are deleted at shutdown
+    psPathQueryService* service = npcclient ? npcclient->GetPathQueryService() : NULL;
+    if(service)
+    {
+        service->Release(pendingQuery);
+        service->Release(pathQuery);
+    }
+    pendingQuery = NULL;
+    pathQuery = NULL;
+    path = NULL;
+}
+
+ScriptOperation::OperationResult MovementOperation::Run(NPC* npc, bool interrupted)
+{
+    iSector* mySector;
+    csVector3 myPos;
+
+    // Reset the consec collisions counter each time a movment operation is started
+    if(!interrupted)
+    {
+        consecCollisions = 0;
+    }
+
+    ReleasePaths();
+
+    psGameObject::GetPosition(npc->GetActor(), myPos, mySector);
+
+    if(!GetEndPosition(npc, myPos, mySector, endPos, endSector))
+    {
+        NPCDebug(npc, 5, "Failed to find target position!");
+        StopMovement(npc);
+        return OPERATION_FAILED;  // This operation is complete
+    }
+
+	// did we reach the final destination?
+    float distance = npcclient->GetWorld()->Distance2(myPos, mySector, endPos, endSector);
+    if(distance < 0.5)
+    {
+        NPCDebug(npc, 5, "We are done..");
+        StopMovement(npc);
+        return OPERATION_COMPLETED;
+    }
+
+    RequestPath(npc, myPos, mySector);
+    if(!pendingQuery->IsDone())
+    {
+        // Start moving when the path is ready in Advance
+        return OPERATION_NOT_COMPLETED;
+    }
+
+    return StartPath(npc, myPos, mySector);
+}
+
 ScriptOperation::OperationResult MovementOperation::Advance(float timedelta, NPC* npc)
 {
 
@@ -770,10 +824,26 @@ ScriptOperation::OperationResult MovementOperation::Advance(float timedelta, NPC
         return OPERATION_FAILED;
     }
 
-    // Check if path endpoint has changed and needs to be updated
+    // Check if a requested path is ready, or if the path endpoint
+    // has changed and needs to be updated
     float distance;
     csRef<iMapNode> dest;
-    if(EndPointChanged(endPos, endSector))
+    bool newPath = false;
+    if(pendingQuery && pendingQuery->IsDone())
+    {
+        OperationResult result = StartPath(npc, myPos, mySector);
+        if(result != OPERATION_NOT_COMPLETED)
+        {
+            return result;
+        }
+        newPath = true;
+    }
+    else if(!path)
+    {
+        // Still waiting for the first path
+        return OPERATION_NOT_COMPLETED;
+    }
+    else if(!pendingQuery && EndPointChanged(endPos, endSector))
     {
         NPCDebug(npc, 8, "target diverged, recalculate path between %s and %s",
                  toString(myPos, mySector).GetData(),
@@ -788,35 +858,25 @@ ScriptOperation::OperationResult MovementOperation::Advance(float timedelta, NPC
             StopMovement(npc);
             return OPERATION_COMPLETED;
         }
-        path = npcclient->ShortestPath(npc, myPos, mySector, endPos, endSector);
-        if(!path || !path->HasNext())
-        {
-            // We really failed to find a path between us and the target
-            NPCDebug(npc, 5, "Failed to find a path between %s and %s",
-                     toString(myPos, mySector).GetData(),
-                     toString(endPos, endSector).GetData());
-            StopMovement(npc);
-            return OPERATION_FAILED;
-        }
-        else if(!PathReachedEndPoint(npc, path, endPos, endSector))
-        {
-            StopMovement(npc);
-            return OPERATION_FAILED;
-        }
-        else if(path->GetDistance() < 0.5)     // Distance already adjusted for offset
-        {
-            NPCDebug(npc, 5, "We are done...");
 
-            StopMovement(npc);
-            return OPERATION_COMPLETED; // This operation is complete
+        // Keep following the old path until the new one is ready
+        RequestPath(npc, myPos, mySector);
+        if(pendingQuery->IsDone())
+        {
+            OperationResult result = StartPath(npc, myPos, mySector);
+            if(result != OPERATION_NOT_COMPLETED)
+            {
+                return result;
+            }
+            newPath = true;
         }
+    }
 
-        // Start moving toward new dest
-        dest = path->Next();
-        StartMoveTo(npc, dest->GetPosition(), dest->GetSector(), GetVelocity(npc),
-                    action, angle);
-        currentDistance = npcclient->GetWorld()->Distance2(myPos, mySector,
-                           dest->GetPosition(), dest->GetSector());
+    if(newPath)
+    {
+        // Already moving toward the first node of the new path
+        dest = path->Current();
+        distance = npcclient->GetWorld()->Distance2(myPos, mySector, dest->GetPosition(), dest->GetSector());
     }
     else
     {
@@ -854,7 +914,7 @@ ScriptOperation::OperationResult MovementOperation::Advance(float timedelta, NPC
             }
             else
             {
-                dest = path->Next();
+                dest = pathQuery->Next();
                 if(dest == NULL) 
                 {
                     NPCDebug(npc, 5, "DEST PATH == NULL.");
@@ -909,6 +969,9 @@ void MovementOperation::InterruptOperation(NPC* npc)
 {
     ScriptOperation::InterruptOperation(npc);
 
+    // Cancel any path still being calculated, Run will request a new one
+    ReleasePaths();
+
     StopMovement(npc);
 }
 
@@ -5448,6 +5511,38 @@ bool WanderOperation::WanderRouteFilter::Filter(const Waypoint* waypoint) const
               (!parent->groundValid || waypoint->ground == parent->ground)));
 }
 
+bool WanderOperation::WanderRouteFilter::GetFilterKey(uint32 &key) const
+{
+    // Two bits for each flag, one for valid and one for the value.
+    const bool flags[][2] =
+    {
+        { parent->undergroundValid, parent->underground },
+        { parent->underwaterValid,  parent->underwater },
+        { parent->privValid,        parent->priv },
+        { parent->pubValid,         parent->pub },
+        { parent->cityValid,        parent->city },
+        { parent->indoorValid,      parent->indoor },
+        { parent->pathValid,        parent->path },
+        { parent->roadValid,        parent->road },
+        { parent->groundValid,      parent->ground }
+    };
+
+    key = 0;
+    for(size_t i = 0; i < sizeof(flags)/sizeof(flags[0]); i++)
+    {
+        if(flags[i][0])
+        {
+            key |= 1 << (2*i);
+            if(flags[i][1])
+            {
+                key |= 1 << (2*i+1);
+            }
+        }
+    }
+
+    return true;
+}
+
 bool WanderOperation::StartMoveTo(NPC* npc, psPathPoint* point)
 {
     float dummyAngle;
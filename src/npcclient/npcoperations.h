@@ -58,6 +58,7 @@ class gemNPCActor;
 class MoveOperation;
 class Waypoint;
 class Behavior;
+class psPathQuery;
 
 /**
 * This is the base class for all operations in action scripts.
@@ -294,6 +295,8 @@ protected:
 
     // Instance variables
     csRef<iCelHPath> path;
+    psPathQuery*     pathQuery;     ///< The query that calculated the path followed
+    psPathQuery*     pendingQuery;  ///< Path requested but not yet calculated
 
     // Cache values for end position
     csVector3 endPos;
@@ -307,11 +310,29 @@ protected:
     // Constructor
     MovementOperation(const MovementOperation* other);
 
+    /**
+     * Request a new path from the current position to the end position.
+     *
+     * The path is calculated in the background, StartPath() has to
+     * be called once the pending query is done.
+     */
+    void RequestPath(NPC* npc, const csVector3 &myPos, iSector* mySector);
+
+    /**
+     * Take the path of the pending query and start moving along it.
+     */
+    OperationResult StartPath(NPC* npc, const csVector3 &myPos, iSector* mySector);
+
+    /**
+     * Release the path and cancel any pending path request.
+     */
+    void ReleasePaths();
+
 public:
 
     MovementOperation(const char*  name);
 
-    virtual ~MovementOperation() { }
+    virtual ~MovementOperation();
 
     virtual bool Load(iDocumentNode* node);
 
@@ -1728,6 +1749,7 @@ protected:
     public:
         WanderRouteFilter(WanderOperation*  parent):parent(parent) {};
         virtual bool Filter(const Waypoint* waypoint) const;
+        virtual bool GetFilterKey(uint32 &key) const;
     protected:
         WanderOperation*  parent;
     };
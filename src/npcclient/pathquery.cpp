@@ -0,0 +1,313 @@
+/*
+* pathquery.cpp
+*
+* Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation (version 2 of the License)
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*
+*/
+#include <psconfig.h>
+
+//=============================================================================
+// Crystal Space Includes
+//=============================================================================
+#include <csutil/sysfunc.h>
+
+//=============================================================================
+// Project Includes
+//=============================================================================
+#include "util/consoleout.h"
+
+//=============================================================================
+// Local Includes
+//=============================================================================
+#include "pathquery.h"
+
+/// Upper bounds in ms of the latency histogram buckets, the last bucket takes the rest.
+static const csTicks latencyBounds[PATH_QUERY_LATENCY_BUCKETS-1] =
+{
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000
+};
+
+//-----------------------------------------------------------------------------
+
+psPathQuery::psPathQuery(psPathQueryService* service, const csVector3 &from, iSector* fromSector,
+                         const csVector3 &goal, iSector* goalSector)
+    : service(service), from(from), fromSector(fromSector),
+      goal(goal), goalSector(goalSector), state(QUEUED), submitted(csGetTicks())
+{
+}
+
+bool psPathQuery::IsDone() const
+{
+    CS::Threading::MutexScopedLock lock(service->mutex);
+    return state == DONE;
+}
+
+csPtr<iMapNode> psPathQuery::Next()
+{
+    csRef<iMapNode> node = path->Next();
+    return csPtr<iMapNode>(node);
+}
+
+csArray<csSimpleRenderMesh*>* psPathQuery::GetDebugMeshes()
+{
+    csArray<csSimpleRenderMesh*>* meshes = path->GetDebugMeshes();
+    path->Restart();
+    return meshes;
+}
+
+//-----------------------------------------------------------------------------
+
+psPathQueryService::Worker::Worker(psPathQueryService* service, psNavContext* context)
+    : service(service), context(context)
+{
+}
+
+void psPathQueryService::Worker::Run()
+{
+    psPathQuery* query;
+    while((query = service->WaitForQuery()) != NULL)
+    {
+        service->Process(query, context);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+psPathQueryService::psPathQueryService(iCelHNavStruct* mainNavStruct,
+                                       const csRefArray<iCelHNavStruct> &workerNavStructs)
+    : stopping(false), submitted(0), completed(0), failed(0), canceled(0), maxLatency(0)
+{
+    for(int i = 0; i < PATH_QUERY_LATENCY_BUCKETS; i++)
+    {
+        latency[i] = 0;
+    }
+
+    // The main structure is never handed to a worker
+    psNavContext* context = new psNavContext;
+    context->navStruct = mainNavStruct;
+    contexts.Push(context);
+
+    for(size_t i = 0; i < workerNavStructs.GetSize(); i++)
+    {
+        context = new psNavContext;
+        context->navStruct = workerNavStructs[i];
+        contexts.Push(context);
+    }
+
+    for(size_t i = 1; i < contexts.GetSize(); i++)
+    {
+        csRef<Worker> worker;
+        worker.AttachNew(new Worker(this, contexts[i]));
+
+        csRef<CS::Threading::Thread> thread;
+        thread.AttachNew(new CS::Threading::Thread(worker));
+        thread->Start();
+        workers.Push(thread);
+    }
+}
+
+psPathQueryService::~psPathQueryService()
+{
+    {
+        CS::Threading::MutexScopedLock lock(mutex);
+        stopping = true;
+        queueCondition.NotifyAll();
+    }
+
+    for(size_t i = 0; i < workers.GetSize(); i++)
+    {
+        workers[i]->Wait();
+    }
+    workers.Empty();
+
+    // The workers are done, so all queries left are queued or done
+    csSet<csPtrKey<psPathQuery> >::GlobalIterator it(queries.GetIterator());
+    while(it.HasNext())
+    {
+        delete (psPathQuery*)it.Next();
+    }
+    queries.Empty();
+    queue.Empty();
+}
+
+psPathQuery* psPathQueryService::Submit(const csVector3 &from, iSector* fromSector,
+                                        const csVector3 &goal, iSector* goalSector)
+{
+    psPathQuery* query = new psPathQuery(this, from, fromSector, goal, goalSector);
+
+    if(!IsAsync())
+    {
+        {
+            CS::Threading::MutexScopedLock lock(mutex);
+            submitted++;
+            queries.Add(query);
+            query->state = psPathQuery::RUNNING;
+        }
+        Process(query, contexts[0]);
+        return query;
+    }
+
+    CS::Threading::MutexScopedLock lock(mutex);
+    submitted++;
+    queries.Add(query);
+    queue.Push(query);
+    queueCondition.NotifyOne();
+
+    return query;
+}
+
+void psPathQueryService::Release(psPathQuery* query)
+{
+    if(!query)
+    {
+        return;
+    }
+
+    CS::Threading::MutexScopedLock lock(mutex);
+    queries.Delete(query);
+    switch(query->state)
+    {
+        case psPathQuery::QUEUED:
+            queue.Delete(query);
+            canceled++;
+            delete query;
+            break;
+        case psPathQuery::RUNNING:
+            // The worker deletes the query when done
+            query->state = psPathQuery::CANCELED;
+            break;
+        default:
+            delete query;
+            break;
+    }
+}
+
+csPtr<iCelHPath> psPathQueryService::ShortestPath(const csVector3 &from, iSector* fromSector,
+                                                  const csVector3 &goal, iSector* goalSector)
+{
+    return FindPath(contexts[0], from, fromSector, goal, goalSector);
+}
+
+csPtr<iCelHPath> psPathQueryService::FindPath(psNavContext* context, const csVector3 &from, iSector* fromSector,
+                                              const csVector3 &goal, iSector* goalSector)
+{
+    CS::Threading::MutexScopedLock lock(context->mutex);
+    csRef<iCelHPath> path = context->navStruct->ShortestPath(from, fromSector, goal, goalSector);
+    if(path)
+    {
+        // Walk the path once to calculate the low level path of every
+        // segment, after the restart it's traversed without the navmesh.
+        while(path->HasNext())
+        {
+            path->Next();
+        }
+        path->Restart();
+    }
+    return csPtr<iCelHPath>(path);
+}
+
+psPathQuery* psPathQueryService::WaitForQuery()
+{
+    CS::Threading::MutexScopedLock lock(mutex);
+    while(!stopping && queue.IsEmpty())
+    {
+        queueCondition.Wait(mutex);
+    }
+
+    if(stopping)
+    {
+        return NULL;
+    }
+
+    psPathQuery* query = queue[0];
+    queue.DeleteIndex(0);
+    query->state = psPathQuery::RUNNING;
+
+    return query;
+}
+
+void psPathQueryService::Process(psPathQuery* query, psNavContext* context)
+{
+    csRef<iCelHPath> path = FindPath(context, query->from, query->fromSector,
+                                     query->goal, query->goalSector);
+
+    CS::Threading::MutexScopedLock lock(mutex);
+    AddLatency(csGetTicks() - query->submitted);
+
+    if(query->state == psPathQuery::CANCELED)
+    {
+        canceled++;
+        delete query;
+        return;
+    }
+
+    if(path)
+    {
+        completed++;
+    }
+    else
+    {
+        failed++;
+    }
+
+    query->path = path;
+    query->state = psPathQuery::DONE;
+}
+
+void psPathQueryService::AddLatency(csTicks ticks)
+{
+    if(ticks > maxLatency)
+    {
+        maxLatency = ticks;
+    }
+
+    int bucket = 0;
+    while(bucket < PATH_QUERY_LATENCY_BUCKETS-1 && ticks > latencyBounds[bucket])
+    {
+        bucket++;
+    }
+    latency[bucket]++;
+}
+
+void psPathQueryService::PrintStats()
+{
+    CS::Threading::MutexScopedLock lock(mutex);
+
+    CPrintf(CON_CMDOUTPUT, "Path queries: %s, %zu workers, %zu queued\n",
+            IsAsync() ? "async" : "sync", workers.GetSize(), queue.GetSize());
+    CPrintf(CON_CMDOUTPUT, "Submitted %u, found %u, failed %u, canceled %u, max latency %u ms\n",
+            submitted, completed, failed, canceled, maxLatency);
+
+    uint32 total = 0;
+    for(int i = 0; i < PATH_QUERY_LATENCY_BUCKETS; i++)
+    {
+        total += latency[i];
+    }
+
+    for(int i = 0; i < PATH_QUERY_LATENCY_BUCKETS; i++)
+    {
+        csString range;
+        if(i < PATH_QUERY_LATENCY_BUCKETS-1)
+        {
+            range.Format("<= %4u ms", latencyBounds[i]);
+        }
+        else
+        {
+            range.Format(" > %4u ms", latencyBounds[i-1]);
+        }
+        CPrintf(CON_CMDOUTPUT, "  %s %8u %5.1f%%\n", range.GetData(), latency[i],
+                total ? (100.0f*latency[i])/total : 0.0f);
+    }
+}
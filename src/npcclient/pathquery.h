@@ -0,0 +1,257 @@
+/*
+* pathquery.h
+*
+* Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation (version 2 of the License)
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*
+*/
+#ifndef __PATHQUERY_H__
+#define __PATHQUERY_H__
+
+//=============================================================================
+// Crystal Space Includes
+//=============================================================================
+#include <csgeom/vector3.h>
+#include <csutil/array.h>
+#include <csutil/parray.h>
+#include <csutil/ref.h>
+#include <csutil/refarr.h>
+#include <csutil/set.h>
+#include <csutil/threading/condition.h>
+#include <csutil/threading/mutex.h>
+#include <csutil/threading/thread.h>
+#include <tools/celhpf.h>
+
+/**
+ * \addtogroup npcclient
+ * @{ */
+
+struct iSector;
+class psPathQueryService;
+
+/// Number of buckets in the path query latency histogram.
+#define PATH_QUERY_LATENCY_BUCKETS 11
+
+/**
+ * A navigation structure and the lock serializing its use.
+ *
+ * A navigation structure keeps the search state of its navmeshes, so it
+ * can only be used by one thread at a time.
+ */
+struct psNavContext
+{
+    csRef<iCelHNavStruct> navStruct;
+    CS::Threading::Mutex  mutex;
+};
+
+/**
+ * A navmesh path request handed to the psPathQueryService.
+ *
+ * Queries are owned by the service. The requester polls IsDone() and
+ * has to hand the query back with psPathQueryService::Release() when
+ * the path is no longer used.
+ */
+class psPathQuery
+{
+    friend class psPathQueryService;
+public:
+    /**
+     * Check if the path has been calculated.
+     */
+    bool IsDone() const;
+
+    /**
+     * Get the calculated path, NULL if no path was found.
+     *
+     * Only valid once IsDone() returns true.
+     */
+    iCelHPath* GetPath() const
+    {
+        return path;
+    }
+
+    /**
+     * Advance to the next node of the path.
+     *
+     * The low level path of every segment is calculated with the path, so
+     * this doesn't touch the navigation structure and never blocks.
+     */
+    csPtr<iMapNode> Next();
+
+    /**
+     * Get the debug meshes of the path. The path is restarted afterwards.
+     */
+    csArray<csSimpleRenderMesh*>* GetDebugMeshes();
+
+    /**
+     * Get the sector the path was requested from.
+     */
+    iSector* GetStartSector() const
+    {
+        return fromSector;
+    }
+
+    /**
+     * Get the goal the path was requested to.
+     */
+    const csVector3 &GetGoal() const
+    {
+        return goal;
+    }
+
+    /**
+     * Get the sector of the goal the path was requested to.
+     */
+    iSector* GetGoalSector() const
+    {
+        return goalSector;
+    }
+
+private:
+    enum State
+    {
+        QUEUED,
+        RUNNING,
+        DONE,
+        CANCELED
+    };
+
+    psPathQuery(psPathQueryService* service, const csVector3 &from, iSector* fromSector,
+                const csVector3 &goal, iSector* goalSector);
+
+    psPathQueryService* service;
+    csVector3           from;
+    iSector*            fromSector;
+    csVector3           goal;
+    iSector*            goalSector;
+    csRef<iCelHPath>    path;
+    State               state;
+    csTicks             submitted;  ///< Time the query was queued, used for the latency statistics.
+};
+
+/**
+ * Calculate navmesh paths for the npcclient in background threads.
+ *
+ * Finding a path through the hierarchical navigation structure queries
+ * the detour navmesh from the start and the goal to every portal in their
+ * sectors, which is far too slow to do for lots of NPCs in the main loop.
+ * Movement operations submit their requests here and pick up the result
+ * in a later Advance while the workers do the search.
+ *
+ * Each worker has its own copy of the navigation structure, the main
+ * structure is only used by the main loop for the synchronous requests.
+ * Without workers the requests are calculated right away when submitted.
+ *
+ * The low level path of every segment is calculated together with the
+ * path, so the main loop can traverse it without locking the structure.
+ */
+class psPathQueryService
+{
+    friend class psPathQuery;
+public:
+    /**
+     * Create the service.
+     *
+     * @param mainNavStruct The navigation structure used for synchronous requests.
+     * @param workerNavStructs Navigation structures for the workers, one worker
+     *                   is started for each of these. If empty all requests
+     *                   are synchronous.
+     */
+    psPathQueryService(iCelHNavStruct* mainNavStruct, const csRefArray<iCelHNavStruct> &workerNavStructs);
+
+    /**
+     * Stop the workers and delete all queries not released yet.
+     */
+    ~psPathQueryService();
+
+    /**
+     * Check if paths are calculated in background threads.
+     */
+    bool IsAsync() const
+    {
+        return !workers.IsEmpty();
+    }
+
+    /**
+     * Request a path.
+     *
+     * @return The query, to be polled and released by the caller.
+     */
+    psPathQuery* Submit(const csVector3 &from, iSector* fromSector,
+                        const csVector3 &goal, iSector* goalSector);
+
+    /**
+     * Hand a query back to the service. Queries still waiting or being
+     * calculated are canceled.
+     */
+    void Release(psPathQuery* query);
+
+    /**
+     * Calculate a path right away in the main loop, using the main
+     * navigation structure.
+     */
+    csPtr<iCelHPath> ShortestPath(const csVector3 &from, iSector* fromSector,
+                                  const csVector3 &goal, iSector* goalSector);
+
+    /**
+     * Print the query counters and the latency histogram.
+     */
+    void PrintStats();
+
+private:
+    /// Background thread calculating queued paths.
+    class Worker : public CS::Threading::Runnable
+    {
+    public:
+        Worker(psPathQueryService* service, psNavContext* context);
+        virtual void Run();
+
+    private:
+        psPathQueryService* service;
+        psNavContext*       context;
+    };
+
+    /// Wait for the next query, returns NULL when the service stops.
+    psPathQuery* WaitForQuery();
+
+    /// Calculate a query in the given context.
+    void Process(psPathQuery* query, psNavContext* context);
+
+    /// Calculate a path and the low level path of all its segments.
+    static csPtr<iCelHPath> FindPath(psNavContext* context, const csVector3 &from, iSector* fromSector,
+                                     const csVector3 &goal, iSector* goalSector);
+
+    void AddLatency(csTicks latency);
+
+    csPDelArray<psNavContext>                 contexts;
+    csRefArray<CS::Threading::Thread>         workers;
+
+    csArray<psPathQuery*>                     queue;
+    csSet<csPtrKey<psPathQuery> >             queries;    ///< All queries not released yet.
+    mutable CS::Threading::Mutex              mutex;
+    CS::Threading::Condition                  queueCondition;
+    bool                                      stopping;
+
+    // Statistics
+    uint32                                    submitted;
+    uint32                                    completed;
+    uint32                                    failed;
+    uint32                                    canceled;
+    csTicks                                   maxLatency;
+    uint32                                    latency[PATH_QUERY_LATENCY_BUCKETS];
+};
+
+/** @} */
+
+#endif
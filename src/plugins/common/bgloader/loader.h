@@ -45,6 +45,8 @@
 #include <ibgloader.h>
 #include <iscenemanipulate.h>
 
+#include "objectgrid.h"
+
 #ifdef CS_DEBUG
 #define LOADER_DEBUG_MESSAGE(...) csPrintf(__VA_ARGS__)
 #else
@@ -485,6 +487,11 @@ private:
             return curBBox.Overlap(bbox);
         }
 
+        inline const csBox3& GetBBox() const
+        {
+            return bbox;
+        }
+
         inline bool OutOfRange(const csBox3& curBBox) const
         {
             return !curBBox.Overlap(bbox);
@@ -892,6 +899,11 @@ private:
         csRef<iThreadReturn> status;
     };
 
+    // selects the UpdateObjects implementation for range based objects at compile time
+    template<bool rangeBased> struct RangeTag
+    {
+    };
+
     // helper class that allows a specific dependency type for an object
     template<typename T> class ObjectLoader
     {
@@ -899,11 +911,11 @@ private:
         typedef CheckedLoad<T> HashObjectType;
         typedef csHash<HashObjectType, csString> HashType;
 
-        ObjectLoader() : objectCount(0)
+        ObjectLoader() : objectCount(0), gridValid(false), rangeValid(false)
         {
         }
 
-        ObjectLoader(const ObjectLoader& other) : objectCount(0)
+        ObjectLoader(const ObjectLoader& other) : objectCount(0), gridValid(false), rangeValid(false)
         {
             CS::Threading::RecursiveMutexScopedLock lock(other.busy);
             typename HashType::ConstGlobalIterator it(other.objects.GetIterator());
@@ -943,6 +955,9 @@ private:
                 return true;
             }
 
+            // objects outside the boxes may be loaded now
+            rangeValid = false;
+
             bool ready = true;
             typename HashType::GlobalIterator it(objects.GetIterator());
             while(it.HasNext())
@@ -968,6 +983,7 @@ private:
         void UnloadObjects()
         {
             CS::Threading::RecursiveMutexScopedLock lock(busy);
+            rangeValid = false;
             if(!objectCount)
             {
                 // nothing to be done
@@ -991,35 +1007,7 @@ private:
         {
             CS::Threading::RecursiveMutexScopedLock lock(busy);
             int oldObjectCount = objectCount;
-            if(CS::Meta::IsBaseOf<RangeBased,T>::value)
-            {
-                typename HashType::GlobalIterator it(objects.GetIterator());
-                while(it.HasNext())
-                {
-                    HashObjectType& ref = it.Next();
-                    if(ref.checked)
-                    {
-                        if(ref.obj->OutOfRange(keepBox))
-                        {
-                            ref.obj->Unload();
-                            ref.checked = false;
-                            --objectCount;
-                        }
-                    }
-                    else if(ref.obj->InRange(loadBox))
-                    {
-                        ref.checked = ref.obj->Load(false);
-                        if(ref.checked)
-                        {
-                            ++objectCount;
-                        }
-                    }
-                }
-            }
-            else
-            {
-                LoadObjects(false);
-            }
+            UpdateObjects(loadBox, keepBox, RangeTag<CS::Meta::IsBaseOf<RangeBased,T>::value>());
             return (int)objectCount - oldObjectCount;
         }
 
@@ -1029,12 +1017,14 @@ private:
             if(!objects.Contains(obj->GetName()))
             {
                 objects.Put(obj->GetName(), csRef<T>(obj));
+                InvalidateGrid();
             }
         }
 
         void RemoveDependency(const T* obj)
         {
             CS::Threading::RecursiveMutexScopedLock lock(busy);
+            InvalidateGrid();
             const HashObjectType& ref = objects.Get(obj->GetName(), HashObjectType(csRef<T>()));
             if(ref.checked)
             {
@@ -1074,10 +1064,129 @@ private:
         }
 
     protected:
+        typedef typename ObjectGrid<HashObjectType>::ObjectList ObjectList;
+
+        void UpdateObjects(const csBox3& /*loadBox*/, const csBox3& /*keepBox*/, RangeTag<false>)
+        {
+            LoadObjects(false);
+        }
+
+        // Only objects whose range state can change are checked: the ones
+        // in the parts of the old keep box the new one doesn't cover, the
+        // ones in the parts of the new load box the old one didn't cover
+        // and the ones still waiting to finish loading.
+        void UpdateObjects(const csBox3& loadBox, const csBox3& keepBox, RangeTag<true>)
+        {
+            if(!gridValid)
+            {
+                BuildGrid();
+            }
+
+            // the grid only covers x/z, so vertical changes need a full sweep
+            if(!rangeValid ||
+               loadBox.MinY() != lastLoadBox.MinY() || loadBox.MaxY() != lastLoadBox.MaxY() ||
+               keepBox.MinY() != lastKeepBox.MinY() || keepBox.MaxY() != lastKeepBox.MaxY())
+            {
+                pending.Empty();
+                typename HashType::GlobalIterator it(objects.GetIterator());
+                while(it.HasNext())
+                {
+                    UpdateObject(&it.Next(), loadBox, keepBox);
+                }
+            }
+            else
+            {
+                ObjectList unloadCandidates;
+                ObjectList loadCandidates;
+                grid.CollectMoved(lastLoadBox, lastKeepBox, loadBox, keepBox, unloadCandidates, loadCandidates);
+                for(size_t i = 0; i < unloadCandidates.GetSize(); i++)
+                {
+                    HashObjectType* ref = unloadCandidates[i];
+                    if(ref->checked && ref->obj->OutOfRange(keepBox))
+                    {
+                        ref->obj->Unload();
+                        ref->checked = false;
+                        --objectCount;
+                    }
+                }
+
+                // retry the objects that didn't finish loading yet
+                ObjectList waiting(pending);
+                pending.Empty();
+                for(size_t i = 0; i < waiting.GetSize(); i++)
+                {
+                    UpdateObject(waiting[i], loadBox, keepBox);
+                }
+
+                for(size_t i = 0; i < loadCandidates.GetSize(); i++)
+                {
+                    UpdateObject(loadCandidates[i], loadBox, keepBox);
+                }
+            }
+
+            lastLoadBox = loadBox;
+            lastKeepBox = keepBox;
+            rangeValid = true;
+        }
+
+        // unload the object if it left the keep box, load it if it's in the load box
+        void UpdateObject(HashObjectType* ref, const csBox3& loadBox, const csBox3& keepBox)
+        {
+            if(ref->checked)
+            {
+                if(ref->obj->OutOfRange(keepBox))
+                {
+                    ref->obj->Unload();
+                    ref->checked = false;
+                    --objectCount;
+                }
+            }
+            else if(ref->obj->InRange(loadBox))
+            {
+                ref->checked = ref->obj->Load(false);
+                if(ref->checked)
+                {
+                    ++objectCount;
+                }
+                else
+                {
+                    pending.PushSmart(ref);
+                }
+            }
+        }
+
+        void BuildGrid()
+        {
+            grid.Empty();
+
+            typename HashType::GlobalIterator it(objects.GetIterator());
+            while(it.HasNext())
+            {
+                HashObjectType* ref = &it.Next();
+                grid.Add(ref, ref->obj->GetBBox());
+            }
+            gridValid = true;
+        }
+
+        void InvalidateGrid()
+        {
+            gridValid = false;
+            rangeValid = false;
+            pending.Empty();
+        }
+
         mutable CS::Threading::RecursiveMutex busy;
 
         HashType objects;
         size_t objectCount;
+
+        // range index, only used for range based objects
+        ObjectGrid<HashObjectType> grid;
+        ObjectList pending;         // objects in the load box that didn't finish loading
+        csBox3 lastLoadBox;
+        csBox3 lastKeepBox;
+        bool gridValid;             // grid matches objects
+        bool rangeValid;            // the loaded objects match lastLoadBox and lastKeepBox
     };
 
     // actual world objects
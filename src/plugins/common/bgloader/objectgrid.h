@@ -0,0 +1,162 @@
+/*
+ * objectgrid.h
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#ifndef __OBJECTGRID_H__
+#define __OBJECTGRID_H__
+
+#include <math.h>
+
+#include <csgeom/box.h>
+#include <csutil/array.h>
+#include <csutil/hash.h>
+
+// size of the grid cells used to find range based objects near the load and keep boxes
+#define OBJECT_GRID_CELL_SIZE 64.0f
+// objects covering more cells than this are checked on every update instead
+#define OBJECT_GRID_MAX_CELLS 64
+
+/**
+ * Spatial index of objects on the x/z plane, used to find the range based
+ * objects whose state can change when the load and keep boxes move.
+ *
+ * An object is put in every cell its box overlaps, so an object may be
+ * returned more than once. Objects covering too many cells are kept in a
+ * separate list and returned by every CollectMoved.
+ */
+template<typename T> class ObjectGrid
+{
+public:
+    typedef csArray<T*> ObjectList;
+
+    void Empty()
+    {
+        cells.Empty();
+        largeObjects.Empty();
+    }
+
+    // add an object with the given box
+    // returns false if the box is empty, the object isn't added then as it's never in range
+    bool Add(T* obj, const csBox3& box)
+    {
+        if(box.Empty())
+        {
+            return false;
+        }
+
+        int minX = GridCoord(box.MinX());
+        int maxX = GridCoord(box.MaxX());
+        int minZ = GridCoord(box.MinZ());
+        int maxZ = GridCoord(box.MaxZ());
+        if((maxX - minX + 1) * (maxZ - minZ + 1) > OBJECT_GRID_MAX_CELLS)
+        {
+            largeObjects.Push(obj);
+            return true;
+        }
+
+        for(int x = minX; x <= maxX; ++x)
+        {
+            for(int z = minZ; z <= maxZ; ++z)
+            {
+                ObjectList* cell = cells.GetElementPointer(GridKey(x, z));
+                if(!cell)
+                {
+                    cells.Put(GridKey(x, z), ObjectList());
+                    cell = cells.GetElementPointer(GridKey(x, z));
+                }
+                cell->Push(obj);
+            }
+        }
+        return true;
+    }
+
+    // collect the objects in cells overlapping the x/z rectangle
+    void CollectCells(float minX, float minZ, float maxX, float maxZ, ObjectList& result) const
+    {
+        if(minX > maxX || minZ > maxZ)
+        {
+            return;
+        }
+
+        for(int x = GridCoord(minX); x <= GridCoord(maxX); ++x)
+        {
+            for(int z = GridCoord(minZ); z <= GridCoord(maxZ); ++z)
+            {
+                const ObjectList* cell = cells.GetElementPointer(GridKey(x, z));
+                if(cell)
+                {
+                    result.Merge(*cell);
+                }
+            }
+        }
+    }
+
+    // collect the objects in cells overlapping the part of box not covered by other
+    void CollectDifference(const csBox3& other, const csBox3& box, ObjectList& result) const
+    {
+        if(box.Empty())
+        {
+            return;
+        }
+
+        if(other.Empty() || box.MinX() > other.MaxX() || box.MaxX() < other.MinX() ||
+           box.MinZ() > other.MaxZ() || box.MaxZ() < other.MinZ())
+        {
+            CollectCells(box.MinX(), box.MinZ(), box.MaxX(), box.MaxZ(), result);
+            return;
+        }
+
+        float midMinX = csMax(box.MinX(), other.MinX());
+        float midMaxX = csMin(box.MaxX(), other.MaxX());
+
+        // strips left and right of other, then below and above it in between
+        CollectCells(box.MinX(), box.MinZ(), other.MinX(), box.MaxZ(), result);
+        CollectCells(other.MaxX(), box.MinZ(), box.MaxX(), box.MaxZ(), result);
+        CollectCells(midMinX, box.MinZ(), midMaxX, other.MinZ(), result);
+        CollectCells(midMinX, other.MaxZ(), midMaxX, box.MaxZ(), result);
+    }
+
+    // collect the objects whose range state can change when the load and keep boxes move
+    // unloadCandidates are in the parts of the old keep box the new one doesn't cover,
+    // loadCandidates in the parts of the new load box the old one didn't cover
+    void CollectMoved(const csBox3& lastLoadBox, const csBox3& lastKeepBox,
+                      const csBox3& loadBox, const csBox3& keepBox,
+                      ObjectList& unloadCandidates, ObjectList& loadCandidates) const
+    {
+        CollectDifference(keepBox, lastKeepBox, unloadCandidates);
+        unloadCandidates.Merge(largeObjects);
+        CollectDifference(lastLoadBox, loadBox, loadCandidates);
+        loadCandidates.Merge(largeObjects);
+    }
+
+private:
+    static int GridCoord(float coord)
+    {
+        return (int)floorf(coord / OBJECT_GRID_CELL_SIZE);
+    }
+
+    static uint32 GridKey(int x, int z)
+    {
+        return (uint32(x & 0xFFFF) << 16) | uint32(z & 0xFFFF);
+    }
+
+    csHash<ObjectList, uint32> cells;
+    ObjectList largeObjects;
+};
+
+#endif // __OBJECTGRID_H__
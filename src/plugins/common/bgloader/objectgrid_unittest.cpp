@@ -0,0 +1,160 @@
+/*
+ * objectgrid_unittest.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#include <cssysdef.h>
+
+//====================================================================================
+// Local Includes
+//====================================================================================
+#include "objectgrid.h"
+
+//====================================================================================
+// Library Includes
+//====================================================================================
+#include <gtest/gtest.h>
+
+struct GridObject
+{
+    csBox3 bbox;
+    bool loaded;
+};
+
+// Moves the load and keep boxes and checks that only looking at the
+// candidates CollectMoved returns to ObjectLoader gives the same result as
+// checking every object.
+class ObjectGridTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        // too large for the grid
+        GridObject large;
+        large.bbox.Set(-2000.0f, 0.0f, 280.0f, 2000.0f, 2.0f, 290.0f);
+        large.loaded = false;
+        objects.Push(large);
+
+        for(int x = -20; x < 20; x++)
+        {
+            for(int z = -20; z < 20; z++)
+            {
+                GridObject obj;
+                obj.bbox.Set(x*16.0f, 0.0f, z*16.0f, x*16.0f + 4.0f, 2.0f, z*16.0f + 4.0f);
+                obj.loaded = false;
+                objects.Push(obj);
+            }
+        }
+
+        for(size_t i = 0; i < objects.GetSize(); i++)
+        {
+            EXPECT_TRUE(grid.Add(&objects[i], objects[i].bbox));
+        }
+    }
+
+    static csBox3 Box(float x, float z, float size)
+    {
+        return csBox3(x - size, -100.0f, z - size, x + size, 100.0f, z + size);
+    }
+
+    void Move(float x, float z)
+    {
+        csBox3 loadBox = Box(x, z, 100.0f);
+        csBox3 keepBox = Box(x, z, 150.0f);
+
+        ObjectGrid<GridObject>::ObjectList unloadCandidates;
+        ObjectGrid<GridObject>::ObjectList loadCandidates;
+        grid.CollectMoved(lastLoadBox, lastKeepBox, loadBox, keepBox, unloadCandidates, loadCandidates);
+        for(size_t i = 0; i < unloadCandidates.GetSize(); i++)
+        {
+            if(!keepBox.Overlap(unloadCandidates[i]->bbox))
+            {
+                unloadCandidates[i]->loaded = false;
+            }
+        }
+        for(size_t i = 0; i < loadCandidates.GetSize(); i++)
+        {
+            if(loadBox.Overlap(loadCandidates[i]->bbox))
+            {
+                loadCandidates[i]->loaded = true;
+            }
+        }
+
+        // the full sweep
+        for(size_t i = 0; i < objects.GetSize(); i++)
+        {
+            bool loaded = expected[i];
+            if(!keepBox.Overlap(objects[i].bbox))
+            {
+                loaded = false;
+            }
+            if(loadBox.Overlap(objects[i].bbox))
+            {
+                loaded = true;
+            }
+            expected[i] = loaded;
+            EXPECT_EQ(loaded, objects[i].loaded) << "object " << i << " at " << x << "," << z;
+        }
+
+        lastLoadBox = loadBox;
+        lastKeepBox = keepBox;
+    }
+
+    csArray<GridObject> objects;
+    csArray<bool> expected;
+    ObjectGrid<GridObject> grid;
+    csBox3 lastLoadBox;
+    csBox3 lastKeepBox;
+};
+
+TEST_F(ObjectGridTest, CollectsOnlyTheDifference)
+{
+    grid.Empty();
+    GridObject inside;
+    inside.bbox.Set(10.0f, 0.0f, 10.0f, 12.0f, 1.0f, 12.0f);
+    GridObject outside;
+    outside.bbox.Set(300.0f, 0.0f, 10.0f, 302.0f, 1.0f, 12.0f);
+    grid.Add(&inside, inside.bbox);
+    grid.Add(&outside, outside.bbox);
+
+    ObjectGrid<GridObject>::ObjectList result;
+    grid.CollectDifference(Box(0.0f, 0.0f, 100.0f), Box(0.0f, 0.0f, 100.0f), result);
+    EXPECT_EQ(0u, result.GetSize());
+
+    // moving right only uncovers the right strip
+    grid.CollectDifference(Box(0.0f, 0.0f, 100.0f), Box(250.0f, 0.0f, 100.0f), result);
+    EXPECT_EQ(csArrayItemNotFound, result.Find(&inside));
+    EXPECT_NE(csArrayItemNotFound, result.Find(&outside));
+}
+
+TEST_F(ObjectGridTest, MovesAcrossTheGrid)
+{
+    expected.SetSize(objects.GetSize(), false);
+
+    // small steps in every direction, then jumps
+    for(float x = -300.0f; x <= 300.0f; x += 10.0f)
+    {
+        Move(x, 0.5f*x);
+    }
+    for(float z = 300.0f; z >= -300.0f; z -= 25.0f)
+    {
+        Move(300.0f, z);
+    }
+    Move(-250.0f, 200.0f);
+    Move(0.0f, 0.0f);
+    Move(40.0f, -30.0f);
+}
@@ -95,6 +95,7 @@ void celHPath::Initialize(iCelPath* highLevelPath)
   // High level paths always have two nodes for each segment of the
   // path in a sector (entry and exit point).
   llPaths.SetSize(llSize);
+  llSectors.SetSize(llSize);
   currentllPosition = 0;
 
   // Construct first part of the low level path
@@ -102,6 +103,7 @@ void celHPath::Initialize(iCelPath* highLevelPath)
   currentSector = firstNode->GetSector();
   csRef<iCelNavMesh> navMesh = navMeshes.Get(currentSector, 0);
   llPaths[0] = navMesh->ShortestPath(firstNode->GetPosition(), goal->GetPosition());
+  llSectors[0] = currentSector;
 
   // Set current node
   currentNode = firstNode;
@@ -162,6 +164,7 @@ iMapNode* celHPath::NextInternal (bool rev)
       {
         csRef<iCelNavMesh> navMesh = navMeshes.Get(currentSector, 0);
         llPaths[currentllPosition] = navMesh->ShortestPath(currentNode->GetPosition(), dst->GetPosition());
+        llSectors[currentllPosition] = currentSector;
         if(rev)
         {
           while(llPaths[currentllPosition]->HasNext())
@@ -178,6 +181,13 @@ iMapNode* celHPath::NextInternal (bool rev)
     {
       advanced += llPaths[currentllPosition]->Length();
       currentllPosition += rev ? -1 : 1;
+
+      // Low level paths calculated before a restart are traversed again
+      // without going through the high level path, so follow their sector.
+      if(llPaths[currentllPosition].IsValid())
+      {
+        currentSector = llSectors[currentllPosition];
+      }
     }
     else
     {
@@ -1131,6 +1141,9 @@ celHNavStructBuilder::celHNavStructBuilder (iBase* parent) : scfImplementationTy
 {
   sectors = 0;
   parameters.AttachNew(new celNavMeshParams());
+  buildThreads = 0;
+  reuseCachedTiles = true;
+  tileBudget = 0;
 }
 
 celHNavStructBuilder::~celHNavStructBuilder ()
@@ -1173,6 +1186,8 @@ bool celHNavStructBuilder::InstantiateNavMeshBuilders ()
       return false;
     }
     builder->SetNavMeshParams(parameters);
+    builder->SetBuildThreads(buildThreads);
+    builder->SetTileCache(tileCacheVfs, tileCacheDirectory, reuseCachedTiles);
     builder->SetSector(key);
     builders.Put(key, builder);
     currentSector++;
@@ -1327,6 +1342,7 @@ bool celHNavStructBuilder::ParseMeshes (iDocumentNode* node, csHash<csRef<iSecto
     fileName = id;
     csRef<iFile> file = vfs->Open(fileName.GetDataSafe(), VFS_FILE_READ);
     csRef<iCelNavMeshBuilder> builder = csLoadPluginCheck<iCelNavMeshBuilder>(objectRegistry, "cel.navmeshbuilder");
+    builder->SetTileBudget(tileBudget);
     csRef<iCelNavMesh> navMesh = builder->LoadNavMesh(file);
     navStruct->AddNavMesh(navMesh);
   }
@@ -1465,4 +1481,31 @@ void celHNavStructBuilder::SetNavMeshParams (const iCelNavMeshParams* parameters
   }
 }
 
+void celHNavStructBuilder::SetBuildThreads (int threads)
+{
+  buildThreads = threads;
+  csHash<csRef<iCelNavMeshBuilder>, csPtrKey<iSector> >::GlobalIterator it = builders.GetIterator();
+  while (it.HasNext())
+  {
+    it.Next()->SetBuildThreads(threads);
+  }
+}
+
+void celHNavStructBuilder::SetTileCache (iVFS* vfs, const char* directory, bool reuse)
+{
+  tileCacheVfs = vfs;
+  tileCacheDirectory = directory;
+  reuseCachedTiles = reuse;
+  csHash<csRef<iCelNavMeshBuilder>, csPtrKey<iSector> >::GlobalIterator it = builders.GetIterator();
+  while (it.HasNext())
+  {
+    it.Next()->SetTileCache(vfs, directory, reuse);
+  }
+}
+
+void celHNavStructBuilder::SetTileBudget (size_t bytes)
+{
+  tileBudget = bytes;
+}
+
 } CS_PLUGIN_NAMESPACE_END(celNavMesh)
@@ -51,6 +51,7 @@ private:
   csRef<iCelPath> hlPath; // High level path
   csHash<csRef<iCelNavMesh>, csPtrKey<iSector> >& navMeshes;
   csArray<csRef<iCelNavMeshPath> > llPaths; // Low level paths
+  csArray<iSector*> llSectors; // Sector of each low level path
   size_t currentllPosition; // Current position for low level paths array
   csRef<iMapNode> currentNode;
   csPtrKey<iSector> currentSector;
@@ -139,6 +140,11 @@ private:
   csRefArray<iSector> sectors;
   csHash<csRef<iCelNavMeshBuilder>, csPtrKey<iSector> > builders;
   csRef<celHNavStruct> navStruct;
+  int buildThreads;
+  csRef<iVFS> tileCacheVfs;
+  csString tileCacheDirectory;
+  bool reuseCachedTiles;
+  size_t tileBudget;
 
   bool InstantiateNavMeshBuilders();
 
@@ -159,6 +165,9 @@ public:
   virtual iCelHNavStruct* LoadHNavStruct (iVFS* vfs, const char* directory);
   virtual const iCelNavMeshParams* GetNavMeshParams () const;
   virtual void SetNavMeshParams (const iCelNavMeshParams* parameters);
+  virtual void SetBuildThreads (int threads);
+  virtual void SetTileCache (iVFS* vfs, const char* directory, bool reuse = true);
+  virtual void SetTileBudget (size_t bytes);
 };
 
 }
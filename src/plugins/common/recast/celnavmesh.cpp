@@ -25,6 +25,10 @@
 #include "csutil/csendian.h"
 #include "csutil/databuf.h"
 #include "csutil/memfile.h"
+#include "csutil/sysfunc.h"
+#include "csutil/set.h"
+#include "iutil/stringarray.h"
+#include "recastnavigation/DetourNode.h"
 
 CS_PLUGIN_NAMESPACE_BEGIN(celNavMesh)
 {
@@ -411,6 +415,10 @@ const int celNavMesh::MAX_NODES = 2048;
 const int celNavMesh::NAVMESHSET_MAGIC = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T'; //'MSET';
 const int celNavMesh::NAVMESHSET_VERSION = 1;
 
+// Searches of a path before the whole navmesh is attached, each one reaches
+// two more rings of tiles around the last one
+static const int MaxAttachPasses = 8;
+
 celNavMesh::celNavMesh (iObjectRegistry* objectRegistry) : scfImplementationType (this)
 {
   parameters = 0;
@@ -423,6 +431,9 @@ celNavMesh::celNavMesh (iObjectRegistry* objectRegistry) : scfImplementationType
   this->objectRegistry = objectRegistry;
   debugMeshes = 0;
   agentDebugMeshes = 0;
+  attachedSize = 0;
+  tileBudget = 0;
+  useCounter = 0;
 }
 
 celNavMesh::~celNavMesh ()
@@ -513,6 +524,9 @@ csArray<csPoly3D> celNavMesh::QueryPolygons(const csBox3& box) const
   box.GetCenter().Get(center);
   (box.Max()-box.GetCenter()).Get(extent);
 
+  BeginQuery();
+  AttachTilesInBox(center, extent);
+
   // get polygon references
   dtPolyRef polyRefs[128];
   int polyCount;
@@ -558,6 +572,9 @@ iCelNavMeshPath* celNavMesh::ShortestPath (const csVector3& from, const csVector
   polyPickExt[0] = parameters->GetPolygonSearchBox()[0];
   polyPickExt[1] = parameters->GetPolygonSearchBox()[1];
   polyPickExt[2] = parameters->GetPolygonSearchBox()[2];
+  BeginQuery();
+  AttachTilesInBox(startPos, polyPickExt);
+  AttachTilesInBox(endPos, polyPickExt);
   dtPolyRef startRef; 
   detourNavMeshQuery->findNearestPoly(startPos, polyPickExt, &filter, &startRef, 0);
   dtPolyRef endRef;
@@ -568,6 +585,20 @@ iCelNavMeshPath* celNavMesh::ShortestPath (const csVector3& from, const csVector
   int npolys = 0;
   detourNavMeshQuery->findPath(startRef, endRef, startPos, endPos, &filter, polys, &npolys, maxPathSize);
 
+  // The search can only expand into attached tiles, so search again until
+  // the neighbours of all tiles it reached are attached. The last search
+  // then sees the same links as it would with the whole navmesh attached.
+  // Long paths over many tiles get the whole navmesh after a few passes.
+  for (int pass = 1; startRef && endRef && AttachTilesAroundSearch(); pass++)
+  {
+    if (pass == MaxAttachPasses)
+    {
+      AttachAllTiles();
+    }
+    npolys = 0;
+    detourNavMeshQuery->findPath(startRef, endRef, startPos, endPos, &filter, polys, &npolys, maxPathSize);
+  }
+
   // Find the actual path inside those polygons
   float* straightPath = new float[maxPathSize * 3];
   unsigned char* straightPathFlags = new unsigned char[maxPathSize];
@@ -635,6 +666,9 @@ bool celNavMesh::Update (const csOBB& boundingBox)
 
 bool celNavMesh::AddTile (unsigned char* data, int dataSize)
 {
+  // Tiles changed at runtime can't be dropped and loaded from the file again
+  AttachAllTiles(true);
+
   dtTileRef result;
   detourNavMesh->addTile(data, dataSize, 0, 0, &result);
   if (result)
@@ -649,6 +683,8 @@ bool celNavMesh::AddTile (unsigned char* data, int dataSize)
 
 bool celNavMesh::RemoveTile (int x, int y)
 {
+  AttachAllTiles(true);
+
   if (detourNavMesh->removeTile(detourNavMesh->getTileRefAt(x, y, 0), 0, 0) == DT_SUCCESS)
   {
     return true;
@@ -676,6 +712,229 @@ csBox3 celNavMesh::GetBoundingBox() const
   return csBox3(boundingMin[0], boundingMin[1], boundingMin[2], boundingMax[0], boundingMax[1], boundingMax[2]);
 }
 
+void celNavMesh::SetTileBudget (size_t bytes)
+{
+  tileBudget = bytes;
+}
+
+uint32 celNavMesh::TileKey (int x, int y)
+{
+  return (uint32(x & 0xFFFF) << 16) | uint32(y & 0xFFFF);
+}
+
+bool celNavMesh::AttachTile (TileEntry& entry) const
+{
+  // detour writes the links into the tile data, so the tile needs its own copy
+  unsigned char* data = (unsigned char*)dtAlloc(entry.dataSize, DT_ALLOC_PERM);
+  if (!data)
+  {
+    return false;
+  }
+  memcpy(data, fileData->GetUint8() + entry.offset, entry.dataSize);
+
+  dtStatus status = detourNavMesh->addTile(data, entry.dataSize, DT_TILE_FREE_DATA, entry.fileRef, &entry.ref);
+  if ((status & DT_FAILURE)
+    && (status & (DT_WRONG_MAGIC | DT_WRONG_VERSION)))
+  {
+    // Try endian-swapping the data
+    if (dtNavMeshHeaderSwapEndian (data, entry.dataSize)
+      && dtNavMeshDataSwapEndian (data, entry.dataSize))
+    {
+      status = detourNavMesh->addTile(data, entry.dataSize, DT_TILE_FREE_DATA, entry.fileRef, &entry.ref);
+    }
+  }
+  if (status & DT_FAILURE)
+  {
+    dtFree(data);
+    entry.ref = 0;
+    entry.failed = true;
+    csApplicationFramework::ReportWarning("could not attach tile at location %d, %d in sector %s",
+        entry.x, entry.y, sector ? sector->QueryObject()->GetName() : "unknown");
+    return false;
+  }
+
+  attachedSize += entry.dataSize;
+  return true;
+}
+
+void celNavMesh::DetachTile (TileEntry& entry) const
+{
+  detourNavMesh->removeTile(entry.ref, 0, 0);
+  entry.ref = 0;
+  attachedSize -= entry.dataSize;
+}
+
+bool celNavMesh::AttachTilesAt (int x, int y) const
+{
+  bool attached = false;
+  csHash<size_t, uint32>::ConstIterator it = tileIndex.GetIterator(TileKey(x, y));
+  while (it.HasNext())
+  {
+    TileEntry& entry = tiles[it.Next()];
+    entry.lastUsed = useCounter;
+    if (!entry.ref && !entry.failed)
+    {
+      attached |= AttachTile(entry);
+    }
+  }
+  return attached;
+}
+
+void celNavMesh::AttachTilesInBox (const float* center, const float* extents) const
+{
+  if (tiles.IsEmpty())
+  {
+    return;
+  }
+
+  float bmin[3];
+  float bmax[3];
+  dtVsub(bmin, center, extents);
+  dtVadd(bmax, center, extents);
+
+  int minX, minY, maxX, maxY;
+  detourNavMesh->calcTileLoc(bmin, &minX, &minY);
+  detourNavMesh->calcTileLoc(bmax, &maxX, &maxY);
+  for (int y = minY; y <= maxY; y++)
+  {
+    for (int x = minX; x <= maxX; x++)
+    {
+      AttachTilesAt(x, y);
+    }
+  }
+}
+
+struct TileLoc
+{
+  int x;
+  int y;
+};
+
+bool celNavMesh::AttachTilesAroundSearch () const
+{
+  if (tiles.IsEmpty())
+  {
+    return false;
+  }
+
+  // detour only links polygons of neighbouring tiles, so the neighbours
+  // of the tiles of all nodes of the last search are all it could reach
+  bool attached = false;
+  csSet<uint32> checkedTiles;
+  csArray<TileLoc> newTiles;
+  const dtNodePool* nodePool = detourNavMeshQuery->getNodePool();
+  for (int bucket = 0; bucket < nodePool->getHashSize(); bucket++)
+  {
+    for (dtNodeIndex i = nodePool->getFirst(bucket); i != DT_NULL_IDX; i = nodePool->getNext(i))
+    {
+      const dtMeshTile* tile;
+      const dtPoly* poly;
+      if (dtStatusFailed(detourNavMesh->getTileAndPolyByRef(nodePool->getNodeAtIdx(i + 1)->id, &tile, &poly)))
+      {
+        continue;
+      }
+
+      uint32 key = TileKey(tile->header->x, tile->header->y);
+      if (checkedTiles.Contains(key))
+      {
+        continue;
+      }
+      checkedTiles.AddNoTest(key);
+
+      for (int y = tile->header->y - 1; y <= tile->header->y + 1; y++)
+      {
+        for (int x = tile->header->x - 1; x <= tile->header->x + 1; x++)
+        {
+          if (AttachTilesAt(x, y))
+          {
+            TileLoc loc = { x, y };
+            newTiles.Push(loc);
+            attached = true;
+          }
+        }
+      }
+    }
+  }
+
+  // the next search will expand into the new tiles, attach their
+  // neighbours ahead of it to save a pass
+  for (size_t i = 0; i < newTiles.GetSize(); i++)
+  {
+    for (int y = newTiles[i].y - 1; y <= newTiles[i].y + 1; y++)
+    {
+      for (int x = newTiles[i].x - 1; x <= newTiles[i].x + 1; x++)
+      {
+        AttachTilesAt(x, y);
+      }
+    }
+  }
+  return attached;
+}
+
+void celNavMesh::AttachAllTiles (bool dropIndex)
+{
+  for (size_t i = 0; i < tiles.GetSize(); i++)
+  {
+    TileEntry& entry = tiles[i];
+    entry.lastUsed = useCounter;
+    if (!entry.ref && !entry.failed)
+    {
+      AttachTile(entry);
+    }
+  }
+
+  if (dropIndex)
+  {
+    tiles.Empty();
+    tileIndex.Empty();
+    fileData.Invalidate();
+    attachedSize = 0;
+  }
+}
+
+struct TileAge
+{
+  uint32 lastUsed;
+  size_t index;
+};
+
+static int CompareTileAge (const TileAge& a, const TileAge& b)
+{
+  if (a.lastUsed != b.lastUsed)
+  {
+    return a.lastUsed < b.lastUsed ? -1 : 1;
+  }
+  return 0;
+}
+
+void celNavMesh::BeginQuery () const
+{
+  useCounter++;
+  if (!tileBudget || attachedSize <= tileBudget)
+  {
+    return;
+  }
+
+  // Drop the least recently used tiles until the rest fits the budget
+  csArray<TileAge> attached;
+  for (size_t i = 0; i < tiles.GetSize(); i++)
+  {
+    if (tiles[i].ref)
+    {
+      TileAge age;
+      age.lastUsed = tiles[i].lastUsed;
+      age.index = i;
+      attached.Push(age);
+    }
+  }
+  attached.Sort(CompareTileAge);
+
+  for (size_t i = 0; i < attached.GetSize() && attachedSize > tileBudget; i++)
+  {
+    DetachTile(tiles[attached[i].index]);
+  }
+}
+
 // Saving helpers
 static void SetAttributeFloat (iDocumentNode* parent, const char* childName, float val)
 {
@@ -701,7 +960,30 @@ static void SetAttributeInt (iDocumentNode* parent, const char* childName, int v
 }
 
 static const unsigned char NavmeshFileMagic[3] = { 'c', 'n', 'm' };
-static const unsigned char NavmeshCurrentVersion = 0;
+// Version 0 stores the tiles one after the other, version 1 adds an index
+// in front of them, so the tiles can be loaded one by one when needed.
+static const unsigned char NavmeshCurrentVersion = 1;
+
+static bool WriteUInt32 (iFile* file, uint32 value)
+{
+  uint32 diskValue (csLittleEndian::UInt32 (value));
+  return file->Write ((char*)&diskValue, sizeof (diskValue)) == sizeof (diskValue);
+}
+
+static uint32 GetUInt32 (const unsigned char* data)
+{
+  uint32 value;
+  memcpy (&value, data, sizeof (value));
+  return csLittleEndian::Convert (value);
+}
+
+struct SavedTile
+{
+  dtTileRef ref;
+  int x, y;
+  const unsigned char* data;
+  uint32 dataSize;
+};
 
 bool celNavMesh::SaveToFile (iFile* file) const
 {
@@ -780,22 +1062,23 @@ bool celNavMesh::SaveToFile (iFile* file) const
       return false;
   }
 
+  // Collect the tiles, the ones that were never attached are taken from the loaded file
+  csArray<SavedTile> savedTiles;
+  for (size_t i = 0; i < tiles.GetSize(); ++i)
   {
-    int numTiles = 0;
-    for (int i = 0; i < detourNavMesh->getMaxTiles(); ++i)
+    const TileEntry& entry = tiles[i];
+    if (entry.ref || entry.failed)
     {
-      const dtMeshTile* tile = detourNavMesh->getTile(i);
-      if (!tile || !tile->header || !tile->dataSize)
-      {
-        continue;
-      }
-      numTiles++;
+      continue;
     }
-    uint32 diskNum (csLittleEndian::UInt32 (numTiles));
-    if (file->Write ((char*)&diskNum, sizeof (diskNum)) != sizeof (diskNum)) return false;
+    SavedTile saved;
+    saved.ref = entry.fileRef;
+    saved.x = entry.x;
+    saved.y = entry.y;
+    saved.data = fileData->GetUint8() + entry.offset;
+    saved.dataSize = entry.dataSize;
+    savedTiles.Push(saved);
   }
-
-  // Create tiles data
   for (int i = 0; i < detourNavMesh->getMaxTiles(); ++i)
   {
     const dtMeshTile* tile = detourNavMesh->getTile(i);
@@ -803,13 +1086,37 @@ bool celNavMesh::SaveToFile (iFile* file) const
     {
       continue;
     }
-    uint32 diskRef (csLittleEndian::UInt32 (detourNavMesh->getTileRef(tile)));
-    if (file->Write ((char*)&diskRef, sizeof (diskRef)) != sizeof (diskRef))
+    SavedTile saved;
+    saved.ref = detourNavMesh->getTileRef(tile);
+    saved.x = tile->header->x;
+    saved.y = tile->header->y;
+    saved.data = tile->data;
+    saved.dataSize = tile->dataSize;
+    savedTiles.Push(saved);
+  }
+
+  if (!WriteUInt32 (file, (uint32)savedTiles.GetSize()))
+    return false;
+
+  // Write the tile index, followed by the tiles data aligned to 4 bytes
+  size_t offset = file->GetPos() + savedTiles.GetSize() * 5 * sizeof (uint32);
+  for (size_t i = 0; i < savedTiles.GetSize(); ++i)
+  {
+    const SavedTile& saved = savedTiles[i];
+    if (!WriteUInt32 (file, saved.ref) || !WriteUInt32 (file, (uint32)saved.x) || !WriteUInt32 (file, (uint32)saved.y)
+        || !WriteUInt32 (file, saved.dataSize) || !WriteUInt32 (file, (uint32)offset))
       return false;
-    uint32 diskSize (csLittleEndian::UInt32 (tile->dataSize));
-    if (file->Write ((char*)&diskSize, sizeof (diskSize)) != sizeof (diskSize))
+    offset += (saved.dataSize + 3) & ~3;
+  }
+
+  const char padding[4] = { 0, 0, 0, 0 };
+  for (size_t i = 0; i < savedTiles.GetSize(); ++i)
+  {
+    const SavedTile& saved = savedTiles[i];
+    if (file->Write ((const char*)saved.data, saved.dataSize) != saved.dataSize)
       return false;
-    if (file->Write ((const char*)tile->data, tile->dataSize) != (size_t)tile->dataSize)
+    size_t paddingSize = (4 - (saved.dataSize & 3)) & 3;
+    if (file->Write (padding, paddingSize) != paddingSize)
       return false;
   }
 
@@ -836,7 +1143,7 @@ bool celNavMesh::LoadNavMesh (iFile* file)
     file->SetPos (0);
     return LoadNavMeshLegacy (file);
   }
-  if (magic[3] != NavmeshCurrentVersion)
+  if (magic[3] > NavmeshCurrentVersion)
   {
     // Version mismatch
     return false;
@@ -900,36 +1207,70 @@ bool celNavMesh::LoadNavMesh (iFile* file)
   if (file->Read ((char*)&numTiles, sizeof (numTiles)) != sizeof (numTiles))
     return false;
   numTiles = csLittleEndian::Convert (numTiles);
-  for (uint i = 0; i < numTiles; i++)
+
+  // Only the index is read here, the tiles are attached when a query needs
+  // them. VFS maps files on disk into memory, so tiles never used are never
+  // read from disk either.
+  size_t pos = file->GetPos();
+  fileData = file->GetAllData();
+  if (!fileData.IsValid() || !IndexTiles (pos, numTiles, magic[3]))
   {
-    uint32 tileRef;
-    if (file->Read ((char*)&tileRef, sizeof (tileRef)) != sizeof (tileRef))
-      return false;
-    tileRef = csLittleEndian::Convert (tileRef);
+    tiles.Empty();
+    tileIndex.Empty();
+    fileData.Invalidate();
+    return false;
+  }
 
-    uint32 tileSize;
-    if (file->Read ((char*)&tileSize, sizeof (tileSize)) != sizeof (tileSize))
-      return false;
-    tileSize = csLittleEndian::Convert (tileSize);
-    unsigned char* tileData = (unsigned char*)dtAlloc (tileSize, DT_ALLOC_PERM);
-    if (file->Read ((char*)tileData, tileSize) != tileSize) return false;
+  return true;
+}
+
+bool celNavMesh::IndexTiles (size_t pos, uint32 numTiles, unsigned char version)
+{
+  const unsigned char* data = fileData->GetUint8();
+  const size_t size = fileData->GetSize();
+  for (uint32 i = 0; i < numTiles; i++)
+  {
+    TileEntry entry;
+    entry.ref = 0;
+    entry.lastUsed = 0;
+    entry.failed = false;
 
-    dtStatus status = detourNavMesh->addTile(tileData, tileSize, DT_TILE_FREE_DATA, tileRef, nullptr);
-    if ((status & DT_FAILURE)
-      && (status & (DT_WRONG_MAGIC | DT_WRONG_VERSION)))
+    if (version == 0)
     {
-      // Try endian-swapping the data
-      if (dtNavMeshHeaderSwapEndian (tileData, tileSize)
-        && dtNavMeshDataSwapEndian (tileData, tileSize))
+      // The tiles follow each other, their location is in the tile header
+      if (pos + 2 * sizeof (uint32) > size)
+        return false;
+      entry.fileRef = GetUInt32 (data + pos);
+      entry.dataSize = GetUInt32 (data + pos + 4);
+      entry.offset = pos + 2 * sizeof (uint32);
+      if (entry.dataSize < sizeof (dtMeshHeader) || entry.offset + entry.dataSize > size)
+        return false;
+
+      dtMeshHeader header;
+      memcpy (&header, data + entry.offset, sizeof (header));
+      if (header.magic != DT_NAVMESH_MAGIC)
       {
-        status = detourNavMesh->addTile(tileData, tileSize, DT_TILE_FREE_DATA, tileRef, nullptr);
+        dtNavMeshHeaderSwapEndian ((unsigned char*)&header, sizeof (header));
       }
+      entry.x = header.x;
+      entry.y = header.y;
+      pos = entry.offset + entry.dataSize;
     }
-    if (status & DT_FAILURE)
+    else
     {
-      dtFree (tileData);
-      return false;
+      if (pos + 5 * sizeof (uint32) > size)
+        return false;
+      entry.fileRef = GetUInt32 (data + pos);
+      entry.x = (int)GetUInt32 (data + pos + 4);
+      entry.y = (int)GetUInt32 (data + pos + 8);
+      entry.dataSize = GetUInt32 (data + pos + 12);
+      entry.offset = GetUInt32 (data + pos + 16);
+      if (entry.offset + entry.dataSize > size)
+        return false;
+      pos += 5 * sizeof (uint32);
     }
+
+    tileIndex.Put (TileKey (entry.x, entry.y), tiles.Push (entry));
   }
 
   return true;
@@ -1354,6 +1695,7 @@ csArray<csSimpleRenderMesh*>* celNavMesh::GetDebugMeshes ()
 
   // Update debug meshes
   if (!detourNavMesh) return nullptr;
+  AttachAllTiles();
   DebugDrawCS dd;
   duDebugDrawNavMesh(&dd, *detourNavMesh, navMeshDrawFlags);
   debugMeshes = dd.GetMeshes();
@@ -1655,25 +1997,22 @@ celNavMeshBuilder::celNavMeshBuilder (iBase* parent) : scfImplementationType (th
   triangleVertices = 0;
   triangleIndices = 0;
   chunkyTriMesh = 0;
-  triangleAreas = 0;
-  solid = 0;
-  chf = 0;
-  cSet = 0;
-  pMesh = 0;
-  dMesh = 0;
 
   numberOfVertices = 0;
   numberOfTriangles = 0;
   numberOfOffMeshCon = 0;
   numberOfVolumes = 0;
 
+  buildThreads = 0;
+  reuseCachedTiles = true;
+  tileBudget = 0;
+
   parameters.AttachNew(new celNavMeshParams());
 }
 
 celNavMeshBuilder::~celNavMeshBuilder ()
 {
   CleanUpSectorData();
-  CleanUpTileData();
 }
 
 void celNavMeshBuilder::CleanUpSectorData () 
@@ -2120,70 +2459,379 @@ THREADED_CALLABLE_IMPL(celNavMeshBuilder,BuildNavMesh)
                                 parameters->GetDetailSampleDist();
   tileConfig.detailSampleMaxError = tileConfig.ch * parameters->GetDetailSampleMaxError();
 
-  float tileBoundingMin[3];
-  float tileBoundingMax[3];
+  // Collect the tiles, the ones whose input did not change since the
+  // last build are taken from the tile cache
+  csArray<TileTask> tiles;
+  tiles.SetCapacity(tw * th);
+  csArray<TileTask*> pending;
   for (int y = 0; y < th; ++y)
   {
-    int percent = ((float)y/th)*100;
-    csPrintf("%d%%\n",percent); // Print progress %
     for (int x = 0; x < tw; ++x)
     {
-      tileBoundingMin[0] = boundingMin[0] + x * tcs;
-      tileBoundingMin[1] = boundingMin[1];
-      tileBoundingMin[2] = boundingMin[2] + y * tcs;
+      TileTask& task = tiles.GetExtend(tiles.GetSize());
+      task.x = x;
+      task.y = y;
+
+      task.bmin[0] = boundingMin[0] + x * tcs;
+      task.bmin[1] = boundingMin[1];
+      task.bmin[2] = boundingMin[2] + y * tcs;
+
+      task.bmax[0] = boundingMin[0] + (x + 1) * tcs;
+      task.bmax[1] = boundingMax[1];
+      task.bmax[2] = boundingMin[2] + (y + 1) * tcs;
+
+      task.config = tileConfig;
+      rcVcopy(task.config.bmin, task.bmin);
+      rcVcopy(task.config.bmax, task.bmax);
+      task.config.bmin[0] -= task.config.borderSize * task.config.cs;
+      task.config.bmin[2] -= task.config.borderSize * task.config.cs;
+      task.config.bmax[0] += task.config.borderSize * task.config.cs;
+      task.config.bmax[2] += task.config.borderSize * task.config.cs;
+
+      task.data = 0;
+      task.dataSize = 0;
+      task.built = false;
+      task.hash = HashTileInput(&task);
+    }
+  }
+  for (size_t i = 0; i < tiles.GetSize(); i++)
+  {
+    if (!LoadCachedTile(&tiles[i]))
+    {
+      pending.Push(&tiles[i]);
+    }
+  }
+  if (tileCacheVfs)
+  {
+    csPrintf("%zu of %zu tiles unchanged\n", tiles.GetSize() - pending.GetSize(), tiles.GetSize());
+  }
 
-      tileBoundingMax[0] = boundingMin[0] + (x + 1) * tcs;
-      tileBoundingMax[1] = boundingMax[1];
-      tileBoundingMax[2] = boundingMin[2] + (y + 1) * tcs;
+  BuildTiles(pending);
 
-      rcVcopy(tileConfig.bmin, tileBoundingMin);
-      rcVcopy(tileConfig.bmax, tileBoundingMax);
-      tileConfig.bmin[0] -= tileConfig.borderSize * tileConfig.cs;
-      tileConfig.bmin[2] -= tileConfig.borderSize * tileConfig.cs;
-      tileConfig.bmax[0] += tileConfig.borderSize * tileConfig.cs;
-      tileConfig.bmax[2] += tileConfig.borderSize * tileConfig.cs;
+  // Add the tiles to the navmesh, which can't be done from several threads
+  for (size_t i = 0; i < tiles.GetSize(); i++)
+  {
+    TileTask& task = tiles[i];
+    if (task.built)
+    {
+      SaveCachedTile(&task);
+    }
+    if (!task.data)
+    {
+      continue;
+    }
+    if (!navMesh->AddTile(task.data, task.dataSize))
+    {
+      dtFree(task.data);
+      csApplicationFramework::ReportWarning("could not add tile at location %d, %d in sector %s",
+          task.x, task.y, currentSector->QueryObject()->GetName());
+    }
+  }
+  PruneTileCache(tiles);
+  ret->SetResult(csRef<iBase>(navMesh));
+  return true;
+}
 
-      int dataSize = 0;
-      unsigned char* data = BuildTile(x, y, tileBoundingMin, tileBoundingMax, tileConfig, dataSize);
-      if (data)
+/**
+ * Builds tiles taken from a shared list until all are done.
+ */
+class TileBuildWorker : public CS::Threading::Runnable
+{
+public:
+  TileBuildWorker (celNavMeshBuilder* builder, csArray<TileTask*>& tasks, size_t& next, 
+                   size_t& done, CS::Threading::Mutex& mutex)
+    : builder(builder), tasks(tasks), next(next), done(done), mutex(mutex)
+  {
+  }
+
+  virtual void Run ()
+  {
+    while (true)
+    {
+      TileTask* task;
       {
-        if (!navMesh->AddTile(data, dataSize))
+        CS::Threading::MutexScopedLock lock(mutex);
+        if (next >= tasks.GetSize())
         {
-          dtFree(data);
-          csApplicationFramework::ReportWarning("could not add tile at location %d, %d in sector %s",
-              x, y, currentSector->QueryObject()->GetName());
-          continue;
+          return;
         }
+        task = tasks[next++];
       }
+
+      task->data = builder->BuildTile(task->x, task->y, task->bmin, task->bmax, task->config, task->dataSize);
+      task->built = true;
+
+      CS::Threading::MutexScopedLock lock(mutex);
+      done++;
     }
+  }
+
+private:
+  celNavMeshBuilder* builder;
+  csArray<TileTask*>& tasks;
+  size_t& next;
+  size_t& done;
+  CS::Threading::Mutex& mutex;
+};
+
+void celNavMeshBuilder::BuildTiles (csArray<TileTask*>& tasks)
+{
+  if (tasks.IsEmpty())
+  {
+    return;
+  }
+
+  size_t threadCount = buildThreads > 0 ? buildThreads : CS::Platform::GetProcessorCount();
+  threadCount = csMax(csMin(threadCount, tasks.GetSize()), (size_t)1);
+
+  size_t next = 0;
+  size_t done = 0;
+  CS::Threading::Mutex mutex;
+  csRefArray<CS::Threading::Thread> threads;
+  for (size_t i = 0; i < threadCount; i++)
+  {
+    csRef<TileBuildWorker> worker;
+    worker.AttachNew(new TileBuildWorker(this, tasks, next, done, mutex));
+    csRef<CS::Threading::Thread> thread;
+    thread.AttachNew(new CS::Threading::Thread(worker));
+    thread->Start();
+    threads.Push(thread);
+  }
+
+  // Print progress until all tiles are done
+  while (true)
+  {
+    size_t finished;
+    {
+      CS::Threading::MutexScopedLock lock(mutex);
+      finished = done;
+    }
+    if (finished >= tasks.GetSize())
+    {
+      break;
+    }
+    int percent = ((float)finished/tasks.GetSize())*100;
+    csPrintf("%d%%\n",percent); // Print progress %
+    csSleep(100);
     csPrintf(CS_ANSI_CURSOR_UP(1)); // go back one line
     csPrintf(CS_ANSI_CLEAR_LINE); // clear line
   }
-  ret->SetResult(csRef<iBase>(navMesh));
+
+  for (size_t i = 0; i < threads.GetSize(); i++)
+  {
+    threads[i]->Wait();
+  }
+}
+
+// 64 bit FNV-1a, used to detect changes in the input of a tile
+static const uint64 TileHashOffset = CONST_UINT64(0xcbf29ce484222325);
+static const uint64 TileHashPrime = CONST_UINT64(0x100000001b3);
+
+// Change when the tile build changes, to invalidate all cached tiles
+static const uint32 TileCacheVersion = 1;
+
+static void HashBytes (uint64& hash, const void* data, size_t size)
+{
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= TileHashPrime;
+  }
+}
+
+uint64 celNavMeshBuilder::HashTileInput (const TileTask* task) const
+{
+  uint64 hash = TileHashOffset;
+  HashBytes(hash, &TileCacheVersion, sizeof(TileCacheVersion));
+  HashBytes(hash, &task->x, sizeof(task->x));
+  HashBytes(hash, &task->y, sizeof(task->y));
+  HashBytes(hash, task->bmin, sizeof(task->bmin));
+  HashBytes(hash, task->bmax, sizeof(task->bmax));
+  HashBytes(hash, &task->config, sizeof(task->config));
+
+  float agent[3];
+  agent[0] = parameters->GetAgentHeight();
+  agent[1] = parameters->GetAgentRadius();
+  agent[2] = parameters->GetAgentMaxClimb();
+  HashBytes(hash, agent, sizeof(agent));
+
+  HashBytes(hash, volumes, numberOfVolumes * sizeof(ConvexVolume));
+  HashBytes(hash, offMeshConVerts, numberOfOffMeshCon * 3 * 2 * sizeof(float));
+  HashBytes(hash, offMeshConRads, numberOfOffMeshCon * sizeof(float));
+  HashBytes(hash, offMeshConDirs, numberOfOffMeshCon * sizeof(unsigned char));
+  HashBytes(hash, offMeshConAreas, numberOfOffMeshCon * sizeof(unsigned char));
+  HashBytes(hash, offMeshConFlags, numberOfOffMeshCon * sizeof(unsigned short));
+
+  if (!chunkyTriMesh)
+  {
+    return hash;
+  }
+
+  // Hash the vertices of the triangles overlapping the tile, so edits
+  // elsewhere in the sector don't change the hash
+  const float* bmin = task->config.bmin;
+  const float* bmax = task->config.bmax;
+  float tbmin[2], tbmax[2];
+  tbmin[0] = bmin[0];
+  tbmin[1] = bmin[2];
+  tbmax[0] = bmax[0];
+  tbmax[1] = bmax[2];
+  int cid[512];
+  const int ncid = rcGetChunksOverlappingRect(chunkyTriMesh, tbmin, tbmax, cid, 512);
+  for (int i = 0; i < ncid; ++i)
+  {
+    const rcChunkyTriMeshNode& node = chunkyTriMesh->nodes[cid[i]];
+    const int* tris = &chunkyTriMesh->tris[node.i * 3];
+    for (int j = 0; j < node.n; ++j)
+    {
+      const float* v0 = &triangleVertices[tris[j * 3] * 3];
+      const float* v1 = &triangleVertices[tris[j * 3 + 1] * 3];
+      const float* v2 = &triangleVertices[tris[j * 3 + 2] * 3];
+      if (csMax(v0[0], csMax(v1[0], v2[0])) < bmin[0] || csMin(v0[0], csMin(v1[0], v2[0])) > bmax[0] ||
+          csMax(v0[2], csMax(v1[2], v2[2])) < bmin[2] || csMin(v0[2], csMin(v1[2], v2[2])) > bmax[2])
+      {
+        continue;
+      }
+      HashBytes(hash, v0, 3 * sizeof(float));
+      HashBytes(hash, v1, 3 * sizeof(float));
+      HashBytes(hash, v2, 3 * sizeof(float));
+    }
+  }
+
+  return hash;
+}
+
+// Content of the cache files of tiles without walkable area
+static const char TileCacheEmptyMarker[] = "empty";
+
+csString celNavMeshBuilder::GetTileCacheSectorDir () const
+{
+  // Each sector has its own directory, so a build can prune it
+  csString path;
+  path.Format("%s%s/", tileCacheDirectory.GetData(), currentSector->QueryObject()->GetName());
+  return path;
+}
+
+csString celNavMeshBuilder::GetTileCachePath (uint64 hash) const
+{
+  csString path;
+  path.Format("%s%08x%08x.tile", GetTileCacheSectorDir().GetData(), (uint32)(hash >> 32), (uint32)hash);
+  return path;
+}
+
+bool celNavMeshBuilder::LoadCachedTile (TileTask* task)
+{
+  if (!tileCacheVfs || !reuseCachedTiles)
+  {
+    return false;
+  }
+
+  csRef<iDataBuffer> buffer = tileCacheVfs->ReadFile(GetTileCachePath(task->hash), false);
+  if (!buffer.IsValid() || !buffer->GetSize())
+  {
+    return false;
+  }
+
+  if (buffer->GetSize() == sizeof(TileCacheEmptyMarker) - 1
+    && !memcmp(buffer->GetData(), TileCacheEmptyMarker, buffer->GetSize()))
+  {
+    task->data = 0;
+    task->dataSize = 0;
+    return true;
+  }
+
+  task->dataSize = (int)buffer->GetSize();
+  task->data = (unsigned char*)dtAlloc(task->dataSize, DT_ALLOC_PERM);
+  memcpy(task->data, buffer->GetData(), task->dataSize);
   return true;
 }
 
-void celNavMeshBuilder::CleanUpTileData()
+void celNavMeshBuilder::SaveCachedTile (const TileTask* task)
+{
+  // Failed builds are tried again next time
+  if (!tileCacheVfs || task->dataSize < 0)
+  {
+    return;
+  }
+
+  bool written;
+  if (task->data)
+  {
+    written = tileCacheVfs->WriteFile(GetTileCachePath(task->hash), (const char*)task->data, task->dataSize);
+  }
+  else
+  {
+    written = tileCacheVfs->WriteFile(GetTileCachePath(task->hash), TileCacheEmptyMarker,
+                                      sizeof(TileCacheEmptyMarker) - 1);
+  }
+  if (!written)
+  {
+    csApplicationFramework::ReportWarning("could not write tile %d, %d of sector %s to the tile cache",
+        task->x, task->y, currentSector->QueryObject()->GetName());
+  }
+}
+
+void celNavMeshBuilder::PruneTileCache (const csArray<TileTask>& tiles)
 {
-  delete [] triangleAreas;
-  triangleAreas = 0;
-  rcFreeHeightField(solid);
-  solid = 0;
-  rcFreeCompactHeightfield(chf);
-  chf = 0;
-  rcFreeContourSet(cSet);
-  cSet = 0;
-  rcFreePolyMesh(pMesh);
-  pMesh = 0;
-  rcFreePolyMeshDetail(dMesh);
-  dMesh = 0;
+  if (!tileCacheVfs)
+  {
+    return;
+  }
+
+  // Remove the cached tiles of earlier builds this one didn't use
+  csSet<csString> used;
+  for (size_t i = 0; i < tiles.GetSize(); i++)
+  {
+    csString path = GetTileCachePath(tiles[i].hash);
+    used.AddNoTest(path.Slice(path.FindLast('/') + 1));
+  }
+
+  csRef<iStringArray> files = tileCacheVfs->FindFiles(GetTileCacheSectorDir());
+  for (size_t i = 0; files.IsValid() && i < files->GetSize(); i++)
+  {
+    csString path = files->Get(i);
+    if (path.EndsWith(".tile") && !used.Contains(path.Slice(path.FindLast('/') + 1)))
+    {
+      tileCacheVfs->DeleteFile(path);
+    }
+  }
 }
 
+
+/**
+ * Intermediate data of a tile build, freed when the build is done or fails.
+ */
+struct TileBuildData
+{
+  unsigned char* triangleAreas;
+  rcHeightfield* solid;
+  rcCompactHeightfield* chf;
+  rcContourSet* cSet;
+  rcPolyMesh* pMesh;
+  rcPolyMeshDetail* dMesh;
+
+  TileBuildData () : triangleAreas(0), solid(0), chf(0), cSet(0), pMesh(0), dMesh(0)
+  {
+  }
+
+  ~TileBuildData ()
+  {
+    delete [] triangleAreas;
+    rcFreeHeightField(solid);
+    rcFreeCompactHeightfield(chf);
+    rcFreeContourSet(cSet);
+    rcFreePolyMesh(pMesh);
+    rcFreePolyMeshDetail(dMesh);
+  }
+};
+
 // Based on Recast Sample_TileMesh::buildTileMesh()
 // NOTE I left the original Recast comments
 unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const float* bmin, const float* bmax, 
                                             const rcConfig& tileConfig, int& dataSize)
 {
+  dataSize = -1;
 
   if (!triangleVertices || !triangleIndices || !chunkyTriMesh)
   {
@@ -2191,17 +2839,19 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
     return 0;
   }
 
-  // Make sure memory from last run is freed correctly (so there are no memory leaks if BuildTile crashes)
-  CleanUpTileData();
+  // Tiles are built in parallel, so each build has its own context and
+  // intermediate data, which is freed when leaving this function.
+  rcContext context(false);
+  TileBuildData tile;
 
   // Allocate voxel heighfield where we rasterize our input data to.
-  solid = rcAllocHeightfield();
-  if (!solid)
+  tile.solid = rcAllocHeightfield();
+  if (!tile.solid)
   {
     csApplicationFramework::ReportError("Out of memory building navigation mesh.");
     return 0;
   }
-  if (!rcCreateHeightfield(&dummy, *solid, tileConfig.width, tileConfig.height, tileConfig.bmin, tileConfig.bmax, 
+  if (!rcCreateHeightfield(&context, *tile.solid, tileConfig.width, tileConfig.height, tileConfig.bmin, tileConfig.bmax, 
                            tileConfig.cs, tileConfig.ch))
   {
     csApplicationFramework::ReportError("Failed to create Heightfield");
@@ -2211,8 +2861,8 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
   // Allocate array that can hold triangle flags.
   // If you have multiple meshes you need to process, allocate
   // and array which can hold the max number of triangles you need to process.
-  triangleAreas = new unsigned char[chunkyTriMesh->maxTrisPerChunk];
-  if (!triangleAreas)
+  tile.triangleAreas = new unsigned char[chunkyTriMesh->maxTrisPerChunk];
+  if (!tile.triangleAreas)
   {
     csApplicationFramework::ReportError("Out of memory building navigation mesh.");
     return 0;
@@ -2227,6 +2877,7 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
   const int ncid = rcGetChunksOverlappingRect(chunkyTriMesh, tbmin, tbmax, cid, 512);
   if (!ncid)
   {
+    dataSize = 0;
     return 0;
   }
 
@@ -2239,44 +2890,44 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
 
     tileTriangleCount += ntris;
 
-    memset(triangleAreas, 0, ntris * sizeof(unsigned char));
-    rcMarkWalkableTriangles(&dummy, tileConfig.walkableSlopeAngle, triangleVertices, numberOfVertices, tris, 
-                            ntris, triangleAreas);
+    memset(tile.triangleAreas, 0, ntris * sizeof(unsigned char));
+    rcMarkWalkableTriangles(&context, tileConfig.walkableSlopeAngle, triangleVertices, numberOfVertices, tris, 
+                            ntris, tile.triangleAreas);
 
-    rcRasterizeTriangles(&dummy, triangleVertices, numberOfVertices, tris, triangleAreas, ntris, *solid, 
+    rcRasterizeTriangles(&context, triangleVertices, numberOfVertices, tris, tile.triangleAreas, ntris, *tile.solid, 
                          tileConfig.walkableClimb);
   }
 
-  delete [] triangleAreas;
-  triangleAreas = 0;
+  delete [] tile.triangleAreas;
+  tile.triangleAreas = 0;
 
   // Once all geoemtry is rasterized, we do initial pass of filtering to
   // remove unwanted overhangs caused by the conservative rasterization
   // as well as filter spans where the character cannot possibly stand.
-  rcFilterLowHangingWalkableObstacles(&dummy, tileConfig.walkableClimb, *solid);
-  rcFilterLedgeSpans(&dummy, tileConfig.walkableHeight, tileConfig.walkableClimb, *solid);
-  rcFilterWalkableLowHeightSpans(&dummy, tileConfig.walkableHeight, *solid);
+  rcFilterLowHangingWalkableObstacles(&context, tileConfig.walkableClimb, *tile.solid);
+  rcFilterLedgeSpans(&context, tileConfig.walkableHeight, tileConfig.walkableClimb, *tile.solid);
+  rcFilterWalkableLowHeightSpans(&context, tileConfig.walkableHeight, *tile.solid);
 
   // Compact the heightfield so that it is faster to handle from now on.
   // This will result more cache coherent data as well as the neighbours
   // between walkable cells will be calculated.
-  chf = rcAllocCompactHeightfield();
-  if (!chf)
+  tile.chf = rcAllocCompactHeightfield();
+  if (!tile.chf)
   {
     csApplicationFramework::ReportError("Out of memory building navigation mesh.");
     return 0;
   }
-  if (!rcBuildCompactHeightfield(&dummy, tileConfig.walkableHeight, tileConfig.walkableClimb, *solid, *chf))
+  if (!rcBuildCompactHeightfield(&context, tileConfig.walkableHeight, tileConfig.walkableClimb, *tile.solid, *tile.chf))
   {
     csApplicationFramework::ReportError("failed to build compact heightfield");
     return 0;
   }
 
-  rcFreeHeightField(solid);
-  solid = 0;
+  rcFreeHeightField(tile.solid);
+  tile.solid = 0;
 
   // Erode the walkable area by agent radius.
-  if (!rcErodeWalkableArea(&dummy, tileConfig.walkableRadius, *chf))
+  if (!rcErodeWalkableArea(&context, tileConfig.walkableRadius, *tile.chf))
   {
     csApplicationFramework::ReportError("failed to errode walkable area");
     return 0;
@@ -2285,83 +2936,84 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
   // (Optional) Mark areas.
   for (int i  = 0; i < numberOfVolumes; ++i)
   {
-    rcMarkConvexPolyArea(&dummy, volumes[i].verts, volumes[i].nverts, volumes[i].hmin, volumes[i].hmax, 
-                         (unsigned char)volumes[i].area, *chf);
+    rcMarkConvexPolyArea(&context, volumes[i].verts, volumes[i].nverts, volumes[i].hmin, volumes[i].hmax, 
+                         (unsigned char)volumes[i].area, *tile.chf);
   }
 
   // Prepare for region partitioning, by calculating distance field along the walkable surface.
-  if (!rcBuildDistanceField(&dummy, *chf))
+  if (!rcBuildDistanceField(&context, *tile.chf))
   {
     csApplicationFramework::ReportError("failed to build distance field");
     return 0;
   }
 
   // Partition the walkable surface into simple regions without holes.
-  if (!rcBuildRegions(&dummy, *chf, tileConfig.borderSize, tileConfig.minRegionArea, tileConfig.mergeRegionArea))
+  if (!rcBuildRegions(&context, *tile.chf, tileConfig.borderSize, tileConfig.minRegionArea, tileConfig.mergeRegionArea))
   {
     csApplicationFramework::ReportError("failed to build regions");
     return 0;
   }
 
   // remove border mapping as we don't want those to be removed
-  /*for(int i = 0; i < chf->spanCount; i++)
+  /*for(int i = 0; i < tile.chf->spanCount; i++)
   {
-    chf->areas[i] &= ~RC_BORDER_REG;
+    tile.chf->areas[i] &= ~RC_BORDER_REG;
   }*/
 
   // Create contours.
-  cSet = rcAllocContourSet();
-  if (!cSet)
+  tile.cSet = rcAllocContourSet();
+  if (!tile.cSet)
   {
     csApplicationFramework::ReportError("Out of memory building navigation mesh.");
     return 0;
   }
-  if (!rcBuildContours(&dummy, *chf, tileConfig.maxSimplificationError, tileConfig.maxEdgeLen, *cSet))
+  if (!rcBuildContours(&context, *tile.chf, tileConfig.maxSimplificationError, tileConfig.maxEdgeLen, *tile.cSet))
   {
     csApplicationFramework::ReportError("failed to build contours");
     return 0;
   }
-  if (cSet->nconts == 0)
+  if (tile.cSet->nconts == 0)
   {
+    dataSize = 0;
     return 0;
   }
 
   // Build polygon navmesh from the contours.
-  pMesh = rcAllocPolyMesh();
-  if (!pMesh)
+  tile.pMesh = rcAllocPolyMesh();
+  if (!tile.pMesh)
   {
     csApplicationFramework::ReportError("Out of memory building navigation mesh.");
     return 0;
   }
-  if (!rcBuildPolyMesh(&dummy, *cSet, tileConfig.maxVertsPerPoly, *pMesh))
+  if (!rcBuildPolyMesh(&context, *tile.cSet, tileConfig.maxVertsPerPoly, *tile.pMesh))
   {
     csApplicationFramework::ReportError("failed to build poly mesh");
     return 0;
   }
 
   // Build detail mesh.
-  dMesh = rcAllocPolyMeshDetail();
-  if (!dMesh)
+  tile.dMesh = rcAllocPolyMeshDetail();
+  if (!tile.dMesh)
   {
     csApplicationFramework::ReportError("Out of memory building navigation mesh.");
     return 0;
   }
-  if (!rcBuildPolyMeshDetail(&dummy, *pMesh, *chf, tileConfig.detailSampleDist, tileConfig.detailSampleMaxError, *dMesh))
+  if (!rcBuildPolyMeshDetail(&context, *tile.pMesh, *tile.chf, tileConfig.detailSampleDist, tileConfig.detailSampleMaxError, *tile.dMesh))
   {
     csApplicationFramework::ReportError("fail to build poly mesh detail");
     return 0;
   }
 
-  rcFreeCompactHeightfield(chf);
-  chf = 0;
-  rcFreeContourSet(cSet);
-  cSet = 0;
+  rcFreeCompactHeightfield(tile.chf);
+  tile.chf = 0;
+  rcFreeContourSet(tile.cSet);
+  tile.cSet = 0;
 
   unsigned char* navData = 0;
   int navDataSize = 0;
   if (tileConfig.maxVertsPerPoly <= DT_VERTS_PER_POLYGON)
   {
-    if (pMesh->nverts >= 0xffff)
+    if (tile.pMesh->nverts >= 0xffff)
     {
       // The vertex indices are ushorts, and cannot point to more than 0xffff vertices.
       csApplicationFramework::ReportError("number of vertices overflowed");
@@ -2369,41 +3021,41 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
     }
 
     // Update poly flags from areas.
-    for (int i = 0; i < pMesh->npolys; ++i)
+    for (int i = 0; i < tile.pMesh->npolys; ++i)
     {
-      if (pMesh->areas[i] == RC_WALKABLE_AREA)
-        pMesh->areas[i] = SAMPLE_POLYAREA_GROUND;
+      if (tile.pMesh->areas[i] == RC_WALKABLE_AREA)
+        tile.pMesh->areas[i] = SAMPLE_POLYAREA_GROUND;
 
-      if (pMesh->areas[i] == SAMPLE_POLYAREA_GROUND ||
-        pMesh->areas[i] == SAMPLE_POLYAREA_GRASS ||
-        pMesh->areas[i] == SAMPLE_POLYAREA_ROAD)
+      if (tile.pMesh->areas[i] == SAMPLE_POLYAREA_GROUND ||
+        tile.pMesh->areas[i] == SAMPLE_POLYAREA_GRASS ||
+        tile.pMesh->areas[i] == SAMPLE_POLYAREA_ROAD)
       {
-        pMesh->flags[i] = SAMPLE_POLYFLAGS_WALK;
+        tile.pMesh->flags[i] = SAMPLE_POLYFLAGS_WALK;
       }
-      else if (pMesh->areas[i] == SAMPLE_POLYAREA_WATER)
+      else if (tile.pMesh->areas[i] == SAMPLE_POLYAREA_WATER)
       {
-        pMesh->flags[i] = SAMPLE_POLYFLAGS_SWIM;
+        tile.pMesh->flags[i] = SAMPLE_POLYFLAGS_SWIM;
       }
-      else if (pMesh->areas[i] == SAMPLE_POLYAREA_DOOR)
+      else if (tile.pMesh->areas[i] == SAMPLE_POLYAREA_DOOR)
       {
-        pMesh->flags[i] = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
+        tile.pMesh->flags[i] = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
       }
     }
 
     dtNavMeshCreateParams params;
     memset(&params, 0, sizeof(params));
-    params.verts = pMesh->verts;
-    params.vertCount = pMesh->nverts;
-    params.polys = pMesh->polys;
-    params.polyAreas = pMesh->areas;
-    params.polyFlags = pMesh->flags;
-    params.polyCount = pMesh->npolys;
-    params.nvp = pMesh->nvp;
-    params.detailMeshes = dMesh->meshes;
-    params.detailVerts = dMesh->verts;
-    params.detailVertsCount = dMesh->nverts;
-    params.detailTris = dMesh->tris;
-    params.detailTriCount = dMesh->ntris;
+    params.verts = tile.pMesh->verts;
+    params.vertCount = tile.pMesh->nverts;
+    params.polys = tile.pMesh->polys;
+    params.polyAreas = tile.pMesh->areas;
+    params.polyFlags = tile.pMesh->flags;
+    params.polyCount = tile.pMesh->npolys;
+    params.nvp = tile.pMesh->nvp;
+    params.detailMeshes = tile.dMesh->meshes;
+    params.detailVerts = tile.dMesh->verts;
+    params.detailVertsCount = tile.dMesh->nverts;
+    params.detailTris = tile.dMesh->tris;
+    params.detailTriCount = tile.dMesh->ntris;
     params.offMeshConVerts = offMeshConVerts;
     params.offMeshConRad = offMeshConRads;
     params.offMeshConDir = offMeshConDirs;
@@ -2429,10 +3081,10 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
     }
   }
 
-  rcFreePolyMesh(pMesh);
-  pMesh = 0;
-  rcFreePolyMeshDetail(dMesh);
-  dMesh = 0;
+  rcFreePolyMesh(tile.pMesh);
+  tile.pMesh = 0;
+  rcFreePolyMeshDetail(tile.dMesh);
+  tile.dMesh = 0;
 
   dataSize = navDataSize;
   return navData;
@@ -2441,6 +3093,7 @@ unsigned char* celNavMeshBuilder::BuildTile(const int tx, const int ty, const fl
 iCelNavMesh* celNavMeshBuilder::LoadNavMesh (iFile* file)
 {
   navMesh.AttachNew(new celNavMesh(objectRegistry));
+  navMesh->SetTileBudget(tileBudget);
   navMesh->LoadNavMesh(file);
   return navMesh;
 }
@@ -2567,5 +3220,26 @@ iSector* celNavMeshBuilder::GetSector () const
   return currentSector;
 }
 
+void celNavMeshBuilder::SetBuildThreads (int threads)
+{
+  buildThreads = threads;
+}
+
+void celNavMeshBuilder::SetTileCache (iVFS* vfs, const char* directory, bool reuse)
+{
+  tileCacheVfs = vfs;
+  tileCacheDirectory = directory;
+  if (!tileCacheDirectory.IsEmpty() && tileCacheDirectory.GetAt(tileCacheDirectory.Length() - 1) != '/')
+  {
+    tileCacheDirectory.Append('/');
+  }
+  reuseCachedTiles = reuse;
+}
+
+void celNavMeshBuilder::SetTileBudget (size_t bytes)
+{
+  tileBudget = bytes;
+}
+
 }
 CS_PLUGIN_NAMESPACE_END(celNavMesh)
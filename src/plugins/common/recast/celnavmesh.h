@@ -28,10 +28,13 @@
 #include <csgeom/vector3.h>
 #include <csqsqrt.h>
 #include <cstool/csapplicationframework.h>
+#include <csutil/csstring.h>
+#include <csutil/hash.h>
 #include <csutil/list.h>
 #include <csutil/ref.h>
 #include <csutil/scf_implementation.h>
 #include <csutil/threadmanager.h>
+#include <csutil/threading/thread.h>
 #include <iengine/mesh.h>
 #include <iengine/movable.h>
 #include <iengine/portal.h>
@@ -41,6 +44,7 @@
 #include <imesh/objmodel.h>
 #include <imesh/terrain2.h>
 #include <iutil/comp.h>
+#include <iutil/databuff.h>
 #include <iutil/document.h>
 #include <iutil/objreg.h>
 #include <iutil/vfs.h>
@@ -254,6 +258,18 @@ private:
     int dataSize;
   };
 
+  // A tile of a navmesh loaded from file, attached to the detour navmesh when first needed
+  struct TileEntry
+  {
+    dtTileRef fileRef;  // ref the tile had when it was saved
+    dtTileRef ref;      // ref in the detour navmesh, 0 if not attached
+    int x, y;
+    size_t offset;      // position of the tile data in fileData
+    uint32 dataSize;
+    uint32 lastUsed;
+    bool failed;        // the tile data is invalid, don't try to attach it again
+  };
+
   csRef<iSector> sector;
   iObjectRegistry* objectRegistry;
   csRef<iCelNavMeshPath> path;
@@ -266,6 +282,15 @@ private:
   float boundingMin[3];
   float boundingMax[3];
   unsigned char navMeshDrawFlags;
+
+  // Lazily attached tiles, empty if all tiles are in the detour navmesh
+  csRef<iDataBuffer> fileData;
+  mutable csArray<TileEntry> tiles;
+  csHash<size_t, uint32> tileIndex;
+  mutable size_t attachedSize;
+  size_t tileBudget;
+  mutable uint32 useCounter;
+
   static const int MAX_NODES;
   static const int NAVMESHSET_MAGIC;
   static const int NAVMESHSET_VERSION;
@@ -273,6 +298,17 @@ private:
   bool LoadCelNavMeshParams (iDocumentNode* mainNode);
   bool LoadDtNavMeshParams (iDocumentNode* paramsNode, dtNavMeshParams& params);
   bool LoadNavMeshLegacy (iFile* file);
+  bool IndexTiles (size_t pos, uint32 numTiles, unsigned char version);
+
+  // helpers to attach the tiles needed by a query and to keep the attached tiles within the budget
+  static uint32 TileKey (int x, int y);
+  bool AttachTile (TileEntry& entry) const;
+  void DetachTile (TileEntry& entry) const;
+  bool AttachTilesAt (int x, int y) const;
+  void AttachTilesInBox (const float* center, const float* extents) const;
+  bool AttachTilesAroundSearch () const;
+  void AttachAllTiles (bool dropIndex = false);
+  void BeginQuery () const;
 public:
   celNavMesh (iObjectRegistry* objectRegistry);
   virtual ~celNavMesh ();
@@ -282,6 +318,7 @@ public:
   bool AddTile (unsigned char* data, int dataSize);
   bool RemoveTile (int x, int y);
   bool LoadNavMesh (iFile* file);
+  void SetTileBudget (size_t bytes);
 
   // API
   virtual iCelNavMeshPath* ShortestPath (const csVector3& from, const csVector3& goal, int maxPathSize = 32);
@@ -302,6 +339,23 @@ public:
 
 
 
+/**
+ * A tile of a navigation mesh to be built.
+ */
+struct TileTask
+{
+  int x, y;
+  float bmin[3];
+  float bmax[3];
+  rcConfig config;
+  uint64 hash; // Hash of all input of the tile build
+  unsigned char* data;
+  int dataSize; // 0 for tiles without walkable area, -1 if the build failed
+  bool built; // False if the data was loaded from the tile cache
+};
+
+class TileBuildWorker;
+
 /**
  * Navigation mesh creator.
  */
@@ -317,14 +371,12 @@ private:
   // Recast & Detour
   rcChunkyTriMesh* chunkyTriMesh;
   
-  // Tile specific
-  unsigned char* triangleAreas;
-  rcContext dummy;
-  rcHeightfield* solid;
-  rcCompactHeightfield* chf;
-  rcContourSet* cSet;
-  rcPolyMesh* pMesh;
-  rcPolyMeshDetail* dMesh;
+  // Tile building
+  int buildThreads;
+  csRef<iVFS> tileCacheVfs;
+  csString tileCacheDirectory;
+  bool reuseCachedTiles;
+  size_t tileBudget;
   
   // Off-Mesh connections.
   static const int MAX_OFFMESH_CONNECTIONS = 256;
@@ -352,10 +404,20 @@ private:
   float boundingMax[3];
 
   void CleanUpSectorData ();
-  void CleanUpTileData ();
   bool GetSectorData ();  
+  // returns 0 with dataSize 0 for tiles without walkable area and dataSize -1 if the build failed
   unsigned char* BuildTile(const int tx, const int ty, const float* bmin, const float* bmax, 
                            const rcConfig& tileConfig, int& dataSize);
+
+  // helpers to build the tiles of a navmesh in parallel, reusing unchanged tiles from the cache
+  friend class TileBuildWorker;
+  void BuildTiles (csArray<TileTask*>& tasks);
+  uint64 HashTileInput (const TileTask* task) const;
+  csString GetTileCacheSectorDir () const;
+  csString GetTileCachePath (uint64 hash) const;
+  bool LoadCachedTile (TileTask* task);
+  void SaveCachedTile (const TileTask* task);
+  void PruneTileCache (const csArray<TileTask>& tiles);
   iObjectRegistry* GetObjectRegistry() const { return objectRegistry; }
 
   // helper function to check whether an object has to be clipped
@@ -381,6 +443,9 @@ public:
   virtual const iCelNavMeshParams* GetNavMeshParams () const;
   virtual void SetNavMeshParams (const iCelNavMeshParams* parameters);
   virtual iSector* GetSector () const;
+  virtual void SetBuildThreads (int threads);
+  virtual void SetTileCache (iVFS* vfs, const char* directory, bool reuse = true);
+  virtual void SetTileBudget (size_t bytes);
 
 };
 
@@ -23,6 +23,7 @@
 
 #include "data.h"
 #include "util/log.h"
+#include <csutil/sysfunc.h>
 #include <csutil/xmltiny.h>
 #include <iutil/cfgmgr.h>
 
@@ -32,6 +33,7 @@ SoundFile::SoundFile(const char* newName, const char* newFileName)
     name      = csString(newName);
     fileName  = csString(newFileName);
     sndData   = 0;
+    dataSize  = 0;
     lastTouch = csGetTicks();
 }
 
@@ -40,6 +42,7 @@ SoundFile::SoundFile(SoundFile* const &copySoundFile)
     name      = csString(copySoundFile->name);
     fileName  = csString(copySoundFile->fileName);
     sndData   = 0;
+    dataSize  = 0;
     lastTouch = csGetTicks();
 }
 
@@ -51,12 +54,51 @@ SoundFile::~SoundFile()
 //--------------------------------------------------
 
 
+static int CompareLastTouch(SoundFile* const &a, SoundFile* const &b)
+{
+    if(a->lastTouch < b->lastTouch)
+    {
+        return -1;
+    }
+    return a->lastTouch > b->lastTouch ? 1 : 0;
+}
+
+
+//--------------------------------------------------
+
+
+SoundDataCache::Loader::Loader(SoundDataCache* cache)
+    : cache(cache)
+{
+}
+
+void SoundDataCache::Loader::Run()
+{
+    LoadRequest* request;
+    while((request = cache->WaitForRequest()) != 0)
+    {
+        csRef<iSndSysData> sndData = cache->ReadSoundData(request->name, request->fileName);
+
+        CS::Threading::MutexScopedLock lock(cache->loadMutex);
+        request->sndData = sndData;
+        request->done = true;
+        cache->loadCondition.NotifyAll();
+    }
+}
+
+
+//--------------------------------------------------
+
+
 SoundDataCache::SoundDataCache()
+    : cacheTime(DEFAULT_SOUNDFILE_CACHETIME), cacheSize(DEFAULT_SOUNDFILE_CACHESIZE*1024),
+      loadedSize(0), prefetchRange(DEFAULT_SOUNDFILE_PREFETCHRANGE), stopping(false)
 {
 }
 
 SoundDataCache::~SoundDataCache()
 {
+    StopLoader();
     UnloadSoundLib();
 }
 
@@ -75,16 +117,143 @@ bool SoundDataCache::Initialize(iObjectRegistry* objectReg)
     }
 
     // Configuration
+    bool backgroundLoading = true;
     csRef<iConfigManager> configManager = csQueryRegistry<iConfigManager>(objectReg);
     if(configManager != 0)
     {
         cacheTime = configManager->GetInt("PlaneShift.Sound.DataCacheTime", DEFAULT_SOUNDFILE_CACHETIME);
+        cacheSize = size_t(configManager->GetInt("PlaneShift.Sound.DataCacheSize", DEFAULT_SOUNDFILE_CACHESIZE))*1024;
+        prefetchRange = configManager->GetFloat("PlaneShift.Sound.PrefetchRange", DEFAULT_SOUNDFILE_PREFETCHRANGE);
+        backgroundLoading = configManager->GetBool("PlaneShift.Sound.BackgroundLoading", true);
     }
     else
     {
         cacheTime = DEFAULT_SOUNDFILE_CACHETIME;
     }
 
+    if(backgroundLoading && !loaderThread.IsValid())
+    {
+        csRef<Loader> loader;
+        loader.AttachNew(new Loader(this));
+
+        loaderThread.AttachNew(new CS::Threading::Thread(loader));
+        loaderThread->Start();
+    }
+
+    return true;
+}
+
+void SoundDataCache::StopLoader()
+{
+    if(!loaderThread.IsValid())
+    {
+        return;
+    }
+
+    {
+        CS::Threading::MutexScopedLock lock(loadMutex);
+        stopping = true;
+        loadCondition.NotifyAll();
+    }
+
+    loaderThread->Wait();
+    loaderThread.Invalidate();
+
+    csHash<LoadRequest*, csString>::GlobalIterator requestIter(loadRequests.GetIterator());
+    while(requestIter.HasNext())
+    {
+        delete requestIter.Next();
+    }
+    loadRequests.DeleteAll();
+    loadQueue.Empty();
+}
+
+SoundDataCache::LoadRequest* SoundDataCache::WaitForRequest()
+{
+    CS::Threading::MutexScopedLock lock(loadMutex);
+    while(!stopping && loadQueue.IsEmpty())
+    {
+        loadCondition.Wait(loadMutex);
+    }
+
+    if(stopping)
+    {
+        return 0;
+    }
+
+    LoadRequest* request = loadQueue[0];
+    loadQueue.DeleteIndex(0);
+    request->running = true;
+
+    return request;
+}
+
+void SoundDataCache::PrefetchSoundData(const char* name)
+{
+    if(!loaderThread.IsValid() || !sndLoader.IsValid() || !vfs.IsValid())
+    {
+        return;
+    }
+
+    // already cached, just keep it there
+    SoundFile* soundFile = loadedSoundFiles.Get(name, 0);
+    if(soundFile != 0)
+    {
+        soundFile->lastTouch = csGetTicks();
+        return;
+    }
+
+    // don't retry files that don't exist every update
+    if(failedSoundFiles.Contains(name))
+    {
+        return;
+    }
+
+    soundFile = libSoundFiles.Get(name, 0);
+
+    CS::Threading::MutexScopedLock lock(loadMutex);
+    if(loadRequests.Contains(name))
+    {
+        return;
+    }
+
+    LoadRequest* request = new LoadRequest;
+    request->name = name;
+    request->fileName = (soundFile != 0 ? soundFile->fileName.GetData() : name);
+    request->running = false;
+    request->done = false;
+
+    loadRequests.Put(request->name, request);
+    loadQueue.Push(request);
+    loadCondition.NotifyAll();
+}
+
+bool SoundDataCache::TakeLoadRequest(const char* name, csRef<iSndSysData> &sndData)
+{
+    CS::Threading::MutexScopedLock lock(loadMutex);
+    LoadRequest* request = loadRequests.Get(name, 0);
+    if(request == 0)
+    {
+        return false;
+    }
+
+    if(!request->running)
+    {
+        // the loader didn't get to it yet, the caller can't wait that long
+        loadQueue.Delete(request);
+        loadRequests.Delete(name, request);
+        delete request;
+        return false;
+    }
+
+    while(!request->done)
+    {
+        loadCondition.Wait(loadMutex);
+    }
+
+    sndData = request->sndData;
+    loadRequests.Delete(name, request);
+    delete request;
     return true;
 }
 
@@ -119,6 +288,8 @@ void SoundDataCache::UnloadSoundFile(const char* name)
     {
         // this decrement the reference of csRef and delete if it's 0
         soundFile->sndData.Invalidate();
+        loadedSize -= soundFile->dataSize;
+        soundFile->dataSize = 0;
         loadedSoundFiles.Delete(name, soundFile);
     }
 }
@@ -126,9 +297,7 @@ void SoundDataCache::UnloadSoundFile(const char* name)
 SoundFile* SoundDataCache::LoadSoundFile(const char* name)
 {
     SoundFile*          soundFile;
-    csRef<iDataBuffer>  soundBuf;
-    bool                error = false;
-    bool                isDynamic = false;
+    csRef<iSndSysData>  sndData;
 
     // checking if this has been initialized correctly
     if(!sndLoader.IsValid() || !vfs.IsValid())
@@ -136,55 +305,66 @@ SoundFile* SoundDataCache::LoadSoundFile(const char* name)
         return 0;
     }
 
-    // checking the sound library
+    // checking if the file is already loaded
     soundFile = libSoundFiles.Get(name, 0);
-    if(soundFile == 0) // maybe this is a dynamic file
+    if(soundFile != 0 && soundFile->sndData.IsValid())
     {
-        soundFile = new SoundFile(name, name);
-        isDynamic = true;
+        return soundFile;
     }
 
-    // checking if the file is already loaded
-    if(soundFile->sndData.IsValid())
+    // the loader may be working on it already, otherwise load it here
+    if(!TakeLoadRequest(name, sndData))
     {
-        return soundFile;
+        sndData = ReadSoundData(name, soundFile != 0 ? soundFile->fileName.GetData() : name);
+    }
+
+    if(!sndData.IsValid())
+    {
+        return 0;
     }
 
+    failedSoundFiles.Delete(name);
+    return AddSoundFile(name, sndData);
+}
+
+csPtr<iSndSysData> SoundDataCache::ReadSoundData(const char* name, const char* fileName) const
+{
+    csRef<iSndSysData> sndData;
+
     // loading the data into a buffer
-    soundBuf = vfs->ReadFile(soundFile->fileName);
+    csRef<iDataBuffer> soundBuf = vfs->ReadFile(fileName);
     if(soundBuf != 0)
     {
         // extracting sound data from the buffer
-        soundFile->sndData = sndLoader->LoadSound(soundBuf);
-        if(!soundFile->sndData.IsValid())
+        sndData = sndLoader->LoadSound(soundBuf);
+        if(!sndData.IsValid())
         {
             Error2("Can't load sound '%s'!", name);
-            error = true;
         }
     }
     else
     {
         Error2("Can't load file '%s'!", name);
-        error = true;
     }
 
-    // handling errors
-    if(error)
-    {
-        if(isDynamic) // file is not in the library
-        {
-            delete soundFile;
-        }
+    return csPtr<iSndSysData>(sndData);
+}
 
-        return 0;
+SoundFile* SoundDataCache::AddSoundFile(const char* name, iSndSysData* sndData)
+{
+    SoundFile* soundFile = libSoundFiles.Get(name, 0);
+    if(soundFile == 0) // new dynamic file in the library
+    {
+        soundFile = new SoundFile(name, name);
+        libSoundFiles.Put(name, soundFile);
     }
 
     // keeping track of the loaded files
+    soundFile->sndData = sndData;
+    soundFile->dataSize = sndData->GetDataSize();
+    soundFile->lastTouch = csGetTicks();
+    loadedSize += soundFile->dataSize;
     loadedSoundFiles.Put(name, soundFile);
-    if(isDynamic) // new file in the library
-    {
-        libSoundFiles.Put(name, soundFile);
-    }
 
     return soundFile;
 }
@@ -193,15 +373,53 @@ void SoundDataCache::Update()
 {
     csTicks             now;
     SoundFile*          soundFile;
-    csArray<SoundFile*> allSoundFiles;
+    csArray<SoundFile*> expiredSoundFiles;
+    csArray<SoundFile*> unusedSoundFiles;
+
+    // adding the sounds the loader has finished
+    if(loaderThread.IsValid())
+    {
+        csArray<LoadRequest*> doneRequests;
+        {
+            CS::Threading::MutexScopedLock lock(loadMutex);
+            csHash<LoadRequest*, csString>::GlobalIterator requestIter(loadRequests.GetIterator());
+            while(requestIter.HasNext())
+            {
+                LoadRequest* request = requestIter.Next();
+                if(request->done)
+                {
+                    doneRequests.Push(request);
+                }
+            }
+
+            for(size_t i = 0; i < doneRequests.GetSize(); i++)
+            {
+                loadRequests.Delete(doneRequests[i]->name, doneRequests[i]);
+            }
+        }
+
+        for(size_t i = 0; i < doneRequests.GetSize(); i++)
+        {
+            LoadRequest* request = doneRequests[i];
+            if(!request->sndData.IsValid())
+            {
+                failedSoundFiles.Add(request->name);
+            }
+            else if(!loadedSoundFiles.Contains(request->name))
+            {
+                AddSoundFile(request->name, request->sndData);
+            }
+            delete request;
+        }
+    }
 
     // FIXME csticks
     now = csGetTicks();
-    allSoundFiles = loadedSoundFiles.GetAll();
 
-    for(size_t i = 0; i < allSoundFiles.GetSize(); i++)
+    csHash<SoundFile*, csString>::GlobalIterator soundFileIter(loadedSoundFiles.GetIterator());
+    while(soundFileIter.HasNext())
     {
-        soundFile = allSoundFiles[i];
+        soundFile = soundFileIter.Next();
 
         // checking if SoundDataCache is the only one that reference to the data
         if(soundFile->sndData->GetRefCount() == 1)
@@ -209,12 +427,39 @@ void SoundDataCache::Update()
             // checking if the cache time has elapsed
             if(soundFile->lastTouch + cacheTime <= now)
             {
-                UnloadSoundFile(soundFile->name);
+                expiredSoundFiles.Push(soundFile);
+            }
+            else
+            {
+                unusedSoundFiles.Push(soundFile);
             }
         }
         else // data is still in use
         {
-            soundFile->lastTouch = csGetTicks();
+            soundFile->lastTouch = now;
+        }
+    }
+
+    for(size_t i = 0; i < expiredSoundFiles.GetSize(); i++)
+    {
+        UnloadSoundFile(expiredSoundFiles[i]->name);
+    }
+
+    // unloading the least recently used sounds until the cache fits again,
+    // sounds that are playing can't be unloaded and don't count
+    if(loadedSize > cacheSize && !unusedSoundFiles.IsEmpty())
+    {
+        size_t unusedSize = 0;
+        for(size_t i = 0; i < unusedSoundFiles.GetSize(); i++)
+        {
+            unusedSize += unusedSoundFiles[i]->dataSize;
+        }
+
+        unusedSoundFiles.Sort(CompareLastTouch);
+        for(size_t i = 0; i < unusedSoundFiles.GetSize() && unusedSize > cacheSize; i++)
+        {
+            unusedSize -= unusedSoundFiles[i]->dataSize;
+            UnloadSoundFile(unusedSoundFiles[i]->name);
         }
     }
 }
@@ -311,5 +556,7 @@ void SoundDataCache::UnloadSoundLib()
     // unloading sound library
     libSoundFiles.DeleteAll();
     loadedSoundFiles.DeleteAll();
+    failedSoundFiles.DeleteAll();
+    loadedSize = 0;
 }
 
@@ -32,11 +32,17 @@
 #include <iutil/objreg.h>
 #include <csutil/csstring.h>
 #include <csutil/hash.h>
+#include <csutil/set.h>
+#include <csutil/threading/condition.h>
+#include <csutil/threading/mutex.h>
+#include <csutil/threading/thread.h>
 #include <iutil/vfs.h>
 #include <isndsys/ss_data.h>
 #include <isndsys/ss_loader.h>
 
 #define DEFAULT_SOUNDFILE_CACHETIME 300000
+#define DEFAULT_SOUNDFILE_CACHESIZE 65536   // KB
+#define DEFAULT_SOUNDFILE_PREFETCHRANGE 10.0f
 
 
 /**
@@ -49,6 +55,7 @@ public:
     csString            name;           ///< Identifier of this file/resource. MUST be unique.
     csString            fileName;       ///< File's name in our vfs. It doesn't need to be unique.
     csRef<iSndSysData>  sndData;        ///< Data in suitable format.
+    size_t              dataSize;       ///< Size in bytes of sndData, counted against the cache size.
     csTicks             lastTouch;      ///< Last time when this SoundFile was used/touched.
 
     /**
@@ -90,11 +97,22 @@ public:
  * could cause the application to crash by ending up with pointing to an object that
  * the cache has destroyed.
  *
+ * Prefetch:
+ * Sounds that will probably be played soon, like the ones of emitters the listener
+ * is approaching, can be handed to PrefetchSoundData. They are read and decoded by
+ * a background thread so that GetSoundData doesn't have to block on the VFS when
+ * they are actually played. Setting "PlaneShift.Sound.BackgroundLoading" to false
+ * disables the thread and prefetching.
+ *
  * Cache:
  * The data is cached and unloaded when it is not referenced anymore and the time
  * given in the configuration option "PlaneShift.Sound.DataCacheTime" has elapsed.
- * One can force the cache to unload a sound with UnloadSoundFile if it is known
- * that the sound won't be used again.
+ * The size of the cached data that is not referenced anymore is kept below
+ * "PlaneShift.Sound.DataCacheSize" (in KB) by unloading the least recently used of
+ * these sounds before their time has elapsed. Sounds still referenced don't count
+ * toward the limit and are never unloaded, so the total can exceed it. One can
+ * force the cache to unload a sound with UnloadSoundFile if it is known that the
+ * sound won't be used again.
  *
  * Death:
  * It is not necessary to call UnloadSoundLib. The destructor takes care of it too.
@@ -149,6 +167,25 @@ public:
      */
     bool GetSoundData(const char* name, csRef<iSndSysData> &sndData);
 
+    /**
+     * Queues a sound to be loaded by the background thread if it is not already
+     * cached. This never blocks, the sound is added to the cache during one of
+     * the next calls to Update. Does nothing if background loading is disabled.
+     * @param name the name of the sound to load (or its path if it is not in the
+     * library.
+     */
+    void PrefetchSoundData(const char* name);
+
+    /**
+     * Gets the distance from the maximum range of emitters and entities within
+     * which their sounds should be prefetched.
+     * @return the prefetch distance, 0 if background loading is disabled.
+     */
+    float GetPrefetchRange() const
+    {
+        return loaderThread.IsValid() ? prefetchRange : 0.0f;
+    }
+
     /**
      * Forces the cache to unload and delete the data of the given sound from the
      * memory, no matter if it's still in use or not.
@@ -157,19 +194,95 @@ public:
     void UnloadSoundFile(const char* name);
 
     /**
-     * Checks the reference counting to sounds to determine if they are still in use
-     * or not. Unloads the sound data that has not been used for the time specified
-     * in the configuration option "PlaneShift.Sound.DataCacheTime".
+     * Adds the sounds loaded in the background to the cache. Checks the reference
+     * counting to sounds to determine if they are still in use or not. Unloads the
+     * sound data that has not been used for the time specified in the configuration
+     * option "PlaneShift.Sound.DataCacheTime" and the least recently used unreferenced
+     * sounds while those are bigger than "PlaneShift.Sound.DataCacheSize".
      */
     void Update();
 
 private:
+    /**
+     * A sound file waiting for or being loaded by the background thread.
+     */
+    struct LoadRequest
+    {
+        csString            name;           ///< Identifier of the sound.
+        csString            fileName;       ///< File's name in our vfs.
+        csRef<iSndSysData>  sndData;        ///< Loaded data, invalid if loading failed.
+        bool                running;        ///< True once the loader has taken the request.
+        bool                done;           ///< True once sndData has been set.
+    };
+
+    /**
+     * Background thread reading and decoding the prefetched sounds.
+     */
+    class Loader : public CS::Threading::Runnable
+    {
+    public:
+        Loader(SoundDataCache* cache);
+        virtual void Run();
+
+    private:
+        SoundDataCache* cache;
+    };
+
     uint                         cacheTime;         ///< Number of milliseconds a file remains cached.
+    size_t                       cacheSize;         ///< Maximum size in bytes of the unused cached data.
+    size_t                       loadedSize;        ///< Size in bytes of the data in loadedSoundFiles.
+    float                        prefetchRange;     ///< Distance beyond the max range to prefetch sounds.
     csRef<iVFS>                  vfs;               ///< VFS used to retrieve the sound library.
     csRef<iSndSysLoader>         sndLoader;         ///< Crystal Space sound loader.
     csHash<SoundFile*, csString> libSoundFiles;     ///< Maps the sounds' identifiers with their data.
     csHash<SoundFile*, csString> loadedSoundFiles;  ///< Hash of loaded SoundFiles.
-    
+    csSet<csString>              failedSoundFiles;  ///< Sounds that couldn't be prefetched, not queued again.
+
+    csRef<CS::Threading::Thread>     loaderThread;  ///< Thread loading the prefetched sounds.
+    csHash<LoadRequest*, csString>   loadRequests;  ///< All requests not yet added to the cache.
+    csArray<LoadRequest*>            loadQueue;     ///< Requests waiting for the loader.
+    CS::Threading::Mutex             loadMutex;     ///< Protects loadRequests, loadQueue and their content.
+    CS::Threading::Condition         loadCondition; ///< Signals new requests and finished loads.
+    bool                             stopping;      ///< True when the loader has to exit.
+
+    /**
+     * Stops the background thread and deletes all pending requests.
+     */
+    void StopLoader();
+
+    /**
+     * Waits for the next request, used by the loader thread.
+     * @return the request to load, 0 when the loader has to stop.
+     */
+    LoadRequest* WaitForRequest();
+
+    /**
+     * Reads and decodes a sound file from the VFS. Safe to call from the loader.
+     * @param name the name of the sound used in error messages.
+     * @param fileName the file's name in the VFS.
+     * @return the sound data, invalid on error.
+     */
+    csPtr<iSndSysData> ReadSoundData(const char* name, const char* fileName) const;
+
+    /**
+     * Takes the request for the given sound from the loader. If the loader is
+     * already working on it then this waits for the data, otherwise the request
+     * is just dropped so that the caller can load it right away.
+     * @param name the name of the sound.
+     * @param sndData set to the loaded data if the loader has done its job.
+     * @return true if sndData has been set by the loader, false if the caller
+     * has to load the sound itself.
+     */
+    bool TakeLoadRequest(const char* name, csRef<iSndSysData> &sndData);
+
+    /**
+     * Stores loaded data in the SoundFile of the given sound and keeps track of it.
+     * @param name the name of the sound.
+     * @param sndData the loaded data.
+     * @return the SoundFile of the sound.
+     */
+    SoundFile* AddSoundFile(const char* name, iSndSysData* sndData);
+
     /**
      * Load the sound data into a SoundFile from the VFS (if not already loaded). If
      * the sound is not in libSoundFiles then it considers the parameter "name" as a
@@ -29,6 +29,7 @@
 // Project Includes
 //====================================================================================
 #include <music/musicutil.h>
+#include <music/pcmmixer.h>
 
 //====================================================================================
 // Local Includes
@@ -156,7 +157,7 @@ size_t Instrument::GetNoteBuffer(char pitch, int alter, uint octave, float durat
     return requestedBytes;
 }
 
-void Instrument::AddNoteToChord(char pitch, int alter, uint octave, float duration, uint noteNumber, char* buffer, size_t &bufferLength)
+void Instrument::AddNoteToChord(char pitch, int alter, uint octave, float duration, char* buffer, size_t &bufferLength)
 {
     Note* note = 0;
     csHash<Note*, char>* oct;
@@ -220,38 +221,25 @@ void Instrument::AddNoteToChord(char pitch, int alter, uint octave, float durati
         return;
     }
 
-    // updating buffer's length and cleaning up
+    // updating buffer's length and filling the new part with silence
     if(requestedBytes > bufferLength)
     {
-        for(size_t i = bufferLength; i < requestedBytes; i++)
-        {
-            buffer[i] = 0;
-        }
+        memset(buffer + bufferLength, format->Bits == 8 ? 128 : 0, requestedBytes - bufferLength);
         bufferLength = requestedBytes;
     }
 
     // adjust the copy size on the given note length
+    if(noteLength <= phaseShift)
+    {
+        return;
+    }
     if(requestedBytes > noteLength - phaseShift)
     {
         requestedBytes = noteLength - phaseShift;
     }
 
-    // Adding data: if noteNumber is odd we add the note
-    // in phase opposition to avoid to much big numbers.
-    if(noteNumber % 2 == 0)
-    {
-        for(size_t i = 0; i < requestedBytes; i++)
-        {
-            buffer[i] += noteBuffer[i + phaseShift];
-        }
-    }
-    else
-    {
-        for(size_t i = 0; i < requestedBytes; i++)
-        {
-            buffer[i] -= noteBuffer[i + phaseShift];
-        }
-    }
+    // adding data, samples that would overflow are clipped
+    psMusic::MixPCM(buffer, noteBuffer + phaseShift, requestedBytes, format->Bits);
 }
 
 bool Instrument::AddNote(const char* fileName, char pitch, int alter, uint octave)
@@ -147,7 +147,8 @@ public:
     size_t GetNoteBuffer(char note, int alter, uint octave, float duration, char* &buffer, size_t &length);
 
     /**
-     * Add a note to an already existing buffer.
+     * Add a note to an already existing buffer. The samples are added with
+     * saturation, so loud chords are clipped instead of wrapping around.
      *
      * @param note a char representing the note in the British English notation
      * (i.e. A, B, C, ..., G).
@@ -155,11 +156,10 @@ public:
      * it is not altered.
      * @param octave 4 for the central octave in piano.
      * @param duration the duration of the note in seconds.
-     * @param noteNumber the number of the note already in the chord.
      * @param buffer the buffer where the note is added for the given length.
      * @param length the current length of the buffer.
      */
-    void AddNoteToChord(char note, int alter, uint octave, float duration, uint noteNumber, char* buffer, size_t &bufferLength);
+    void AddNoteToChord(char note, int alter, uint octave, float duration, char* buffer, size_t &bufferLength);
 
 private:
     uint polyphony;                            ///< number of notes that this instrument can play at the same time.
@@ -70,7 +70,7 @@ psEmitter::~psEmitter()
     Stop();
 }
 
-bool psEmitter::CheckRange(csVector3 listenerPos)
+bool psEmitter::CheckRange(csVector3 listenerPos, float margin)
 {
     csVector3 rangeVec;
     float range;
@@ -82,7 +82,7 @@ bool psEmitter::CheckRange(csVector3 listenerPos)
     {
         return false;
     }
-    else if(range <= maxrange)
+    else if(range <= maxrange + margin)
     {
         return true;
     }
@@ -75,8 +75,9 @@ public:
      * Calculates the distance to the given position and returns 
      * true if this emitter is in range.
      * @param listenerPos position used for calculation
+     * @param margin distance to add to the maximum range
      */
-    bool CheckRange(csVector3 listenerPos);
+    bool CheckRange(csVector3 listenerPos, float margin = 0.0f);
     /**
      * Check time of day.
      * Checks if time is within this emitters timewindow.
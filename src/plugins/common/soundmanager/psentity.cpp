@@ -24,6 +24,7 @@
 
 #include "pssound.h"
 #include "soundmanager.h"
+#include "data.h"
 
 #include "util/log.h"
 
@@ -326,6 +327,21 @@ bool psEntity::Play(SoundControl* &ctrl, csVector3 entityPosition)
     return false;
 }
 
+void psEntity::PrefetchSounds() const
+{
+    EntityState* entityState = states.Get(state, 0);
+    if(entityState == 0)
+    {
+        return;
+    }
+
+    SoundDataCache* dataCache = SoundSystemManager::GetSingleton().GetSoundDataCache();
+    for(size_t i = 0; i < entityState->resources.GetSize(); i++)
+    {
+        dataCache->PrefetchSoundData(entityState->resources[i]);
+    }
+}
+
 void psEntity::Stop()
 {
     if(IsPlaying())
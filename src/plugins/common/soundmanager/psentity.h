@@ -201,6 +201,12 @@ public:
      */
     void SetState(int state, bool forceChange, bool setReady);
 
+    /**
+     * Asks the sound data cache to load the sounds of the current state in
+     * the background so that they are ready when the entity gets in range.
+     */
+    void PrefetchSounds() const;
+
     /**
      * Force this entity to play the sound associated to its current state.
      * You need to supply a SoundControl and the position for this sound.
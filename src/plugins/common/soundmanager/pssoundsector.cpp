@@ -35,6 +35,7 @@
 #include "psemitter.h"
 #include "soundctrl.h"
 #include "sectormngr.h"
+#include "data.h"
 #include "soundmanager.h"
 
 
@@ -292,6 +293,8 @@ void psSoundSector::UpdateAllEmitters(SoundControl* &ctrl)
     psEmitter* emitter;
     int timeOfDay = SoundSectorManager::GetSingleton().GetTimeOfDay();
     csVector3 listenerPos = SoundSystemManager::GetSingleton().GetListenerPos();
+    SoundDataCache* dataCache = SoundSystemManager::GetSingleton().GetSoundDataCache();
+    float prefetchRange = dataCache->GetPrefetchRange();
 
     // start/stop all emitters in range
     for(size_t i = 0; i< emitterarray.GetSize(); i++)
@@ -323,6 +326,15 @@ void psSoundSector::UpdateAllEmitters(SoundControl* &ctrl)
         {
             emitter->Stop();
         }
+        else if(prefetchRange > 0.0f
+                && active == true
+                && ctrl->GetToggle() == true
+                && emitter->CheckTimeOfDay(timeOfDay) == true
+                && emitter->CheckRange(listenerPos, prefetchRange) == true)
+        {
+            // the listener is getting close, load the sound before it has to play
+            dataCache->PrefetchSoundData(emitter->resource);
+        }
     }
 }
 
@@ -334,6 +346,7 @@ void psSoundSector::UpdateAllEntities(SoundControl* &ctrl)
 
     listenerPos = SoundSystemManager::GetSingleton().GetListenerPos();
     timeOfDay = SoundSectorManager::GetSingleton().GetTimeOfDay();
+    float prefetchRange = SoundSystemManager::GetSingleton().GetSoundDataCache()->GetPrefetchRange();
 
     csHash<psEntity*, uint>::GlobalIterator tempEntityIter(tempEntities.GetIterator());
     while(tempEntityIter.HasNext())
@@ -351,6 +364,12 @@ void psSoundSector::UpdateAllEntities(SoundControl* &ctrl)
         // should be updated
         if(entity->IsTemporary())
         {
+            // loading the sounds of entities the listener is approaching
+            if(prefetchRange > 0.0f && !entity->IsPlaying() && range <= entity->GetMaxRange() + prefetchRange)
+            {
+                entity->PrefetchSounds();
+            }
+
             entity->Update(timeOfDay, range, SoundManager::updateTime, ctrl, entity->GetPosition());
         }
     }
@@ -405,7 +405,7 @@ bool SndSysSongStream::GetNextChord(char* &noteBuffer, size_t &noteBufferSize)
         AdjustAlteration(step, alter);
 
         // add waves
-        songData->instrument->AddNoteToChord(step, alter, octave, duration, nChordNotes, copyNoteBuffer, noteBufferSize);
+        songData->instrument->AddNoteToChord(step, alter, octave, duration, copyNoteBuffer, noteBufferSize);
 
         // updating current state
         nChordNotes++;
@@ -421,6 +421,11 @@ CS_PLUGIN_NAMESPACE_BEGIN(dbmysql)
         profileDump.Empty();
     }
 
+    void psMysqlConnection::GetProfileTotals(uint32 &statements, uint64 &time)
+    {
+        profs.GetTotals(statements, time);
+    }
+
     iRecord* psMysqlConnection::NewUpdatePreparedStatement(const char* table, const char* idfield, unsigned int count, const char* file, unsigned int line)
     {
         return new dbUpdate(conn, table, idfield, count, logcsv, file, line);
@@ -449,6 +449,11 @@ CS_PLUGIN_NAMESPACE_BEGIN(dbpostgresql)
         profileDump.Empty();
     }
 
+    void psMysqlConnection::GetProfileTotals(uint32 &statements, uint64 &time)
+    {
+        profs.GetTotals(statements, time);
+    }
+
     iRecord* psMysqlConnection::NewUpdatePreparedStatement(const char* table, const char* idfield, unsigned int count, const char* file, unsigned int line)
     {
         return new dbUpdate(conn, &stmtNum, table, idfield, count, logcsv, file, line);
@@ -118,6 +118,7 @@ CS_PLUGIN_NAMESPACE_BEGIN(dbpostgresql)
 
         virtual const char* DumpProfile();
         virtual void ResetProfile();
+        virtual void GetProfileTotals(uint32 &statements, uint64 &time);
         
         iRecord* NewUpdatePreparedStatement(const char* table, const char* idfield, unsigned int count, const char* file, unsigned int line);
         iRecord* NewInsertPreparedStatement(const char* table, unsigned int count, const char* file, unsigned int line);
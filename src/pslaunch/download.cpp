@@ -19,11 +19,14 @@
 
 #include <cssysdef.h>
 
+#include <csutil/md5.h>
 #include <csutil/randomgen.h>
+#include <iutil/stringarray.h>
 
 #include <curl/curl.h>
 
 #include "download.h"
+#include "transfer.h"
 #include "updaterconfig.h"
 #include "updaterengine.h"
 
@@ -149,6 +152,40 @@ int ProgressCallback(void *clientp, double finalSize, double dlnow, double /*ult
     return UpdaterEngine::GetSingletonPtr()->CheckQuit() ? 1 : 0;
 }
 
+/* Reports the progress of DownloadFiles and lets the user cancel it. */
+class DownloadScheduler : public TransferScheduler
+{
+public:
+    DownloadScheduler(const csStringArray& baseURLs, size_t connections, uint retries):
+        TransferScheduler(baseURLs, connections, retries), filesDone(0)
+    {
+    }
+
+protected:
+    bool CheckCancel()
+    {
+        return UpdaterEngine::GetSingletonPtr()->CheckQuit();
+    }
+
+    void TransferDone(size_t index)
+    {
+        filesDone++;
+        if(!Succeeded(index))
+        {
+            UpdaterEngine::GetSingletonPtr()->PrintOutput("Failed to download %s: %s\n",
+                GetURL(index).GetData(), GetError(index).GetData());
+        }
+
+        if(filesDone % 100 == 0 || filesDone == GetSize())
+        {
+            UpdaterEngine::GetSingletonPtr()->PrintOutput("Downloaded %zu of %zu files\n", filesDone, GetSize());
+        }
+    }
+
+private:
+    size_t filesDone;
+};
+
 Downloader::Downloader(iVFS* _vfs, UpdaterConfig* _config)
 {
     this->Init(_vfs);
@@ -415,6 +452,88 @@ bool Downloader::DownloadFile(const char *file, const char *dest, bool URL, bool
     return false;
 }
 
+size_t Downloader::DownloadFiles(csArray<FileRequest>& files, const csStringArray& baseURLs, size_t connections, uint retries)
+{
+    if(!vfs || !fileUtil)
+    {
+        return 0;
+    }
+
+    csStringArray mirrors = baseURLs;
+    if(mirrors.IsEmpty() && config)
+    {
+        // Start with the active mirror, the files are spread from there.
+        csRefArray<Mirror>& configMirrors = config->GetCurrentConfig()->GetMirrors();
+        for(size_t i = 0; i < configMirrors.GetSize(); i++)
+        {
+            mirrors.Push(configMirrors[(activeMirrorID + i) % configMirrors.GetSize()]->GetBaseURL());
+        }
+    }
+
+    DownloadScheduler scheduler(mirrors, connections, retries);
+
+    // Every file gets a partial file named after its destination and md5sum,
+    // so the data of a failed transfer is resumed by the next run. The cache
+    // dir is removed with the downloader, so they are kept in their own dir.
+    fileUtil->MakeDirectory(UPDATE_PARTIAL_DIR);
+    csStringArray cacheFiles;
+    for(size_t i = 0; i < files.GetSize(); i++)
+    {
+        csString key = files[i].dest + ":" + files[i].md5;
+        csString fileName;
+        fileName.Format("%s/%s.download", UPDATE_PARTIAL_DIR,
+            CS::Utility::Checksum::MD5::Encode(key).HexString().GetData());
+        cacheFiles.Push(fileName);
+
+        csRef<iDataBuffer> cachepath = vfs->GetRealPath(fileName);
+        scheduler.Add(files[i].paths, cachepath->GetData(), files[i].md5);
+        files[i].success = false;
+    }
+
+    scheduler.Run();
+
+    size_t downloaded = 0;
+    for(size_t i = 0; i < files.GetSize(); i++)
+    {
+        if(scheduler.Succeeded(i))
+        {
+            if(vfs->Exists(files[i].dest))
+                fileUtil->RemoveFile(files[i].dest);
+
+            if(fileUtil->CopyFile(cacheFiles[i], files[i].dest, true, false, true, false))
+            {
+                files[i].success = true;
+                downloaded++;
+            }
+            else
+            {
+                UpdaterEngine::GetSingletonPtr()->PrintOutput("Error renaming file %s to %s.\n", cacheFiles[i], files[i].dest.GetData());
+            }
+
+            if(vfs->Exists(cacheFiles[i]))
+                fileUtil->RemoveFile(cacheFiles[i], true);
+        }
+    }
+
+    // Only the partial files of this batch that can still be resumed are kept,
+    // the ones of files that have been repaired since are removed.
+    csRef<iStringArray> partialFiles = vfs->FindFiles(UPDATE_PARTIAL_DIR "/");
+    for(size_t i = 0; partialFiles.IsValid() && i < partialFiles->GetSize(); i++)
+    {
+        const char* partialFile = partialFiles->Get(i);
+        bool pending = false;
+        for(size_t j = 0; j < files.GetSize() && !pending; j++)
+        {
+            pending = !files[j].success && cacheFiles[j] == partialFile;
+        }
+
+        if(!pending)
+            fileUtil->RemoveFile(partialFile, true);
+    }
+
+    return downloaded;
+}
+
 uint Downloader::CycleActiveMirror()
 {
     activeMirrorID++;
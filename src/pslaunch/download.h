@@ -23,6 +23,7 @@
 
 #include <iutil/vfs.h>
 #include <csutil/csstring.h>
+#include <csutil/stringarray.h>
 #include <util/fileutil.h>
 
 class UpdaterEngine;
@@ -33,6 +34,22 @@ typedef void CURL;
 class Downloader
 {
 public:
+    /* A file to download with DownloadFiles. */
+    struct FileRequest
+    {
+        /* Paths of the file relative to the mirrors, tried in order. */
+        csStringArray paths;
+
+        /* VFS path to save the file to. */
+        csString dest;
+
+        /* Expected md5sum of the file, empty to not check it. */
+        csString md5;
+
+        /* Set by DownloadFiles if the file was saved to dest. */
+        bool success;
+    };
+
     Downloader(iVFS* _vfs, UpdaterConfig* _config);
     Downloader(iVFS* _vfs);
     ~Downloader();
@@ -46,6 +63,17 @@ public:
      */
     bool DownloadFile (const char* file, const char* dest, bool URL, bool silent = false, uint retries = 1, bool vfsPath = false);
 
+    /*
+     * Download a number of files concurrently, with up to 'connections' transfers
+     * at a time spread over the base URLs. If baseURLs is empty the configured
+     * mirrors are used. An interrupted transfer is resumed 'retries' times from
+     * the same URL before trying the next one. Files are checked against their
+     * md5sum while they come in. Data of failed transfers is kept, a later call
+     * for the same destination and md5sum resumes it.
+     * Returns the number of files downloaded.
+     */
+    size_t DownloadFiles(csArray<FileRequest>& files, const csStringArray& baseURLs, size_t connections, uint retries = 1);
+
     /* Set the proxy server host and port */
     void SetProxy (const char* host, int port);
 private:
@@ -0,0 +1,280 @@
+/*
+* integritycheck.cpp
+*
+* Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation (version 2 of the License)
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*
+*/
+
+#include <csutil/md5.h>
+#include <csutil/refarr.h>
+#include <csutil/stringarray.h>
+#include <csutil/sysfunc.h>
+
+#include "integritycheck.h"
+#include "updaterengine.h"
+
+/* Size of the chunks files are read in. */
+#define HASH_CHUNK_SIZE 65536
+
+IntegrityChecker::IntegrityChecker(iVFS* vfs, InfoShare* infoShare, const char* cacheFile):
+    vfs(vfs), infoShare(infoShare), cacheFile(cacheFile), cacheChanged(false),
+    nextJob(0), jobsDone(0), bytesRead(0), bytesSkipped(0), startTime(0)
+{
+    if(!this->cacheFile.IsEmpty())
+    {
+        LoadCache();
+    }
+}
+
+IntegrityChecker::~IntegrityChecker()
+{
+    if(cacheChanged)
+    {
+        SaveCache();
+    }
+}
+
+size_t IntegrityChecker::AddFile(const char* path)
+{
+    Job job;
+    job.path = path;
+    return jobs.Push(job);
+}
+
+bool IntegrityChecker::Run(size_t threads)
+{
+    nextJob = 0;
+    jobsDone = 0;
+    bytesRead = 0;
+    bytesSkipped = 0;
+    startTime = csGetTicks();
+    PublishProgress(true);
+
+    if(threads > jobs.GetSize())
+    {
+        threads = jobs.GetSize();
+    }
+
+    if(threads <= 1)
+    {
+        while(ProcessNext())
+        {
+        }
+    }
+    else
+    {
+        csRefArray<CS::Threading::Thread> workers;
+        for(size_t i = 0; i < threads; i++)
+        {
+            csRef<Worker> worker;
+            worker.AttachNew(new Worker(this));
+
+            csRef<CS::Threading::Thread> thread;
+            thread.AttachNew(new CS::Threading::Thread(worker));
+            thread->Start();
+            workers.Push(thread);
+        }
+
+        for(size_t i = 0; i < workers.GetSize(); i++)
+        {
+            workers[i]->Wait();
+        }
+    }
+
+    PublishProgress(false);
+
+    if(cacheChanged)
+    {
+        SaveCache();
+        cacheChanged = false;
+    }
+
+    return !infoShare->GetCancelUpdater();
+}
+
+void IntegrityChecker::Worker::Run()
+{
+    while(checker->ProcessNext())
+    {
+    }
+}
+
+bool IntegrityChecker::ProcessNext()
+{
+    size_t index;
+    {
+        CS::Threading::MutexScopedLock lock(mutex);
+        if(nextJob >= jobs.GetSize() || infoShare->GetCancelUpdater())
+        {
+            return false;
+        }
+        index = nextJob++;
+    }
+
+    // Jobs aren't added while running, so each worker can fill in its own.
+    Job& job = jobs[index];
+
+    size_t size = 0;
+    csString time;
+    bool exists = GetSignature(job.path, size, time);
+
+    if(exists && !cacheFile.IsEmpty())
+    {
+        CS::Threading::MutexScopedLock lock(mutex);
+        const CacheEntry* entry = cache.GetElementPointer(job.path);
+        if(entry && entry->size == size && entry->time == time)
+        {
+            job.md5 = entry->md5;
+            jobsDone++;
+            bytesSkipped += size;
+            PublishProgress(true);
+            return true;
+        }
+    }
+
+    if(exists)
+    {
+        job.md5 = HashFile(vfs, job.path, infoShare);
+    }
+
+    CS::Threading::MutexScopedLock lock(mutex);
+    jobsDone++;
+    bytesRead += size;
+
+    if(!job.md5.IsEmpty() && !cacheFile.IsEmpty())
+    {
+        CacheEntry entry;
+        entry.size = size;
+        entry.time = time;
+        entry.md5 = job.md5;
+        cache.PutUnique(job.path, entry);
+        cacheChanged = true;
+    }
+
+    PublishProgress(true);
+    return true;
+}
+
+csString IntegrityChecker::HashFile(iVFS* vfs, const char* path, InfoShare* infoShare)
+{
+    csRef<iFile> file = vfs->Open(path, VFS_FILE_READ);
+    if(!file.IsValid())
+    {
+        return "";
+    }
+
+    CS::Utility::Checksum::MD5 md5;
+    md5.Init();
+
+    // Kept off the stack of the worker threads.
+    char* buffer = new char[HASH_CHUNK_SIZE];
+    size_t length;
+    while((length = file->Read(buffer, HASH_CHUNK_SIZE)) > 0)
+    {
+        md5.Append((const CS::Utility::Checksum::MD5::md5_byte_t*)buffer, length);
+
+        if(infoShare && infoShare->GetCancelUpdater())
+        {
+            delete[] buffer;
+            return "";
+        }
+    }
+    delete[] buffer;
+
+    CS::Utility::Checksum::MD5::Digest digest;
+    md5.Finish(digest.data);
+    return digest.HexString();
+}
+
+bool IntegrityChecker::GetSignature(const char* path, size_t& size, csString& time)
+{
+    csFileTime fileTime;
+    if(!vfs->GetFileTime(path, fileTime))
+    {
+        return false;
+    }
+
+    csRef<iFile> file = vfs->Open(path, VFS_FILE_READ);
+    if(!file.IsValid())
+    {
+        return false;
+    }
+    size = file->GetSize();
+
+    time.Format("%04d%02d%02d%02d%02d%02d", fileTime.year + 1900, fileTime.mon + 1, fileTime.day,
+                fileTime.hour, fileTime.min, fileTime.sec);
+    return true;
+}
+
+void IntegrityChecker::LoadCache()
+{
+    csRef<iDataBuffer> data = vfs->ReadFile(cacheFile, true);
+    if(!data.IsValid())
+    {
+        return;
+    }
+
+    // One file per line: md5sum size time path
+    csStringArray lines;
+    lines.SplitString(data->GetData(), "\n", csStringArray::delimIgnore);
+    for(size_t i = 0; i < lines.GetSize(); i++)
+    {
+        csStringArray fields;
+        fields.SplitString(lines[i], " ", csStringArray::delimIgnore);
+        if(fields.GetSize() < 4)
+        {
+            continue;
+        }
+
+        // Paths may contain spaces.
+        csString path = fields[3];
+        for(size_t j = 4; j < fields.GetSize(); j++)
+        {
+            path.AppendFmt(" %s", fields[j]);
+        }
+
+        CacheEntry entry;
+        entry.md5 = fields[0];
+        entry.size = strtoul(fields[1], NULL, 10);
+        entry.time = fields[2];
+        cache.PutUnique(path, entry);
+    }
+}
+
+void IntegrityChecker::SaveCache()
+{
+    csString data;
+    csHash<CacheEntry, csString>::GlobalIterator iter(cache.GetIterator());
+    while(iter.HasNext())
+    {
+        csString path;
+        const CacheEntry& entry = iter.Next(path);
+        data.AppendFmt("%s %zu %s %s\n", entry.md5.GetData(), entry.size, entry.time.GetData(), path.GetData());
+    }
+
+    vfs->WriteFile(cacheFile, data.GetData(), data.Length());
+}
+
+void IntegrityChecker::PublishProgress(bool running)
+{
+    InfoShare::IntegrityProgress progress;
+    progress.running = running;
+    progress.filesDone = jobsDone;
+    progress.filesTotal = jobs.GetSize();
+    progress.bytesRead = bytesRead;
+    progress.bytesSkipped = bytesSkipped;
+    progress.elapsed = csGetTicks() - startTime;
+    infoShare->SetIntegrityProgress(progress);
+}
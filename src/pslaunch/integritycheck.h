@@ -0,0 +1,116 @@
+/*
+* integritycheck.h
+*
+* Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation (version 2 of the License)
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*
+*/
+
+#ifndef __INTEGRITYCHECK_H__
+#define __INTEGRITYCHECK_H__
+
+#include <iutil/vfs.h>
+#include <csutil/csstring.h>
+#include <csutil/hash.h>
+#include <csutil/threading/mutex.h>
+#include <csutil/threading/thread.h>
+
+/* Cache of the md5sums of the installed files. */
+#define INTEGRITY_CACHE_FILENAME "/this/integritycache.txt"
+
+class InfoShare;
+
+/*
+* Calculates the md5sums of a list of files with a number of threads.
+*
+* Files are read in chunks, so big files don't have to fit in memory.
+* The md5sum of each file is kept in a cache together with its size and
+* modification time, files that didn't change since the last check are
+* not read again.
+*/
+class IntegrityChecker
+{
+public:
+    /*
+    * cacheFile is the VFS path of the signature cache, NULL to not use one.
+    * The progress is published to infoShare.
+    */
+    IntegrityChecker(iVFS* vfs, InfoShare* infoShare, const char* cacheFile);
+    ~IntegrityChecker();
+
+    /* Add a file to check, returns its index in the results. */
+    size_t AddFile(const char* path);
+
+    /*
+    * Calculate the md5sums of all added files with the given number of threads.
+    * Returns false if the check was canceled.
+    */
+    bool Run(size_t threads);
+
+    /* The md5sum of a checked file, empty if the file couldn't be read. */
+    const csString& GetMD5(size_t index) const { return jobs[index].md5; }
+
+    /* Calculate the md5sum of a file reading it in chunks, empty if it can't be read. */
+    static csString HashFile(iVFS* vfs, const char* path, InfoShare* infoShare = NULL);
+
+private:
+    struct Job
+    {
+        csString path;
+        csString md5;
+    };
+
+    struct CacheEntry
+    {
+        size_t size;
+        csString time;
+        csString md5;
+    };
+
+    class Worker : public CS::Threading::Runnable
+    {
+    public:
+        Worker(IntegrityChecker* checker) : checker(checker) {}
+        void Run();
+
+    private:
+        IntegrityChecker* checker;
+    };
+
+    /* Hash the next job, returns false when there are no jobs left. */
+    bool ProcessNext();
+
+    /* Size and modification time of a file, false if it doesn't exist. */
+    bool GetSignature(const char* path, size_t& size, csString& time);
+
+    void LoadCache();
+    void SaveCache();
+    void PublishProgress(bool running);
+
+    csRef<iVFS> vfs;
+    InfoShare* infoShare;
+    csString cacheFile;
+    csHash<CacheEntry, csString> cache;
+    bool cacheChanged;
+
+    csArray<Job> jobs;
+    size_t nextJob;
+    size_t jobsDone;
+    uint64 bytesRead;
+    uint64 bytesSkipped;
+    csTicks startTime;
+    CS::Threading::Mutex mutex;
+};
+
+#endif // __INTEGRITYCHECK_H__
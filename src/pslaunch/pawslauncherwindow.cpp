@@ -96,6 +96,30 @@ void pawsLauncherWindow::EnablePlay()
         play->SetEnabled(true);
 }
 
+void pawsLauncherWindow::ShowIntegrityProgress(const InfoShare::IntegrityProgress& progress)
+{
+    pawsTextBox* text = (pawsTextBox*)FindWidget("UpdaterProgress");
+    if(!text)
+        return;
+
+    if(!progress.running)
+    {
+        text->Hide();
+        return;
+    }
+
+    float seconds = progress.elapsed / 1000.0f;
+    float mbRead = progress.bytesRead / (1024.0f * 1024.0f);
+    float mbSkipped = progress.bytesSkipped / (1024.0f * 1024.0f);
+
+    csString status;
+    status.Format("Checked %zu of %zu files, %.1f MB read at %.1f MB/s, %.1f MB unchanged",
+        progress.filesDone, progress.filesTotal, mbRead,
+        seconds > 0.0f ? mbRead / seconds : 0.0f, mbSkipped);
+    text->SetText(status);
+    text->Show();
+}
+
 void pawsLauncherWindow::UpdateNews()
 {
     pawsMessageTextBox* serverNews = (pawsMessageTextBox*)FindWidget("ServerNews");
@@ -36,6 +36,9 @@ public:
     bool PostSetup();
     void EnablePlay();
 
+    /* Show the progress and throughput of the integrity check. */
+    void ShowIntegrityProgress(const InfoShare::IntegrityProgress& progress);
+
 private:
     pawsWidget* launcherMain;
     pawsWidget* launcherUpdater;
@@ -251,6 +251,9 @@ bool psLauncherGUI::HandleEvent (iEvent &ev)
                 updateProgressOutput->AppendLastMessage(message);
             }
         }
+        pawsLauncherWindow* launcher = (pawsLauncherWindow*)paws->FindWidget("Launcher");
+        launcher->ShowIntegrityProgress(infoShare->GetIntegrityProgress());
+
         if(infoShare->GetUpdateNeeded())
         {
             pawsButton* yes = (pawsButton*)paws->FindWidget("UpdaterYesButton");
@@ -0,0 +1,443 @@
+/*
+* transfer.cpp
+*
+* Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation (version 2 of the License)
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*
+*/
+
+#include <cssysdef.h>
+
+#include <csutil/sysfunc.h>
+
+#include <curl/curl.h>
+
+#ifdef CS_PLATFORM_UNIX
+#include <sys/select.h>
+#endif
+
+#include "transfer.h"
+
+/* Size of the chunks existing targets are hashed in. */
+#define RESUME_CHUNK_SIZE 65536
+
+/* A transfer receiving less than a byte per second for this long is restarted. */
+#define STALL_TIMEOUT 60
+
+TransferScheduler::TransferScheduler(const csStringArray& baseURLs, size_t connections, uint retries):
+    baseURLs(baseURLs), connections(connections > 1 ? connections : 1), retries(retries)
+{
+    curl_global_init(CURL_GLOBAL_ALL);
+    multi = curl_multi_init();
+}
+
+TransferScheduler::~TransferScheduler()
+{
+    for(size_t i = 0; i < transfers.GetSize(); i++)
+    {
+        Close(transfers[i]);
+        delete[] transfers[i]->errorBuffer;
+        delete transfers[i];
+    }
+
+    if(multi)
+        curl_multi_cleanup(multi);
+    curl_global_cleanup();
+}
+
+size_t TransferScheduler::Add(const csStringArray& paths, const char* target, const char* md5)
+{
+    Transfer* transfer = new Transfer;
+    transfer->index = transfers.GetSize();
+    transfer->paths = paths;
+    transfer->target = target;
+    transfer->md5 = md5;
+    transfer->handle = NULL;
+    transfer->file = NULL;
+    transfer->hash.Init();
+    transfer->written = 0;
+    // Spread the files over the mirrors.
+    transfer->firstMirror = baseURLs.GetSize() ? transfer->index % baseURLs.GetSize() : 0;
+    transfer->candidate = 0;
+    transfer->attempts = 0;
+    transfer->started = false;
+    transfer->receiving = false;
+    transfer->writeFailed = false;
+    transfer->success = false;
+    transfer->done = false;
+    transfer->errorBuffer = new char[CURL_ERROR_SIZE];
+    transfer->errorBuffer[0] = '\0';
+
+    return transfers.Push(transfer);
+}
+
+bool TransferScheduler::Run()
+{
+    if(!multi)
+    {
+        for(size_t i = 0; i < transfers.GetSize(); i++)
+        {
+            transfers[i]->error = "CURL failed to initialize!";
+            transfers[i]->done = true;
+        }
+        return true;
+    }
+
+    size_t next = 0;
+    size_t active = 0;
+    bool canceled = false;
+
+    while(true)
+    {
+        // Keep all connections busy.
+        while(active < connections && next < transfers.GetSize())
+        {
+            Transfer* transfer = transfers[next++];
+            if(Start(transfer))
+            {
+                active++;
+            }
+            else
+            {
+                transfer->done = true;
+                TransferDone(transfer->index);
+            }
+        }
+
+        if(active == 0)
+            break;
+
+        int running;
+        while(curl_multi_perform(multi, &running) == CURLM_CALL_MULTI_PERFORM)
+        {
+        }
+
+        bool finished = false;
+        CURLMsg* msg;
+        int left;
+        while((msg = curl_multi_info_read(multi, &left)) != NULL)
+        {
+            if(msg->msg != CURLMSG_DONE)
+                continue;
+
+            char* data;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &data);
+            Transfer* transfer = (Transfer*)data;
+            CURLcode result = msg->data.result;
+
+            finished = true;
+            if(Finish(transfer, result) || !Start(transfer))
+            {
+                transfer->done = true;
+                active--;
+                TransferDone(transfer->index);
+            }
+        }
+
+        if(CheckCancel())
+        {
+            canceled = true;
+            break;
+        }
+
+        // New transfers can be started right away.
+        if(!finished)
+            Wait(100);
+    }
+
+    if(canceled)
+    {
+        for(size_t i = 0; i < transfers.GetSize(); i++)
+        {
+            Transfer* transfer = transfers[i];
+            if(!transfer->done)
+            {
+                Close(transfer);
+                transfer->error = "Canceled";
+                transfer->done = true;
+            }
+        }
+    }
+
+    return !canceled;
+}
+
+bool TransferScheduler::Start(Transfer* transfer)
+{
+    if(baseURLs.IsEmpty() || transfer->paths.IsEmpty())
+    {
+        transfer->error = "No mirrors to download from!";
+        return false;
+    }
+
+    if(!transfer->started)
+    {
+        transfer->started = true;
+
+        // Resume a target left by an earlier run, the data has to be hashed too.
+        FILE* existing = fopen(transfer->target.GetData(), "rb");
+        if(existing)
+        {
+            char* buffer = new char[RESUME_CHUNK_SIZE];
+            size_t length;
+            while((length = fread(buffer, 1, RESUME_CHUNK_SIZE, existing)) > 0)
+            {
+                transfer->hash.Append((const CS::Utility::Checksum::MD5::md5_byte_t*)buffer, length);
+                transfer->written += length;
+            }
+            delete[] buffer;
+            fclose(existing);
+        }
+    }
+
+    transfer->file = fopen(transfer->target.GetData(), transfer->written > 0 ? "ab" : "wb");
+    if(!transfer->file)
+    {
+        transfer->error.Format("Couldn't write to file! (%s)", transfer->target.GetData());
+        return false;
+    }
+
+    transfer->handle = curl_easy_init();
+    if(!transfer->handle)
+    {
+        fclose(transfer->file);
+        transfer->file = NULL;
+        transfer->error = "CURL failed to initialize!";
+        return false;
+    }
+
+    transfer->url = GetCandidateURL(transfer);
+    transfer->receiving = false;
+    transfer->writeFailed = false;
+    transfer->errorBuffer[0] = '\0';
+
+    CURL* curl = transfer->handle;
+    curl_easy_setopt(curl, CURLOPT_URL, transfer->url.GetData());
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->errorBuffer);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (char*)transfer);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &WriteData);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(curl, CURLOPT_HEADER, 0);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, STALL_TIMEOUT);
+    if(transfer->written > 0)
+    {
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)transfer->written);
+    }
+
+    curl_multi_add_handle(multi, curl);
+    return true;
+}
+
+bool TransferScheduler::Finish(Transfer* transfer, int result)
+{
+    long httpCode = 0;
+    curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &httpCode);
+    Close(transfer);
+
+    if(transfer->writeFailed)
+    {
+        // Retrying won't help if the disk is full.
+        transfer->error.Format("Couldn't write to file! (%s)", transfer->target.GetData());
+        return true;
+    }
+
+    if(result == CURLE_OK)
+    {
+        CS::Utility::Checksum::MD5::Digest digest;
+        transfer->hash.Finish(digest.data);
+        csString md5sum = digest.HexString();
+
+        if(transfer->md5.IsEmpty() || md5sum.Compare(transfer->md5))
+        {
+            transfer->md5sum = md5sum;
+            transfer->error.Empty();
+            transfer->success = true;
+            return true;
+        }
+
+        // Try to get a good copy from somewhere else, the bad data is never
+        // kept for a later run to resume.
+        transfer->error.Format("md5sum %s of %s does not match %s", md5sum.GetData(),
+                               transfer->url.GetData(), transfer->md5.GetData());
+        Restart(transfer);
+        return !NextCandidate(transfer);
+    }
+
+    if(transfer->errorBuffer[0])
+        transfer->error = transfer->errorBuffer;
+    else
+        transfer->error = curl_easy_strerror((CURLcode)result);
+
+    if(httpCode == 416 || result == CURLE_BAD_DOWNLOAD_RESUME || result == CURLE_RANGE_ERROR)
+    {
+        // The partial data doesn't fit the file on the server, get all of it.
+        Restart(transfer);
+    }
+    else if(result == CURLE_HTTP_RETURNED_ERROR || result == CURLE_REMOTE_FILE_NOT_FOUND ||
+            result == CURLE_FILE_COULDNT_READ_FILE || result == CURLE_COULDNT_RESOLVE_HOST ||
+            result == CURLE_COULDNT_CONNECT)
+    {
+        // Not there, no use in asking again.
+        return !NextCandidate(transfer);
+    }
+
+    // Resume from the same URL first.
+    if(transfer->attempts < retries)
+    {
+        transfer->attempts++;
+        return false;
+    }
+
+    return !NextCandidate(transfer);
+}
+
+bool TransferScheduler::NextCandidate(Transfer* transfer)
+{
+    transfer->attempts = 0;
+    transfer->candidate++;
+    return transfer->candidate < baseURLs.GetSize() * transfer->paths.GetSize();
+}
+
+void TransferScheduler::Restart(Transfer* transfer)
+{
+    transfer->hash.Init();
+    transfer->written = 0;
+
+    if(transfer->file)
+    {
+        fclose(transfer->file);
+        transfer->file = fopen(transfer->target.GetData(), "wb");
+    }
+    else
+    {
+        // Finished attempts are closed already, the next Start creates it again.
+        remove(transfer->target.GetData());
+    }
+}
+
+void TransferScheduler::Close(Transfer* transfer)
+{
+    if(transfer->handle)
+    {
+        curl_multi_remove_handle(multi, transfer->handle);
+        curl_easy_cleanup(transfer->handle);
+        transfer->handle = NULL;
+    }
+
+    if(transfer->file)
+    {
+        fclose(transfer->file);
+        transfer->file = NULL;
+    }
+}
+
+void TransferScheduler::Wait(long timeout)
+{
+    long curlTimeout = -1;
+    curl_multi_timeout(multi, &curlTimeout);
+    if(curlTimeout >= 0 && curlTimeout < timeout)
+        timeout = curlTimeout;
+
+    if(timeout <= 0)
+        return;
+
+    fd_set readSet;
+    fd_set writeSet;
+    fd_set excSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    FD_ZERO(&excSet);
+
+    int maxfd = -1;
+    curl_multi_fdset(multi, &readSet, &writeSet, &excSet, &maxfd);
+
+    if(maxfd == -1)
+    {
+        // Nothing to wait on yet, like while resolving a host.
+        csSleep(timeout < 10 ? timeout : 10);
+        return;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    select(maxfd + 1, &readSet, &writeSet, &excSet, &tv);
+}
+
+csString TransferScheduler::GetCandidateURL(Transfer* transfer) const
+{
+    size_t pathCount = transfer->paths.GetSize();
+    size_t mirror = (transfer->firstMirror + transfer->candidate / pathCount) % baseURLs.GetSize();
+    csString path = transfer->paths[transfer->candidate % pathCount];
+
+    // Escape the filename, the directories are kept as they are.
+    csString url = baseURLs[mirror];
+    size_t slash = path.FindLast('/');
+    csString name = path;
+    if(slash != (size_t)-1)
+    {
+        url.Append(path.Slice(0, slash + 1));
+        name = path.Slice(slash + 1);
+    }
+
+    char* encName = curl_easy_escape(transfer->handle, name.GetData(), (int)name.Length());
+    if(encName)
+    {
+        url.Append(encName);
+        curl_free(encName);
+    }
+    else
+    {
+        url.Append(name);
+    }
+
+    return url;
+}
+
+size_t TransferScheduler::WriteData(void* ptr, size_t size, size_t nmemb, void* userData)
+{
+    Transfer* transfer = (Transfer*)userData;
+    size_t length = size * nmemb;
+
+    if(!transfer->receiving)
+    {
+        transfer->receiving = true;
+
+        // A server that doesn't support ranges sends the whole file again.
+        long httpCode = 0;
+        curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &httpCode);
+        if(transfer->written > 0 && httpCode == 200)
+        {
+            transfer->hash.Init();
+            transfer->written = 0;
+            fclose(transfer->file);
+            transfer->file = fopen(transfer->target.GetData(), "wb");
+        }
+    }
+
+    if(!transfer->file || fwrite(ptr, 1, length, transfer->file) != length)
+    {
+        // Returning less than length aborts the transfer.
+        transfer->writeFailed = true;
+        return 0;
+    }
+
+    transfer->hash.Append((const CS::Utility::Checksum::MD5::md5_byte_t*)ptr, length);
+    transfer->written += length;
+    return length;
+}
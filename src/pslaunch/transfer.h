@@ -0,0 +1,152 @@
+/*
+* transfer.h
+*
+* Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+*
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation (version 2 of the License)
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*
+*/
+
+#ifndef __TRANSFER_H__
+#define __TRANSFER_H__
+
+#include <stdio.h>
+
+#include <csutil/array.h>
+#include <csutil/csstring.h>
+#include <csutil/md5.h>
+#include <csutil/stringarray.h>
+
+typedef void CURL;
+typedef void CURLM;
+
+/*
+* Downloads a number of files concurrently with the curl multi interface.
+*
+* Every file has a list of paths which are tried relative to each base URL
+* (mirror). The transfers are spread over the mirrors, a transfer that fails
+* is retried and then moves on to the next path or mirror. Data that was
+* already received is kept, the transfer resumes with a byte range where the
+* server supports it. A target file that already exists is resumed as well.
+*
+* The md5sum of each file is calculated while the data comes in, so files
+* don't have to be read again to be verified.
+*
+* Targets are real paths, the scheduler doesn't use the VFS.
+*/
+class TransferScheduler
+{
+public:
+    /*
+    * baseURLs are the mirrors the paths of the files are relative to.
+    * connections is the maximum number of files downloaded at the same time,
+    * retries the number of times an interrupted transfer is resumed from the
+    * same URL before trying the next one.
+    */
+    TransferScheduler(const csStringArray& baseURLs, size_t connections, uint retries = 1);
+    virtual ~TransferScheduler();
+
+    /*
+    * Add a file to download to target. The paths are tried in order relative to
+    * each mirror. If md5 is not empty the data has to match it. Returns the
+    * index of the file in the results.
+    */
+    size_t Add(const csStringArray& paths, const char* target, const char* md5 = "");
+
+    /*
+    * Download all added files. Returns false if it was canceled, the files not
+    * completed yet are failed then.
+    */
+    bool Run();
+
+    /* Number of added files. */
+    size_t GetSize() const { return transfers.GetSize(); }
+
+    /* True if the file has been downloaded and matches its md5sum. */
+    bool Succeeded(size_t index) const { return transfers[index]->success; }
+
+    /* The URL the file was downloaded from, or the last one tried. */
+    const csString& GetURL(size_t index) const { return transfers[index]->url; }
+
+    /* The last error of the file, empty on success. */
+    const csString& GetError(size_t index) const { return transfers[index]->error; }
+
+    /* The md5sum of the downloaded data, empty if it failed. */
+    const csString& GetMD5(size_t index) const { return transfers[index]->md5sum; }
+
+protected:
+    /* Called while running, return true to cancel all transfers. */
+    virtual bool CheckCancel() { return false; }
+
+    /* Called when a file is done, successful or not. */
+    virtual void TransferDone(size_t /*index*/) {}
+
+private:
+    struct Transfer
+    {
+        size_t index;
+        csStringArray paths;
+        csString target;
+        csString md5;
+
+        CURL* handle;
+        FILE* file;
+        CS::Utility::Checksum::MD5 hash;
+        uint64 written;         // Bytes in the target file, all of them hashed.
+        size_t firstMirror;     // Mirror the transfer started on.
+        size_t candidate;       // Index of the mirror and path tried, see GetCandidateURL.
+        uint attempts;          // Failed attempts on the current candidate.
+        bool started;           // Set once the target has been opened the first time.
+        bool receiving;         // Set once data has been received in the current attempt.
+        bool writeFailed;
+        bool success;
+        bool done;
+        csString url;
+        csString md5sum;
+        csString error;
+        char* errorBuffer;
+    };
+
+    /* Open the target and start the current candidate of a transfer. */
+    bool Start(Transfer* transfer);
+
+    /* Handle a finished attempt, returns true when the transfer is done. */
+    bool Finish(Transfer* transfer, int result);
+
+    /* Move on to the next path or mirror, returns false if all have been tried. */
+    bool NextCandidate(Transfer* transfer);
+
+    /*
+    * Drop the received data, the transfer starts again from the beginning.
+    * The target is truncated, or removed if it isn't open.
+    */
+    void Restart(Transfer* transfer);
+
+    /* Release the curl handle and the file of a transfer. */
+    void Close(Transfer* transfer);
+
+    /* Wait for activity on the transfers for up to timeout ms. */
+    void Wait(long timeout);
+
+    csString GetCandidateURL(Transfer* transfer) const;
+
+    static size_t WriteData(void* ptr, size_t size, size_t nmemb, void* userData);
+
+    csStringArray baseURLs;
+    size_t connections;
+    uint retries;
+    csArray<Transfer*> transfers;
+    CURLM* multi;
+};
+
+#endif // __TRANSFER_H__
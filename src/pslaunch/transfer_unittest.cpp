@@ -0,0 +1,230 @@
+/*
+ * transfer_unittest.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+
+#include <psconfig.h>
+
+//====================================================================================
+// Crystal Space Includes
+//====================================================================================
+#include <csutil/md5.h>
+
+//====================================================================================
+// Local Includes
+//====================================================================================
+#include "transfer.h"
+
+//====================================================================================
+// Library Includes
+//====================================================================================
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// The mirrors are plain directories served with file:// URLs.
+class TransferTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        char cwd[1024];
+        ASSERT_TRUE(getcwd(cwd, sizeof(cwd)) != NULL);
+        dir = cwd;
+        dir.Append("/");
+        mirror.Format("file://%s", dir.GetData());
+    }
+
+    virtual void TearDown()
+    {
+        for(size_t i = 0; i < created.GetSize(); i++)
+        {
+            remove(created[i]);
+        }
+    }
+
+    void WriteFile(const char* name, const csString& data)
+    {
+        csString path = dir + name;
+        FILE* file = fopen(path.GetData(), "wb");
+        ASSERT_TRUE(file != NULL);
+        fwrite(data.GetData(), 1, data.Length(), file);
+        fclose(file);
+        created.Push(path);
+    }
+
+    csString ReadFile(const char* name)
+    {
+        csString data;
+        FILE* file = fopen((dir + name).GetData(), "rb");
+        if(!file)
+        {
+            return data;
+        }
+
+        char buffer[4096];
+        size_t length;
+        while((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            data.Append(buffer, length);
+        }
+        fclose(file);
+        return data;
+    }
+
+    csString Target(const char* name)
+    {
+        created.Push(dir + name);
+        return dir + name;
+    }
+
+    static csString MD5(const csString& data)
+    {
+        CS::Utility::Checksum::MD5 md5;
+        md5.Init();
+        md5.Append((const CS::Utility::Checksum::MD5::md5_byte_t*)data.GetData(), data.Length());
+        CS::Utility::Checksum::MD5::Digest digest;
+        md5.Finish(digest.data);
+        return digest.HexString();
+    }
+
+    static csString Content(int seed, size_t size)
+    {
+        csString data;
+        for(size_t i = 0; i < size; i++)
+        {
+            data << char('a' + (seed + i*7) % 26);
+        }
+        return data;
+    }
+
+    static csStringArray Paths(const char* first, const char* second = NULL)
+    {
+        csStringArray paths;
+        paths.Push(first);
+        if(second)
+        {
+            paths.Push(second);
+        }
+        return paths;
+    }
+
+    csString dir;
+    csString mirror;
+    csStringArray created;
+};
+
+TEST_F(TransferTest, DownloadsConcurrently)
+{
+    csStringArray mirrors;
+    mirrors.Push(mirror);
+    TransferScheduler scheduler(mirrors, 4);
+
+    csArray<csString> contents;
+    for(int i = 0; i < 20; i++)
+    {
+        csString name;
+        name.Format("transfertest_src%d", i);
+        contents.Push(Content(i, 1000*i + 1));
+        WriteFile(name, contents[i]);
+
+        csString target;
+        target.Format("transfertest_dst%d", i);
+        scheduler.Add(Paths(name), Target(target), MD5(contents[i]));
+    }
+
+    EXPECT_TRUE(scheduler.Run());
+
+    for(int i = 0; i < 20; i++)
+    {
+        csString target;
+        target.Format("transfertest_dst%d", i);
+        EXPECT_TRUE(scheduler.Succeeded(i)) << scheduler.GetError(i).GetData();
+        EXPECT_STREQ(MD5(contents[i]), scheduler.GetMD5(i));
+        EXPECT_TRUE(ReadFile(target) == contents[i]);
+    }
+}
+
+TEST_F(TransferTest, FallsBackToOtherPathsAndMirrors)
+{
+    csString data = Content(3, 5000);
+    WriteFile("transfertest_fallback", data);
+
+    csStringArray mirrors;
+    mirrors.Push(mirror + "transfertest_missing/");
+    mirrors.Push(mirror);
+    TransferScheduler scheduler(mirrors, 2);
+    scheduler.Add(Paths("transfertest_missing", "transfertest_fallback"), Target("transfertest_dst"), MD5(data));
+
+    EXPECT_TRUE(scheduler.Run());
+    EXPECT_TRUE(scheduler.Succeeded(0)) << scheduler.GetError(0).GetData();
+    EXPECT_STREQ(mirror + "transfertest_fallback", scheduler.GetURL(0));
+    EXPECT_TRUE(ReadFile("transfertest_dst") == data);
+}
+
+TEST_F(TransferTest, ResumesPartialTarget)
+{
+    csString data = Content(5, 100000);
+    WriteFile("transfertest_resume", data);
+    WriteFile("transfertest_dst", data.Slice(0, 40000));
+
+    csStringArray mirrors;
+    mirrors.Push(mirror);
+    TransferScheduler scheduler(mirrors, 1);
+    scheduler.Add(Paths("transfertest_resume"), Target("transfertest_dst"), MD5(data));
+
+    EXPECT_TRUE(scheduler.Run());
+    EXPECT_TRUE(scheduler.Succeeded(0)) << scheduler.GetError(0).GetData();
+    EXPECT_TRUE(ReadFile("transfertest_dst") == data);
+}
+
+TEST_F(TransferTest, RestartsWhenPartialTargetIsCorrupt)
+{
+    csString data = Content(7, 20000);
+    WriteFile("transfertest_corrupt", data);
+    WriteFile("transfertest_dst", Content(8, 10000));
+
+    // The resumed data fails the md5sum, the second mirror gets all of it.
+    csStringArray mirrors;
+    mirrors.Push(mirror);
+    mirrors.Push(mirror);
+    TransferScheduler scheduler(mirrors, 1);
+    scheduler.Add(Paths("transfertest_corrupt"), Target("transfertest_dst"), MD5(data));
+
+    EXPECT_TRUE(scheduler.Run());
+    EXPECT_TRUE(scheduler.Succeeded(0)) << scheduler.GetError(0).GetData();
+    EXPECT_TRUE(ReadFile("transfertest_dst") == data);
+}
+
+TEST_F(TransferTest, FailsOnWrongMD5)
+{
+    WriteFile("transfertest_wrong", Content(9, 3000));
+
+    csStringArray mirrors;
+    mirrors.Push(mirror);
+    TransferScheduler scheduler(mirrors, 1);
+    scheduler.Add(Paths("transfertest_wrong"), Target("transfertest_dst"), "00000000000000000000000000000000");
+    scheduler.Add(Paths("transfertest_nothere"), Target("transfertest_dst2"));
+
+    EXPECT_TRUE(scheduler.Run());
+    EXPECT_FALSE(scheduler.Succeeded(0));
+    EXPECT_FALSE(scheduler.GetError(0).IsEmpty());
+    // The bad data must not be resumed by a later run.
+    EXPECT_TRUE(ReadFile("transfertest_dst").IsEmpty());
+    EXPECT_FALSE(scheduler.Succeeded(1));
+    EXPECT_FALSE(scheduler.GetError(1).IsEmpty());
+}
@@ -80,6 +80,11 @@ UpdaterConfig::UpdaterConfig(csStringArray& args, iObjectRegistry* _object_reg,
     repairInZip = configFile->GetBool("Update.RepairInZip");
     keepRepaired = configFile->GetBool("Update.KeepRepairedFiles");
     repairFailed = configFile->GetBool("Update.RepairFailed", true);
+    cacheChecksums = configFile->GetBool("Update.CacheChecksums", true);
+    int threads = configFile->GetInt("Update.CheckThreads", 4);
+    checkThreads = threads > 1 ? threads : 1;
+    int connections = configFile->GetInt("Update.DownloadConnections", 8);
+    downloadConnections = connections > 1 ? connections : 1;
     proxy.host = configFile->GetStr("Updater.Proxy.Host", "");
     proxy.port = configFile->GetInt("Updater.Proxy.Port", 0);
 
@@ -35,6 +35,7 @@
 #define SERVERS_FILENAME "/planeshift/userdata/updateservers.xml"
 #define SERVERS_CURRENT_FILENAME "/this/updateservers.xml"
 #define UPDATE_CACHE_DIR "/planeshift/userdata/updatecache"
+#define UPDATE_PARTIAL_DIR "/planeshift/userdata/updatepartial"
 #define FALLBACK_SERVER "http://www.planeshift.it/"
 
 
@@ -279,6 +280,21 @@ public:
      */
     bool RepairFailed() const { return repairFailed; }
 
+    /**
+     * Returns true if we want to cache the md5sums of unchanged files.
+     */
+    bool CachingChecksums() const { return cacheChecksums; }
+
+    /**
+     * Returns the number of threads used to check the md5sums of the files.
+     */
+    size_t GetCheckThreads() const { return checkThreads; }
+
+    /**
+     * Returns the number of files downloaded at the same time by a repair.
+     */
+    size_t GetDownloadConnections() const { return downloadConnections; }
+
     /**
      * True if we want to use the updater. This could be turned of when third-party
      * updater is used.
@@ -323,6 +339,15 @@ private:
     /* True if we want to perform a repair when files fail after an update. */
     bool repairFailed;
 
+    /* True if we want to cache the md5sums of unchanged files. */
+    bool cacheChecksums;
+
+    /* Number of threads used to check the md5sums of the files. */
+    size_t checkThreads;
+
+    /* Number of files downloaded at the same time by a repair. */
+    size_t downloadConnections;
+
     /* True if we want to use the updater. This could be turned of when third-party
      * updater is used
      */
@@ -26,6 +26,7 @@
 #include "updaterconfig.h"
 #include "updaterengine.h"
 #include "binarypatch.h"
+#include "integritycheck.h"
 
 #ifndef CS_COMPILER_MSVC
 #include <unistd.h>
@@ -1267,18 +1268,25 @@ void UpdaterEngine::CheckIntegrity(bool automatic)
     downloader->SetProxy(config->GetProxy().host.GetData(), config->GetProxy().port);
 
     // Get the zip with md5sums.
-    csString baseurl;
+    csStringArray baseurls;
     csArray<Mirror> mirrors = config->GetCurrentConfig()->GetRepairMirrors();
     if(mirrors.GetSize() > 0)
     {
+        // Start with a random mirror, the others share the repair downloads.
         csRandomGen random = csRandomGen();
-        baseurl = mirrors[random.Get((uint32)mirrors.GetSize())].GetBaseURL();
+        size_t first = random.Get((uint32)mirrors.GetSize());
+        for(size_t i = 0; i < mirrors.GetSize(); i++)
+        {
+            csString url = mirrors[(first + i) % mirrors.GetSize()].GetBaseURL();
+            baseurls.Push(url + "backup/");
+        }
     }
     else //fallback to old style
     {
-        baseurl = config->GetCurrentConfig()->GetMirror(0)->GetBaseURL();
+        csString url = config->GetCurrentConfig()->GetMirror(0)->GetBaseURL();
+        baseurls.Push(url + "backup/");
     }
-    baseurl.Append("backup/");
+    csString baseurl = baseurls[0];
     if(!downloader->DownloadFile(baseurl + "integrity.zip", INTEGRITY_ZIPNAME, true, true, 1, true))
     {
         PrintOutput("\nFailed to download integrity.zip!\n");
@@ -1308,7 +1316,7 @@ void UpdaterEngine::CheckIntegrity(bool automatic)
 
         if(!failed)
         {
-            CheckAndUpdate(md5sums, baseurl, automatic);
+            CheckAndUpdate(md5sums, baseurls, automatic);
         }
     }
 
@@ -1320,79 +1328,99 @@ void UpdaterEngine::CheckIntegrity(bool automatic)
     return;
 }
 
-bool UpdaterEngine::UpdateFile(csString baseurl, csString mountPath, csString filePath, bool failedEx, bool inZipFile)
+bool UpdaterEngine::UpdateFiles(const csStringArray& baseurls, csString mountPath, csString urlPrefix,
+                                const csRefArray<iDocumentNode>& nodes, bool inZipFile)
 {
-    PrintOutput("\nDownloading file: %s\n", filePath.GetData());
-
-    csString downloadpath(mountPath);
-    downloadpath.Append(filePath);
+    PrintOutput("\nDownloading %zu files:\n", nodes.GetSize());
 
-    csRef<iDataBuffer> rp;
-    csRef<FileStat> fs;
+    csArray<Downloader::FileRequest> requests;
+    csRefArray<FileStat> stats;
+    csStringArray realPaths;
 
-    if(!inZipFile)
+    for(size_t i = 0; i < nodes.GetSize(); i++)
     {
-        // Save permissions.
-        #ifdef CS_PLATFORM_UNIX
-            rp = vfs->GetRealPath(downloadpath);
-            fs = fileUtil->StatFile(rp->GetData());
-        #endif
+        csString filePath = nodes[i]->GetAttributeValue("path");
+        csString downloadpath(mountPath);
+        downloadpath.Append(filePath);
+
+        csRef<FileStat> fs;
+        csString realPath;
+        if(!inZipFile)
+        {
+            // Save permissions.
+            #ifdef CS_PLATFORM_UNIX
+                csRef<iDataBuffer> rp = vfs->GetRealPath(downloadpath);
+                realPath = rp->GetData();
+                fs = fileUtil->StatFile(realPath);
+            #endif
+
+            fileUtil->CopyFile(downloadpath, downloadpath + ".bak", true, false, true);
+        }
+        stats.Push(fs);
+        realPaths.Push(realPath);
 
-        fileUtil->CopyFile(downloadpath, downloadpath + ".bak", true, false, true);
+        // Make parent dir if needed.
+        csString parent = mountPath;
+        fileUtil->MakeDirectory(parent.Truncate(parent.FindLast('/')));
+
+        // Maybe it's in a platform specific subdirectory, that's tried next.
+        Downloader::FileRequest request;
+        request.paths.Push(urlPrefix + filePath);
+        request.paths.Push(urlPrefix + config->GetCurrentConfig()->GetPlatform() + "/" + filePath);
+        request.dest = downloadpath;
+        request.md5 = nodes[i]->GetAttributeValue("md5sum");
+        requests.Push(request);
     }
 
-    // Make parent dir if needed.
-    csString parent = mountPath;
-    fileUtil->MakeDirectory(parent.Truncate(parent.FindLast('/')));
+    size_t downloaded = downloader->DownloadFiles(requests, baseurls, config->GetDownloadConnections());
 
-    // Download file.
-    if(!downloader->DownloadFile(baseurl + filePath, downloadpath, true, true, 1, true))
+    for(size_t i = 0; i < requests.GetSize(); i++)
     {
-        // Maybe it's in a platform specific subdirectory. Try that next.
-        csString url = baseurl + config->GetCurrentConfig()->GetPlatform() + "/";
-        if(!downloader->DownloadFile(url + filePath, downloadpath, true, true, 1, true))
+        const csString& downloadpath = requests[i].dest;
+
+        if(!inZipFile)
         {
-            if(!inZipFile)
+            if(!requests[i].success)
             {
                 // Restore file.
                 if(vfs->Exists(downloadpath))
                     fileUtil->RemoveFile(downloadpath, true);
                 fileUtil->MoveFile(downloadpath + ".bak", downloadpath, true, false, true);
             }
-            PrintOutput(" Failed!\n");
-            return false;
-        }
-    }
-
-    if(!inZipFile)
-    {
-        #ifdef CS_PLATFORM_UNIX
-            // Restore permissions.
-            if(fs.IsValid())
+            else
             {
-                if(failedEx)
+                #ifdef CS_PLATFORM_UNIX
+                    // Restore permissions.
+                    FileStat* fs = stats[i];
+                    if(fs)
+                    {
+                        if(nodes[i]->GetAttributeValueAsBool("exec"))
+                        {
+                            fs->mode = fs->mode | S_IXUSR | S_IXGRP;
+                        }
+                        fileUtil->SetPermissions(realPaths[i], fs);
+                    }
+                #endif
+
+                if(!config->KeepingRepaired())
                 {
-                    fs->mode = fs->mode | S_IXUSR | S_IXGRP;
+                    if(vfs->Exists(downloadpath + ".bak"))
+                        fileUtil->RemoveFile(downloadpath + ".bak", true);
                 }
-                fileUtil->SetPermissions(rp->GetData(), fs);
             }
-        #endif
-
-        if(!config->KeepingRepaired())
-        {
-            if(vfs->Exists(downloadpath + ".bak"))
-                fileUtil->RemoveFile(downloadpath + ".bak", true);
         }
+
+        PrintOutput("%s %s\n", nodes[i]->GetAttributeValue("path"), requests[i].success ? "Success!" : "Failed!");
     }
-    PrintOutput(" Success!\n");
-    return true;
+
+    return downloaded == requests.GetSize();
 }
 
-void UpdaterEngine::CheckAndUpdate(iDocumentNode* md5sums, csString baseurl, bool accepted)
+void UpdaterEngine::CheckAndUpdate(iDocumentNode* md5sums, const csStringArray& baseurls, bool accepted)
 {
 
     PrintOutput("Checking file integrity:\n");
-    PrintOutput("Using mirror %s\n\n", baseurl.GetData());
+    PrintOutput("Using mirror %s\n\n", baseurls[0]);
 
     csRefArray<iDocumentNode> failed;
 
@@ -1455,6 +1483,9 @@ void UpdaterEngine::CheckAndUpdate(iDocumentNode* md5sums, csString baseurl, boo
         }
         else if(accepted || c == 'y')
         {
+            // Files outside of zips are downloaded all together.
+            csRefArray<iDocumentNode> failedFiles;
+
             for(size_t i=0; i<failedSize; i++)
             {
                 if(CheckQuit())
@@ -1482,21 +1513,13 @@ void UpdaterEngine::CheckAndUpdate(iDocumentNode* md5sums, csString baseurl, boo
                             csRefArray<iDocumentNode> failedInZip;
                             CheckMD5s(zipmd5sums, "/updatezip/", true, &failedInZip);
 
-                            csString zipDownloadUrl = baseurl;
                             csString zipFilePath = failed.Get(i)->GetAttributeValue("path");
                             zipFilePath.Truncate(zipFilePath.Length()-4);
-                            zipDownloadUrl.Append(zipFilePath);
-                            zipDownloadUrl.Append("/");
+                            zipFilePath.Append("/");
 
-                            for(size_t j=0; j<failedInZip.GetSize(); j++)
+                            if(!failedInZip.IsEmpty())
                             {
-                                UpdateFile(
-                                        zipDownloadUrl,
-                                        "/updatezip/",
-                                        failedInZip.Get(j)->GetAttributeValue("path"),
-                                        failedInZip.Get(j)->GetAttributeValueAsBool("exec"),
-                                        true
-                                );
+                                UpdateFiles(baseurls, "/updatezip/", zipFilePath, failedInZip, true);
                             }
 
                             vfs->Unmount("/updatezip/", realPath);
@@ -1507,13 +1530,18 @@ void UpdaterEngine::CheckAndUpdate(iDocumentNode* md5sums, csString baseurl, boo
                     continue;
                 }
 
-                UpdateFile(
-                        baseurl,
-                        "/this/",
-                        failed.Get(i)->GetAttributeValue("path"),
-                        failed.Get(i)->GetAttributeValueAsBool("exec")
-                );
+                failedFiles.Push(failed.Get(i));
+            }
 
+            if(!failedFiles.IsEmpty())
+            {
+                UpdateFiles(baseurls, "/this/", "", failedFiles);
+            }
+
+            if(CheckQuit())
+            {
+                infoShare->SetCancelUpdater(false);
+                return;
             }
 
             if(vfs->Exists("/this/updaterinfo.xml.bak"))
@@ -1539,14 +1567,15 @@ void UpdaterEngine::CheckAndUpdate(iDocumentNode* md5sums, csString baseurl, boo
 
 void UpdaterEngine::CheckMD5s(iDocumentNode* md5sums, csString mountPath, bool accepted, csRefArray<iDocumentNode> *failed)
 {
+    // Only the installation is cached, files in a mounted zip are checked
+    // with a single thread as the archive is shared.
+    bool installation = mountPath == "/this/";
+    IntegrityChecker checker(vfs, infoShare, installation && config->CachingChecksums() ? INTEGRITY_CACHE_FILENAME : NULL);
+
+    csRefArray<iDocumentNode> nodes;
     csRef<iDocumentNodeIterator> md5nodes = md5sums->GetNodes("md5sum");
     while(md5nodes->HasNext())
     {
-        if(CheckQuit())
-        {
-            infoShare->SetCancelUpdater(false);
-            return;
-        }
         csRef<iDocumentNode> node = md5nodes->Next();
 
         csString platform = node->GetAttributeValue("platform");
@@ -1558,13 +1587,27 @@ void UpdaterEngine::CheckMD5s(iDocumentNode* md5sums, csString mountPath, bool a
                 || platform.Compare("cfg") || platform.Compare("all")))
             continue;
 
+        checker.AddFile(mountPath + node->GetAttributeValue("path"));
+        nodes.Push(node);
+    }
+
+    if(!checker.Run(installation ? config->GetCheckThreads() : 1))
+    {
+        infoShare->SetCancelUpdater(false);
+        return;
+    }
+
+    for(size_t i = 0; i < nodes.GetSize(); i++)
+    {
+        iDocumentNode* node = nodes[i];
         csString path = node->GetAttributeValue("path");
         csString md5sum = node->GetAttributeValue("md5sum");
 
-        csString md5s = GetMD5OfFile(mountPath + path);
+        const csString& md5s = checker.GetMD5(i);
         if(md5s.IsEmpty())
         {
             // File is genuinely missing.
+            PrintOutput("Could not get MD5 of %s!!\n", (mountPath + path).GetData());
             failed->Push(node);
             continue;
         }
@@ -1625,12 +1668,11 @@ bool UpdaterEngine::SwitchMirror()
 csString UpdaterEngine::GetMD5OfFile(csString filePath)
 {
     // Check md5sum is correct.
-    csRef<iDataBuffer> buffer = vfs->ReadFile(filePath, true);
-    if (!buffer)
+    csString md5 = IntegrityChecker::HashFile(vfs, filePath);
+    if (md5.IsEmpty())
     {
         PrintOutput("Could not get MD5 of %s!!\n", filePath.GetData());
-        return "";
     }
 
-    return CS::Utility::Checksum::MD5::Encode(buffer->GetData(), buffer->GetSize()).HexString();
+    return md5;
 }
@@ -53,6 +53,25 @@ struct iVFS;
 
 class InfoShare
 {
+public:
+    /* Progress of the file integrity check. */
+    struct IntegrityProgress
+    {
+        /* True while files are being checked. */
+        bool running;
+        size_t filesDone;
+        size_t filesTotal;
+        /* Bytes of the files that had to be read. */
+        uint64 bytesRead;
+        /* Bytes of the files found unchanged in the cache. */
+        uint64 bytesSkipped;
+        /* Time since the check started, in ms. */
+        csTicks elapsed;
+
+        IntegrityProgress() : running(false), filesDone(0), filesTotal(0),
+            bytesRead(0), bytesSkipped(0), elapsed(0) {}
+    };
+
 private:
     /* Set to true if we want the GUI to exit. */
     volatile bool exitGUI;
@@ -88,6 +107,8 @@ private:
 
     /* Array to store console output. */
     csList<csString> consoleOut;
+
+    IntegrityProgress integrityProgress;
 public:
 
     InfoShare()
@@ -162,6 +183,18 @@ public:
     {
         return consoleOut.IsEmpty();
     }
+
+    inline void SetIntegrityProgress(const IntegrityProgress& progress)
+    {
+        CS::Threading::MutexScopedLock lock(mutex);
+        integrityProgress = progress;
+    }
+
+    inline IntegrityProgress GetIntegrityProgress()
+    {
+        CS::Threading::MutexScopedLock lock(mutex);
+        return integrityProgress;
+    }
 };
 
 class UpdaterEngine : public CS::Threading::Runnable, public Singleton<UpdaterEngine>
@@ -198,9 +231,16 @@ private:
     void Init(csStringArray& args, iObjectRegistry* _object_reg, const char* _appName,
               InfoShare *infoshare);
 
-    void CheckAndUpdate(iDocumentNode* md5sums, csString baseurl, bool accepted = false);
+    void CheckAndUpdate(iDocumentNode* md5sums, const csStringArray& baseurls, bool accepted = false);
     void CheckMD5s(iDocumentNode* md5sums, csString baseurl, bool accepted, csRefArray<iDocumentNode> *failed);
-    bool UpdateFile(csString baseurl, csString mountPath, csString filePath, bool failedEx = false, bool inZipFile = false);
+
+    /*
+     * Download the files of the given md5sum nodes from the repair mirrors
+     * concurrently. urlPrefix is prepended to their paths on the mirrors.
+     * Returns true if all files were downloaded.
+     */
+    bool UpdateFiles(const csStringArray& baseurls, csString mountPath, csString urlPrefix,
+                     const csRefArray<iDocumentNode>& nodes, bool inZipFile = false);
 
     csString GetMD5OfFile(csString filePath);
 
@@ -6759,6 +6759,7 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
         {
             if(wp->Adjust(db,myPos,mySectorName))
             {
+                pathNetwork->WaypointChanged(wp);
                 psserver->npcmanager->WaypointAdjusted(wp);
 
                 UpdateDisplayWaypoint(wp);
@@ -6772,6 +6773,7 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
         {
             if(pathPoint->Adjust(db,indexPoint,myPos,mySectorName))
             {
+                pathNetwork->PathChanged(pathPoint);
                 psserver->npcmanager->PathPointAdjusted(point);
 
                 UpdateDisplayPath(point);
@@ -6991,6 +6993,8 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
         psPathPoint* point = path->AddPoint(db, myPos, mySectorName);
         if(point)
         {
+            pathNetwork->PathChanged(path);
+
             // If path hasn't been created yet, don't push to superclients
             if(path->GetID() > 0)
             {
@@ -7022,6 +7026,7 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
 
         if(path->RemovePoint(db, point))
         {
+            pathNetwork->PathChanged(path);
             psserver->npcmanager->RemovePoint(path, pointId);
 
             if(client->PathIsDisplaying())
@@ -7056,7 +7061,7 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
             psserver->SendSystemError(me->clientnum, "Failed to insert point.");
             return;
         }
-
+        pathNetwork->PathChanged(path);
 
         UpdateDisplayPath(newPoint);
         psserver->SendSystemInfo(me->clientnum, "Inserted point.");
@@ -7328,6 +7333,7 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
             {
                 if(wp->Adjust(db,myPos,mySectorName))
                 {
+                    pathNetwork->WaypointChanged(wp);
                     psserver->npcmanager->WaypointAdjusted(wp);
 
                     UpdateDisplayWaypoint(wp);
@@ -7369,6 +7375,7 @@ void AdminManager::HandlePath(MsgEntry* me, psAdminCmdMessage &msg, AdminCmdData
             {
                 if(point->Adjust(db,myPos,mySectorName))
                 {
+                    pathNetwork->PathChanged(point->GetPath());
                     psserver->npcmanager->PathPointAdjusted(point);
 
                     UpdateDisplayPath(point);
@@ -24,6 +24,7 @@
 //=============================================================================
 #include <iutil/document.h>
 #include <csutil/xmltiny.h>
+#include <csutil/sysfunc.h>
 
 //=============================================================================
 // Project Includes
@@ -133,6 +134,7 @@ bool NPCDialogDict::Initialize(iDataConnection* db)
                 {
                     if(LoadResponses(db))
                     {
+                        CompileHypernyms();
                         return true;
                     }
                     else
@@ -1016,8 +1018,8 @@ void NpcTerm::Print()
         CPrintf(CON_CMDOUTPUT ," %-30s :","");
     }
 
-    if(hypernymSynNet == NULL)
-        BuildHypernymList();
+    if(!hypernymsBuilt)
+        CompileHypernyms(dict);
 
     if(hypernyms.GetSize())
     {
@@ -1121,8 +1123,8 @@ bool NpcTerm::IsNoun()
 
 const char* NpcTerm::GetInterleavedHypernym(size_t which)
 {
-    if(hypernymSynNet == NULL)
-        BuildHypernymList();
+    if(!hypernymsBuilt)
+        CompileHypernyms(dict);
 
     if(which < hypernyms.GetSize())
         return hypernyms.Get(which);
@@ -1130,12 +1132,43 @@ const char* NpcTerm::GetInterleavedHypernym(size_t which)
         return NULL;
 }
 
+NpcTerm* NpcTerm::GetInterleavedHypernymTerm(size_t which, bool &exists)
+{
+    if(!hypernymsBuilt)
+        CompileHypernyms(dict);
+
+    exists = which < hypernymTerms.GetSize();
+    if(!exists)
+        return NULL;
+
+    // Quest triggers can add the term after the hypernyms were compiled.
+    if(!hypernymTerms[which])
+        hypernymTerms[which] = dict->FindTerm(hypernyms[which]);
+
+    return hypernymTerms[which];
+}
+
+void NpcTerm::CompileHypernyms(NPCDialogDict* dictionary)
+{
+    BuildHypernymList();
+
+    hypernymTerms.Empty();
+    hypernymTerms.SetCapacity(hypernyms.GetSize());
+    for(size_t i = 0; i < hypernyms.GetSize(); i++)
+    {
+        hypernymTerms.Push(i == 0 ? this : dictionary->FindTerm(hypernyms[i]));
+    }
+}
+
 void NpcTerm::BuildHypernymList()
 {
-    hypernymSynNet = findtheinfo_ds(const_cast<char*>(term.GetData()), NOUN, -HYPERPTR, ALLSENSES);
+    hypernymsBuilt = true;
+    hypernyms.Empty();
+
+    SynsetPtr hypernymSynNet = findtheinfo_ds(const_cast<char*>(term.GetData()), NOUN, -HYPERPTR, ALLSENSES);
 
     // Hypernym 0 is the original word
-    hypernyms.Put(0, term.GetData());
+    hypernyms.Push(term.GetData());
 
     bool hit;
 
@@ -1171,15 +1204,7 @@ void NpcTerm::BuildHypernymList()
             {
                 hit = true;
                 // Check if we have this word already before we add it.
-                bool found = false;
-                for(size_t i = 0; i < hypernyms.GetSize() && !found; i++)
-                {
-                    if(strcmp(*sense[j]->words,hypernyms[i])==0)
-                    {
-                        found = true;
-                    }
-                }
-                if(!found)
+                if(hypernyms.Find(*sense[j]->words) == csArrayItemNotFound)
                 {
                     hypernyms.Push(*sense[j]->words);
                 }
@@ -1197,6 +1222,32 @@ void NpcTerm::BuildHypernymList()
         }
     }
     while(hit);
+
+    // The words are copied, so the synsets aren't needed anymore
+    free_syns(hypernymSynNet);
+}
+
+void NPCDialogDict::CompileHypernyms()
+{
+    csTicks start = csGetTicks();
+
+    size_t linked = 0;
+    csHash<NpcTerm*,csString>::GlobalIterator termIter(phrases.GetIterator());
+    while(termIter.HasNext())
+    {
+        NpcTerm* term = termIter.Next();
+        term->CompileHypernyms(this);
+
+        bool exists = true;
+        for(size_t i = 1; exists; i++)
+        {
+            if(term->GetInterleavedHypernymTerm(i, exists))
+                linked++;
+        }
+    }
+
+    Debug4(LOG_STARTUP, 0, "Compiled hypernyms of %zu terms, %zu link to known terms, in %u ms",
+           phrases.GetSize(), linked, csGetTicks() - start);
 }
 
 bool NpcTrigger::Load(iResultRow &row)
@@ -28,6 +28,7 @@
 #include <csutil/parray.h>
 #include <csutil/hash.h>
 #include <csutil/redblacktree.h>
+#include <csutil/stringarray.h>
 
 //=============================================================================
 // Project Includes
@@ -116,6 +117,12 @@ public:
 
     bool Initialize(iDataConnection* db);
 
+    /**
+     * Compile the hypernyms of all known terms, so WordNet is only used
+     * when the dictionary is loaded.
+     */
+    void CompileHypernyms();
+
     bool FindKnowledgeArea(const csString &name);
 
     /** Returns record of 'term' (or NULL if unknown) */
@@ -201,9 +208,13 @@ public:
  */
 class NpcTerm
 {
-    SynsetPtr hypernymSynNet;
+    bool hypernymsBuilt;
+
+    /// Hypernyms of all senses of the term, interleaved breadth first.
+    csStringArray hypernyms;
 
-    csArray<const char*> hypernyms;
+    /// The known terms of the hypernyms, NULL for hypernyms that were no known term yet.
+    csArray<NpcTerm*> hypernymTerms;
 
     void BuildHypernymList();
 
@@ -231,18 +242,29 @@ public:
     NpcTerm(const char* term)
     {
         synonym     = NULL;
-        hypernymSynNet = NULL;
+        hypernymsBuilt = false;
         this->term = term;
         this->term.Downcase();
     }
-    ~NpcTerm()
-    {
-        if(hypernymSynNet)
-            free_syns(hypernymSynNet);
-    }
+
+    /**
+     * Look up the hypernyms of the term in WordNet and link them to the
+     * terms of the dictionary, so generalizing the term later doesn't
+     * need WordNet anymore.
+     */
+    void CompileHypernyms(NPCDialogDict* dict);
 
     const char* GetInterleavedHypernym(size_t which);
 
+    /**
+     * Get the known term of a hypernym.
+     *
+     * @param which  The hypernym as counted by GetInterleavedHypernym(), 0 is the term itself.
+     * @param exists Set to true if the term has that many hypernyms.
+     * @return The term of the hypernym, NULL if the hypernym isn't a known term.
+     */
+    NpcTerm* GetInterleavedHypernymTerm(size_t which, bool &exists);
+
     bool IsNoun();
 
     /**
@@ -1217,6 +1217,14 @@ public:
      */
     void ClearStatsDirtyFlags(unsigned int dirtyFlags);
 
+    /**
+     * Get the vitals of the character.
+     */
+    psServerVitals* GetVitals()
+    {
+        return vitals;
+    }
+
     const char* GetHelmGroup()
     {
         return helmGroup.GetData();
@@ -524,15 +524,21 @@ NpcResponse* psNPCDialog::FindOrGeneralizeTrigger(Client* client,NpcTriggerSente
         csArray<int> &gen_terms, int word)
 {
     NpcResponse* resp;
-    csStringArray generalized;
+    csArray<NpcTerm*> generalized;
 
     bool hit;
 
     // Perform breadth-first search on generalisations
 
-    // Copy all terms into stringarray
+    // Copy all terms into the generalized trigger. Hypernyms are
+    // precompiled to the known terms they stand for, NULL if a hypernym
+    // is no known term.
     for(size_t i=0; i<trigger.TermLength(); i++)
-        generalized.Push(trigger.Term(i)->term);
+        generalized.Push(trigger.Term(i));
+
+    // Triggers are made of known terms only, so there is nothing to
+    // look up while any word is generalized to an unknown hypernym
+    size_t unknownTerms = 0;
 
     // We do at least one search with no generalisations
     size_t depth = 0;
@@ -543,19 +549,27 @@ NpcResponse* psNPCDialog::FindOrGeneralizeTrigger(Client* client,NpcTriggerSente
 
         for(size_t i=0; i<gen_terms.GetSize(); i++)
         {
-            const char* hypernym = trigger.Term(gen_terms[i])->GetInterleavedHypernym(depth);
-            if(hypernym)
+            bool exists;
+            NpcTerm* hypernym = trigger.Term(gen_terms[i])->GetInterleavedHypernymTerm(depth, exists);
+            if(exists)
             {
+                if(!generalized[gen_terms[i]])
+                    unknownTerms--;
+                if(!hypernym)
+                    unknownTerms++;
                 generalized.Put(gen_terms[i],hypernym);
                 hit = true;
             }
 
+            if(unknownTerms)
+                continue;
+
             csString generalized_copy;
 
             // Merge string
             for(size_t i=0; i<generalized.GetSize(); i++)
             {
-                generalized_copy.Append(generalized[i]);
+                generalized_copy.Append(generalized[i]->term);
             }
 
             Debug2(LOG_NPC, 0, "Searching for generalized trigger: %s'\n", generalized_copy.GetDataSafe());
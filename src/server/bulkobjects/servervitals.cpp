@@ -36,21 +36,27 @@
 #include "servervitals.h"
 #include "pscharacter.h"
 
+void VitalBuffable::OnChange()
+{
+    vitals->SetDirty(dirtyFlag);
+}
+
 psServerVitals::psServerVitals(psCharacter* character)
 {
     this->character = character;
     statsDirty = 0;
     version    = 0;
+    constructed = false;
 
     // Set up callbacks for updating the dirty flag.
-    vitals[VITAL_HITPOINTS].drRate.Initialize(&statsDirty,  DIRTY_VITAL_HP_RATE);
-    vitals[VITAL_HITPOINTS].max.Initialize(&statsDirty,     DIRTY_VITAL_HP_MAX);
-    vitals[VITAL_MANA].drRate.Initialize(&statsDirty,       DIRTY_VITAL_MANA_RATE);
-    vitals[VITAL_MANA].max.Initialize(&statsDirty,          DIRTY_VITAL_MANA_MAX);
-    vitals[VITAL_PYSSTAMINA].drRate.Initialize(&statsDirty, DIRTY_VITAL_PYSSTAMINA_RATE);
-    vitals[VITAL_PYSSTAMINA].max.Initialize(&statsDirty,    DIRTY_VITAL_PYSSTAMINA_MAX);
-    vitals[VITAL_MENSTAMINA].drRate.Initialize(&statsDirty, DIRTY_VITAL_MENSTAMINA_RATE);
-    vitals[VITAL_MENSTAMINA].max.Initialize(&statsDirty,    DIRTY_VITAL_MENSTAMINA_MAX);
+    vitals[VITAL_HITPOINTS].drRate.Initialize(this,  DIRTY_VITAL_HP_RATE);
+    vitals[VITAL_HITPOINTS].max.Initialize(this,     DIRTY_VITAL_HP_MAX);
+    vitals[VITAL_MANA].drRate.Initialize(this,       DIRTY_VITAL_MANA_RATE);
+    vitals[VITAL_MANA].max.Initialize(this,          DIRTY_VITAL_MANA_MAX);
+    vitals[VITAL_PYSSTAMINA].drRate.Initialize(this, DIRTY_VITAL_PYSSTAMINA_RATE);
+    vitals[VITAL_PYSSTAMINA].max.Initialize(this,    DIRTY_VITAL_PYSSTAMINA_MAX);
+    vitals[VITAL_MENSTAMINA].drRate.Initialize(this, DIRTY_VITAL_MENSTAMINA_RATE);
+    vitals[VITAL_MENSTAMINA].max.Initialize(this,    DIRTY_VITAL_MENSTAMINA_MAX);
 
     //initialize values to a safe value:
     vitals[VITAL_HITPOINTS].value = 0;
@@ -62,6 +68,9 @@ psServerVitals::psServerVitals(psCharacter* character)
     vitals[VITAL_MANA].drRate.SetBase(MANA_REGEN_RATE);
 
     SetOrigVitals();
+
+    // The character isn't done yet, so don't look for its actor before
+    constructed = true;
 }
 
 #define PERCENT_VALUE(v) vitals[v].max.Current() ? vitals[v].value / vitals[v].max.Current() : 0
@@ -166,31 +175,74 @@ bool psServerVitals::Update(csTicks now)
 void psServerVitals::SetExp(unsigned int W)
 {
     experiencePoints = W;
-    statsDirty |= DIRTY_VITAL_EXPERIENCE;
+    SetDirty(DIRTY_VITAL_EXPERIENCE);
 }
 
 void psServerVitals::SetPP(unsigned int pp)
 {
     progressionPoints = pp;
-    statsDirty |= DIRTY_VITAL_PROGRESSION;
-}
-
-Vital &psServerVitals::DirtyVital(int vital, int dirtyFlag)
-{
-    statsDirty |= dirtyFlag;
-    return GetVital(vital);
+    SetDirty(DIRTY_VITAL_PROGRESSION);
 }
 
 void psServerVitals::SetVital(int vital, int dirtyFlag, float value)
 {
-    DirtyVital(vital, dirtyFlag).value = value;
+    float old = PERCENT_VALUE(vital);
+    GetVital(vital).value = value;
     ClampVital(vital);
+
+    // Only publish changes of the percentage the stat message sends
+    if(PERCENT_VALUE(vital) != old)
+        SetDirty(dirtyFlag);
 }
 
 void psServerVitals::AdjustVital(int vital, int dirtyFlag, float delta)
 {
-    DirtyVital(vital, dirtyFlag).value += delta;
-    ClampVital(vital);
+    SetVital(vital, dirtyFlag, GetVital(vital).value + delta);
+}
+
+void psServerVitals::ResetVitals()
+{
+    psVitalManager<Vital>::ResetVitals();
+    Wake();
+}
+
+void psServerVitals::SetDirty(unsigned int dirtyFlags)
+{
+    statsDirty |= dirtyFlags;
+    Wake();
+}
+
+void psServerVitals::Wake()
+{
+    if(!constructed)
+        return;
+
+    gemActor* actor = character->GetActor();
+    if(actor)
+        actor->ScheduleRegeneration();
+}
+
+bool psServerVitals::IsIdle()
+{
+    if(statsDirty || !lastDRUpdate)
+        return false;
+
+    for(int i = 0; i < VITAL_COUNT; i++)
+    {
+        float rate = vitals[i].drRate.Current();
+        if(rate > 0 && vitals[i].value < vitals[i].max.Current())
+            return false;
+        if(rate < 0 && vitals[i].value > 0)
+            return false;
+    }
+    return true;
+}
+
+void psServerVitals::RestartUpdates(csTicks now)
+{
+    // 0 means the first update after login is still pending
+    if(lastDRUpdate)
+        lastDRUpdate = now;
 }
 
 unsigned int psServerVitals::GetStatsDirtyFlags() const
@@ -200,7 +252,7 @@ unsigned int psServerVitals::GetStatsDirtyFlags() const
 
 void psServerVitals::SetAllStatsDirty()
 {
-    statsDirty = DIRTY_VITAL_ALL;
+    SetDirty(DIRTY_VITAL_ALL);
 }
 
 
@@ -38,6 +38,7 @@
 
 class MsgEntry;
 class psCharacter;
+class psServerVitals;
 
 /// Buffables for vitals, which automatically update the dirty flag as necessary.
 class VitalBuffable : public Buffable<float>
@@ -45,20 +46,17 @@ class VitalBuffable : public Buffable<float>
 public:
     virtual ~VitalBuffable() { }
 
-    void Initialize(unsigned int* sDirty, int dirtyF)
+    void Initialize(psServerVitals* owner, int dirtyF)
     {
-        statsDirty = sDirty;
+        vitals = owner;
         dirtyFlag = dirtyF;
     }
 
 protected:
-    virtual void OnChange()
-    {
-        *statsDirty |= dirtyFlag;
-    }
+    virtual void OnChange();
 
     int dirtyFlag; ///< The bit value we should set when this becomes dirty.
-    unsigned int* statsDirty; ///< Pointer to the psServerVitals dirty bitfield.
+    psServerVitals* vitals; ///< The vitals whose dirty bitfield is updated.
 };
 
 /// A character vital (such as HP or Mana) - server side.
@@ -95,6 +93,26 @@ public:
     void SetVital(int vitalName, int dirtyFlag, float value);
     void AdjustVital(int vitalName, int dirtyFlag, float delta);
 
+    /** Reset to the "original" vitals and schedule them to be updated.
+     */
+    void ResetVitals();
+
+    /** Set dirty flags and schedule the vitals to be updated.
+     */
+    void SetDirty(unsigned int dirtyFlags);
+
+    /** Check if Update() would leave the vitals as they are.
+     *
+     *  True if nothing is dirty and every vital is either not regenerating
+     *  or already at the limit it regenerates towards.
+     */
+    bool IsIdle();
+
+    /** Continue updating after being idle, without applying the
+     *  regeneration of the idle time.
+     */
+    void RestartUpdates(csTicks now);
+
     /** Return the dirty flags for vitals.
      */
     unsigned int GetStatsDirtyFlags() const;
@@ -111,19 +129,14 @@ private:
     /// Clamps the vital's current value to be in the interval [0, max].
     void ClampVital(int vital);
 
-    /** @brief Adjust a field in a vital statistic.
-     *
-     *  @param vitalName One of the enums @see PS_VITALS
-     *  @param dirtyFlag What became dirty in this adjustment. @see  PS_DIRTY_VITAL.
-     *
-     *  @return The new value of the field in the vital stat.
-     */
-    Vital &DirtyVital(int vitalName, int dirtyFlag);
+    /// Schedule the actor of the character to have its vitals updated.
+    void Wake();
 
     ///  @see  PS_DIRTY_VITALS
     unsigned int statsDirty;
     unsigned char version;
     psCharacter* character;  ///< the character whose vitals we manage
+    bool constructed;        ///< False while the constructor sets up the vitals.
 };
 
 #endif
@@ -23,6 +23,7 @@
 //=============================================================================
 #include <zlib.h>
 #include <csutil/stringarray.h>
+#include <csutil/sysfunc.h>
 
 //=============================================================================
 // Project Space Includes
@@ -267,6 +268,14 @@ void CacheManager::UnloadAll()
             delete newArray;
         }
         tradeCombinations_IDHash.Empty();
+
+        // The index only points to the combinations deleted above
+        csHash<csArray<CombinationConstruction*>*,csString>::GlobalIterator it2(tradeCombinations_IngredientHash.GetIterator());
+        while(it2.HasNext())
+        {
+            delete it2.Next();
+        }
+        tradeCombinations_IngredientHash.Empty();
     }
 
     {
@@ -1330,6 +1339,147 @@ csPDelArray<CombinationConstruction>* CacheManager::FindCombinationsList(uint32
     return tradeCombinations_IDHash.Get(patternid,NULL);
 }
 
+csString CacheManager::GetIngredientKey(uint32 patternid, const csArray<uint32> &ingredients)
+{
+    csString key;
+    key.Format("%u:", patternid);
+    for(size_t i = 0; i < ingredients.GetSize(); i++)
+    {
+        key.AppendFmt("%u,", ingredients[i]);
+    }
+    return key;
+}
+
+// Index the combinations by their pattern and sorted ingredient list, so the
+// contents of a container are resolved with a single lookup instead of
+// matching them against every combination of the pattern.
+void CacheManager::BuildTradeCombinationIndex()
+{
+    size_t count = 0;
+    csHash<csPDelArray<CombinationConstruction>*,uint32>::GlobalIterator it(tradeCombinations_IDHash.GetIterator());
+    while(it.HasNext())
+    {
+        uint32 patternid;
+        csPDelArray<CombinationConstruction>* combArray = it.Next(patternid);
+        for(size_t i = 0; i < combArray->GetSize(); i++)
+        {
+            CombinationConstruction* current = combArray->Get(i);
+
+            csArray<uint32> ingredients;
+            for(size_t j = 0; j < current->combinations.GetSize(); j++)
+            {
+                ingredients.InsertSorted(current->combinations[j]->GetItemId());
+            }
+
+            csString key = GetIngredientKey(patternid, ingredients);
+            csArray<CombinationConstruction*>* candidates = tradeCombinations_IngredientHash.Get(key, NULL);
+            if(!candidates)
+            {
+                candidates = new csArray<CombinationConstruction*>;
+                tradeCombinations_IngredientHash.Put(key, candidates);
+            }
+            candidates->Push(current);
+            count++;
+        }
+    }
+
+    Notify3(LOG_STARTUP, "%zu Trade Combinations indexed by %zu ingredient lists", count, tradeCombinations_IngredientHash.GetSize());
+}
+
+csArray<CombinationConstruction*>* CacheManager::FindCombinationsByIngredients(uint32 patternid, const csArray<uint32> &ingredients)
+{
+    return tradeCombinations_IngredientHash.Get(GetIngredientKey(patternid, ingredients), NULL);
+}
+
+void CacheManager::BenchmarkTradeCombinations(size_t iterations)
+{
+    // Collect the ingredients of every combination in the table as the
+    // container contents to resolve
+    csArray<uint32> patternids;
+    csArray<csArray<uint32> > contents;
+    csHash<csPDelArray<CombinationConstruction>*,uint32>::GlobalIterator it(tradeCombinations_IDHash.GetIterator());
+    while(it.HasNext())
+    {
+        uint32 patternid;
+        csPDelArray<CombinationConstruction>* combArray = it.Next(patternid);
+        for(size_t i = 0; i < combArray->GetSize(); i++)
+        {
+            csArray<uint32> &ingredients = contents.GetExtend(contents.GetSize());
+            for(size_t j = 0; j < combArray->Get(i)->combinations.GetSize(); j++)
+            {
+                ingredients.InsertSorted(combArray->Get(i)->combinations[j]->GetItemId());
+            }
+            patternids.Push(patternid);
+        }
+    }
+
+    if(contents.IsEmpty())
+    {
+        CPrintf(CON_CMDOUTPUT, "No trade combinations loaded.\n");
+        return;
+    }
+
+    // Scan the combination lists the way matching worked without the index
+    size_t scanFound = 0;
+    csMicroTicks start = csGetMicroTicks();
+    for(size_t n = 0; n < iterations; n++)
+    {
+        for(size_t i = 0; i < contents.GetSize(); i++)
+        {
+            const csArray<uint32> &ingredients = contents[i];
+            csPDelArray<CombinationConstruction>* combArray = FindCombinationsList(patternids[i]);
+            for(size_t j = 0; j < combArray->GetSize(); j++)
+            {
+                CombinationConstruction* current = combArray->Get(j);
+                if(current->combinations.GetSize() != ingredients.GetSize())
+                {
+                    continue;
+                }
+                csArray<uint32> left = ingredients;
+                for(size_t k = 0; k < current->combinations.GetSize(); k++)
+                {
+                    size_t index = left.Find(current->combinations[k]->GetItemId());
+                    if(index != csArrayItemNotFound)
+                    {
+                        left.DeleteIndexFast(index);
+                    }
+                }
+                if(left.IsEmpty())
+                {
+                    scanFound++;
+                }
+            }
+        }
+    }
+    csMicroTicks scanTime = csGetMicroTicks() - start;
+
+    size_t indexFound = 0;
+    start = csGetMicroTicks();
+    for(size_t n = 0; n < iterations; n++)
+    {
+        for(size_t i = 0; i < contents.GetSize(); i++)
+        {
+            csArray<CombinationConstruction*>* candidates = FindCombinationsByIngredients(patternids[i], contents[i]);
+            if(candidates)
+            {
+                indexFound += candidates->GetSize();
+            }
+        }
+    }
+    csMicroTicks indexTime = csGetMicroTicks() - start;
+
+    size_t lookups = contents.GetSize() * iterations;
+    CPrintf(CON_CMDOUTPUT, "Resolved %zu combinations %zu times.\n", contents.GetSize(), iterations);
+    CPrintf(CON_CMDOUTPUT, "Scan:  %8.3f ms, %6.2f us per lookup, %zu candidates\n",
+            scanTime/1000.0, (double)scanTime/lookups, scanFound);
+    CPrintf(CON_CMDOUTPUT, "Index: %8.3f ms, %6.2f us per lookup, %zu candidates\n",
+            indexTime/1000.0, (double)indexTime/lookups, indexFound);
+    if(scanFound != indexFound)
+    {
+        CPrintf(CON_CMDOUTPUT, "Warning: index and scan found different candidates!\n");
+    }
+}
+
 // Trade Transformations
 bool CacheManager::PreloadTradeTransformations()
 {
@@ -1433,7 +1583,7 @@ bool CacheManager::PreloadUniqueTradeTransformations()
                 // Push each result item ID into array
                 for(size_t transrow=0; transrow<result.Count(); transrow++)
                 {
-                    newArray->Push(result[transrow].GetUInt32("item_id"));
+                    newArray->InsertSorted(result[transrow].GetUInt32("item_id"));
                 }
 
                 // Now get a list of unique combination items for each pattern
@@ -1446,9 +1596,14 @@ bool CacheManager::PreloadUniqueTradeTransformations()
                 else
                 {
                     // Push each result item ID into array
+                    // Keep the array sorted and unique, so items can be looked up with FindSortedKey
                     for(size_t combsrow=0; combsrow<result2.Count(); combsrow++)
                     {
-                        newArray->Push(result2[combsrow].GetUInt32("item_id"));
+                        uint32 itemid = result2[combsrow].GetUInt32("item_id");
+                        if(newArray->FindSortedKey(csArrayCmp<uint32,uint32>(itemid)) == csArrayItemNotFound)
+                        {
+                            newArray->InsertSorted(itemid);
+                        }
                     }
 
                     // Add hash
@@ -1546,6 +1701,9 @@ bool CacheManager::PreloadTradePatterns()
 
         Notify2(LOG_STARTUP, "%lu Trade Patterns Loaded", result.Count());
     }
+
+    // All trade tables are loaded by now
+    BuildTradeCombinationIndex();
     return true;
 }
 
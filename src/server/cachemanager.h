@@ -498,9 +498,28 @@ public:
     /// Get set of transformations for that pattern
     csPDelArray<CombinationConstruction>* FindCombinationsList(uint32 patternid);
 
+    /**
+     * Get the combinations of a pattern made of exactly the given ingredients.
+     *
+     * Only the item ids are matched, the caller still has to check the
+     * stack counts against the quantities of the combination.
+     *
+     * @param patternid   The pattern, 0 for patternless combinations.
+     * @param ingredients The item stats ids of the stacks to combine, sorted.
+     * @return The candidate combinations in table order, NULL if there are none.
+     */
+    csArray<CombinationConstruction*>* FindCombinationsByIngredients(uint32 patternid, const csArray<uint32> &ingredients);
+
+    /**
+     * Time resolving every combination of the table from its ingredients
+     * with the ingredient index against scanning the combination lists.
+     */
+    void BenchmarkTradeCombinations(size_t iterations);
+
     /// Get transformation array for pattern and target item
     csPDelArray<psTradeTransformations>* FindTransformationsList(uint32 patternid, uint32 targetid);
     bool PreloadUniqueTradeTransformations();
+    /// Get the sorted unique ingredients of a pattern, use FindSortedKey to look up items.
     csArray<uint32>* GetTradeTransUniqueByID(uint32 id);
     bool PreloadTradeProcesses();
     csArray<psTradeProcesses*>* GetTradeProcessesByID(uint32 id);
@@ -701,6 +720,8 @@ protected:
     bool PreloadQuests();
     bool PreloadTradeCombinations();
     bool PreloadTradeTransformations();
+    void BuildTradeCombinationIndex();
+    csString GetIngredientKey(uint32 patternid, const csArray<uint32> &ingredients);
     bool PreloadTips();
     bool PreloadBadNames();
     bool PreloadArmorVsWeapon();
@@ -925,6 +946,7 @@ protected:
     csHash<psTradePatterns *,csString> tradePatterns_NameHash;
     csHash<csArray<psTradeProcesses*> *,uint32> tradeProcesses_IDHash;
     csHash<csPDelArray<CombinationConstruction> *,uint32> tradeCombinations_IDHash;
+    csHash<csArray<CombinationConstruction*> *,csString> tradeCombinations_IngredientHash; ///< Combinations by pattern and sorted ingredient ids
     csHash<csHash<csPDelArray<psTradeTransformations> *,uint32> *,uint32> tradeTransformations_IDHash;
     csHash<csArray<uint32> *,uint32> tradeTransUnique_IDHash;
     csHash<csArray<CraftTransInfo*> *,uint32> tradeCraftTransInfo_IDHash;
@@ -266,9 +266,30 @@ bool Client::IsMyPet(gemActor* other) const
     return false;
 }
 
+void Client::UpdateConnectionIndex()
+{
+    if(psserver && psserver->GetNetManager())
+    {
+        psserver->GetNetManager()->GetConnections()->UpdateIndex(this);
+    }
+}
+
+void Client::SetAccountID(AccountID id)
+{
+    accountID = id;
+    UpdateConnectionIndex();
+}
+
+void Client::SetPID(PID id)
+{
+    playerID = id;
+    UpdateConnectionIndex();
+}
+
 void Client::SetName(const char* n)
 {
     name = n;
+    UpdateConnectionIndex();
 }
 
 const char* Client::GetName()
@@ -291,6 +312,9 @@ void Client::SetActor(gemActor* myactor)
     {
         allowedToDisconnect = true;
     }
+
+    // The name is taken from the character once there is an actor
+    UpdateConnectionIndex();
 }
 
 psCharacter* Client::GetCharacterData()
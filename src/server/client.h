@@ -213,20 +213,14 @@ public:
     {
         return accountID;
     }
-    void SetAccountID(AccountID id)
-    {
-        accountID = id;
-    }
+    void SetAccountID(AccountID id);
 
     /// The player number for this client.
     PID GetPID()
     {
         return playerID;
     }
-    void SetPID(PID id)
-    {
-        playerID = id;
-    }
+    void SetPID(PID id);
 
     int GetExchangeID()
     {
@@ -576,6 +570,9 @@ protected:
     csList<iSector*> locationDisplaySectors;
 
 private:
+    /// Update the lookup indexes of the connection set after the name or an id changed.
+    void UpdateConnectionIndex();
+
     /// Potential number of exploits automatically detected.
     unsigned int detectedCheatCount;
 
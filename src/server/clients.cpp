@@ -56,7 +56,15 @@ bool SockAddress::operator< (const SockAddress &other) const
 }
 
 
-ClientConnectionSet::ClientConnectionSet():addrHash(307),hash(307)
+/// Key of the name index, names are looked up case insensitive.
+static csString NameKey(const char* name)
+{
+    csString key(name);
+    key.Downcase();
+    return key;
+}
+
+ClientConnectionSet::ClientConnectionSet():addrHash(307),hash(307),snapshotValid(false)
 {
 }
 
@@ -69,6 +77,15 @@ ClientConnectionSet::~ClientConnectionSet()
         p = it.Next();
         delete p;
     }
+
+    if(snapshot.IsValid())
+    {
+        for(size_t i = 0; i < snapshot->retired.GetSize(); i++)
+        {
+            delete snapshot->retired[i];
+        }
+        snapshot->retired.Empty();
+    }
 }
 
 bool ClientConnectionSet::Initialize()
@@ -101,6 +118,8 @@ Client* ClientConnectionSet::Add(LPSOCKADDR_IN addr)
     CS::Threading::RecursiveMutexScopedLock lock(mutex);
     addrHash.PutUnique(SockAddress(client->GetAddress()), client);
     hash.Put(client->GetClientNum(), client);
+    UpdateIndex(client);
+    snapshotValid = false;
     return client;
 }
 
@@ -113,16 +132,108 @@ void ClientConnectionSet::MarkDelete(Client* client)
         Bug2("Couldn't delete client %d, it was never added!", clientid);
 
     hash.DeleteAll(clientid);
-    toDelete.Push(client);
+    RemoveIndex(client);
+    snapshotValid = false;
+
+    // Iterators still walking a snapshot may return this client, so keep
+    // it with the newest snapshot until they are done.
+    if(snapshot.IsValid() && snapshot->GetRefCount() > 1)
+        snapshot->retired.Push(client);
+    else
+        toDelete.Push(client);
 }
 
 void ClientConnectionSet::SweepDelete()
 {
     CS::Threading::RecursiveMutexScopedLock lock(mutex);
 
+    ReleaseRetired();
     toDelete.Empty();
 }
 
+void ClientConnectionSet::ReleaseRetired()
+{
+    // Older snapshots keep the newest one alive, so if the set holds the
+    // only reference no iterator can see the retired clients anymore.
+    if(!snapshot.IsValid() || snapshot->GetRefCount() > 1)
+        return;
+
+    for(size_t i = 0; i < snapshot->retired.GetSize(); i++)
+    {
+        toDelete.Push(snapshot->retired[i]);
+    }
+    snapshot->retired.Empty();
+}
+
+csPtr<ClientSnapshot> ClientConnectionSet::GetSnapshot()
+{
+    CS::Threading::RecursiveMutexScopedLock lock(mutex);
+
+    if(!snapshotValid || !snapshot.IsValid())
+    {
+        ReleaseRetired();
+
+        csRef<ClientSnapshot> newSnapshot;
+        newSnapshot.AttachNew(new ClientSnapshot);
+        newSnapshot->clients.SetCapacity(addrHash.GetSize());
+
+        AddressHash::GlobalIterator it(addrHash.GetIterator());
+        while(it.HasNext())
+        {
+            newSnapshot->clients.Push(it.Next());
+        }
+
+        // Clients still visible to iterators move on to the new snapshot,
+        // so they are only ever deleted by SweepDelete.
+        if(snapshot.IsValid())
+        {
+            newSnapshot->retired = snapshot->retired;
+            snapshot->retired.Empty();
+            snapshot->next = newSnapshot;
+        }
+        snapshot = newSnapshot;
+        snapshotValid = true;
+    }
+
+    return csPtr<ClientSnapshot>(snapshot);
+}
+
+void ClientConnectionSet::UpdateIndex(Client* client)
+{
+    CS::Threading::RecursiveMutexScopedLock lock(mutex);
+
+    if(hash.Get(client->GetClientNum(), NULL) != client)
+        return;
+
+    RemoveIndex(client);
+
+    IndexKeys keys;
+    keys.name = NameKey(client->GetName());
+    keys.pid = client->GetPID();
+    keys.account = client->GetAccountID();
+
+    if(!keys.name.IsEmpty())
+        nameIndex.Put(keys.name, client);
+    if(keys.pid.IsValid())
+        pidIndex.Put(keys.pid, client);
+    if(keys.account.IsValid())
+        accountIndex.Put(keys.account, client);
+
+    indexKeys.Put(client->GetClientNum(), keys);
+}
+
+void ClientConnectionSet::RemoveIndex(Client* client)
+{
+    IndexKeys* keys = indexKeys.GetElementPointer(client->GetClientNum());
+    if(!keys)
+        return;
+
+    nameIndex.Delete(keys->name, client);
+    pidIndex.Delete(keys->pid, client);
+    accountIndex.Delete(keys->account, client);
+    indexKeys.DeleteAll(client->GetClientNum());
+}
+
 size_t ClientConnectionSet::Count() const
 {
     return addrHash.GetSize();
@@ -185,50 +296,38 @@ Client* ClientConnectionSet::Find(const char* name)
     }
 
     CS::Threading::RecursiveMutexScopedLock lock(mutex);
-    AddressHash::GlobalIterator it(addrHash.GetIterator());
-    Client* p = NULL;
-    while(it.HasNext())
-    {
-        p = it.Next();
-        if(!p->GetName())
-            continue;
+    csArray<Client*> clients = nameIndex.GetAll(NameKey(name));
 
-        if(!strcasecmp(p->GetName(), name))
-            break;
-        p = NULL;
+    for(size_t i = 0; i < clients.GetSize(); i++)
+    {
+        if(clients[i]->IsReady())
+            return clients[i];
     }
 
-    if(p && p->IsReady())
-        return p;
-    else
-        return NULL;
+    return NULL;
 }
 
 Client* ClientConnectionSet::FindPlayer(PID playerID)
 {
-    CS::Threading::RecursiveMutexScopedLock lock(mutex);
-    AddressHash::GlobalIterator it(addrHash.GetIterator());
-
-    while(it.HasNext())
-    {
-        Client* p = it.Next();
-        if(p->GetPID() == playerID)
-            return p;
-    }
+    if(!playerID.IsValid())
+        return NULL;
 
-    return NULL;
+    CS::Threading::RecursiveMutexScopedLock lock(mutex);
+    return pidIndex.Get(playerID, NULL);
 }
 
 Client* ClientConnectionSet::FindAccount(AccountID accountID, uint32_t excludeClient)
 {
+    if(!accountID.IsValid())
+        return NULL;
+
     CS::Threading::RecursiveMutexScopedLock lock(mutex);
-    AddressHash::GlobalIterator it(addrHash.GetIterator());
+    csArray<Client*> clients = accountIndex.GetAll(accountID);
 
-    while(it.HasNext())
+    for(size_t i = 0; i < clients.GetSize(); i++)
     {
-        Client* p = it.Next();
-        if(p->GetAccountID() == accountID && p->GetClientNum() != excludeClient)
-            return p;
+        if(clients[i]->GetClientNum() != excludeClient)
+            return clients[i];
     }
 
     return NULL;
@@ -255,12 +354,13 @@ csRef<NetPacketQueueRefCount> ClientConnectionSet::FindQueueAny(uint32_t clientn
 }
 
 ClientIterator::ClientIterator(ClientConnectionSet &clients)
-    : ClientConnectionSet::AddressHash::GlobalIterator(clients.addrHash.GetIterator()), mutex(clients.mutex)
+    : snapshot(clients.GetSnapshot()), index(0), mutex(clients.mutex)
 {
-    mutex.Lock();
 }
 
 ClientIterator::~ClientIterator()
 {
-    mutex.Unlock();
+    // The reference count of the snapshots is shared with the set
+    CS::Threading::RecursiveMutexScopedLock lock(mutex);
+    snapshot.Invalidate();
 }
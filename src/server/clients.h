@@ -20,6 +20,7 @@
 #define __CLIENTS_H__
 
 #include <csutil/hash.h>
+#include <csutil/refcount.h>
 #include <csutil/threading/thread.h>
 
 #include "client.h"
@@ -50,9 +51,29 @@ private:
 template<> class csHashComputer<SockAddress> :
     public csHashComputerStruct<SockAddress> {};
 
+/**
+ * An immutable list of the clients connected at one moment, walked by
+ * ClientIterator without holding the lock of the ClientConnectionSet.
+ *
+ * Clients removed while a snapshot is still walked are handed to the
+ * newest snapshot, and each snapshot keeps the next newer one alive. So
+ * when the set holds the only reference to the newest snapshot, no
+ * iterator that might still see a retired client is left, and
+ * SweepDelete deletes them on the main thread.
+ */
+class ClientSnapshot : public csRefCount
+{
+public:
+    csArray<Client*> clients;
+    csArray<Client*> retired;       ///< Clients removed while this or an older snapshot was walked, only set on the newest.
+    csRef<ClientSnapshot> next;     ///< The snapshot built after this one.
+};
+
 /**
  * This class is a list of several CLient objects, it's designed for finding
  * clients very fast based on their clientnum or their IP address.
+ * Clients can also be found by name, player id and account id through
+ * secondary indexes which are updated by Client when these change.
  * This class is also threadsafe now
  */
 class ClientConnectionSet
@@ -62,11 +83,34 @@ public:
 protected:
     friend class ClientIterator;
 
+    /// The keys a client is stored with in the secondary indexes.
+    struct IndexKeys
+    {
+        csString  name;
+        PID       pid;
+        AccountID account;
+    };
+
     AddressHash addrHash;
     csHash<Client*> hash;
+    csHash<Client*, csString> nameIndex;
+    csHash<Client*, PID> pidIndex;
+    csHash<Client*, AccountID> accountIndex;
+    csHash<IndexKeys, uint32_t> indexKeys;
     csPDelArray<Client> toDelete;
+    csRef<ClientSnapshot> snapshot;     ///< The newest snapshot built.
+    bool snapshotValid;                 ///< False if clients were added or removed since the snapshot was built.
     CS::Threading::RecursiveMutex mutex;
 
+    /// Remove a client from the secondary indexes.
+    void RemoveIndex(Client* client);
+
+    /// Get a snapshot of the current clients, building a new one if needed.
+    csPtr<ClientSnapshot> GetSnapshot();
+
+    /// Move the retired clients of the newest snapshot to toDelete if no iterator can see them anymore.
+    void ReleaseRetired();
+
 public:
     ClientConnectionSet();
     ~ClientConnectionSet();
@@ -101,17 +145,43 @@ public:
     Client* Find(LPSOCKADDR_IN addr);
 
     csRef<NetPacketQueueRefCount> FindQueueAny(uint32_t id);
+
+    /**
+     * Update the secondary indexes of a client after its name, player id
+     * or account id changed. Clients not in the set are ignored.
+     */
+    void UpdateIndex(Client* client);
 };
 
-class ClientIterator : public ClientConnectionSet::AddressHash::GlobalIterator
+/**
+ * Walk the clients connected when the iterator was created.
+ *
+ * The iterator walks a snapshot of the set, so the set is not locked while
+ * walking and clients can be added or removed meanwhile. Clients removed
+ * during the walk are still returned, and stay valid until the iterator
+ * is destroyed.
+ */
+class ClientIterator
 {
 public:
     ClientIterator(ClientConnectionSet &clients);
     ~ClientIterator();
 
+    bool HasNext() const
+    {
+        return index < snapshot->clients.GetSize();
+    }
+
+    Client* Next()
+    {
+        return snapshot->clients[index++];
+    }
+
 private:
+    csRef<ClientSnapshot> snapshot;
+    size_t index;
 
-    /// This is a pointer to the mutex in the ClientConnectionSet class
+    /// The mutex of the ClientConnectionSet, guarding the snapshot references
     CS::Threading::RecursiveMutex &mutex;
 };
 
@@ -72,28 +72,52 @@ csPtr<iDocumentNode> ClientStatusLogger::AddContainerNode(iDocumentNode* parent,
     return csPtr<iDocumentNode>(containerNode);
 }
 
+/**
+* @param client The client to copy, it must have an actor
+* @param now The current ticks, to calculate the time since the last packet
+*/
+void ClientStatus::Capture(Client* client, csTicks now)
+{
+    name = client->GetName();
+    securityLevel = client->GetSecurityLevel();
+    clientNum = client->GetClientNum();
+    pid = client->GetPID();
+    ipAddress = client->GetIPAddress();
+    lastPacket = now - client->GetConnection()->lastRecvPacketTime;
+
+    gemActor* actor = client->GetActor();
+    psGuildInfo* guild = actor->GetGuild();
+    inGuild = guild && guild->GetID();
+    hasGuildLevel = false;
+    guildSecret = false;
+    if(inGuild)
+    {
+        guildName = guild->GetName();
+        guildSecret = guild->IsSecret();
+        if(psGuildLevel* guildLevel = actor->GetGuildLevel())
+        {
+            hasGuildLevel = true;
+            guildTitle = guildLevel->title;
+        }
+    }
+}
+
 /**
 *
 */
-void ClientStatusLogger::LogBasicInfo(Client* client, iDocumentNode* node)
+void ClientStatusLogger::LogBasicInfo(const ClientStatus &client, iDocumentNode* node)
 {
-    AddBasicNode(node, "PlayerName", client->GetName());
-    AddBasicNode(node, "SecurityLevel", client->GetSecurityLevel());
-    AddBasicNode(node, "ClientNum", client->GetClientNum());
-    AddBasicNode(node, "PlayerID", client->GetPID().Unbox());
+    AddBasicNode(node, "PlayerName", client.name);
+    AddBasicNode(node, "SecurityLevel", client.securityLevel);
+    AddBasicNode(node, "ClientNum", client.clientNum);
+    AddBasicNode(node, "PlayerID", client.pid.Unbox());
 }
 
 /**
 * @param client
 */
-void ClientStatusLogger::LogClientInfo(Client* client)
+void ClientStatusLogger::LogClientInfo(const ClientStatus &client)
 {
-    CS_ASSERT(client);
-    CS_ASSERT(client->GetActor());
-
-    if(client == NULL) return;  // errors, don't know how to log these yet so just return
-    if(client->GetActor() == NULL) return;
-
     csRef<iDocumentNode> node = AddContainerNode(statusRootNode, "Client");
 
     LogBasicInfo(client, node);
@@ -105,19 +129,15 @@ void ClientStatusLogger::LogClientInfo(Client* client)
 /**
 *
 */
-void ClientStatusLogger::LogConnectionInfo(Client* client, iDocumentNode* node)
+void ClientStatusLogger::LogConnectionInfo(const ClientStatus &client, iDocumentNode* node)
 {
     csRef<iDocumentNode> connNode = AddContainerNode(node, "Connection");
 
     // IP address
-    csString ipAddr = client->GetIPAddress();
-    AddBasicNode(connNode, "IPAddress", ipAddr);
-
-    NetBase::Connection* conn = client->GetConnection();
+    AddBasicNode(connNode, "IPAddress", client.ipAddress);
 
     // ticks since last packet
-    csTicks lastPacket = startTime - conn->lastRecvPacketTime;
-    AddBasicNode(connNode, "LastPacket", lastPacket);
+    AddBasicNode(connNode, "LastPacket", client.lastPacket);
 
 
 
@@ -126,23 +146,18 @@ void ClientStatusLogger::LogConnectionInfo(Client* client, iDocumentNode* node)
 /**
 *
 */
-void ClientStatusLogger::LogGuildInfo(Client* client, iDocumentNode* node)
+void ClientStatusLogger::LogGuildInfo(const ClientStatus &client, iDocumentNode* node)
 {
-
-    gemActor* actor = client->GetActor();
-    psGuildInfo* guild = actor->GetGuild();
-    if(guild == NULL) return;  // is this an error or indicates no guild?
-    if(guild->GetID() == 0) return;
-
+    if(!client.inGuild) return;
 
     csRef<iDocumentNode> guildNode = AddContainerNode(node, "GuildData");
 
-    AddBasicNode(guildNode, "GuildName", guild->GetName().GetData());
+    AddBasicNode(guildNode, "GuildName", client.guildName.GetData());
 
-    if(psGuildLevel* guildLevel = actor->GetGuildLevel())
+    if(client.hasGuildLevel)
     {
-        AddBasicNode(guildNode, "GuildTitle", guildLevel->title.GetData());
-        AddBasicNode(guildNode, "IsGuildSecret", guild->IsSecret());
+        AddBasicNode(guildNode, "GuildTitle", client.guildTitle.GetData());
+        AddBasicNode(guildNode, "IsGuildSecret", client.guildSecret);
     }
 }
 
@@ -156,5 +171,4 @@ void ClientStatusLogger::LogGuildInfo(Client* client, iDocumentNode* node)
 ClientStatusLogger::ClientStatusLogger(iDocumentNode* statusNode)
     : statusRootNode(statusNode)
 {
-    startTime = csGetTicks();
 }
@@ -22,29 +22,53 @@
 #define __CLIENTSTATUSLOGGER_H__
 
 #include <iutil/document.h>
+#include <csutil/csstring.h>
+
+#include "util/psconst.h"
 
 class Client;
 
+/**
+ * The status of a client, copied from the client so it can be logged
+ * outside of the main thread.
+ */
+struct ClientStatus
+{
+    csString     name;
+    int          securityLevel;
+    uint32_t     clientNum;
+    PID          pid;
+    csString     ipAddress;
+    csTicks      lastPacket;        ///< Ticks since the last packet was received.
+    bool         inGuild;
+    csString     guildName;
+    bool         hasGuildLevel;
+    csString     guildTitle;
+    bool         guildSecret;
+
+    /// Copy the status of a client with an actor.
+    void Capture(Client* client, csTicks now);
+};
+
 /**
 * Logs client status to document
 */
 class ClientStatusLogger
 {
 public:
-    void LogClientInfo(Client* client); ///< write client status info to doc
+    void LogClientInfo(const ClientStatus &client); ///< write client status info to doc
 
     ClientStatusLogger(iDocumentNode* statusNode);
 private:
     csRef<iDocumentNode> statusRootNode; ///< top node for all status entries
-    csTicks startTime;
 
     void AddBasicNode(iDocumentNode* parent, const char* fieldName, const char* text);
     void AddBasicNode(iDocumentNode* parent, const char* fieldName, int data);
     csPtr<iDocumentNode> AddContainerNode(iDocumentNode* parent, const char* fieldName);
 
-    void LogBasicInfo(Client* client, iDocumentNode* node);
-    void LogConnectionInfo(Client* client, iDocumentNode* node);
-    void LogGuildInfo(Client* client, iDocumentNode* node);
+    void LogBasicInfo(const ClientStatus &client, iDocumentNode* node);
+    void LogConnectionInfo(const ClientStatus &client, iDocumentNode* node);
+    void LogGuildInfo(const ClientStatus &client, iDocumentNode* node);
 
     ClientStatusLogger() {}
 };
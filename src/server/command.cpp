@@ -63,10 +63,14 @@
 #include "weathermanager.h"
 #include "rpgrules/factions.h"
 #include "util/dbprofile.h"
+#include "util/pstrace.h"
 #include "economymanager.h"
 #include "questmanager.h"
 #include "chatmanager.h"
+#include "workmanager.h"
 #include "engine/psworld.h"
+#include "psserverdr.h"
+#include "paladinjr.h"
 #include "bulkobjects/dictionary.h"
 #include "bulkobjects/psnpcdialog.h"
 
@@ -533,6 +537,18 @@ int com_dumpwarpspace(const char*)
     return 0;
 }
 
+int com_paladin(const char*)
+{
+    psServerDR* serverdr = EntityManager::GetSingleton().GetServerDR();
+    if(!serverdr || !serverdr->GetPaladin())
+    {
+        CPrintf(CON_CMDOUTPUT, "Paladin is not running.\n");
+        return 0;
+    }
+    serverdr->GetPaladin()->PrintStats();
+    return 0;
+}
+
 
 int com_loadmap(const char* mapname)
 {
@@ -1879,6 +1895,54 @@ int com_showlogs(const char* line)
     return 0;
 }
 
+int com_logstats(const char* line)
+{
+    pslog::DisplayStats();
+    return 0;
+}
+
+int com_trace(const char* line)
+{
+    WordArray words(line);
+    csString cmd(words[0]);
+
+    if(cmd == "on" || cmd == "off")
+    {
+        psTrace::SetEnabled(cmd == "on");
+    }
+    else if(cmd == "clear")
+    {
+        psTrace::Clear();
+    }
+    else if(cmd == "export")
+    {
+        csString filename(words[1]);
+        if(filename.IsEmpty())
+        {
+            filename = "trace.json";
+        }
+
+        int count = psTrace::ExportChrome(filename);
+        if(count < 0)
+        {
+            CPrintf(CON_CMDOUTPUT, "Couldn't write %s.\n", filename.GetData());
+        }
+        else
+        {
+            CPrintf(CON_CMDOUTPUT, "Wrote %d spans to %s, open it in chrome://tracing.\n", count, filename.GetData());
+        }
+        return 0;
+    }
+    else if(!cmd.IsEmpty())
+    {
+        CPrintf(CON_CMDOUTPUT, "Please specify: [on|off|clear|export <file>]\n");
+        return 0;
+    }
+
+    CPrintf(CON_CMDOUTPUT, "Tracing is %s.\n", psTrace::IsEnabled() ? "on" : "off");
+    return 0;
+}
+
 int com_setlog(const char* line)
 {
     if(!*line)
@@ -2410,6 +2474,26 @@ int com_transactions(const char* str)
     return 0;
 }
 
+int com_benchtrade(const char* arg)
+{
+    int iterations = atoi(arg);
+    if(iterations <= 0)
+    {
+        iterations = 100;
+    }
+
+    psserver->GetCacheManager()->BenchmarkTradeCombinations(iterations);
+
+    return 0;
+}
+
+int com_reloadresources(const char*)
+{
+    psserver->GetWorkManager()->ReloadResources();
+
+    return 0;
+}
+
 int com_allocations(const char* str)
 {
     CS::Debug::DumpAllocateMemoryBlocks();
@@ -2553,6 +2637,7 @@ const COMMAND commands[] =
     { "maplist",   true, com_maplist,   "List all mounted maps"},
     { "dumpwarpspace",   true, com_dumpwarpspace,   "Dump the warp space table"},
     { "netprofile", true, com_netprofile, "shows network profile info" },
+    { "paladin",   true, com_paladin,   "Show the movement cheat check statistics" },
     { "quit",      true, com_quit,      "[minutes] Makes the server exit immediately or after the specified amount of minutes"},
     { "ready",     false, com_ready,     "Tells server to start accepting connections"},
     { "sectors",   true, com_sectors,   "Display all sectors" },
@@ -2563,10 +2648,14 @@ const COMMAND commands[] =
     { "settime",   true, com_settime,    "Sets the current server hour using a 24 hour clock" },
     { "showtime",  true, com_showtime,   "Show the current time" },
     { "showlogs",  true, com_showlogs,  "Show server logs" },
+    { "logstats",  true, com_logstats,  "Show the dropped log messages and the console output statistics" },
+    { "trace",     true, com_trace,     "Turn tracing on or off, or export the trace of the server threads ( trace [on|off|clear|export <file>] )" },
     { "spawn",     false, com_spawn,     "Loads npcs, items, action locations, hunt locations in the server"},
+    { "reloadresources", true, com_reloadresources, "Reloads the natural resources from the database"},
     { "status",    true, com_status,    "Show server status"},
     { "transactions", false, com_transactions, "Performs an action on the transaction history (run without parameters for options)" },
     { "dumpallocations", true, com_allocations, "Dump all allocations to allocations.txt if CS extensive memdebug is enabled" },
+    { "benchtrade", true, com_benchtrade, "[iterations] Time matching all trade combinations with and without the ingredient index" },
 
     // npc commands
     { "-- NPC commands",  true, NULL, "------------------------------------------------" },
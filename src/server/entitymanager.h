@@ -172,6 +172,10 @@ public:
     {
         return gameWorld;
     }
+    psServerDR* GetServerDR()
+    {
+        return serverdr;
+    }
 
 protected:
     csHash<psAffinityAttribute*> affinityAttributeList;
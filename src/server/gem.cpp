@@ -225,12 +225,14 @@ void GEMSupervisor::AddEntity(gemObject* obj, EID objEid)
 void GEMSupervisor::AddActorEntity(gemActor* actor)
 {
     actors_by_pid.Put(actor->GetPID(), actor);
+    ScheduleRegeneration(actor);
     Debug3(LOG_CELPERSIST,0,"Actor added to supervisor with %s and %s.\n", ShowID(actor->GetEID()), ShowID(actor->GetPID()));
 }
 
 void GEMSupervisor::RemoveActorEntity(gemActor* actor)
 {
     actors_by_pid.Delete(actor->GetPID(), actor);
+    UnscheduleRegeneration(actor);
     Debug3(LOG_CELPERSIST,0,"Actor <%s, %s> removed from supervisor.\n", ShowID(actor->GetEID()), ShowID(actor->GetPID()));
 }
 
@@ -421,19 +423,52 @@ void GEMSupervisor::UpdateAllDR()
 
 void GEMSupervisor::UpdateAllStats()
 {
-    csHash<gemObject*, EID>::GlobalIterator iter(entities_by_eid.GetIterator());
-
-    while(iter.HasNext())
+    // Removed actors are swapped with the last one, so only step forward
+    // when the actor stays scheduled.
+    size_t i = 0;
+    while(i < regenActors.GetSize())
     {
-        gemObject* obj = iter.Next();
-        gemActor* actor = dynamic_cast<gemActor*>(obj);
-        if(actor)
+        gemActor* actor = regenActors[i];
+        actor->UpdateStats();
+
+        // Removed during its update (e.g. killed), another actor is at i now
+        if(i >= regenActors.GetSize() || regenActors[i] != actor)
+            continue;
+
+        if(actor->IsRegenerationIdle())
+        {
+            UnscheduleRegeneration(actor);
+        }
+        else
         {
-            actor->UpdateStats();
+            i++;
         }
     }
 }
 
+void GEMSupervisor::ScheduleRegeneration(gemActor* actor)
+{
+    if(actor->GetRegenerationIndex() != csArrayItemNotFound)
+        return;
+
+    actor->SetRegenerationIndex(regenActors.Push(actor));
+}
+
+void GEMSupervisor::UnscheduleRegeneration(gemActor* actor)
+{
+    size_t index = actor->GetRegenerationIndex();
+    if(index == csArrayItemNotFound)
+        return;
+
+    gemActor* last = regenActors.Pop();
+    if(last != actor)
+    {
+        regenActors[index] = last;
+        last->SetRegenerationIndex(index);
+    }
+    actor->SetRegenerationIndex(csArrayItemNotFound);
+}
+
 void GEMSupervisor::GetPlayerObjects(PID playerID, csArray<gemObject*> &list)
 {
     csHash<gemObject*, EID>::GlobalIterator iter(entities_by_eid.GetIterator());
@@ -2180,7 +2215,7 @@ gemActor::gemActor(GEMSupervisor* gemsupervisor, CacheManager* cachemanager, Ent
                    float rotangle,
                    int clientnum) :
     gemObject(gemsupervisor,entitymanager,cachemanager,chardata->GetCharFullName(),factname,myInstance,room,pos,rotangle,clientnum),
-    psChar(chardata), mount(NULL), attack_cnt(0), DRcounter(0), forceDRcounter(0), lastDR(0), lastV(0), lastSentSuperclientPos(0, 0, 0),
+    psChar(chardata), mount(NULL), attack_cnt(0), DRcounter(0), forceDRcounter(0), lastDR(0), regenIndex(csArrayItemNotFound), lastV(0), lastSentSuperclientPos(0, 0, 0),
     lastSentSuperclientInstance(-1), activeReports(0), isFalling(false), invincible(false), visible(true), viewAllObjects(false),
     movementMode(0), isAllowedToMove(true), atRest(true), player_mode(PSCHARACTER_MODE_PEACE), spellCasting(NULL), workEvent(NULL),
     activeMagic_seq(0), pcmove(NULL), nevertired(false), infinitemana(false), instantcast(false), safefall(false), givekillexp(false),
@@ -3099,6 +3134,30 @@ void gemActor::UpdateStats()
     }
 }
 
+bool gemActor::IsRegenerationIdle()
+{
+    if(!psChar)
+        return true;
+
+    // An actor at 0 HP still has to be killed by the next update
+    if(psChar->GetHP() == 0 && IsAlive())
+        return false;
+
+    return psChar->GetVitals()->IsIdle();
+}
+
+void gemActor::ScheduleRegeneration()
+{
+    if(regenIndex != csArrayItemNotFound)
+        return;
+
+    // Nothing changed while idle, so the time since the last update doesn't count
+    if(psChar)
+        psChar->GetVitals()->RestartUpdates(csGetTicks());
+
+    cel->ScheduleRegeneration(this);
+}
+
 void gemActor::HandleDeath()
 {
     // Cancel the appropriate ActiveSpells
@@ -4087,6 +4146,11 @@ void gemActor::GetPrevTeleportLocation(csVector3 &pos, float &yrot, iSector* &se
 }
 
 void gemActor::MulticastDRUpdate()
+{
+    MulticastDRUpdate(GetMulticastClients());
+}
+
+void gemActor::MulticastDRUpdate(csArray<PublishDestination> &clients)
 {
     bool on_ground;
     float yrot,ang_vel;
@@ -4096,7 +4160,7 @@ void gemActor::MulticastDRUpdate()
     psDRMessage drmsg(0, eid, on_ground, movementMode, DRcounter,
                       pos,yrot,sector, "", vel,worldVel,ang_vel,
                       psserver->GetNetManager()->GetAccessPointers());
-    drmsg.Multicast(GetMulticastClients(),0,PROX_LIST_ANY_RANGE);
+    drmsg.Multicast(clients,0,PROX_LIST_ANY_RANGE);
 }
 
 void gemActor::ForcePositionUpdate(int32_t loadDelay, csString background, csVector2 point1, csVector2 point2, csString widget)
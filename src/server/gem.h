@@ -196,10 +196,23 @@ public:
     void UpdateAllDR();
 
 	/**
-	 * Searches all actors in the game, and updates their vitals
+	 * Updates the vitals of the actors scheduled for regeneration.
+	 *
+	 * Actors with static vitals are dropped from the schedule, they are
+	 * scheduled again when their vitals change.
 	 */
     void UpdateAllStats();
 
+    /**
+     * Schedule the vitals of an actor to be updated by UpdateAllStats.
+     */
+    void ScheduleRegeneration(gemActor* actor);
+
+    /**
+     * Remove an actor from the regeneration schedule.
+     */
+    void UnscheduleRegeneration(gemActor* actor);
+
     void GetAllEntityPos(csArray<psAllEntityPosMessage> &msgs);
     int  CountManagedNPCs(AccountID superclientID);
     void FillNPCList(MsgEntry* msg, AccountID superclientID);
@@ -298,6 +311,7 @@ protected:
     csHash<gemObject*, EID> entities_by_eid; ///< A list of all the entities stored by EID (entity/gem ID).
     csHash<gemItem*, uint32> items_by_uid;   ///< A list of all the items stored by UID (psItem ID).
     csHash<gemActor*,  PID> actors_by_pid;   ///< A list of all the actors stored by PID (player/character ID).
+    csArray<gemActor*> regenActors;          ///< Actors whose vitals may change, updated by UpdateAllStats.
 
     uint32              nextEID;             ///< The next ID available for an object.
 
@@ -1186,6 +1200,7 @@ protected:
     uint8_t DRcounter;  ///< increments in loop to prevent out of order packet overwrites of better data
     uint8_t forceDRcounter; ///< sequence number for forced position updates
     csTicks lastDR;
+    size_t regenIndex;  ///< Index in the regeneration schedule of the GEMSupervisor.
     csVector3 lastV;
 
     /** Production Start Pos is used to record the place where people started digging. */
@@ -1565,6 +1580,29 @@ public:
 	 * If there are updates to publish, it then uses SendStatDRMessage to inform all actors client side
 	 */
     void UpdateStats();
+
+    /**
+     * Check if the vitals of this actor stay the same until they are changed.
+     */
+    bool IsRegenerationIdle();
+
+    /**
+     * Make sure the vitals of this actor are updated by UpdateAllStats.
+     *
+     * Called by the vitals when they change.
+     */
+    void ScheduleRegeneration();
+
+    /// The index of this actor in the regeneration schedule, csArrayItemNotFound if not scheduled.
+    size_t GetRegenerationIndex() const
+    {
+        return regenIndex;
+    }
+    void SetRegenerationIndex(size_t index)
+    {
+        regenIndex = index;
+    }
+
     void ProcessStamina();
     void ProcessStamina(const csVector3 &velocity, bool force=false);
 
@@ -1579,6 +1617,8 @@ public:
 
     bool SetDRData(psDRMessage &drmsg);
     void MulticastDRUpdate();
+    /// Send the current DR state only to the given clients.
+    void MulticastDRUpdate(csArray<PublishDestination> &clients);
     virtual void ForcePositionUpdate(int32_t loadDelay = 0, csString background = "", csVector2 point1 = 0, csVector2 point2 = 0, csString widget = "");
 
     using gemObject::RegisterCallback;
@@ -28,6 +28,7 @@
 #include "util/pserror.h"
 #include "util/serverconsole.h"
 #include "util/eventmanager.h"
+#include "util/pstrace.h"
 
 #include "net/message.h"
 #include "net/messages.h"
@@ -473,6 +474,7 @@ void NetManager::Run()
     size_t clientCountMax = 0;
 
     printf("Network thread started!\n");
+    psTrace::SetThreadName("network");
 
     while(!stop_network)
     {
@@ -490,6 +492,7 @@ void NetManager::Run()
         // Check for link dead clients.
         if(currentticks - lastlinkcheck > LINKCHECK)
         {
+            PS_TRACE_SCOPE("CheckLinkDead");
             CheckLinkDead();
             lastlinkcheck = csGetTicks();
         }
@@ -497,6 +500,7 @@ void NetManager::Run()
         // Check to resend packages that have not been ACK'd yet
         if(currentticks - lastresendcheck > RESENDCHECK)
         {
+            PS_TRACE_SCOPE("CheckResendPkts");
             CheckResendPkts();
             CheckFragmentTimeouts();
             lastresendcheck = csGetTicks();
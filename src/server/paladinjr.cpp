@@ -41,6 +41,11 @@
  */
 #define MAX_ACCUMULATED_LAG 10000
 
+/*
+ * Interval in ms to forget the DR updates of clients that are gone.
+ */
+#define PALADIN_PRUNE_INTERVAL 60000
+
 void PaladinJr::Initialize(EntityManager* celbase, CacheManager* cachemanager)
 {
     iConfigManager* configmanager = psserver->GetConfig();
@@ -95,12 +100,115 @@ void PaladinJr::Initialize(EntityManager* celbase, CacheManager* cachemanager)
     maxSpeed = sqrtf(maxVelocity.z * maxVelocity.z + maxVelocity.x * maxVelocity.x);
     //maxSpeed = 1;
 
-    watchTime = configmanager->GetInt("PlaneShift.Paladin.WatchTime", 30000);
+    cdMinDistance = configmanager->GetFloat("PlaneShift.Paladin.CD.MinDistance", 0.5f);
+    cdVelocityTolerance = configmanager->GetFloat("PlaneShift.Paladin.CD.VelocityTolerance", 1.5f);
+    cdBudget = configmanager->GetFloat("PlaneShift.Paladin.CD.Budget", 20.0f);
+    cdTokens = cdBudget;
+    cdSuspectBudget = configmanager->GetFloat("PlaneShift.Paladin.CD.SuspectBudget", 50.0f);
+    cdSuspectTokens = cdSuspectBudget;
+    cdLastRefill = csGetTicks();
+    lastPrune = csGetTicks();
+
+    cdChecked = 0;
+    cdFiltered = 0;
+    cdSuspect = 0;
+    cdOverBudget = 0;
+    checkClient = false;
 
-    target = NULL;
     entitymanager = celbase;
 }
 
+bool PaladinJr::MovedAsReported(const psDRMessage &lastUpdate, const psDRMessage &currUpdate, csTicks elapsed)
+{
+    // The client may have changed speed in between, allow the faster of both
+    float lastSpeed = sqrtf(lastUpdate.vel.x*lastUpdate.vel.x + lastUpdate.vel.z*lastUpdate.vel.z) +
+                      sqrtf(lastUpdate.worldVel.x*lastUpdate.worldVel.x + lastUpdate.worldVel.z*lastUpdate.worldVel.z);
+    float currSpeed = sqrtf(currUpdate.vel.x*currUpdate.vel.x + currUpdate.vel.z*currUpdate.vel.z) +
+                      sqrtf(currUpdate.worldVel.x*currUpdate.worldVel.x + currUpdate.worldVel.z*currUpdate.worldVel.z);
+
+    float allowed = csMax(lastSpeed, currSpeed) * cdVelocityTolerance * elapsed / 1000.0f + cdMinDistance;
+    float dx = currUpdate.pos.x - lastUpdate.pos.x;
+    float dz = currUpdate.pos.z - lastUpdate.pos.z;
+    return dx*dx + dz*dz <= allowed*allowed;
+}
+
+bool PaladinJr::NeedsCDCheck(Client* client, const psDRMessage &lastUpdate, const psDRMessage &currUpdate, csTicks elapsed)
+{
+    // GMs are not checked, and the extrapolation can't cross sectors
+    if(client->GetSecurityLevel() || lastUpdate.sector != currUpdate.sector)
+    {
+        cdFiltered++;
+        return false;
+    }
+
+    // A client that barely moved can't have passed through anything
+    float dx = currUpdate.pos.x - lastUpdate.pos.x;
+    float dz = currUpdate.pos.z - lastUpdate.pos.z;
+    if(dx*dx + dz*dz < cdMinDistance*cdMinDistance)
+    {
+        cdFiltered++;
+        return false;
+    }
+
+    csTicks now = csGetTicks();
+    float seconds = (now - cdLastRefill)/1000.0f;
+    cdLastRefill = now;
+    cdTokens = csMin(cdBudget, cdTokens + cdBudget*seconds);
+    cdSuspectTokens = csMin(cdSuspectBudget, cdSuspectTokens + cdSuspectBudget*seconds);
+
+    // Updates matching their velocity are only sampled, suspect ones have their own budget
+    float* tokens = &cdTokens;
+    if(!MovedAsReported(lastUpdate, currUpdate, elapsed))
+    {
+        cdSuspect++;
+        tokens = &cdSuspectTokens;
+    }
+
+    // Clients already caught cheating are always checked
+    if(client->GetDetectedCheatCount() == 0)
+    {
+        if(*tokens < 1.0f)
+        {
+            cdOverBudget++;
+            return false;
+        }
+        *tokens -= 1.0f;
+    }
+
+    cdChecked++;
+    return true;
+}
+
+void PaladinJr::PruneUpdates(csTicks now)
+{
+    if(now - lastPrune < PALADIN_PRUNE_INTERVAL)
+        return;
+    lastPrune = now;
+
+    csArray<uint32_t> stale;
+    csHash<ClientUpdate, uint32_t>::GlobalIterator it(lastUpdates.GetIterator());
+    while(it.HasNext())
+    {
+        uint32_t clientnum;
+        const ClientUpdate &update = it.Next(clientnum);
+        if(now - update.received > PALADIN_PRUNE_INTERVAL)
+            stale.Push(clientnum);
+    }
+
+    for(size_t i = 0; i < stale.GetSize(); i++)
+    {
+        lastUpdates.DeleteAll(stale[i]);
+    }
+}
+
+void PaladinJr::PrintStats()
+{
+    CPrintf(CON_CMDOUTPUT, "Paladin %s: %s, %zu clients tracked\n", PALADIN_VERSION,
+            enabled ? (enforcing ? "enforcing" : "enabled") : "disabled", lastUpdates.GetSize());
+    CPrintf(CON_CMDOUTPUT, "CD checks %u, filtered %u, suspect %u, over budget %u, budget %.1f/s, suspect budget %.1f/s\n",
+            cdChecked, cdFiltered, cdSuspect, cdOverBudget, cdBudget, cdSuspectBudget);
+}
+
 bool PaladinJr::ValidateMovement(Client* client, gemActor* actor, psDRMessage &currUpdate)
 {
     if(!enabled)
@@ -116,40 +224,29 @@ bool PaladinJr::ValidateMovement(Client* client, gemActor* actor, psDRMessage &c
 
     checkClient = false;
 
-    if(target && (csGetTicks() - started > watchTime))
-    {
-        checked.Add(target->GetClientNum());
-        target = NULL;
-        started = csGetTicks();
-    }
-
-    if(checked.In(client->GetClientNum()))
-    {
-        if(!target && csGetTicks() - started > PALADIN_MAX_SWITCH_TIME)
-        {
-            // We have checked every client online
-            started = csGetTicks();
-            target = client;
-            lastUpdate = currUpdate;
-#ifdef PALADIN_DEBUG
-            CPrintf(CON_DEBUG, "Now checking client %d\n", target->GetClientNum());
-#endif
-            checked.DeleteAll();
-        }
+    if(!(checks & CDVIOLATION))
         return true;
-    }
 
-    if(!target)
+    csTicks now = csGetTicks();
+    PruneUpdates(now);
+
+    ClientUpdate* last = lastUpdates.GetElementPointer(client->GetClientNum());
+    if(!last)
     {
-        started = csGetTicks();
-        target = client;
-        lastUpdate = currUpdate;
-#ifdef PALADIN_DEBUG
-        CPrintf(CON_DEBUG, "Now checking client %d\n", target->GetClientNum());
-#endif
+        // Nothing to extrapolate from yet
+        ClientUpdate update;
+        update.update = currUpdate;
+        update.received = now;
+        lastUpdates.Put(client->GetClientNum(), update);
         return true;
     }
-    else if(target != client)
+
+    psDRMessage lastUpdate = last->update;
+    csTicks elapsed = now - last->received;
+    last->update = currUpdate;
+    last->received = now;
+
+    if(!NeedsCDCheck(client, lastUpdate, currUpdate, elapsed))
         return true;
 
     float yrot;
@@ -191,7 +288,6 @@ bool PaladinJr::ValidateMovement(Client* client, gemActor* actor, psDRMessage &c
     // No longer need CD checking
     actor->pcmove->UseCD(false);
 
-    lastUpdate = currUpdate;
     checkClient = true;
     return true;
 }
@@ -201,6 +297,8 @@ bool PaladinJr::CheckCollDetection(Client* client, gemActor* actor)
     if(!enabled || !checkClient || !(checks & CDVIOLATION) || client->GetSecurityLevel())
         return true;
 
+    checkClient = false;
+
     csVector3 pos;
     float yrot;
     iSector* sector;
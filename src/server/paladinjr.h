@@ -22,20 +22,25 @@
 //#define PALADIN_DEBUG
 
 #include <iutil/cfgmgr.h>
+#include <csutil/hash.h>
 
-#ifdef PALADIN_DEBUG
-#define PALADIN_MAX_SWITCH_TIME 0
-#else
-#define PALADIN_MAX_SWITCH_TIME 5000
-#endif
-
-#define PALADIN_VERSION "0.13"
+#define PALADIN_VERSION "0.14"
 
+/**
+ * Movement cheat detection.
+ *
+ * The speed, distance and warp checks are cheap and run on every DR update
+ * of every client. The collision detection check extrapolates the movement
+ * of the last DR update with collision detection, which is expensive. A
+ * cheap pre-filter skips the updates where the client barely moved, and
+ * the remaining extrapolations are limited to a budget per second. Clients
+ * with detected cheats are checked before the budget is applied.
+ */
 class PaladinJr
 {
 public:
 
-    /// Extrapolate the current position from last DR packet
+    /// Check the new DR packet and extrapolate the position from the last DR packet if needed
     bool ValidateMovement(Client* client, gemActor* actor, psDRMessage &drmsg);
 
     /** Compare extrapolated displacement with new displacement from new DR packet
@@ -53,6 +58,9 @@ public:
         return enabled;
     }
 
+    /// Print the collision detection check counters.
+    void PrintStats();
+
 private:
 
     enum // possible cheat checks as bitmask
@@ -67,23 +75,60 @@ private:
     bool enabled;
     bool enforcing;
     int checks; ///< checks to perform
-    unsigned int watchTime;
     unsigned int warnCount; ///< warn each x detects
     unsigned int maxCount; ///< kick after x detects
 
     bool SpeedCheck(Client* client, gemActor* actor, psDRMessage &currUpdate);
 
+    /**
+     * Decide if the last DR update of a client is worth a collision
+     * detection check, taking a check from the budget if it is.
+     *
+     * Updates that moved further than the reported velocity allows in the
+     * elapsed time are suspect and drawn from their own budget, the others
+     * are only sampled.
+     */
+    bool NeedsCDCheck(Client* client, const psDRMessage &lastUpdate, const psDRMessage &currUpdate, csTicks elapsed);
+
+    /// Check that the horizontal displacement matches the reported velocities.
+    bool MovedAsReported(const psDRMessage &lastUpdate, const psDRMessage &currUpdate, csTicks elapsed);
+
+    /// Forget the DR updates of clients not seen for a while.
+    void PruneUpdates(csTicks now);
+
+    /// The last DR update of a client, to extrapolate from
+    struct ClientUpdate
+    {
+        psDRMessage update;
+        csTicks     received;
+    };
 
     EntityManager*         entitymanager;
 
-    /// Already checked list of clientnums
-    csSet<uint32_t> checked;
+    /// Last DR update of each client by clientnum
+    csHash<ClientUpdate, uint32_t> lastUpdates;
+    csTicks lastPrune;
+
+    /// Minimum horizontal distance between DR updates to check collision detection
+    float cdMinDistance;
 
-    /// Currently checking client
-    Client* target;
+    /// Slack on the distance the reported velocity allows, for network jitter
+    float cdVelocityTolerance;
 
-    /// Time at which we started to check target client
-    csTicks started;
+    /// Collision detection checks per second for updates matching their velocity
+    float cdBudget;
+    float cdTokens;
+
+    /// Collision detection checks per second for suspect updates
+    float cdSuspectBudget;
+    float cdSuspectTokens;
+    csTicks cdLastRefill;
+
+    // Statistics
+    uint32 cdChecked;
+    uint32 cdFiltered;
+    uint32 cdSuspect;
+    uint32 cdOverBudget;
 
     /// Predicted, extrapolated, position based on last recieved DR packet
     csVector3 predictedPos;
@@ -99,9 +144,6 @@ private:
     /// Check this client?
     bool checkClient;
 
-    /// Data from last DR update stored here
-    psDRMessage lastUpdate;
-
     /// Maximum absolute velocities
     csVector3 maxVelocity;
 
@@ -87,6 +87,7 @@
 #include "questionmanager.h"
 #include "questmanager.h"
 #include "serverstatus.h"
+#include "servermetrics.h"
 #include "spawnmanager.h"
 #include "spellmanager.h"
 #include "tutorialmanager.h"
@@ -177,6 +178,8 @@ psServer::~psServer()
         NetManager::Destroy();
     }
 
+    ServerStatus::Shutdown();
+
     delete economymanager;
     delete tutorialmanager;
     delete charmanager;
@@ -199,6 +202,8 @@ psServer::~psServer()
     delete questmanager;
     delete dict;
     delete database;
+    // Write the queued log lines before the csv logs are closed
+    ConsoleOut::StopAsync();
     delete logcsv;
     delete rng;
     delete gmeventManager;
@@ -621,6 +626,11 @@ bool psServer::Initialize(iObjectRegistry* object_reg)
         Debug1(LOG_STARTUP,0,"Server status reporter initialized.");
     }
 
+    if(!ServerMetrics::Initialize(object_reg))
+    {
+        CPrintf(CON_WARNING, "Warning: Couldn't initialize server metrics.\n");
+    }
+
 	// Loads the date and time from database and publishes to all clients
     weathermanager->StartGameTime();
     return true;
@@ -900,6 +910,13 @@ void psServer::LoadLogSettings()
         CPrintf(CON_CMDOUTPUT,"All LOGS are off.\n");
     }
 
+    // Write the console output from a background thread, so verbose logs don't stall the game
+    pslog::SetRateLimit(configmanager->GetInt("PlaneShift.Log.RateLimit", 1000));
+    if(configmanager->GetBool("PlaneShift.Log.Async", true))
+    {
+        ConsoleOut::StartAsync();
+    }
+
     csString debugFile =  configmanager->GetStr("PlaneShift.DebugFile");
     if(debugFile.Length() > 0)
     {
@@ -20,6 +20,7 @@
 //=============================================================================
 // Crystal Space Includes
 //=============================================================================
+#include <iutil/cfgmgr.h>
 #include <iutil/databuff.h>
 #include <iengine/movable.h>
 #include <iengine/mesh.h>
@@ -63,11 +64,40 @@
 #include "scripting.h"
 #include "netmanager.h"
 
+/// Period of the relay of DR updates held back from distant observers.
+#define DR_RELAY_PERIOD 100
+
+/**
+ * Periodically sends the DR updates held back from distant observers.
+ */
+class psDRRelayEvent : public psGameEvent
+{
+public:
+    psDRRelayEvent(psServerDR* serverDR)
+        : psGameEvent(0, DR_RELAY_PERIOD, "psDRRelayEvent"), serverDR(serverDR)
+    {
+    }
+
+    virtual void Trigger()
+    {
+        serverDR->RelayPendingDR();
+        psserver->GetEventManager()->Push(new psDRRelayEvent(serverDR));
+    }
+
+private:
+    psServerDR* serverDR;
+};
+
 psServerDR::psServerDR(CacheManager* cachemanager, EntityManager* entitymanager)
 {
     cacheManager = cachemanager;
     entityManager = entitymanager;
     paladin = NULL;
+    nearRange = 30.0f;
+    farRange = 60.0f;
+    midInterval = 250;
+    farInterval = 1000;
+    lastPrune = 0;
     calc_damage = psserver->GetMathScriptEngine()->FindScript("Calculate Fall Damage");
 }
 
@@ -90,6 +120,14 @@ bool psServerDR::Initialize()
     paladin = new PaladinJr;
     paladin->Initialize(entityManager, cacheManager);
 
+    iConfigManager* config = psserver->GetConfig();
+    nearRange = config->GetFloat("PlaneShift.Server.DR.NearRange", nearRange);
+    farRange = config->GetFloat("PlaneShift.Server.DR.FarRange", farRange);
+    midInterval = config->GetInt("PlaneShift.Server.DR.MidInterval", midInterval);
+    farInterval = config->GetInt("PlaneShift.Server.DR.FarInterval", farInterval);
+
+    psserver->GetEventManager()->Push(new psDRRelayEvent(this));
+
     return true;
 }
 
@@ -275,9 +313,7 @@ void psServerDR::HandleDeadReckoning(MsgEntry* me,Client* client)
     */
 
     // Now multicast to other clients
-    psserver->GetEventManager()->Multicast(me,
-                                           actor->GetMulticastClients(),
-                                           me->clientnum,PROX_LIST_ANY_RANGE);
+    RelayDR(me, actor);
 
     paladin->CheckCollDetection(client, actor);
 
@@ -322,3 +358,163 @@ void psServerDR::HandleDeadReckoning(MsgEntry* me,Client* client)
     }
 }
 
+
+csTicks psServerDR::GetRelayInterval(float dist) const
+{
+    if(dist < nearRange)
+    {
+        return 0;
+    }
+    if(dist < farRange)
+    {
+        return midInterval;
+    }
+    return farInterval;
+}
+
+void psServerDR::RelayDR(MsgEntry* me, gemActor* actor)
+{
+    csTicks now = csGetTicks();
+    uint32_t sender = me->clientnum;
+    EID eid = actor->GetEID();
+
+    csArray<PublishDestination> &observers = actor->GetMulticastClients();
+    csArray<PublishDestination> sendNow;
+    csArray<uint32_t>* waiting = pendingRelay.GetElementPointer(eid);
+
+    for(size_t i = 0; i < observers.GetSize(); i++)
+    {
+        const PublishDestination &dest = observers[i];
+        if(dest.client == sender)
+        {
+            continue;
+        }
+
+        uint64 key = RelayKey(eid, dest.client);
+        csTicks interval = GetRelayInterval(dest.dist);
+        if(interval && now - lastRelay.Get(key, 0) < interval)
+        {
+            // Too soon for this observer, it gets the latest state later.
+            if(!waiting)
+            {
+                pendingRelay.Put(eid, csArray<uint32_t>());
+                waiting = pendingRelay.GetElementPointer(eid);
+            }
+            if(waiting->Find(dest.client) == csArrayItemNotFound)
+            {
+                waiting->Push(dest.client);
+            }
+            continue;
+        }
+
+        if(interval)
+        {
+            lastRelay.PutUnique(key, now);
+            if(waiting)
+            {
+                waiting->Delete(dest.client);
+            }
+        }
+        sendNow.Push(dest);
+    }
+
+    if(!sendNow.IsEmpty())
+    {
+        psserver->GetEventManager()->Multicast(me, sendNow, sender, PROX_LIST_ANY_RANGE);
+    }
+}
+
+void psServerDR::RelayPendingDR()
+{
+    csTicks now = csGetTicks();
+    GEMSupervisor* gem = entityManager->GetGEM();
+
+    csArray<EID> done;
+    csHash<csArray<uint32_t>, EID>::GlobalIterator iter(pendingRelay.GetIterator());
+    while(iter.HasNext())
+    {
+        EID eid;
+        csArray<uint32_t> &waiting = iter.Next(eid);
+
+        gemObject* object = gem->FindObject(eid);
+        gemActor* actor = object ? object->GetActorPtr() : NULL;
+        if(!actor)
+        {
+            done.Push(eid);
+            continue;
+        }
+
+        // Only observers still in range get the update, with their current distance.
+        csArray<PublishDestination> &observers = actor->GetMulticastClients();
+        csArray<PublishDestination> sendNow;
+        for(size_t i = 0; i < observers.GetSize(); i++)
+        {
+            const PublishDestination &dest = observers[i];
+            if(waiting.Find(dest.client) == csArrayItemNotFound)
+            {
+                continue;
+            }
+
+            uint64 key = RelayKey(eid, dest.client);
+            if(now - lastRelay.Get(key, 0) >= GetRelayInterval(dest.dist))
+            {
+                lastRelay.PutUnique(key, now);
+                waiting.Delete(dest.client);
+                sendNow.Push(dest);
+            }
+        }
+
+        // Observers that left the proximity list don't need the update anymore.
+        for(size_t i = waiting.GetSize(); i-- > 0;)
+        {
+            bool found = false;
+            for(size_t j = 0; j < observers.GetSize() && !found; j++)
+            {
+                found = observers[j].client == waiting[i];
+            }
+            if(!found)
+            {
+                waiting.DeleteIndex(i);
+            }
+        }
+
+        if(!sendNow.IsEmpty())
+        {
+            // Send the current state instead of the held back message.
+            actor->MulticastDRUpdate(sendNow);
+        }
+
+        if(waiting.IsEmpty())
+        {
+            done.Push(eid);
+        }
+    }
+
+    for(size_t i = 0; i < done.GetSize(); i++)
+    {
+        pendingRelay.DeleteAll(done[i]);
+    }
+
+    // Relay times older than the longest interval don't hold anything back.
+    if(now - lastPrune < csMax(midInterval, farInterval))
+    {
+        return;
+    }
+    lastPrune = now;
+
+    csArray<uint64> expired;
+    csHash<csTicks, uint64>::GlobalIterator timeIter(lastRelay.GetIterator());
+    while(timeIter.HasNext())
+    {
+        uint64 key;
+        csTicks time = timeIter.Next(key);
+        if(now - time >= csMax(midInterval, farInterval))
+        {
+            expired.Push(key);
+        }
+    }
+    for(size_t i = 0; i < expired.GetSize(); i++)
+    {
+        lastRelay.DeleteAll(expired[i]);
+    }
+}
@@ -21,10 +21,12 @@
 //=============================================================================
 // Crystal Space Includes
 //=============================================================================
+#include <csutil/hash.h>
 
 //=============================================================================
 // Project Includes
 //=============================================================================
+#include "util/psconst.h"
 
 //=============================================================================
 // Local Includes
@@ -38,6 +40,7 @@ class MathScript;
 class PaladinJr;
 class CacheManager;
 class EntityManager;
+struct PublishDestination;
 
 class psServerDR : public MessageManager<psServerDR>
 {
@@ -49,6 +52,17 @@ public:
 
     void SendPersist();
 
+    /**
+     * Send the current DR state of actors to the observers that were
+     * skipped because they got an update too recently.
+     */
+    void RelayPendingDR();
+
+    PaladinJr* GetPaladin()
+    {
+        return paladin;
+    }
+
 protected:
 
     void HandleDeadReckoning(MsgEntry* me,Client* client);
@@ -57,11 +71,37 @@ protected:
     void HandleFallDamage(gemActor* actor,int clientnum, const csVector3 &pos, iSector* sector);
     void ResetPos(gemActor* actor);
 
+    /**
+     * Multicast a DR update to the observers of an actor.
+     *
+     * Observers further away than nearRange get at most one update per
+     * tier interval, the ones skipped are queued for RelayPendingDR.
+     */
+    void RelayDR(MsgEntry* me, gemActor* actor);
+
+    /// Minimum time between two DR updates sent to an observer at the given distance.
+    csTicks GetRelayInterval(float dist) const;
+
+    /// Key of the last relay time of an actor to an observer.
+    static uint64 RelayKey(EID actor, uint32_t client)
+    {
+        return (uint64(actor.Unbox()) << 32) | client;
+    }
+
     MathScript* calc_damage;
     PaladinJr* paladin;
 
     CacheManager* cacheManager;
     EntityManager* entityManager;
+
+    float nearRange;      ///< Observers within this range get every DR update.
+    float farRange;       ///< Observers beyond this range get the far interval.
+    csTicks midInterval;  ///< Minimum time between DR updates between nearRange and farRange.
+    csTicks farInterval;  ///< Minimum time between DR updates beyond farRange.
+
+    csHash<csTicks, uint64> lastRelay;           ///< Last time an actor was relayed to an observer.
+    csHash<csArray<uint32_t>, EID> pendingRelay; ///< Observers still waiting for the state of an actor.
+    csTicks lastPrune;                           ///< Last time expired relay times were removed.
 };
 
 #endif
@@ -0,0 +1,174 @@
+/*
+ * servermetrics.cpp
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#include <psconfig.h>
+//=============================================================================
+// Crystal Space Includes
+//=============================================================================
+#include <csutil/sysfunc.h>
+#include <iutil/cfgmgr.h>
+#include <iutil/objreg.h>
+#include <iutil/vfs.h>
+
+//=============================================================================
+// Project Includes
+//=============================================================================
+#include "util/eventmanager.h"
+#include "util/gameevent.h"
+#include "util/pstrace.h"
+
+#include "net/messages.h"
+
+//=============================================================================
+// Local Includes
+//=============================================================================
+#include "servermetrics.h"
+#include "psserver.h"
+#include "netmanager.h"
+#include "clients.h"
+#include "globals.h"
+
+/*****************************************************************
+*                psServerMetricsRunEvent
+******************************************************************/
+
+class psServerMetricsRunEvent : public psGameEvent
+{
+public:
+    psServerMetricsRunEvent(csTicks interval)
+        : psGameEvent(0, interval, "psServerMetricsRunEvent")
+    {
+    }
+
+    void Trigger()
+    {
+        PS_TRACE_SCOPE("ServerMetrics");
+
+        csString snapshot = ServerMetrics::Snapshot();
+        psserver->vfs->WriteFile(ServerMetrics::file, snapshot.GetData(), snapshot.Length());
+
+        ServerMetrics::ScheduleNextRun();
+    }
+};
+
+/*****************************************************************
+*                ServerMetrics
+******************************************************************/
+
+csTicks  ServerMetrics::rate;
+csString ServerMetrics::file;
+
+bool ServerMetrics::Initialize(iObjectRegistry* objreg)
+{
+    csRef<iConfigManager> configmanager =  csQueryRegistry<iConfigManager> (objreg);
+    if(!configmanager)
+        return false;
+
+    rate = configmanager->GetInt("PlaneShift.Server.Metrics.Rate", 0);
+    if(!rate)
+        return true;
+
+    file = configmanager->GetStr("PlaneShift.Server.Metrics.File", "/this/metrics.txt");
+
+    ScheduleNextRun();
+    return true;
+}
+
+void ServerMetrics::ScheduleNextRun()
+{
+    psserver->GetEventManager()->Push(new psServerMetricsRunEvent(rate));
+}
+
+csString ServerMetrics::Snapshot()
+{
+    // Totals at the previous snapshot, to calculate the rates
+    static csTicks lastTime = 0;
+    static long lastCountIn = 0;
+    static long lastCountOut = 0;
+    static uint32 lastStatements = 0;
+    static uint64 lastStatementTime = 0;
+
+    csTicks now = csGetTicks();
+    float seconds = lastTime ? (now - lastTime)/1000.0f : 0.0f;
+    lastTime = now;
+
+    csString snapshot;
+
+    // Event thread
+    EventManager* eventmanager = psserver->GetEventManager();
+    const EventMetrics &metrics = eventmanager->GetMetrics();
+
+    snapshot.AppendFmt("psserver_uptime_ms %u\n", now);
+    snapshot.AppendFmt("psserver_events %u\n", metrics.events);
+    snapshot.AppendFmt("psserver_event_lateness_max_ms %u\n", metrics.maxLateness);
+    snapshot.AppendFmt("psserver_event_lateness_avg_ms %.2f\n",
+                       metrics.events ? (float)metrics.totalLateness/metrics.events : 0.0f);
+    snapshot.AppendFmt("psserver_event_queue %zu\n", eventmanager->GetEventQueueSize());
+    snapshot.AppendFmt("psserver_message_queue %u\n", eventmanager->GetMessageQueueSize());
+    snapshot.AppendFmt("psserver_messages %u\n", metrics.messages);
+
+    csHash<MsgTypeMetrics,int>::ConstGlobalIterator iter(metrics.msgTypes.GetIterator());
+    while(iter.HasNext())
+    {
+        int msgType;
+        const MsgTypeMetrics &typeMetrics = iter.Next(msgType);
+        csString name = GetMsgTypeName(msgType);
+        snapshot.AppendFmt("psserver_msg_count{type=\"%s\"} %u\n", name.GetData(), typeMetrics.count);
+        snapshot.AppendFmt("psserver_msg_handler_us{type=\"%s\"} %lld\n", name.GetData(), (long long)typeMetrics.time);
+        snapshot.AppendFmt("psserver_msg_handler_max_us{type=\"%s\"} %lld\n", name.GetData(), (long long)typeMetrics.maxTime);
+    }
+    eventmanager->ResetMetrics();
+
+    // Network
+    NetManager* netmanager = psserver->GetNetManager();
+    if(netmanager)
+    {
+        long countIn, countOut, transferIn, transferOut;
+        netmanager->GetTotals(countIn, countOut, transferIn, transferOut);
+
+        snapshot.AppendFmt("psserver_clients %zu\n", netmanager->GetConnections()->Count());
+        snapshot.AppendFmt("psserver_packets_in_total %ld\n", countIn);
+        snapshot.AppendFmt("psserver_packets_out_total %ld\n", countOut);
+        snapshot.AppendFmt("psserver_bytes_in_total %ld\n", transferIn);
+        snapshot.AppendFmt("psserver_bytes_out_total %ld\n", transferOut);
+        snapshot.AppendFmt("psserver_packets_in_per_sec %.1f\n", seconds > 0 ? (countIn - lastCountIn)/seconds : 0.0f);
+        snapshot.AppendFmt("psserver_packets_out_per_sec %.1f\n", seconds > 0 ? (countOut - lastCountOut)/seconds : 0.0f);
+
+        lastCountIn = countIn;
+        lastCountOut = countOut;
+    }
+
+    // Database
+    if(db)
+    {
+        uint32 statements;
+        uint64 statementTime;
+        db->GetProfileTotals(statements, statementTime);
+
+        uint32 intervalStatements = statements - lastStatements;
+        snapshot.AppendFmt("psserver_db_statements_total %u\n", statements);
+        snapshot.AppendFmt("psserver_db_statements %u\n", intervalStatements);
+        snapshot.AppendFmt("psserver_db_latency_avg_ms %.2f\n",
+                           intervalStatements ? (float)(statementTime - lastStatementTime)/intervalStatements : 0.0f);
+
+        lastStatements = statements;
+        lastStatementTime = statementTime;
+    }
+
+    return snapshot;
+}
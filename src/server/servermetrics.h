@@ -0,0 +1,67 @@
+/*
+ * servermetrics.h
+ *
+ * Copyright (C) 2013 Atomic Blue (info@planeshift.it, http://www.atomicblue.org)
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation (version 2 of the License)
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ */
+#ifndef __SERVERMETRICS_H__
+#define __SERVERMETRICS_H__
+//=============================================================================
+// Crystal Space Includes
+//=============================================================================
+#include <csutil/csstring.h>
+
+struct iObjectRegistry;
+
+/**
+ * \addtogroup server
+ * @{ */
+
+/**
+ * Writes a snapshot of the server performance counters to a file at a
+ * fixed interval, for a monitoring scraper to pick up.
+ *
+ * The snapshot has one "name value" line per counter, with the message
+ * types as labels on the handler times:
+ *
+ *  psserver_event_lateness_max_ms 3
+ *  psserver_message_queue 0
+ *  psserver_msg_handler_us{type="MSGTYPE_DEAD_RECKONING"} 5210
+ *
+ * Counters ending in _total count since the start of the server, the
+ * others are about the interval since the last snapshot.
+ */
+class ServerMetrics
+{
+public:
+    /** Reads config files, starts periodical metrics snapshots */
+    static bool Initialize(iObjectRegistry* objreg);
+
+    /** Has the snapshot written in a while */
+    static void ScheduleNextRun();
+
+    /** Build a snapshot of the counters and reset the interval counters */
+    static csString Snapshot();
+
+    /// Interval in milliseconds to write a snapshot.
+    static csTicks rate;
+
+    /// File that the snapshot is written to.
+    static csString file;
+};
+
+/** @} */
+
+#endif
@@ -21,6 +21,8 @@
 // Crystal Space Includes
 //=============================================================================
 #include <csutil/csstring.h>
+#include <csutil/scfstr.h>
+#include <csutil/sysfunc.h>
 #include <csutil/xmltiny.h>
 #include <iutil/objreg.h>
 #include <iutil/cfgmgr.h>
@@ -30,6 +32,7 @@
 //=============================================================================
 #include "util/eventmanager.h"
 #include "util/psxmlparser.h"
+#include "util/log.h"
 
 #include "bulkobjects/psguildinfo.h"
 //=============================================================================
@@ -47,33 +50,128 @@
 #include "bulkobjects/pssectorinfo.h"
 #include "economymanager.h"
 
+#ifdef CS_PLATFORM_WIN32
+#include <windows.h>
+#endif
+
 
 /*****************************************************************
-*                psServerStatusRunEvent
+*                Report snapshot
 ******************************************************************/
 
-class psServerStatusRunEvent : public psGameEvent
+/// Status of a player, copied from the client and its character.
+struct ServerStatusPlayer
+{
+    ClientStatus client;
+    unsigned int kills;
+    unsigned int deaths;
+    unsigned int suicides;
+    csVector3    pos;
+    csString     sector;
+};
+
+/// Status of a NPC, copied from its character.
+struct ServerStatusNPC
+{
+    csString     name;
+    PID          pid;
+    unsigned int kills;
+    unsigned int deaths;
+    unsigned int suicides;
+    csVector3    pos;
+    csString     sector;
+};
+
+/**
+ * Everything that goes into a report, copied on the event thread so the
+ * report can be written by the writer thread.
+ */
+struct ServerStatusReport
+{
+    csString     time;
+    time_t       now;
+    unsigned int number;
+    size_t       clientCount;
+    unsigned int mobBirths;
+    unsigned int mobDeaths;
+    unsigned int playerDeaths;
+    unsigned int soldItems;
+    unsigned int soldValue;
+    unsigned int moneyIn;
+    unsigned int moneyOut;
+    csTicks      captureTime;       ///< Time taken to copy this report on the event thread.
+
+    csArray<ServerStatusPlayer> players;
+    csArray<ServerStatusNPC>    npcs;
+};
+
+/*****************************************************************
+*                ServerStatusWriter
+******************************************************************/
+
+/**
+ * Thread formatting the reports and writing them to disk, so the event
+ * thread only has to copy the data.
+ *
+ * Only the newest report is kept when the writer falls behind.
+ */
+class ServerStatusWriter : public CS::Threading::Runnable
 {
 public:
-    psServerStatusRunEvent(csTicks interval);
-    void Trigger();
-    void ReportClient(Client* curr, ClientStatusLogger &clientLogger, csString &reportString);
-    void ReportNPC(psCharacter* chardata, csString &reportString);
+    virtual void Run();
 };
 
-psServerStatusRunEvent::psServerStatusRunEvent(csTicks interval)
-    : psGameEvent(0, interval, "psServerStatusRunEvent")
+static CS::Threading::Mutex writerMutex;
+static CS::Threading::Condition writerCondition;
+static csRef<CS::Threading::Thread> writerThread;
+static ServerStatusReport* pendingReport = NULL;
+static bool writerStopping = false;
+static csTicks lastWriteTime = 0;   ///< Time the writer took for the last report.
+
+static csString realReportFile;
+static csString realTestLogFile;
+
+/**
+ * Replace a file with new content.
+ *
+ * The content is written to a temporary file first which is then renamed,
+ * so readers of the file never see a partially written report.
+ */
+static bool ReplaceFile(const csString &path, const char* data, size_t size)
 {
+    csString temp = path + ".tmp";
+
+    FILE* file = fopen(temp, "wb");
+    if(!file)
+    {
+        Error2("Couldn't open %s to write the server status.", temp.GetData());
+        return false;
+    }
+
+    bool ok = fwrite(data, 1, size, file) == size;
+    ok = (fclose(file) == 0) && ok;
+    if(ok)
+    {
+#ifdef CS_PLATFORM_WIN32
+        ok = MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        ok = rename(temp, path) == 0;
+#endif
+    }
 
+    if(!ok)
+    {
+        Error2("Couldn't write the server status to %s.", path.GetData());
+        remove(temp);
+    }
+    return ok;
 }
 
-void psServerStatusRunEvent::Trigger()
+static void WriteReport(const ServerStatusReport &report)
 {
-    struct tm currentTime;
-    time_t now;
+    csTicks start = csGetTicks();
 
     csString reportString;
-    csString timeString;
 
     csRef<iDocumentSystem> docSystem;
     docSystem.AttachNew(new csTinyDocumentSystem());
@@ -83,23 +181,148 @@ void psServerStatusRunEvent::Trigger()
     // create ClientStatusLogger object to log info under node
     ClientStatusLogger clientLogger(rootNode);
 
-    time(&now);
-    currentTime = *gmtime(&now);
-    timeString = asctime(&currentTime);
-    timeString.Trim();
-    EconomyManager::Economy &economy = psserver->GetEconomyManager()->economy;
+    reportString.Format("<server_report time=\"%s\" now=\"%ld\" number=\"%u\" client_count=\"%zu\" mob_births=\"%u\" mob_deaths=\"%u\" player_deaths=\"%u\" sold_items=\"%u\" sold_value=\"%u\" totalMoneyIn=\"%u\" totalMoneyOut=\"%u\" capture_time=\"%u\" write_time=\"%u\">\n",
+                        report.time.GetData(), (long)report.now, report.number, report.clientCount, report.mobBirths, report.mobDeaths, report.playerDeaths, report.soldItems, report.soldValue, report.moneyIn, report.moneyOut, report.captureTime, lastWriteTime);
+
+    for(size_t i = 0; i < report.players.GetSize(); i++)
+    {
+        const ServerStatusPlayer &player = report.players[i];
 
-    unsigned int moneyIn = economy.lootValue + economy.sellingValue + economy.pickupsValue;
-    unsigned int moneyOut = economy.buyingValue + economy.droppedValue;
+        // log this client's info with the clientLogger
+        clientLogger.LogClientInfo(player.client);
+
+        csString guildTitle;
+        csString guildName;
+        if(player.client.inGuild && !player.client.guildSecret)
+        {
+            if(player.client.hasGuildLevel)
+            {
+                guildTitle = EscpXML(player.client.guildTitle);
+            }
+            guildName = EscpXML(player.client.guildName);
+        }
+
+        reportString.AppendFmt("<player name=\"%s\" characterID=\"%u\" guild=\"%s\" title=\"%s\" security=\"%d\" kills=\"%u\" deaths=\"%u\" suicides=\"%u\" pos_x=\"%.2f\" pos_y=\"%.2f\" pos_z=\"%.2f\" sector=\"%s\" />\n",
+                               EscpXML(player.client.name).GetData(),
+                               player.client.pid.Unbox(),
+                               guildName.GetDataSafe(),
+                               guildTitle.GetDataSafe(),
+                               player.client.securityLevel,
+                               player.kills,
+                               player.deaths,
+                               player.suicides,
+                               player.pos.x,
+                               player.pos.y,
+                               player.pos.z,
+                               EscpXML(player.sector).GetData());
+    }
+
+    for(size_t i = 0; i < report.npcs.GetSize(); i++)
+    {
+        const ServerStatusNPC &npc = report.npcs[i];
+
+        reportString.AppendFmt("<npc name=\"%s\" characterID=\"%u\" kills=\"%u\" deaths=\"%u\" suicides=\"%u\" pos_x=\"%.2f\" pos_y=\"%.2f\" pos_z=\"%.2f\" sector=\"%s\" />\n",
+                               EscpXML(npc.name).GetData(), npc.pid.Unbox(),
+                               npc.kills, npc.deaths, npc.suicides, npc.pos.x, npc.pos.y, npc.pos.z,
+                               EscpXML(npc.sector).GetData());
+    }
+    reportString.Append("</server_report>");
+
+    ReplaceFile(realReportFile, reportString.GetData(), reportString.Length());
+
+    // write XML log to file
+    csRef<iString> testLog;
+    testLog.AttachNew(new scfString());
+    doc->Write(testLog);
+    ReplaceFile(realTestLogFile, testLog->GetData(), testLog->Length());
+
+    lastWriteTime = csGetTicks() - start;
+}
+
+void ServerStatusWriter::Run()
+{
+    while(true)
+    {
+        ServerStatusReport* report;
+        {
+            CS::Threading::MutexScopedLock lock(writerMutex);
+            while(!pendingReport && !writerStopping)
+            {
+                writerCondition.Wait(writerMutex);
+            }
+
+            if(!pendingReport)
+            {
+                return;
+            }
+
+            report = pendingReport;
+            pendingReport = NULL;
+        }
+
+        WriteReport(*report);
+        delete report;
+    }
+}
+
+/// Hand a report to the writer thread, replacing a report not written yet.
+static void SubmitReport(ServerStatusReport* report)
+{
+    CS::Threading::MutexScopedLock lock(writerMutex);
+    delete pendingReport;
+    pendingReport = report;
+    writerCondition.NotifyOne();
+}
+
+/*****************************************************************
+*                psServerStatusRunEvent
+******************************************************************/
+
+class psServerStatusRunEvent : public psGameEvent
+{
+public:
+    psServerStatusRunEvent(csTicks interval);
+    void Trigger();
+    void CaptureClient(Client* curr, ServerStatusReport* report, csTicks now);
+    void CaptureNPC(psCharacter* chardata, ServerStatusReport* report);
+};
+
+psServerStatusRunEvent::psServerStatusRunEvent(csTicks interval)
+    : psGameEvent(0, interval, "psServerStatusRunEvent")
+{
+
+}
+
+void psServerStatusRunEvent::Trigger()
+{
+    csTicks start = csGetTicks();
+    struct tm currentTime;
+
+    ServerStatusReport* report = new ServerStatusReport;
+
+    time(&report->now);
+    currentTime = *gmtime(&report->now);
+    report->time = asctime(&currentTime);
+    report->time.Trim();
+    EconomyManager::Economy &economy = psserver->GetEconomyManager()->economy;
 
     ClientConnectionSet* clients = psserver->entitymanager->GetClients();
-    reportString.Format("<server_report time=\"%s\" now=\"%ld\" number=\"%u\" client_count=\"%zu\" mob_births=\"%u\" mob_deaths=\"%u\" player_deaths=\"%u\" sold_items=\"%u\" sold_value=\"%u\" totalMoneyIn=\"%u\" totalMoneyOut=\"%u\">\n",
-                        timeString.GetData(), now, ServerStatus::count, clients->Count(), ServerStatus::mob_birthcount, ServerStatus::mob_deathcount, ServerStatus::player_deathcount, ServerStatus::sold_items, ServerStatus::sold_value, moneyIn, moneyOut);
+    report->number = ServerStatus::count;
+    report->clientCount = clients->Count();
+    report->mobBirths = ServerStatus::mob_birthcount;
+    report->mobDeaths = ServerStatus::mob_deathcount;
+    report->playerDeaths = ServerStatus::player_deathcount;
+    report->soldItems = ServerStatus::sold_items;
+    report->soldValue = ServerStatus::sold_value;
+    report->moneyIn = economy.lootValue + economy.sellingValue + economy.pickupsValue;
+    report->moneyOut = economy.buyingValue + economy.droppedValue;
+
+    report->players.SetCapacity(report->clientCount);
     ClientIterator i(*clients);
     while(i.HasNext())
     {
         Client* curr = i.Next();
-        ReportClient(curr, clientLogger, reportString);
+        CaptureClient(curr, report, start);
     }
     // Record npc data
     csHash<gemObject*, EID> &gems = psserver->entitymanager->GetGEM()->GetAllGEMS();
@@ -110,69 +333,42 @@ void psServerStatusRunEvent::Trigger()
     {
         obj = gemi.Next();
         if(!obj->GetClient() && obj->GetCharacterData())
-            ReportNPC(obj->GetCharacterData(), reportString);
+            CaptureNPC(obj->GetCharacterData(), report);
     }
-    reportString.Append("</server_report>");
 
-    csRef<iFile> logFile = psserver->vfs->Open(ServerStatus::reportFile, VFS_FILE_WRITE);
-    logFile->Write(reportString, reportString.Length());
-    logFile->Flush();
-
-    // write XML log to file
-    csRef<iFile> logFileTest = psserver->vfs->Open(csString("/this/testlog.xml"), VFS_FILE_WRITE);
-    doc->Write(logFileTest);
+    report->captureTime = csGetTicks() - start;
+    SubmitReport(report);
 
     ServerStatus::count++;
     ServerStatus::ScheduleNextRun();
 }
 
-void psServerStatusRunEvent::ReportClient(Client* curr, ClientStatusLogger &clientLogger, csString &reportString)
+void psServerStatusRunEvent::CaptureClient(Client* curr, ServerStatusReport* report, csTicks now)
 {
     if(curr->IsSuperClient() || !curr->GetActor())
         return;
 
     const psCharacter* chr = curr->GetCharacterData();
-    // log this client's info with the clientLogger
-    clientLogger.LogClientInfo(curr);
-
-    psGuildInfo* guild = curr->GetActor()->GetGuild();
-    csString guildTitle;
-    csString guildName;
-    if(guild && guild->GetID() && !guild->IsSecret())
-    {
-        psGuildLevel* level = curr->GetActor()->GetGuildLevel();
-        if(level)
-        {
-            guildTitle = EscpXML(level->title);
-        }
-        guildName = EscpXML(guild->GetName());
-    }
 
-    reportString.AppendFmt("<player name=\"%s\" characterID=\"%u\" guild=\"%s\" title=\"%s\" security=\"%d\" kills=\"%u\" deaths=\"%u\" suicides=\"%u\" pos_x=\"%.2f\" pos_y=\"%.2f\" pos_z=\"%.2f\" sector=\"%s\" />\n",
-                           EscpXML(curr->GetName()).GetData(),
-                           chr->GetPID().Unbox(),
-                           guildName.GetDataSafe(),
-                           guildTitle.GetDataSafe(),
-                           curr->GetSecurityLevel(),
-                           chr->GetKills(),
-                           chr->GetDeaths(),
-                           chr->GetSuicides(),
-                           chr->GetLocation().loc.x,
-                           chr->GetLocation().loc.y,
-                           chr->GetLocation().loc.z,
-                           EscpXML(chr->GetLocation().loc_sector->name).GetData());
+    ServerStatusPlayer &player = report->players.GetExtend(report->players.GetSize());
+    player.client.Capture(curr, now);
+    player.kills = chr->GetKills();
+    player.deaths = chr->GetDeaths();
+    player.suicides = chr->GetSuicides();
+    player.pos = chr->GetLocation().loc;
+    player.sector = chr->GetLocation().loc_sector->name;
 }
 
-void psServerStatusRunEvent::ReportNPC(psCharacter* chardata, csString &reportString)
+void psServerStatusRunEvent::CaptureNPC(psCharacter* chardata, ServerStatusReport* report)
 {
-    csString escpxml_name = EscpXML(chardata->GetCharFullName());
-    csString player;
-
-    player.Format("<npc name=\"%s\" characterID=\"%u\" kills=\"%u\" deaths=\"%u\" suicides=\"%u\" pos_x=\"%.2f\" pos_y=\"%.2f\" pos_z=\"%.2f\" sector=\"%s\" />\n",
-                  escpxml_name.GetData(), chardata->GetPID().Unbox(),
-                  chardata->GetKills(), chardata->GetDeaths(), chardata->GetSuicides(), chardata->GetLocation().loc.x, chardata->GetLocation().loc.y, chardata->GetLocation().loc.z, (const char*) EscpXML(chardata->GetLocation().loc_sector->name));
-
-    reportString.Append(player);
+    ServerStatusNPC &npc = report->npcs.GetExtend(report->npcs.GetSize());
+    npc.name = chardata->GetCharFullName();
+    npc.pid = chardata->GetPID();
+    npc.kills = chardata->GetKills();
+    npc.deaths = chardata->GetDeaths();
+    npc.suicides = chardata->GetSuicides();
+    npc.pos = chardata->GetLocation().loc;
+    npc.sector = chardata->GetLocation().loc_sector->name;
 }
 
 /*****************************************************************
@@ -201,10 +397,49 @@ bool ServerStatus::Initialize(iObjectRegistry* objreg)
     reportRate = configmanager->GetInt("PlaneShift.Server.Status.Rate", 1000);
     reportFile = configmanager->GetStr("PlaneShift.Server.Status.LogFile", "/this/serverfile");
 
+    // The writer thread writes the files directly, VFS is only used here
+    csRef<iVFS> vfs = csQueryRegistry<iVFS> (objreg);
+    csRef<iDataBuffer> realPath;
+    csRef<iDataBuffer> realTestPath;
+    if(vfs)
+    {
+        realPath = vfs->GetRealPath(reportFile);
+        realTestPath = vfs->GetRealPath("/this/testlog.xml");
+    }
+    if(!realPath || !realTestPath)
+    {
+        Error2("Couldn't find the real path of the server status file %s.", reportFile.GetData());
+        return false;
+    }
+    realReportFile = realPath->GetData();
+    realTestLogFile = realTestPath->GetData();
+
+    writerStopping = false;
+    csRef<ServerStatusWriter> writer;
+    writer.AttachNew(new ServerStatusWriter);
+    writerThread.AttachNew(new CS::Threading::Thread(writer));
+    writerThread->Start();
+
     ScheduleNextRun();
     return true;
 }
 
+void ServerStatus::Shutdown()
+{
+    if(!writerThread)
+        return;
+
+    {
+        CS::Threading::MutexScopedLock lock(writerMutex);
+        writerStopping = true;
+        writerCondition.NotifyAll();
+    }
+
+    // The writer writes the pending report before it stops
+    writerThread->Wait();
+    writerThread.Invalidate();
+}
+
 void ServerStatus::ScheduleNextRun()
 {
     psserver->GetEventManager()->Push(new psServerStatusRunEvent(reportRate));
@@ -22,6 +22,7 @@
 // Crystal Space Includes
 //=============================================================================
 #include <iutil/vfs.h>
+#include <csutil/threading/condition.h>
 #include <csutil/threading/thread.h>
 #include <csutil/csstring.h>
 
@@ -51,8 +52,14 @@ class psServer;
  *  At the moment it overwrites logs but can be easily changed to either create a
  *  unique log file for each report ( such as daily ).
  *
+ *  The event thread only copies the data of the report, the report is formatted
+ *  and written by a writer thread. Files are replaced atomically so the report
+ *  can be read at any time.
+ *
  * Log Format:
- *  &lt;server_report time="Time stamp for report" number="number of this report" &gt;
+ *  &lt;server_report time="Time stamp for report" number="number of this report"
+ *                 capture_time="ms the event thread took to copy the report"
+ *                 write_time="ms the writer took for the previous report" &gt;
  *  &lt;player name="player name"
  *             guild="guild name"
  *             title="guild rank"
@@ -70,6 +77,9 @@ public:
     /** Has the generator run in a while */
     static void ScheduleNextRun();
 
+    /** Stops the writer thread after writing the last report */
+    static void Shutdown();
+
     /// Interval in milliseconds to generate a report file.
     static csTicks reportRate;
 
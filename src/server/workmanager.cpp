@@ -172,6 +172,9 @@ WorkManager::~WorkManager()
     //do nothing
 }
 
+/// Size of the cells of the natural resource grids.
+#define RESOURCE_CELL_SIZE 32.0f
+
 void WorkManager::Initialize()
 {
     Result res(db->Select("select * from natural_resources"));
@@ -181,31 +184,9 @@ void WorkManager::Initialize()
         for(unsigned int i=0; i<res.Count(); i++)
         {
             NaturalResource* nr = new NaturalResource;
-
-            nr->sector = res[i].GetInt("loc_sector_id");
-            nr->loc.x  = res[i].GetFloat("loc_x");
-            nr->loc.y  = res[i].GetFloat("loc_y");
-            nr->loc.z  = res[i].GetFloat("loc_z");
-            nr->radius = res[i].GetFloat("radius");
-            nr->visible_radius = res[i].GetFloat("visible_radius");
-            nr->probability = res[i].GetFloat("probability");
-            nr->skill = cacheManager->GetSkillByID(res[i].GetInt("skill"));
-            nr->skill_level = res[i].GetInt("skill_level");
-            nr->item_cat_id = res[i].GetUInt32("item_cat_id");
-            nr->item_quality = res[i].GetFloat("item_quality");
-            nr->anim = res[i]["animation"];
-            nr->anim_duration_seconds = res[i].GetInt("anim_duration_seconds");
-            nr->reward = res[i].GetInt("item_id_reward");
-            nr->reward_nickname = res[i]["reward_nickname"];
-
-            size_t actionNum = resourcesActions.FindCaseInsensitive(res[i]["action"]);
-            if(actionNum == csArrayItemNotFound)
-                actionNum = resourcesActions.Push(res[i]["action"]);
-
-            nr->action = actionNum;
-
+            LoadResource(nr, res[i]);
             resources.Push(nr);
-
+            IndexResource(nr);
         }
     }
     else
@@ -215,6 +196,116 @@ void WorkManager::Initialize()
     }
 }
 
+void WorkManager::ReloadResources()
+{
+    Result res(db->Select("select * from natural_resources"));
+    if(!res.IsValid())
+    {
+        Error2("Database error loading natural_resources: %s\n",
+               db->GetLastError());
+        return;
+    }
+
+    csHash<NaturalResource*, int> oldResources;
+    for(size_t i = 0; i < resources.GetSize(); i++)
+    {
+        oldResources.Put(resources[i]->id, resources[i]);
+    }
+
+    size_t added = 0;
+    size_t updated = 0;
+    csSet<csPtrKey<NaturalResource> > loaded;
+    for(unsigned int i=0; i<res.Count(); i++)
+    {
+        // Update existing resources in place, production events in
+        // progress point to them
+        NaturalResource* nr = oldResources.Get(res[i].GetInt("id"), NULL);
+        if(nr)
+        {
+            for(size_t action = 0; action < resourceIndex.GetSize(); action++)
+            {
+                resourceIndex[action]->Remove(nr);
+            }
+            updated++;
+        }
+        else
+        {
+            nr = new NaturalResource;
+            resources.Push(nr);
+            added++;
+        }
+
+        LoadResource(nr, res[i]);
+        IndexResource(nr);
+        loaded.AddNoTest(nr);
+    }
+
+    // Keep the removed resources around for the events still using them
+    size_t removed = 0;
+    for(size_t i = resources.GetSize(); i-- > 0;)
+    {
+        NaturalResource* nr = resources[i];
+        if(loaded.Contains(nr))
+        {
+            continue;
+        }
+        for(size_t action = 0; action < resourceIndex.GetSize(); action++)
+        {
+            resourceIndex[action]->Remove(nr);
+        }
+        retiredResources.Push(resources.Extract(i));
+        removed++;
+    }
+
+    CPrintf(CON_CMDOUTPUT, "Natural resources reloaded: %zu added, %zu updated, %zu removed.\n",
+            added, updated, removed);
+}
+
+void WorkManager::LoadResource(NaturalResource* nr, iResultRow &row)
+{
+    nr->id     = row.GetInt("id");
+    nr->sector = row.GetInt("loc_sector_id");
+    nr->loc.x  = row.GetFloat("loc_x");
+    nr->loc.y  = row.GetFloat("loc_y");
+    nr->loc.z  = row.GetFloat("loc_z");
+    nr->radius = row.GetFloat("radius");
+    nr->visible_radius = row.GetFloat("visible_radius");
+    nr->probability = row.GetFloat("probability");
+    nr->skill = cacheManager->GetSkillByID(row.GetInt("skill"));
+    nr->skill_level = row.GetInt("skill_level");
+    nr->item_cat_id = row.GetUInt32("item_cat_id");
+    nr->item_quality = row.GetFloat("item_quality");
+    nr->anim = row["animation"];
+    nr->anim_duration_seconds = row.GetInt("anim_duration_seconds");
+    nr->reward = row.GetInt("item_id_reward");
+    nr->reward_nickname = row["reward_nickname"];
+
+    size_t rewardNum = resourcesRewards.FindCaseInsensitive(row["reward_nickname"]);
+    if(rewardNum == csArrayItemNotFound)
+        rewardNum = resourcesRewards.Push(row["reward_nickname"]);
+
+    nr->reward_id = rewardNum;
+
+    size_t actionNum = resourcesActions.FindCaseInsensitive(row["action"]);
+    if(actionNum == csArrayItemNotFound)
+        actionNum = resourcesActions.Push(row["action"]);
+
+    nr->action = actionNum;
+}
+
+void WorkManager::IndexResource(NaturalResource* nr)
+{
+    while(resourceIndex.GetSize() <= nr->action)
+    {
+        resourceIndex.Push(new psSpatialIndex<NaturalResource, int>(RESOURCE_CELL_SIZE));
+    }
+
+    // A resource can only be found within its visible radius
+    csBox2 box(nr->loc.x - nr->visible_radius, nr->loc.z - nr->visible_radius,
+               nr->loc.x + nr->visible_radius, nr->loc.z + nr->visible_radius);
+    resourceIndex[nr->action]->Add(nr, nr->sector, box);
+}
+
 void WorkManager::HandleWorkCommand(MsgEntry* me, Client* client)
 {
     psWorkCmdMessage msg(me);
@@ -727,20 +818,36 @@ csArray<NearNaturalResource> WorkManager::FindNearestResource(iSector* sector, c
 
     Debug2(LOG_TRADE,0, "Finding nearest resource for %s\n", reward ? reward : "any resource");
 
-    for(size_t i = 0; i < resources.GetSize(); i++)
+    size_t rewardId = csArrayItemNotFound;
+    if(reward)
+    {
+        rewardId = resourcesRewards.FindCaseInsensitive(reward);
+        if(rewardId == csArrayItemNotFound)
+        {
+            Debug2(LOG_TRADE,0, "No resource found for %s\n", reward);
+            return nearResources;
+        }
+    }
+
+    // Only the resources of this action in the cell of the player can be close enough
+    csArray<NaturalResource*> candidates;
+    csSet<csPtrKey<NaturalResource> > found;
+    if(action < resourceIndex.GetSize())
+    {
+        resourceIndex[action]->Query(sectorid, csBox2(pos.x, pos.z, pos.x, pos.z), candidates, found);
+    }
+
+    for(size_t i = 0; i < candidates.GetSize(); i++)
     {
-        NaturalResource* curr=resources[i];
-        if(curr->sector==sectorid)
+        NaturalResource* curr = candidates[i];
+        if(!reward || curr->reward_id == rewardId)
         {
-            if(curr->action == action && (!reward || curr->reward_nickname.CompareNoCase(reward)))
+            csVector3 diff = curr->loc - pos;
+            float dist = diff.Norm();
+            // Add the resource if dist is less than radius
+            if(dist < curr->visible_radius)
             {
-                csVector3 diff = curr->loc - pos;
-                float dist = diff.Norm();
-                // Add the resource if dist is less than radius
-                if(dist < curr->visible_radius)
-                {
-                    nearResources.Push(NearNaturalResource(curr,dist));
-                }
+                nearResources.Push(NearNaturalResource(curr,dist));
             }
         }
     }
@@ -1730,27 +1837,38 @@ bool WorkManager::ValidateCombination(csArray<psItem*> itemArray, uint32 &result
     size_t itemCount = itemArray.GetSize();
     if(itemCount != 0)
     {
+        // Combinations are indexed by their sorted ingredients, so only the
+        // combinations made of exactly these items have to be matched
+        csArray<uint32> ingredients;
+        for(size_t i = 0; i < itemCount; i++)
+        {
+            ingredients.InsertSorted(itemArray[i]->GetCurrentStats()->GetUID());
+        }
+
         // Get all possible combinations for those patterns and group
-        csArray<csPDelArray<CombinationConstruction>*> combArray;
-        csArray<csPDelArray<CombinationConstruction>*> combGroupArray;
-        csArray<csPDelArray<CombinationConstruction>*> patternlessArray;
+        csArray<csArray<CombinationConstruction*>*> combArray;
+        csArray<csArray<CombinationConstruction*>*> combGroupArray;
+        csArray<csArray<CombinationConstruction*>*> patternlessArray;
 
 
         for (size_t i = 0; i < patterns.GetSize(); i++)
         {
             //get the combinations for the pattern
-            csPDelArray<CombinationConstruction>* result = cacheManager->FindCombinationsList(patterns.Get(i)->GetId());
+            csArray<CombinationConstruction*>* result = cacheManager->FindCombinationsByIngredients(patterns.Get(i)->GetId(), ingredients);
             if (result) //if it's not null we add it to the valid results
             {
                 combArray.Push(result);
             }
             //get the combinations for the group id
-            result = cacheManager->FindCombinationsList(patterns.Get(i)->GetGroupPatternId());
+            result = cacheManager->FindCombinationsByIngredients(patterns.Get(i)->GetGroupPatternId(), ingredients);
             if (result) //if it's not null we add it to the valid results
             {
                 combGroupArray.Push(result);
             }
-            result = cacheManager->FindCombinationsList(0);
+        }
+        if (!patterns.IsEmpty())
+        {
+            csArray<CombinationConstruction*>* result = cacheManager->FindCombinationsByIngredients(0, ingredients);
             if (result)
             {
                 patternlessArray.Push(result);
@@ -1760,7 +1878,7 @@ bool WorkManager::ValidateCombination(csArray<psItem*> itemArray, uint32 &result
         if(combArray.IsEmpty() && combGroupArray.IsEmpty() && patternlessArray.IsEmpty())
         {
             // Check for group pattern combinations
-            if(secure) psserver->SendSystemInfo(clientNum,"Failed to find any combinations in patterns and groups.");
+            if(secure) psserver->SendSystemInfo(clientNum,"Failed to find any combinations of these items in patterns and groups.");
             return false;
         }
 
@@ -1904,7 +2022,7 @@ bool WorkManager::AnyCombination(csArray<psItem*> itemArray, uint32 &resultId, i
                 for(size_t i=0; i<itemArray.GetSize(); i++)
                 {
                     psItem* item = itemArray.Get(i);
-                    if(uniqueArray->Find(item->GetBaseStats()->GetUID()) == csArrayItemNotFound)
+                    if(uniqueArray->FindSortedKey(csArrayCmp<uint32,uint32>(item->GetBaseStats()->GetUID())) == csArrayItemNotFound)
                     {
                         return false;
                     }
@@ -2307,31 +2425,27 @@ bool WorkManager::IsIngredient(uint32 patternId, uint32 targetId)
         return false;
     }
 
-    // Go through list
-    for(size_t i=0; i<itemArray->GetSize(); i++)
+    // Check item on ingredient list
+    if(itemArray->FindSortedKey(csArrayCmp<uint32,uint32>(targetId)) != csArrayItemNotFound)
     {
-        // Check item on ingredient list
-        if(itemArray->Get(i) == targetId)
+        // Get all unknow item transforms for this pattern
+        csPDelArray<psTradeTransformations>* transArray =
+            cacheManager->FindTransformationsList(patternId, 0);
+        if(transArray == NULL)
         {
-            // Get all unknow item transforms for this pattern
-            csPDelArray<psTradeTransformations>* transArray =
-                cacheManager->FindTransformationsList(patternId, 0);
-            if(transArray == NULL)
-            {
-                if(secure) psserver->SendSystemInfo(clientNum,"No known transformations for this item.");
-                return false;
-            }
+            if(secure) psserver->SendSystemInfo(clientNum,"No known transformations for this item.");
+            return false;
+        }
 
-            // Go through list of transforms
-            for(size_t j=0; j<transArray->GetSize(); j++)
+        // Go through list of transforms
+        for(size_t j=0; j<transArray->GetSize(); j++)
+        {
+            // Get first transform with a 0 process ID this indicates processless any ingredient transform
+            trans = transArray->Get(j);
+            process = NULL;
+            if(trans->GetProcessId() == 0)
             {
-                // Get first transform with a 0 process ID this indicates processless any ingredient transform
-                trans = transArray->Get(j);
-                process = NULL;
-                if(trans->GetProcessId() == 0)
-                {
-                    return true;
-                }
+                return true;
             }
         }
     }
@@ -28,6 +28,7 @@
 //=============================================================================
 // Project Includes
 //=============================================================================
+#include "util/psspatialindex.h"
 
 //=============================================================================
 // Local Includes
@@ -39,6 +40,7 @@ class psWorkGameEvent;
 class WorkManager;
 class psItem;
 class Client;
+class iResultRow;
 struct CombinationConstruction;
 
 // Define the work event types
@@ -101,6 +103,7 @@ enum TradeTransfomType
  */
 struct NaturalResource
 {
+    int          id;                    ///< The id of the resource in the database.
     int          sector;                ///< The id of the sector this resource is in.
     csVector3    loc;                   ///< Centre point of resource location.
     float        radius;                ///< Radius around the centre where resource can be found.
@@ -114,6 +117,7 @@ struct NaturalResource
     int          anim_duration_seconds; ///< Length of time the animation should play.
     int          reward;                ///< Item ID of the reward
     csString     reward_nickname;       ///< Item name of the reward
+    size_t       reward_id;             ///< Id Corresponding to resourcesRewards index.
     size_t       action;                ///< The action you need to take to get this resource.
     ///< Id Corresponding to resourcesActions index.
 };
@@ -317,6 +321,14 @@ public:
     /// Handle production events from super clients
     void HandleProduction(gemActor* actor,const char* type,const char* reward);
 
+    /**
+     * Reload the natural resources from the database.
+     *
+     * Resources are updated in place, removed resources are kept in
+     * memory since production events in progress may still use them.
+     */
+    void ReloadResources();
+
 protected:
     csPDelArray<NaturalResource> resources;       ///< list of all natural resources in game.
     /** List of all actions usable with natural resources.
@@ -324,6 +336,10 @@ protected:
      *        array position of the string is extremely important to be mantained
      */
     csStringArray resourcesActions;
+    csStringArray resourcesRewards;               ///< Interned reward nicknames, same rules as resourcesActions.
+    /// Per action grids of the resources in each sector, indexed like resourcesActions.
+    csPDelArray<psSpatialIndex<NaturalResource, int> > resourceIndex;
+    csPDelArray<NaturalResource> retiredResources; ///< Resources removed by a reload.
     MathScript* calc_repair_rank;                 ///< This is the calculation for how much skill is required to repair.
     MathScript* calc_repair_time;                 ///< This is the calculation for how long a repair takes.
     MathScript* calc_repair_result;               ///< This is the calculation for how many points of quality are added in a repair.
@@ -625,6 +641,12 @@ protected:
 
     void Initialize();
 
+    /// Set the resource from a natural_resources row.
+    void LoadResource(NaturalResource* nr, iResultRow &row);
+
+    /// Add the resource to the grid of its action and sector.
+    void IndexResource(NaturalResource* nr);
+
     /**
       * Calculates the quality of the item based on the skills applied
       */
@@ -52,6 +52,9 @@ void NavGen::PrintHelp()
     csPrintf("  -meshes=dir     set mesh directory     (/planeshift/meshes/)\n");
     csPrintf("  -world=dir      set world directory    (/planeshift/world/)\n");
     csPrintf("  -output=dir     set output directory   (/planeshift/navmesh/)\n");
+    csPrintf("  -cache=dir      set tile cache directory (/planeshift/navmeshcache/)\n");
+    csPrintf("  -threads=n      set number of threads building tiles, 0 for one per core (0)\n");
+    csPrintf("  -rebuild        build all tiles instead of reusing unchanged ones from the cache\n");
 }
 
 void NavGen::Run()
@@ -83,6 +86,19 @@ void NavGen::Run()
     if(output.IsEmpty())
         output = config->GetStr("NavGen.OutputDir", basePath+"navmesh");
 
+    // Built tiles are kept by the hash of their input, so after a world
+    // edit only the tiles that changed are built again.
+    csString cache = cmdline->GetOption("cache");
+    if(cache.IsEmpty())
+        cache = config->GetStr("NavGen.TileCacheDir", basePath+"navmeshcache/");
+
+    bool rebuild = cmdline->GetBoolOption("rebuild", false);
+
+    int threads = config->GetInt("NavGen.Threads", 0);
+    csString threadsOption = cmdline->GetOption("threads");
+    if(!threadsOption.IsEmpty())
+        threads = atoi(threadsOption.GetData());
+
     float height = config->GetFloat("NavGen.Agent.Height", 2.f);
     float width  = config->GetFloat("NavGen.Agent.Width", 0.5f);
     float slope  = config->GetFloat("NavGen.Agent.Slope", 45.f);
@@ -112,6 +128,8 @@ void NavGen::Run()
     csPrintf("NavGen.CellHeight: %f\n", cellHeight);
     csPrintf("NavGen.TileSize: %d\n", tileSize);
     csPrintf("NavGen.BorderSize: %d\n", borderSize);
+    csPrintf("NavGen.TileCacheDir: %s%s\n", cache.GetData(), rebuild ? " (rebuild)" : "");
+    csPrintf("NavGen.Threads: %d\n", threads);
     csPrintf("---\n");
 
     vc->Advance();
@@ -236,6 +254,8 @@ void NavGen::Run()
         parameters->SetCellHeight(cellHeight);
         parameters->SetBorderSize(borderSize);
         builder->SetNavMeshParams(parameters);
+        builder->SetBuildThreads(threads);
+        builder->SetTileCache(vfs, cache, !rebuild);
 
         // get list of loaded sectors
         csRefArray<iSector> sectors;